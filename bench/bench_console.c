@@ -0,0 +1,320 @@
+/**
+ * @file bench_console.c
+ *
+ * @brief Benchmark of console output throughput and cost through printf(), _write() and the UART TX FIFO
+ *
+ * Each workload is run for BENCH_ROUNDS rounds starting from an idle transmitter, and reports:
+ * - cyc/B:     CPU cycles spent in the calls producing the output, per byte
+ * - irq/B:     transmitter interrupts per byte
+ * - peak:      highest TX FIFO level, in bytes
+ * - blk:       writes that had to wait for FIFO space; their wait is included in cyc/B
+ * - line:      share of the line rate achieved from the first call until the last byte left the USART
+ *
+ * The bsp_log() workloads print the same text as their printf() counterparts, except that bsp_log() has no %e, so
+ * the second float is printed with %f.  The BSP_TLOG() workloads log the same values as binary frames, so their byte
+ * count is the saving on the line; pipe the output through tools/bsp_tlog_decode.py to read them.  Only the burst
+ * workload is sized to outrun the TX FIFO.  Run the host build with HAL_SIM_FAST=1, so that waiting for the simulated
+ * line does not count as host cycles.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include "bsp.h"
+#include "bsp_internal.h"
+#include "bsp_log.h"
+#include "bsp_prof.h"
+#include "bsp_tlog.h"
+#include <stddef.h>
+#include <stdlib.h>
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define BENCH_ROUNDS                (4)
+#define BENCH_CHARS                 (512)
+#define BENCH_LINES                 (16)
+#define BENCH_BURST_BYTES           (4096)
+#define BENCH_BURST_LINE_BYTES      (64)
+#define BENCH_NUMBERS               (24)
+
+#define BENCH_UART_BITS_PER_BYTE    (10)
+
+typedef struct
+{
+    const char *name;
+    void (*run)(void);
+    uint32_t bytes;
+    uint64_t cycles;
+    uint64_t elapsed_us;
+    uint32_t irq_count;
+    uint32_t fifo_peak;
+    uint32_t block_count;
+} bench_workload_t;
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static uint8_t bench_burst[BENCH_BURST_BYTES];
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static void bench_run_chars(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BENCH_CHARS; i++)
+    {
+        putchar('a' + (i % 26));
+    }
+
+    return;
+}
+
+static void bench_run_lines(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BENCH_LINES; i++)
+    {
+        printf("The quick brown fox %2lu\r\n", (unsigned long) i);
+    }
+
+    return;
+}
+
+static void bench_run_burst(void)
+{
+    fwrite(bench_burst, 1, sizeof(bench_burst), stdout);
+
+    return;
+}
+
+static void bench_run_ints(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BENCH_NUMBERS; i++)
+    {
+        printf("%ld 0x%08lx\r\n", ((long) i * 7919) - 65536, (unsigned long) (i * 2654435761UL));
+    }
+
+    return;
+}
+
+static void bench_run_floats(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BENCH_NUMBERS; i++)
+    {
+        printf("%.3f %.2e\r\n", (double) i * 0.1234, (double) i * -98765.4321);
+    }
+
+    return;
+}
+
+static void bench_run_log_lines(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BENCH_LINES; i++)
+    {
+        bsp_log("The quick brown fox %2lu\r\n", (unsigned long) i);
+    }
+
+    return;
+}
+
+static void bench_run_log_ints(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BENCH_NUMBERS; i++)
+    {
+        bsp_log("%ld 0x%08lx\r\n", ((long) i * 7919) - 65536, (unsigned long) (i * 2654435761UL));
+    }
+
+    return;
+}
+
+static void bench_run_log_floats(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BENCH_NUMBERS; i++)
+    {
+        bsp_log("%.3f %.2f\r\n", (double) i * 0.1234, (double) i * -98765.4321);
+    }
+
+    return;
+}
+
+static void bench_run_tlog_lines(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BENCH_LINES; i++)
+    {
+        BSP_TLOG("The quick brown fox %2lu\r\n", (unsigned long) i);
+    }
+
+    return;
+}
+
+static void bench_run_tlog_ints(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BENCH_NUMBERS; i++)
+    {
+        BSP_TLOG("%ld 0x%08lx\r\n", ((long) i * 7919) - 65536, (unsigned long) (i * 2654435761UL));
+    }
+
+    return;
+}
+
+static void bench_run_tlog_floats(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BENCH_NUMBERS; i++)
+    {
+        BSP_TLOG("%.3f %.2e\r\n", (double) i * 0.1234, (double) i * -98765.4321);
+    }
+
+    return;
+}
+
+static bench_workload_t bench_workloads[] =
+{
+    { .name = "single chars",       .run = bench_run_chars },
+    { .name = "short lines",        .run = bench_run_lines },
+    { .name = "4 KB burst",         .run = bench_run_burst },
+    { .name = "formatted ints",     .run = bench_run_ints },
+    { .name = "formatted floats",   .run = bench_run_floats },
+    { .name = "bsp_log lines",      .run = bench_run_log_lines },
+    { .name = "bsp_log ints",       .run = bench_run_log_ints },
+    { .name = "bsp_log floats",     .run = bench_run_log_floats },
+    { .name = "BSP_TLOG lines",     .run = bench_run_tlog_lines },
+    { .name = "BSP_TLOG ints",      .run = bench_run_tlog_ints },
+    { .name = "BSP_TLOG floats",    .run = bench_run_tlog_floats },
+};
+
+static void bench_measure(bench_workload_t *workload)
+{
+    uint32_t round;
+
+    for (round = 0; round < BENCH_ROUNDS; round++)
+    {
+        bsp_uart_stats_t stats;
+        uint64_t start_us;
+        uint32_t start;
+
+        bsp_uart_flush();
+        bsp_uart_reset_stats();
+
+        start_us = bsp_tick_now_us();
+        start = bsp_cycles_now();
+        workload->run();
+        bsp_console_flush();
+        workload->cycles += bsp_cycles_now() - start;
+
+        bsp_uart_flush();
+        workload->elapsed_us += bsp_tick_now_us() - start_us;
+
+        bsp_uart_get_stats(&stats);
+        workload->bytes += stats.tx_bytes;
+        workload->irq_count += stats.tx_irq_count;
+        workload->block_count += stats.tx_block_count;
+        if (stats.tx_fifo_peak > workload->fifo_peak)
+        {
+            workload->fifo_peak = stats.tx_fifo_peak;
+        }
+    }
+
+    return;
+}
+
+static void bench_print(const bench_workload_t *workload)
+{
+    uint64_t line_bits = ((uint64_t) BSP_UART_BAUD_RATE * workload->elapsed_us) / 1000000;
+    uint32_t irq_milli = (uint32_t) (((uint64_t) workload->irq_count * 1000) / workload->bytes);
+    uint32_t line_permille = 0;
+
+    if (line_bits != 0)
+    {
+        line_permille = (uint32_t) (((uint64_t) workload->bytes * BENCH_UART_BITS_PER_BYTE * 1000) / line_bits);
+    }
+
+    printf("%-18s %6lu B  cyc/B %6lu  irq/B %lu.%03lu  peak %4lu  blk %4lu  line %3lu.%lu%%\r\n",
+           workload->name,
+           (unsigned long) workload->bytes,
+           (unsigned long) (workload->cycles / workload->bytes),
+           (unsigned long) (irq_milli / 1000),
+           (unsigned long) (irq_milli % 1000),
+           (unsigned long) workload->fifo_peak,
+           (unsigned long) workload->block_count,
+           (unsigned long) (line_permille / 10),
+           (unsigned long) (line_permille % 10));
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+int main(void)
+{
+    uint32_t i;
+
+    bsp_init();
+
+    for (i = 0; i < BENCH_BURST_BYTES; i++)
+    {
+        bench_burst[i] = ((i % BENCH_BURST_LINE_BYTES) == (BENCH_BURST_LINE_BYTES - 2)) ? '\r' :
+                         ((i % BENCH_BURST_LINE_BYTES) == (BENCH_BURST_LINE_BYTES - 1)) ? '\n' :
+                         ('0' + (i % 10));
+    }
+
+    for (i = 0; i < (sizeof(bench_workloads) / sizeof(bench_workloads[0])); i++)
+    {
+        bench_measure(&bench_workloads[i]);
+    }
+
+    printf("\r\nConsole benchmark: %u rounds, %u baud, SystemCoreClock %lu Hz\r\n",
+           BENCH_ROUNDS,
+           BSP_UART_BAUD_RATE,
+           (unsigned long) SystemCoreClock);
+
+    for (i = 0; i < (sizeof(bench_workloads) / sizeof(bench_workloads[0])); i++)
+    {
+        bench_print(&bench_workloads[i]);
+    }
+
+    while (1)
+    {
+        bsp_sleep();
+    }
+
+    exit(1);
+
+    return 0;
+}
@@ -0,0 +1,349 @@
+/**
+ * @file bench_dsp.c
+ *
+ * @brief Benchmark of the q15 DSP kernels against their C references
+ *
+ * Each kernel filters the same BENCH_BLOCK-sample block of a noisy triangle wave through its dual-MAC version and its
+ * reference, from the same starting state, for BENCH_ROUNDS rounds.  The fastest round of each is reported, which
+ * leaves out rounds stretched by an interrupt:
+ * - ref, simd:   CPU cycles per input sample
+ * - speedup:     ref / simd
+ * - check:       whether the two produced identical outputs and end states in every round
+ *
+ * On the host the cycles are host time scaled to SystemCoreClock, see hal_sim_dwt(), so only the check and the order
+ * of magnitude mean anything there.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include "bsp.h"
+#include "bsp_dsp.h"
+#include "bsp_prof.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define BENCH_ROUNDS                (8)
+#define BENCH_BLOCK                 (256)
+
+#define BENCH_FIR_TAPS              (31)
+#define BENCH_DECIM_TAPS            (16)
+#define BENCH_DECIM_FACTOR          (4)
+#define BENCH_BIQUAD_SECTIONS       (2)
+#define BENCH_MAVG_WINDOW           (16)
+
+// Large enough for the longest history plus a block, for any kernel
+#define BENCH_STATE_SAMPLES         (BENCH_FIR_TAPS - 1 + BENCH_BLOCK)
+
+typedef struct
+{
+    const char *name;
+    void (*setup)(void);            ///< Put both kernels in the same starting state
+    void (*run)(bool simd);         ///< One block through one of the kernels into bench_out[simd]
+    bool (*same)(void);             ///< Whether both kernels now hold the same state
+    uint32_t out_count;             ///< Outputs per block
+    uint32_t best[2];               ///< Fewest cycles per round, reference then dual-MAC
+    bool mismatch;
+} bench_kernel_t;
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static int16_t bench_in[BENCH_BLOCK];
+static int16_t bench_out[2][BENCH_BLOCK];
+
+// Triangular taps, 1 up to 16 and back down, summing to just under 1.0
+static const int16_t bench_fir_coeffs[BENCH_FIR_TAPS] =
+{
+    127, 254, 381, 508, 635, 762, 889, 1016, 1143, 1270, 1397, 1524, 1651, 1778, 1905, 2032,
+    1905, 1778, 1651, 1524, 1397, 1270, 1143, 1016, 889, 762, 635, 508, 381, 254, 127,
+};
+
+// Boxcar anti-alias taps for decimation by 4
+static const int16_t bench_decim_coeffs[BENCH_DECIM_TAPS] =
+{
+    [0 ... (BENCH_DECIM_TAPS - 1)] = 2047,
+};
+
+// 4th-order Butterworth low-pass at 50 Hz for 1 kHz sampling, as two q1.14 sections
+static const bsp_dsp_biquad_coeffs_t bench_biquad_coeffs[BENCH_BIQUAD_SECTIONS] =
+{
+    { .b0 = 312, .b1 = 624, .b2 = 312, .a1 = 24243, .a2 = -9107 },
+    { .b0 = 359, .b1 = 717, .b2 = 359, .a1 = 27869, .a2 = -12919 },
+};
+
+// One filter per version, each with its own state
+static int16_t bench_state[2][BENCH_STATE_SAMPLES];
+static bsp_dsp_fir_t bench_fir[2];
+static bsp_dsp_decim_t bench_decim[2];
+static bsp_dsp_biquad_t bench_biquad[2];
+static bsp_dsp_mavg_t bench_mavg[2];
+static bsp_dsp_stats_t bench_stats[2];
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static bool bench_same_state(void)
+{
+    return memcmp(bench_state[0], bench_state[1], sizeof(bench_state[0])) == 0;
+}
+
+static void bench_fir_setup(void)
+{
+    bsp_dsp_fir_init(&bench_fir[0], bench_fir_coeffs, BENCH_FIR_TAPS, bench_state[0], BENCH_BLOCK);
+    bsp_dsp_fir_init(&bench_fir[1], bench_fir_coeffs, BENCH_FIR_TAPS, bench_state[1], BENCH_BLOCK);
+
+    return;
+}
+
+static void bench_fir_run(bool simd)
+{
+    if (simd)
+    {
+        bsp_dsp_fir(&bench_fir[1], bench_in, bench_out[1], BENCH_BLOCK);
+    }
+    else
+    {
+        bsp_dsp_fir_ref(&bench_fir[0], bench_in, bench_out[0], BENCH_BLOCK);
+    }
+
+    return;
+}
+
+static void bench_decim_setup(void)
+{
+    bsp_dsp_decim_init(&bench_decim[0], bench_decim_coeffs, BENCH_DECIM_TAPS, BENCH_DECIM_FACTOR, bench_state[0],
+                       BENCH_BLOCK);
+    bsp_dsp_decim_init(&bench_decim[1], bench_decim_coeffs, BENCH_DECIM_TAPS, BENCH_DECIM_FACTOR, bench_state[1],
+                       BENCH_BLOCK);
+
+    return;
+}
+
+static void bench_decim_run(bool simd)
+{
+    if (simd)
+    {
+        bsp_dsp_decim(&bench_decim[1], bench_in, bench_out[1], BENCH_BLOCK);
+    }
+    else
+    {
+        bsp_dsp_decim_ref(&bench_decim[0], bench_in, bench_out[0], BENCH_BLOCK);
+    }
+
+    return;
+}
+
+static void bench_biquad_setup(void)
+{
+    bsp_dsp_biquad_init(&bench_biquad[0], bench_biquad_coeffs, BENCH_BIQUAD_SECTIONS, bench_state[0]);
+    bsp_dsp_biquad_init(&bench_biquad[1], bench_biquad_coeffs, BENCH_BIQUAD_SECTIONS, bench_state[1]);
+
+    return;
+}
+
+static void bench_biquad_run(bool simd)
+{
+    if (simd)
+    {
+        bsp_dsp_biquad(&bench_biquad[1], bench_in, bench_out[1], BENCH_BLOCK);
+    }
+    else
+    {
+        bsp_dsp_biquad_ref(&bench_biquad[0], bench_in, bench_out[0], BENCH_BLOCK);
+    }
+
+    return;
+}
+
+static void bench_mavg_setup(void)
+{
+    bsp_dsp_mavg_init(&bench_mavg[0], BENCH_MAVG_WINDOW, bench_state[0], BENCH_BLOCK);
+    bsp_dsp_mavg_init(&bench_mavg[1], BENCH_MAVG_WINDOW, bench_state[1], BENCH_BLOCK);
+
+    return;
+}
+
+static void bench_mavg_run(bool simd)
+{
+    if (simd)
+    {
+        bsp_dsp_mavg(&bench_mavg[1], bench_in, bench_out[1], BENCH_BLOCK);
+    }
+    else
+    {
+        bsp_dsp_mavg_ref(&bench_mavg[0], bench_in, bench_out[0], BENCH_BLOCK);
+    }
+
+    return;
+}
+
+static bool bench_mavg_same(void)
+{
+    return bench_same_state() && (bench_mavg[0].sum == bench_mavg[1].sum);
+}
+
+static void bench_stats_setup(void)
+{
+    memset(bench_stats, 0, sizeof(bench_stats));
+
+    return;
+}
+
+static void bench_stats_run(bool simd)
+{
+    if (simd)
+    {
+        bsp_dsp_stats(bench_in, BENCH_BLOCK, &bench_stats[1]);
+    }
+    else
+    {
+        bsp_dsp_stats_ref(bench_in, BENCH_BLOCK, &bench_stats[0]);
+    }
+
+    return;
+}
+
+static bool bench_stats_same(void)
+{
+    return memcmp(&bench_stats[0], &bench_stats[1], sizeof(bench_stats[0])) == 0;
+}
+
+static bench_kernel_t bench_kernels[] =
+{
+    { "fir 31 taps",      bench_fir_setup,    bench_fir_run,    bench_same_state, BENCH_BLOCK },
+    { "decim 16 taps / 4", bench_decim_setup,  bench_decim_run,  bench_same_state, BENCH_BLOCK / BENCH_DECIM_FACTOR },
+    { "biquad 2 sections", bench_biquad_setup, bench_biquad_run, bench_same_state, BENCH_BLOCK },
+    { "mavg 16",          bench_mavg_setup,   bench_mavg_run,   bench_mavg_same,  BENCH_BLOCK },
+    { "stats",            bench_stats_setup,  bench_stats_run,  bench_stats_same, 0 },
+};
+
+/**
+ * Fill the input block with the next stretch of a triangle wave plus noise, both well inside full scale
+ *
+ */
+static void bench_fill_input(void)
+{
+    static uint32_t phase = 0;
+    static uint32_t noise = 1;
+    uint32_t i;
+
+    for (i = 0; i < BENCH_BLOCK; i++)
+    {
+        int32_t ramp = (int32_t) ((phase++ * 512) % 32768) - 16384;
+
+        noise = (noise * 1103515245) + 12345;
+        bench_in[i] = (int16_t) (((ramp < 0) ? -ramp : ramp) * 2 - 16384 + (int32_t) ((noise >> 16) % 4096) - 2048);
+    }
+
+    return;
+}
+
+static void bench_measure(bench_kernel_t *kernel)
+{
+    uint32_t round;
+
+    kernel->best[0] = UINT32_MAX;
+    kernel->best[1] = UINT32_MAX;
+    kernel->setup();
+
+    for (round = 0; round < BENCH_ROUNDS; round++)
+    {
+        uint32_t version;
+
+        bench_fill_input();
+        memset(bench_out, 0, sizeof(bench_out));
+
+        for (version = 0; version < 2; version++)
+        {
+            uint32_t start = bsp_cycles_now();
+            uint32_t cycles;
+
+            kernel->run(version != 0);
+            cycles = bsp_cycles_now() - start;
+            if (cycles < kernel->best[version])
+            {
+                kernel->best[version] = cycles;
+            }
+        }
+
+        if ((memcmp(bench_out[0], bench_out[1], kernel->out_count * sizeof(int16_t)) != 0) || !kernel->same())
+        {
+            kernel->mismatch = true;
+        }
+    }
+
+    return;
+}
+
+static void bench_print(const bench_kernel_t *kernel)
+{
+    uint32_t simd = (kernel->best[1] != 0) ? kernel->best[1] : 1;
+    uint32_t speedup_x100 = (uint32_t) (((uint64_t) kernel->best[0] * 100) / simd);
+
+    printf("%-18s ref %5lu.%02lu  simd %5lu.%02lu cyc/sample  speedup %3lu.%02lu  %s\r\n",
+           kernel->name,
+           (unsigned long) (kernel->best[0] / BENCH_BLOCK),
+           (unsigned long) (((kernel->best[0] % BENCH_BLOCK) * 100) / BENCH_BLOCK),
+           (unsigned long) (kernel->best[1] / BENCH_BLOCK),
+           (unsigned long) (((kernel->best[1] % BENCH_BLOCK) * 100) / BENCH_BLOCK),
+           (unsigned long) (speedup_x100 / 100),
+           (unsigned long) (speedup_x100 % 100),
+           kernel->mismatch ? "MISMATCH" : "match");
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+int main(void)
+{
+    uint32_t i;
+
+    bsp_init();
+
+    for (i = 0; i < (sizeof(bench_kernels) / sizeof(bench_kernels[0])); i++)
+    {
+        bench_measure(&bench_kernels[i]);
+    }
+
+    printf("\r\nDSP benchmark: %u rounds of %u samples, SystemCoreClock %lu Hz\r\n",
+           BENCH_ROUNDS,
+           BENCH_BLOCK,
+           (unsigned long) SystemCoreClock);
+
+    for (i = 0; i < (sizeof(bench_kernels) / sizeof(bench_kernels[0])); i++)
+    {
+        bench_print(&bench_kernels[i]);
+    }
+
+    while (1)
+    {
+        bsp_sleep();
+    }
+
+    exit(1);
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+/**
+ * @file bench_kv.c
+ *
+ * @brief Benchmark of the flash key/value store: write cost, start-up index rebuild and read latency
+ *
+ * The store is formatted, then:
+ * - fill:        BENCH_KEYS keys are written once
+ * - churn:       BENCH_WRITES writes and deletes of random keys and lengths, with a compaction step taken after every
+ *                BENCH_IDLE_EVERY of them as bsp_sleep() would when idle; the head moves on and sectors are compacted
+ *                and erased several times over
+ * - rebuild:     bsp_kv_init() is run again, as at start-up, after the fill and after the churn
+ * - get:         the fastest of BENCH_ROUNDS reads of a stored value, and of a key that is not stored
+ *
+ * Writes and compaction steps are reported as their average and worst time; the worst are the ones that erased a
+ * sector.  After each rebuild every key is read back and checked against a copy kept in RAM.
+ *
+ * The store's sectors are erased: anything kept in them is lost.  On the host the microseconds follow the simulated
+ * flash timing, while the cycles are host time scaled to SystemCoreClock, see hal_sim_dwt(), so only their order of
+ * magnitude means anything there.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include "bsp.h"
+#include "bsp_internal.h"
+#include "bsp_kv.h"
+#include "bsp_prof.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define BENCH_KEYS                  (64)
+#define BENCH_KEY_BASE              (0x1000)
+#define BENCH_VALUE_MAX             (64)
+#define BENCH_WRITES                (8192)
+#define BENCH_IDLE_EVERY            (8)
+#define BENCH_DELETE_ONE_IN         (8)
+#define BENCH_ROUNDS                (64)
+
+typedef struct
+{
+    const char *name;
+    uint32_t count;
+    uint64_t total_us;
+    uint32_t max_us;
+} bench_timing_t;
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+// What the store should hold; a length of 0 means the key is not stored
+static uint8_t bench_values[BENCH_KEYS][BENCH_VALUE_MAX];
+static uint32_t bench_lens[BENCH_KEYS];
+
+static uint8_t bench_buf[BENCH_VALUE_MAX];
+static uint32_t bench_random = 1;
+static uint32_t bench_failures = 0;
+
+static bench_timing_t bench_set = { .name = "set" };
+static bench_timing_t bench_compact = { .name = "compact step" };
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static uint32_t bench_rand(uint32_t range)
+{
+    bench_random = (bench_random * 1103515245) + 12345;
+
+    return (bench_random >> 16) % range;
+}
+
+static void bench_time(bench_timing_t *timing, uint64_t start_us)
+{
+    uint32_t us = (uint32_t) (bsp_tick_now_us() - start_us);
+
+    timing->count++;
+    timing->total_us += us;
+    if (us > timing->max_us)
+    {
+        timing->max_us = us;
+    }
+
+    return;
+}
+
+static void bench_write(uint32_t i)
+{
+    uint64_t start_us;
+    uint32_t ret;
+
+    if ((bench_rand(BENCH_DELETE_ONE_IN) == 0) && (bench_lens[i] != 0))
+    {
+        ret = bsp_kv_delete(BENCH_KEY_BASE + i);
+        bench_lens[i] = 0;
+    }
+    else
+    {
+        bench_lens[i] = 1 + bench_rand(BENCH_VALUE_MAX);
+        for (uint32_t j = 0; j < bench_lens[i]; j++)
+        {
+            bench_values[i][j] = (uint8_t) bench_rand(256);
+        }
+
+        start_us = bsp_tick_now_us();
+        ret = bsp_kv_set(BENCH_KEY_BASE + i, bench_values[i], bench_lens[i]);
+        bench_time(&bench_set, start_us);
+    }
+
+    if (ret != BSP_STATUS_OK)
+    {
+        bench_failures++;
+    }
+
+    return;
+}
+
+/**
+ * Every key must read back as last written, or be missing if it was deleted
+ *
+ */
+static bool bench_check(void)
+{
+    for (uint32_t i = 0; i < BENCH_KEYS; i++)
+    {
+        uint32_t len;
+
+        if (bsp_kv_get(BENCH_KEY_BASE + i, bench_buf, sizeof(bench_buf), &len) != BSP_STATUS_OK)
+        {
+            len = 0;
+        }
+        if ((len != bench_lens[i]) || (memcmp(bench_buf, bench_values[i], len) != 0))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void bench_rebuild(const char *when)
+{
+    uint64_t start_us = bsp_tick_now_us();
+    uint32_t start = bsp_cycles_now();
+    uint32_t cycles;
+    uint32_t us;
+    bsp_kv_stats_t stats;
+
+    bsp_kv_init();
+    cycles = bsp_cycles_now() - start;
+    us = (uint32_t) (bsp_tick_now_us() - start_us);
+
+    bsp_kv_get_stats(&stats);
+    printf("rebuild %-14s %6lu us %9lu cyc  %3lu keys, %6lu live bytes  %s\r\n", when, (unsigned long) us,
+           (unsigned long) cycles, (unsigned long) stats.keys, (unsigned long) stats.live_bytes,
+           bench_check() ? "match" : "MISMATCH");
+
+    return;
+}
+
+static uint32_t bench_get_best(uint32_t key)
+{
+    uint32_t best = UINT32_MAX;
+
+    for (uint32_t round = 0; round < BENCH_ROUNDS; round++)
+    {
+        uint32_t start = bsp_cycles_now();
+        uint32_t cycles;
+
+        bsp_kv_get(key, bench_buf, sizeof(bench_buf), NULL);
+        cycles = bsp_cycles_now() - start;
+        if (cycles < best)
+        {
+            best = cycles;
+        }
+    }
+
+    return best;
+}
+
+static void bench_print(const bench_timing_t *timing)
+{
+    printf("%-22s %6lu  avg %6lu us  max %7lu us\r\n", timing->name, (unsigned long) timing->count,
+           (unsigned long) ((timing->count != 0) ? (timing->total_us / timing->count) : 0),
+           (unsigned long) timing->max_us);
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+int main(void)
+{
+    bsp_kv_stats_t stats;
+    uint32_t cycles;
+    uint32_t i;
+
+    bsp_init();
+
+    printf("\r\nKV benchmark: %u keys, values of 1 to %u bytes, %u writes, SystemCoreClock %lu Hz\r\n",
+           BENCH_KEYS,
+           BENCH_VALUE_MAX,
+           BENCH_WRITES,
+           (unsigned long) SystemCoreClock);
+
+    if (bsp_kv_format() != BSP_STATUS_OK)
+    {
+        printf("format failed\r\n");
+    }
+
+    for (i = 0; i < BENCH_KEYS; i++)
+    {
+        bench_lens[i] = 0;
+        bench_write(i);
+    }
+    bench_print(&bench_set);
+    bench_rebuild("after fill");
+
+    memset(&bench_set, 0, sizeof(bench_set));
+    bench_set.name = "set";
+    for (i = 0; i < BENCH_WRITES; i++)
+    {
+        bench_write(bench_rand(BENCH_KEYS));
+
+        if ((i % BENCH_IDLE_EVERY) == (BENCH_IDLE_EVERY - 1))
+        {
+            uint64_t start_us = bsp_tick_now_us();
+
+            if (bsp_kv_compact_step())
+            {
+                bench_time(&bench_compact, start_us);
+            }
+        }
+    }
+
+    bsp_kv_get_stats(&stats);
+    bench_print(&bench_set);
+    bench_print(&bench_compact);
+    printf("compactions %lu (%lu finished by a write), records copied %lu, failures %lu\r\n",
+           (unsigned long) stats.compactions, (unsigned long) stats.foreground, (unsigned long) stats.copies,
+           (unsigned long) bench_failures);
+    bench_rebuild("after churn");
+
+    // A key still stored, for a hit
+    for (i = 0; (i < (BENCH_KEYS - 1)) && (bench_lens[i] == 0); i++)
+    {
+    }
+    cycles = bench_get_best(BENCH_KEY_BASE + i);
+    printf("get %2lu bytes           %6lu cyc %6lu ns\r\n", (unsigned long) bench_lens[i], (unsigned long) cycles,
+           (unsigned long) bsp_cycles_to_ns(cycles));
+    cycles = bench_get_best(BSP_KV_KEY_MAX);
+    printf("get missing key        %6lu cyc %6lu ns\r\n", (unsigned long) cycles,
+           (unsigned long) bsp_cycles_to_ns(cycles));
+
+    while (1)
+    {
+        bsp_sleep();
+    }
+
+    exit(1);
+
+    return 0;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file bench_timer.c
+ *
+ * @brief Benchmark of timer arm cost and arm-to-fire latency/jitter
+ *
+ * Compares the compare-channel timer service against the previous scheme of re-initialising a timer through the HAL
+ * for every timeout.  The previous scheme is reproduced on TIM4, which nothing else uses, so both can be measured from
+ * the same image.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include "bsp.h"
+#include "bsp_prof.h"
+#include "bsp_timer.h"
+#include <stddef.h>
+#include <stdlib.h>
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define BENCH_ITERATIONS            (100)
+#define BENCH_DELAY_MS              (5)
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static TIM_HandleTypeDef bench_tim4_handle;
+static volatile uint32_t bench_fire_cycles = 0;
+static volatile bool bench_fired = false;
+static volatile uint8_t bench_tim4_state = 0;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static void bench_print(uint32_t slot)
+{
+    bsp_prof_slot_t stats;
+
+    bsp_prof_get(slot, &stats);
+    printf("%-28s min %8lu  avg %8lu  max %8lu  jitter %8lu cycles\r\n",
+           stats.name,
+           (unsigned long) stats.min,
+           (unsigned long) (stats.total / stats.count),
+           (unsigned long) stats.max,
+           (unsigned long) (stats.max - stats.min));
+
+    return;
+}
+
+static void bench_timer_cb(uint32_t status, void *arg)
+{
+    bench_fire_cycles = bsp_cycles_now();
+    bench_fired = true;
+
+    return;
+}
+
+/**
+ * Arm TIM4 the way bsp_set_timer() used to arm TIM2: stop, de-init, re-init and start with update interrupt
+ *
+ */
+static void bench_tim4_reinit_arm(uint32_t delay_ms)
+{
+    HAL_TIM_Base_Stop_IT(&bench_tim4_handle);
+    HAL_TIM_Base_DeInit(&bench_tim4_handle);
+
+    bench_tim4_state = 0;
+    bench_tim4_handle.Init.Period = (delay_ms * 10) - 1;
+    HAL_TIM_Base_Init(&bench_tim4_handle);
+    HAL_TIM_Base_Start_IT(&bench_tim4_handle);
+
+    return;
+}
+
+static void bench_run_reinit(void)
+{
+    uint32_t arm;
+    uint32_t latency;
+    uint32_t delay_cycles = (SystemCoreClock / 1000) * BENCH_DELAY_MS;
+    uint32_t i;
+
+    bsp_prof_register("HAL re-init arm", &arm);
+    bsp_prof_register("HAL re-init arm-to-fire", &latency);
+
+    // TIM4 is on APB1 like TIM2, clocked at SystemCoreClock, counting at 10 kHz as TIM2 used to
+    __HAL_RCC_TIM4_CLK_ENABLE();
+    bench_tim4_handle.Instance = TIM4;
+    bench_tim4_handle.Init.Prescaler = (SystemCoreClock / 10000) - 1;
+    bench_tim4_handle.Init.ClockDivision = 0;
+    bench_tim4_handle.Init.CounterMode = TIM_COUNTERMODE_UP;
+    bench_tim4_handle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    HAL_NVIC_SetPriority(TIM4_IRQn, 0x4, 0);
+    HAL_NVIC_EnableIRQ(TIM4_IRQn);
+
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        uint32_t start;
+
+        bench_fired = false;
+        start = bsp_cycles_now();
+        bench_tim4_reinit_arm(BENCH_DELAY_MS);
+        bsp_prof_stop(arm, start);
+
+        // Sleep rather than spin, as the host simulation only moves time in __WFI(); an expiry between the check and
+        // WFI still wakes the core, as in bsp_set_timer()
+        while (!bench_fired)
+        {
+            __disable_irq();
+            if (!bench_fired)
+            {
+                __WFI();
+            }
+            __enable_irq();
+        }
+        bsp_prof_record(latency, bench_fire_cycles - start - delay_cycles);
+    }
+
+    HAL_NVIC_DisableIRQ(TIM4_IRQn);
+    HAL_TIM_Base_Stop_IT(&bench_tim4_handle);
+
+    bench_print(arm);
+    bench_print(latency);
+
+    return;
+}
+
+static void bench_run_compare(void)
+{
+    uint32_t arm;
+    uint32_t latency;
+    uint32_t delay_cycles = (SystemCoreClock / 1000) * BENCH_DELAY_MS;
+    uint32_t i;
+
+    bsp_prof_register("Compare-channel arm", &arm);
+    bsp_prof_register("Compare-channel arm-to-fire", &latency);
+
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        uint32_t start;
+
+        bench_fired = false;
+        start = bsp_cycles_now();
+        bsp_timer_start(NULL, BENCH_DELAY_MS, 0, bench_timer_cb, NULL);
+        bsp_prof_stop(arm, start);
+
+        // Waits as in bench_run_reinit(), so both include the same wake-up from Sleep
+        while (!bench_fired)
+        {
+            __disable_irq();
+            if (!bench_fired)
+            {
+                __WFI();
+            }
+            __enable_irq();
+        }
+        bsp_prof_record(latency, bench_fire_cycles - start - delay_cycles);
+    }
+
+    bench_print(arm);
+    bench_print(latency);
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+void TIM4_IRQHandler(void)
+{
+    if (__HAL_TIM_GET_FLAG(&bench_tim4_handle, TIM_FLAG_UPDATE))
+    {
+        __HAL_TIM_CLEAR_FLAG(&bench_tim4_handle, TIM_FLAG_UPDATE);
+
+        // The first update interrupt after re-init is the spurious one from the update event HAL_TIM_Base_Init()
+        // generates, exactly as the old TIM2 code had to swallow
+        if (++bench_tim4_state == 2)
+        {
+            __HAL_TIM_DISABLE_IT(&bench_tim4_handle, TIM_IT_UPDATE);
+            bench_timer_cb(BSP_STATUS_OK, NULL);
+        }
+    }
+
+    return;
+}
+
+int main(void)
+{
+    bsp_init();
+
+    printf("\r\nTimer benchmark: %u iterations of %u ms, SystemCoreClock %lu Hz\r\n",
+           BENCH_ITERATIONS,
+           BENCH_DELAY_MS,
+           (unsigned long) SystemCoreClock);
+
+    bench_run_reinit();
+    bench_run_compare();
+
+    while (1)
+    {
+        bsp_sleep();
+    }
+
+    exit(1);
+
+    return 0;
+}
@@ -20,7 +20,15 @@
  * INCLUDES
  **********************************************************************************************************************/
 #include <stdlib.h>
+#include <string.h>
 #include "bsp.h"
+#include "bsp_board.h"
+#include "bsp_event.h"
+#include "bsp_kv.h"
+#include "bsp_led.h"
+#include "bsp_ring.h"
+#include "bsp_timer.h"
+#include "bsp_internal.h"
 #include "stm32f4xx_hal.h"
 #include <stdio.h>
 #include <errno.h>
@@ -30,36 +38,55 @@
  * LOCAL LITERAL SUBSTITUTIONS
  **********************************************************************************************************************/
 #define BSP_EXTI_PB_USER_PRIO                       (0xF)
-#define BSP_TIM2_PREPRIO                            (0x4)
 #define USART2_IRQ_PREPRIO                          (0xE)
-
-#define BSP_TIM2_STATE_RESET                        (0x0)
-#define BSP_TIM2_STATE_FIRST_CB                     (0x1)
-#define BSP_TIM2_STATE_TIMEOUT                      (0x2)
+#define BSP_UART_TX_DMA_PREPRIO                     (0xE)
+#define BSP_UART_RX_DMA_PREPRIO                     (0xE)
 
 #define BSP_UART_TX_BUFFER_SIZE_BYTES               (1024)
 #define BSP_UART_RX_BUFFER_SIZE_BYTES               (128)
 
-typedef struct
-{
-    uint32_t size;
-    uint32_t in_index;
-    uint32_t out_index;
-    uint32_t level;
-    uint32_t level_pending;
-    uint8_t *buffer;
-} bsp_char_fifo_t;
+/**
+ * @brief Size of the static stdout line buffer
+ *
+ * When non-zero, stdout is line buffered: output collects here and is handed to the TX FIFO as one block on '\n', when
+ * the buffer fills, on bsp_console_flush() and before the core sleeps.  Console lines therefore end in "\r\n", which
+ * reaches the FIFO with its line; a "\n\r" ending would leave the '\r' to start the next block.  When zero, stdout is
+ * unbuffered and every putchar() is its own _write().
+ */
+#ifndef BSP_UART_STDOUT_BUFFER_SIZE_BYTES
+#define BSP_UART_STDOUT_BUFFER_SIZE_BYTES           (128)
+#endif
+
+/**
+ * @brief Select how bsp_uart_tx_fifo is drained
+ *
+ * When non-zero, each contiguous block of the TX FIFO is handed to DMA1 Stream6 (USART2_TX, channel 4) and only the
+ * DMA transfer-complete interrupt fires per block.  When zero, blocks are sent with HAL_UART_Transmit_IT(), costing
+ * one USART2 interrupt per byte.
+ */
+#ifndef BSP_UART_TX_DMA
+#define BSP_UART_TX_DMA                             (1)
+#endif
+
+/**
+ * @brief Select how bsp_uart_rx_fifo is filled
+ *
+ * When non-zero, DMA1 Stream5 (USART2_RX, channel 4) runs circularly over bsp_uart_rx_buffer and received data is
+ * published to the RX FIFO in bursts on the USART IDLE-line, DMA half-transfer and DMA transfer-complete events.
+ * When zero, every byte is received with its own HAL_UART_Receive_IT() call.
+ */
+#ifndef BSP_UART_RX_DMA
+#define BSP_UART_RX_DMA                             (1)
+#endif
 
 /***********************************************************************************************************************
  * LOCAL VARIABLES
  **********************************************************************************************************************/
-static volatile int32_t bsp_irq_count = 0;
-
-static bsp_callback_t bsp_timer_cb = NULL;
-static void *bsp_timer_cb_arg = NULL;
-static uint8_t bsp_tim2_state = BSP_TIM2_STATE_RESET;
 static volatile uint32_t timer_callback_counter = 0;
 
+static bsp_timer_handle_t bsp_set_timer_handle = BSP_TIMER_HANDLE_INVALID;
+static volatile bool bsp_set_timer_expired = false;
+
 static bsp_callback_t bsp_user_pb_cb = NULL;
 static void* bsp_user_pb_cb_arg = NULL;
 
@@ -67,16 +94,35 @@ static bsp_callback_t bsp_getchar_cb = NULL;
 static void* bsp_getchar_cb_arg = NULL;
 
 uint8_t bsp_uart_tx_buffer[BSP_UART_TX_BUFFER_SIZE_BYTES] = {0};
-bsp_char_fifo_t bsp_uart_tx_fifo = {0};
+bsp_ring_t bsp_uart_tx_fifo = {0};
 uint8_t bsp_uart_rx_buffer[BSP_UART_RX_BUFFER_SIZE_BYTES] = {0};
-bsp_char_fifo_t bsp_uart_rx_fifo = {0};
+bsp_ring_t bsp_uart_rx_fifo = {0};
+static volatile uint32_t bsp_uart_tx_xfer_size = 0;
+static volatile bool bsp_uart_tx_hold = false;
+static uint32_t bsp_uart_tx_policy = BSP_UART_TX_POLICY_BLOCK;
+#if BSP_UART_RX_DMA
+static volatile uint32_t bsp_uart_rx_restart_count = 0;
+static volatile uint32_t bsp_uart_rx_restart_from = 0;
+static volatile uint32_t bsp_uart_rx_restart_head = 0;
+static uint32_t bsp_uart_rx_restart_seen = 0;
+static uint32_t bsp_uart_rx_flushed_bytes = 0;
+#else
+static uint8_t bsp_uart_rx_it_byte = 0;
+#endif
+// HAL tick from which the console counts as quiet, BSP_POWER_RX_HOLDOFF_MS after the last input
+static volatile uint32_t bsp_uart_rx_quiet_from = 0;
+static bsp_uart_stats_t bsp_uart_stats = {0};
+#if BSP_UART_STDOUT_BUFFER_SIZE_BYTES
+static char bsp_uart_stdout_buffer[BSP_UART_STDOUT_BUFFER_SIZE_BYTES];
+#endif
 
 /***********************************************************************************************************************
  * GLOBAL VARIABLES
  **********************************************************************************************************************/
-TIM_HandleTypeDef tim_drv_handle;
 EXTI_HandleTypeDef exti_user_pb_handle;
 UART_HandleTypeDef uart_drv_handle;
+DMA_HandleTypeDef uart_tx_dma_handle;
+DMA_HandleTypeDef uart_rx_dma_handle;
 
 /***********************************************************************************************************************
  * LOCAL FUNCTIONS
@@ -88,7 +134,7 @@ static void bsp_error_handler(void)
     return;
 }
 
-static void bsp_system_clock_config(void)
+void bsp_system_clock_config(void)
 {
     RCC_OscInitTypeDef RCC_OscInitStruct = {0};
     RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
@@ -156,98 +202,363 @@ static void bsp_system_clock_config(void)
     return;
 }
 
-static void bsp_tim2_init(void)
-{
-    uint32_t uwPrescalerValue;
-    /*##-1- Configure the TIM peripheral #######################################*/
-     /* -----------------------------------------------------------------------
-       In this example TIM2 input clock (TIM2CLK) is set to 2 * APB1 clock (PCLK1),
-       since APB1 prescaler is different from 1.
-         TIM2CLK = 2 * PCLK1
-         PCLK1 = HCLK / 2
-         => TIM2CLK = HCLK = SystemCoreClock
-       To get TIM2 counter clock at 10 KHz, the Prescaler is computed as following:
-       Prescaler = (TIM2CLK / TIM2 counter clock) - 1
-       Prescaler = (SystemCoreClock /10 KHz) - 1
-
-       Note:
-        SystemCoreClock variable holds HCLK frequency and is defined in system_stm32f4xx.c file.
-        Each time the core clock (HCLK) changes, user had to update SystemCoreClock
-        variable value. Otherwise, any configuration based on this variable will be incorrect.
-        This variable is updated in three ways:
-         1) by calling CMSIS function SystemCoreClockUpdate()
-         2) by calling HAL API function HAL_RCC_GetSysClockFreq()
-         3) each time HAL_RCC_ClockConfig() is called to configure the system clock frequency
-     ----------------------------------------------------------------------- */
-
-    /* Compute the prescaler value to have TIM2 counter clock equal to 10 KHz */
-    uwPrescalerValue = (uint32_t) ((SystemCoreClock / 10000) - 1);
-
-    /* Set TIMx instance */
-    tim_drv_handle.Instance = TIM2;
-
-    /* Initialize TIM2 peripheral as follow:
-         + Period = 10000 - 1
-         + Prescaler = ((SystemCoreClock/2)/10000) - 1
-         + ClockDivision = 0
-         + Counter direction = Up
-    */
-    tim_drv_handle.Init.Period = 10000 - 1;
-    tim_drv_handle.Init.Prescaler = uwPrescalerValue;
-    tim_drv_handle.Init.ClockDivision = 0;
-    tim_drv_handle.Init.CounterMode = TIM_COUNTERMODE_UP;
-    tim_drv_handle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+static void bsp_set_timer_blocking_cb(uint32_t status, void *arg)
+{
+    bsp_set_timer_expired = true;
 
     return;
 }
 
-static void bsp_tim2_start(uint32_t delay_100us)
+static void bsp_exti_user_pb_cb(void)
 {
-    tim_drv_handle.Init.Period = delay_100us;
-    if(HAL_TIM_Base_Init(&tim_drv_handle) != HAL_OK)
+    if (bsp_user_pb_cb != NULL)
     {
-        bsp_error_handler();
+        bsp_user_pb_cb(BSP_STATUS_OK, bsp_user_pb_cb_arg);
     }
 
-    if(HAL_TIM_Base_Start_IT(&tim_drv_handle) != HAL_OK)
+    return;
+}
+
+/**
+ * Start transmitting the next contiguous block of bsp_uart_tx_fifo, if the transmitter is idle
+ *
+ * A block runs from the FIFO tail up to either its head or the end of the FIFO buffer, whichever comes first.  Data
+ * that wrapped around to the start of the buffer goes out as the following block.
+ *
+ * The transmitter is the TX FIFO's consumer.  This is only ever called from the main loop while no block is in
+ * flight, or from the completion interrupt of the block in flight, so the two can never run at once.
+ *
+ */
+static void bsp_uart_tx_start_next(void)
+{
+    if ((bsp_uart_tx_xfer_size == 0) && !bsp_uart_tx_hold)
     {
-        bsp_error_handler();
+        uint8_t *tx_ptr;
+        uint32_t tx_size = bsp_ring_peek_contiguous(&bsp_uart_tx_fifo, &tx_ptr);
+
+        if (tx_size > 0)
+        {
+            HAL_StatusTypeDef hal_ret;
+
+            bsp_uart_tx_xfer_size = tx_size;
+#if BSP_UART_TX_DMA
+            hal_ret = HAL_DMA_Start_IT(&uart_tx_dma_handle,
+                                       (uint32_t) (uintptr_t) tx_ptr,
+                                       (uint32_t) (uintptr_t) &(uart_drv_handle.Instance->DR),
+                                       tx_size);
+#else
+            hal_ret = HAL_UART_Transmit_IT(&uart_drv_handle, tx_ptr, tx_size);
+#endif
+            if (hal_ret != HAL_OK)
+            {
+                bsp_error_handler();
+            }
+        }
     }
 
     return;
 }
 
-static void bsp_tim2_stop(void)
+/**
+ * Release the block just transmitted from bsp_uart_tx_fifo and chain the next one
+ *
+ */
+static void bsp_uart_tx_xfer_cplt(void)
 {
-    if(HAL_TIM_Base_Stop_IT(&tim_drv_handle) != HAL_OK)
+    bsp_ring_consume(&bsp_uart_tx_fifo, bsp_uart_tx_xfer_size);
+    bsp_uart_tx_xfer_size = 0;
+
+    bsp_uart_tx_start_next();
+
+    return;
+}
+
+#if BSP_UART_TX_DMA
+static void bsp_uart_tx_dma_cplt_cb(DMA_HandleTypeDef *hdma)
+{
+    bsp_uart_tx_xfer_cplt();
+
+    return;
+}
+
+static void bsp_uart_tx_dma_error_cb(DMA_HandleTypeDef *hdma)
+{
+    bsp_error_handler();
+
+    return;
+}
+#endif
+
+/**
+ * Start (or restart) reception into bsp_uart_rx_fifo
+ *
+ * In DMA mode the DMA always restarts at the start of bsp_uart_rx_buffer, so the FIFO head is moved up to the next
+ * multiple of the buffer size to match.  The reader is told to skip everything before that point, discarding any
+ * unread data, through bsp_uart_rx_restart_*, so that neither side ever writes the other's FIFO index.
+ *
+ */
+static void bsp_uart_rx_start(void)
+{
+    HAL_StatusTypeDef hal_ret;
+
+#if BSP_UART_RX_DMA
+    uint32_t head = bsp_uart_rx_fifo.head;
+
+    bsp_uart_rx_restart_from = head;
+    bsp_uart_rx_restart_head = (head + bsp_uart_rx_fifo.mask) & ~bsp_uart_rx_fifo.mask;
+    bsp_uart_rx_restart_count++;
+    bsp_ring_commit(&bsp_uart_rx_fifo, bsp_uart_rx_restart_head - head);
+
+    hal_ret = HAL_UARTEx_ReceiveToIdle_DMA(&uart_drv_handle, bsp_uart_rx_fifo.buffer, bsp_uart_rx_fifo.size);
+#else
+    hal_ret = HAL_UART_Receive_IT(&uart_drv_handle, &bsp_uart_rx_it_byte, 1);
+#endif
+    if (hal_ret != HAL_OK)
     {
         bsp_error_handler();
     }
 
-    if(HAL_TIM_Base_DeInit(&tim_drv_handle) != HAL_OK)
+    return;
+}
+
+#if BSP_UART_RX_DMA
+/**
+ * Skip the reader past data discarded by a reception restart
+ *
+ * @return true if a restart was pending
+ *
+ * @warning RX FIFO consumer side only
+ *
+ */
+static bool bsp_uart_rx_resync(void)
+{
+    bool ret = false;
+    uint32_t restart_count = bsp_uart_rx_restart_count;
+
+    if (restart_count != bsp_uart_rx_restart_seen)
     {
-        bsp_error_handler();
+        uint32_t from = bsp_uart_rx_restart_from;
+        uint32_t to = bsp_uart_rx_restart_head;
+        uint32_t tail = bsp_uart_rx_fifo.tail;
+
+        bsp_uart_rx_restart_seen = restart_count;
+        if ((int32_t) (from - tail) > 0)
+        {
+            bsp_uart_rx_flushed_bytes += from - tail;
+        }
+        if ((int32_t) (to - tail) > 0)
+        {
+            bsp_ring_consume(&bsp_uart_rx_fifo, to - tail);
+        }
+
+        ret = true;
+    }
+
+    return ret;
+}
+#endif
+
+/**
+ * Notify the getchar callback of newly received data
+ *
+ */
+static void bsp_uart_rx_notify(void)
+{
+    bsp_power_hold_off_stop(BSP_POWER_RX_HOLDOFF_MS);
+    bsp_uart_rx_quiet_from = HAL_GetTick() + BSP_POWER_RX_HOLDOFF_MS;
+
+    if (bsp_getchar_cb != NULL)
+    {
+        bsp_getchar_cb(BSP_STATUS_OK, bsp_getchar_cb_arg);
     }
 
     return;
 }
 
-static void bsp_exti_user_pb_cb(void)
+/**
+ * Account for count bytes just published to bsp_uart_tx_fifo and start a transfer if the transmitter is idle
+ *
+ */
+static void bsp_uart_tx_queued(uint32_t count)
 {
-    if (bsp_user_pb_cb != NULL)
+    uint32_t level = bsp_ring_level(&bsp_uart_tx_fifo);
+
+    bsp_uart_stats.tx_bytes += count;
+    if (level > bsp_uart_stats.tx_fifo_peak)
     {
-        bsp_user_pb_cb(BSP_STATUS_OK, bsp_user_pb_cb_arg);
+        bsp_uart_stats.tx_fifo_peak = level;
     }
 
-    bsp_irq_count++;
+    bsp_uart_tx_start_next();
 
     return;
 }
 
+/**
+ * Copy as much of buf as fits into bsp_uart_tx_fifo and start a transfer if the transmitter is idle
+ *
+ * @return Number of bytes queued
+ *
+ */
+static size_t bsp_uart_tx_fifo_put(const uint8_t *buf, size_t len)
+{
+    size_t count = bsp_ring_write(&bsp_uart_tx_fifo, buf, len);
+
+    // The data is published before the transmitter state is checked, so if a completion interrupt lands in between
+    // it picks the new data up itself
+    if (count > 0)
+    {
+        bsp_uart_tx_queued(count);
+    }
+
+    return count;
+}
+
+/**
+ * Queue all of buf, sleeping until the TX completion interrupt frees space whenever the FIFO is full
+ *
+ * With interrupts masked the FIFO can never drain, so whatever does not fit is dropped instead.
+ *
+ */
+static size_t bsp_uart_tx_write_blocking(const uint8_t *buf, size_t len)
+{
+    size_t count = bsp_uart_tx_fifo_put(buf, len);
+
+    if (count < len)
+    {
+        if (__get_PRIMASK() != 0)
+        {
+            bsp_uart_stats.tx_dropped_bytes += len - count;
+        }
+        else
+        {
+            uint32_t start_tick = HAL_GetTick();
+
+            bsp_uart_stats.tx_block_count++;
+            while (count < len)
+            {
+                // WFI still wakes on a pending interrupt with PRIMASK set, so a completion that lands between the
+                // space check and WFI is not missed
+                __disable_irq();
+                if (bsp_ring_space(&bsp_uart_tx_fifo) == 0)
+                {
+                    __WFI();
+                }
+                __enable_irq();
+
+                count += bsp_uart_tx_fifo_put(buf + count, len - count);
+            }
+            bsp_uart_stats.tx_blocked_ms += HAL_GetTick() - start_tick;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Discard the oldest queued bytes that have not yet been handed to the transmitter
+ *
+ * Bytes of the block currently in flight cannot be discarded, so the newer queued bytes are moved down over the
+ * discarded ones and the FIFO head pulled back.  bsp_uart_tx_hold keeps the completion interrupt from starting a
+ * block on data being moved.
+ *
+ * @return Number of bytes discarded
+ *
+ */
+static uint32_t bsp_uart_tx_discard_oldest(uint32_t count)
+{
+    uint32_t head = bsp_uart_tx_fifo.head;
+    uint32_t pending_index;
+    uint32_t pending;
+    uint32_t primask;
+    uint32_t dst;
+    uint32_t src;
+    uint32_t left;
+
+    bsp_uart_tx_hold = true;
+
+    // tail + xfer_size is unchanged by a completion, which moves the tail forward by exactly xfer_size
+    primask = bsp_critical_enter();
+    pending_index = bsp_uart_tx_fifo.tail + bsp_uart_tx_xfer_size;
+    bsp_critical_exit(primask);
+
+    pending = head - pending_index;
+    if (count > pending)
+    {
+        count = pending;
+    }
+
+    // Moved in contiguous spans, split where the source or the destination wraps; moving downwards in order never
+    // overwrites bytes still to be moved
+    dst = pending_index;
+    src = pending_index + count;
+    left = pending - count;
+    while (left != 0)
+    {
+        uint32_t span = left;
+
+        if (span > (bsp_uart_tx_fifo.size - (dst & bsp_uart_tx_fifo.mask)))
+        {
+            span = bsp_uart_tx_fifo.size - (dst & bsp_uart_tx_fifo.mask);
+        }
+        if (span > (bsp_uart_tx_fifo.size - (src & bsp_uart_tx_fifo.mask)))
+        {
+            span = bsp_uart_tx_fifo.size - (src & bsp_uart_tx_fifo.mask);
+        }
+
+        memmove(&bsp_uart_tx_fifo.buffer[dst & bsp_uart_tx_fifo.mask],
+                &bsp_uart_tx_fifo.buffer[src & bsp_uart_tx_fifo.mask], span);
+        dst += span;
+        src += span;
+        left -= span;
+    }
+    bsp_ring_retract(&bsp_uart_tx_fifo, count);
+
+    bsp_uart_tx_hold = false;
+    bsp_uart_tx_start_next();
+
+    return count;
+}
+
+/**
+ * Queue all of buf, discarding the oldest queued output to make room for it
+ *
+ * If buf is larger than the FIFO space not owned by the block in flight, only its newest bytes are kept.
+ *
+ */
+static size_t bsp_uart_tx_write_overwrite(const uint8_t *buf, size_t len)
+{
+    size_t count = bsp_uart_tx_fifo_put(buf, len);
+
+    if (count < len)
+    {
+        size_t skip = len - count;
+        size_t space;
+
+        bsp_uart_stats.tx_overwritten_bytes += bsp_uart_tx_discard_oldest(skip);
+
+        // Whatever still does not fit is the oldest part of the remainder of buf
+        space = bsp_ring_space(&bsp_uart_tx_fifo);
+        if (skip > space)
+        {
+            skip -= space;
+        }
+        else
+        {
+            skip = 0;
+        }
+        bsp_uart_stats.tx_overwritten_bytes += skip;
+
+        count += bsp_uart_tx_fifo_put(buf + count + skip, len - count - skip);
+    }
+
+    return count;
+}
+
 static void bsp_uart_init(void)
 {
     uart_drv_handle.Instance          = USART2;
-    uart_drv_handle.Init.BaudRate     = 115200;
+    uart_drv_handle.Init.BaudRate     = BSP_UART_BAUD_RATE;
     uart_drv_handle.Init.WordLength   = UART_WORDLENGTH_8B;
     uart_drv_handle.Init.StopBits     = UART_STOPBITS_1;
     uart_drv_handle.Init.Parity       = UART_PARITY_NONE;
@@ -260,21 +571,101 @@ static void bsp_uart_init(void)
         bsp_error_handler();
     }
 
-    bsp_uart_tx_fifo.buffer = bsp_uart_tx_buffer;
-    bsp_uart_tx_fifo.size = BSP_UART_TX_BUFFER_SIZE_BYTES;
+#if BSP_UART_TX_DMA
+    // USART2 requests a DMA transfer on every TXE; the DMA stream itself is only enabled while a block is queued
+    SET_BIT(uart_drv_handle.Instance->CR3, USART_CR3_DMAT);
+#endif
 
-    bsp_uart_rx_fifo.buffer = bsp_uart_rx_buffer;
-    bsp_uart_rx_fifo.size = BSP_UART_RX_BUFFER_SIZE_BYTES;
+    bsp_ring_init(&bsp_uart_tx_fifo, bsp_uart_tx_buffer, BSP_UART_TX_BUFFER_SIZE_BYTES);
+    bsp_ring_init(&bsp_uart_rx_fifo, bsp_uart_rx_buffer, BSP_UART_RX_BUFFER_SIZE_BYTES);
 
     // Setup UART to Receive
-    HAL_UART_Receive_IT(&uart_drv_handle, (bsp_uart_rx_fifo.buffer + bsp_uart_rx_fifo.in_index), 1);
+    bsp_uart_rx_start();
 
+    // A buffered stdin would make getchar() wait to fill its buffer rather than return what has been received
     setvbuf(stdin, NULL, _IONBF, 0);
+#if BSP_UART_STDOUT_BUFFER_SIZE_BYTES
+    setvbuf(stdout, bsp_uart_stdout_buffer, _IOLBF, sizeof(bsp_uart_stdout_buffer));
+#else
     setvbuf(stdout, NULL, _IONBF, 0);
+#endif
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * BSP INTERNAL FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * True once everything queued for the console has left the USART shift register
+ *
+ */
+bool bsp_uart_tx_idle(void)
+{
+    return ((bsp_ring_level(&bsp_uart_tx_fifo) == 0) &&
+            (bsp_uart_tx_xfer_size == 0) &&
+            (__HAL_UART_GET_FLAG(&uart_drv_handle, UART_FLAG_TC) != RESET));
+}
+
+/**
+ * True once no console input has arrived for BSP_POWER_RX_HOLDOFF_MS; until then more is likely to follow
+ *
+ */
+bool bsp_uart_rx_idle(void)
+{
+    return ((int32_t) (HAL_GetTick() - bsp_uart_rx_quiet_from) >= 0);
+}
+
+/**
+ * Publish count bytes written in place past the head of bsp_uart_tx_fifo, and count dropped bytes of a message that
+ * did not fit
+ *
+ * @return count
+ *
+ * @warning Main loop only, as the TX FIFO's producer
+ *
+ */
+size_t bsp_uart_tx_commit(uint32_t count, uint32_t dropped)
+{
+    bsp_uart_stats.tx_dropped_bytes += dropped;
+
+    if (count > 0)
+    {
+        bsp_ring_commit(&bsp_uart_tx_fifo, count);
+        bsp_uart_tx_queued(count);
+    }
+
+    return count;
+}
+
+void bsp_uart_count_tx_irq(void)
+{
+    bsp_uart_stats.tx_irq_count++;
 
     return;
 }
 
+/**
+ * Clock of the timers on APB1 (TIM2 to TIM5) and on APB2 (TIM1, TIM9 to TIM11), at the current clock configuration
+ *
+ * The timers run at twice PCLK whenever their APB is divided down from HCLK.
+ *
+ */
+uint32_t bsp_apb1_timer_hz(void)
+{
+    uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+
+    return ((RCC->CFGR & RCC_CFGR_PPRE1) == RCC_HCLK_DIV1) ? pclk1 : (2 * pclk1);
+}
+
+uint32_t bsp_apb2_timer_hz(void)
+{
+    uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+
+    // The APB2 prescaler field sits 3 bits above the APB1 one, with the same encoding
+    return ((RCC->CFGR & RCC_CFGR_PPRE2) == (RCC_HCLK_DIV1 << 3)) ? pclk2 : (2 * pclk2);
+}
+
 /***********************************************************************************************************************
  * MCU HAL FUNCTIONS
  *
@@ -282,35 +673,23 @@ static void bsp_uart_init(void)
  **********************************************************************************************************************/
 void HAL_MspInit(void)
 {
-    GPIO_InitTypeDef GPIO_InitStruct = {0};
     EXTI_ConfigTypeDef exti_config = {0};
 
     // Enable clocks to ports used
     __HAL_RCC_GPIOA_CLK_ENABLE();
     __HAL_RCC_GPIOC_CLK_ENABLE();
 
-    // Configure the LD2 GPO
-    HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_RESET);
-    GPIO_InitStruct.Pin = GPIO_PIN_5;
-    GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
-    GPIO_InitStruct.Alternate = 0;
-    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
-    GPIO_InitStruct.Pull = GPIO_NOPULL;
-    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+    // LD2 is driven by TIM2 channel 1, see bsp_led.c
+    BSP_PIN_INIT(LD2);
 
     // Configure the User PB GPI
-    GPIO_InitStruct.Pin = GPIO_PIN_13;
-    GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
-    GPIO_InitStruct.Alternate = 0;
-    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
-    GPIO_InitStruct.Pull = GPIO_NOPULL;
-    HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+    BSP_PIN_INIT(USER_PB);
 
     // Configure EXTI for User PB GPI
-    exti_config.Line = EXTI_LINE_13;
+    exti_config.Line = BSP_PIN_EXTI_LINE(USER_PB);
     exti_config.Mode = EXTI_MODE_INTERRUPT;
     exti_config.Trigger = EXTI_TRIGGER_FALLING;
-    exti_config.GPIOSel = EXTI_GPIOC;
+    exti_config.GPIOSel = BSP_PIN_EXTI_PORT(USER_PB);
     HAL_EXTI_SetConfigLine(&exti_user_pb_handle, &exti_config);
     HAL_EXTI_RegisterCallback(&exti_user_pb_handle, HAL_EXTI_COMMON_CB_ID, &bsp_exti_user_pb_cb);
     HAL_NVIC_SetPriority((IRQn_Type) EXTI15_10_IRQn, BSP_EXTI_PB_USER_PRIO, 0x00);
@@ -321,8 +700,8 @@ void HAL_MspInit(void)
 
 void HAL_MspDeInit(void)
 {
-    HAL_GPIO_DeInit(GPIOA, GPIO_PIN_5);
-    HAL_GPIO_DeInit(GPIOC, GPIO_PIN_13);
+    BSP_PIN_DEINIT(LD2);
+    BSP_PIN_DEINIT(USER_PB);
 
     __HAL_RCC_GPIOA_CLK_DISABLE();
     __HAL_RCC_GPIOC_CLK_DISABLE();
@@ -330,65 +709,93 @@ void HAL_MspDeInit(void)
     return;
 }
 
-void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *htim)
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
 {
-    if (htim->Instance == TIM2)
+    if (htim->Instance == TIM5)
     {
-        __HAL_RCC_TIM2_CLK_ENABLE();
-        HAL_NVIC_SetPriority(TIM2_IRQn, BSP_TIM2_PREPRIO, 0);
-        HAL_NVIC_EnableIRQ(TIM2_IRQn);
+        bsp_tick_overflow();
     }
 
     return;
 }
 
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim)
 {
-    if (htim->Instance == TIM2)
+    if ((htim->Instance == TIM5) && (htim->Channel == HAL_TIM_ACTIVE_CHANNEL_2))
     {
-        bsp_tim2_state++;
-        if (bsp_tim2_state == BSP_TIM2_STATE_TIMEOUT)
-        {
-            if(HAL_TIM_Base_Stop_IT(&tim_drv_handle) != HAL_OK)
-            {
-                bsp_error_handler();
-            }
+        __HAL_TIM_DISABLE_IT(htim, TIM_IT_CC2);
 
-            if (bsp_timer_cb != NULL)
-            {
-                bsp_timer_cb(BSP_STATUS_OK, bsp_timer_cb_arg);
-                bsp_timer_cb = NULL;
-                bsp_timer_cb_arg = NULL;
-            }
-        }
+        bsp_timer_expired();
     }
 
-    bsp_irq_count++;
-
     return;
 }
 
 void HAL_UART_MspInit(UART_HandleTypeDef *huart)
 {
-    GPIO_InitTypeDef  GPIO_InitStruct;
-
     __HAL_RCC_GPIOA_CLK_ENABLE();
 
     __HAL_RCC_USART2_CLK_ENABLE();
 
-    GPIO_InitStruct.Pin       = GPIO_PIN_2;
-    GPIO_InitStruct.Mode      = GPIO_MODE_AF_PP;
-    GPIO_InitStruct.Pull      = GPIO_PULLUP;
-    GPIO_InitStruct.Speed     = GPIO_SPEED_FAST;
-    GPIO_InitStruct.Alternate = GPIO_AF7_USART2;
-    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
-
-    GPIO_InitStruct.Pin = GPIO_PIN_3;
-    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+    BSP_PIN_INIT(UART_TX);
+    BSP_PIN_INIT(UART_RX);
 
     HAL_NVIC_SetPriority(USART2_IRQn, USART2_IRQ_PREPRIO, 1);
     HAL_NVIC_EnableIRQ(USART2_IRQn);
 
+#if BSP_UART_TX_DMA
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    // USART2_TX is mapped to DMA1 Stream6, channel 4
+    uart_tx_dma_handle.Instance                 = DMA1_Stream6;
+    uart_tx_dma_handle.Init.Channel             = DMA_CHANNEL_4;
+    uart_tx_dma_handle.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+    uart_tx_dma_handle.Init.PeriphInc           = DMA_PINC_DISABLE;
+    uart_tx_dma_handle.Init.MemInc              = DMA_MINC_ENABLE;
+    uart_tx_dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    uart_tx_dma_handle.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+    uart_tx_dma_handle.Init.Mode                = DMA_NORMAL;
+    uart_tx_dma_handle.Init.Priority            = DMA_PRIORITY_LOW;
+    uart_tx_dma_handle.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&uart_tx_dma_handle) != HAL_OK)
+    {
+        bsp_error_handler();
+    }
+
+    // Only transfer-complete and error are enabled by HAL_DMA_Start_IT() while XferHalfCpltCallback is NULL
+    uart_tx_dma_handle.XferCpltCallback = bsp_uart_tx_dma_cplt_cb;
+    uart_tx_dma_handle.XferHalfCpltCallback = NULL;
+    uart_tx_dma_handle.XferErrorCallback = bsp_uart_tx_dma_error_cb;
+
+    HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, BSP_UART_TX_DMA_PREPRIO, 1);
+    HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+#endif
+
+#if BSP_UART_RX_DMA
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    // USART2_RX is mapped to DMA1 Stream5, channel 4
+    uart_rx_dma_handle.Instance                 = DMA1_Stream5;
+    uart_rx_dma_handle.Init.Channel             = DMA_CHANNEL_4;
+    uart_rx_dma_handle.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+    uart_rx_dma_handle.Init.PeriphInc           = DMA_PINC_DISABLE;
+    uart_rx_dma_handle.Init.MemInc              = DMA_MINC_ENABLE;
+    uart_rx_dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    uart_rx_dma_handle.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+    uart_rx_dma_handle.Init.Mode                = DMA_CIRCULAR;
+    uart_rx_dma_handle.Init.Priority            = DMA_PRIORITY_HIGH;
+    uart_rx_dma_handle.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&uart_rx_dma_handle) != HAL_OK)
+    {
+        bsp_error_handler();
+    }
+
+    __HAL_LINKDMA(huart, hdmarx, uart_rx_dma_handle);
+
+    HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, BSP_UART_RX_DMA_PREPRIO, 1);
+    HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+#endif
+
     return;
 }
 
@@ -397,11 +804,21 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef *huart)
     __HAL_RCC_USART2_FORCE_RESET();
     __HAL_RCC_USART2_RELEASE_RESET();
 
-    HAL_GPIO_DeInit(GPIOA, GPIO_PIN_2);
-    HAL_GPIO_DeInit(GPIOA, GPIO_PIN_3);
+    BSP_PIN_DEINIT(UART_TX);
+    BSP_PIN_DEINIT(UART_RX);
 
     HAL_NVIC_DisableIRQ(USART2_IRQn);
 
+#if BSP_UART_TX_DMA
+    HAL_NVIC_DisableIRQ(DMA1_Stream6_IRQn);
+    HAL_DMA_DeInit(&uart_tx_dma_handle);
+#endif
+
+#if BSP_UART_RX_DMA
+    HAL_NVIC_DisableIRQ(DMA1_Stream5_IRQn);
+    HAL_DMA_DeInit(&uart_rx_dma_handle);
+#endif
+
     return;
 }
 
@@ -409,73 +826,63 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *UartHandle)
 {
     if (UartHandle->Instance == USART2)
     {
-        // Increment out_index by number of chars transferred
-        bsp_uart_tx_fifo.level -= uart_drv_handle.TxXferSize;
-        bsp_uart_tx_fifo.out_index += uart_drv_handle.TxXferSize;
-        if (bsp_uart_tx_fifo.out_index >= BSP_UART_TX_BUFFER_SIZE_BYTES)
-        {
-            bsp_uart_tx_fifo.out_index = 0;
-        }
+        bsp_uart_tx_xfer_cplt();
+    }
 
-        // Check if buffer is empty.  if not, send either:
-        // 1.  number of chars until end of FIFO buffer, or
-        // 2.  total number of chars remaining
-        if (bsp_uart_tx_fifo.level > 0)
-        {
-            uint32_t tx_size = 0;
+    return;
+}
 
-            if (bsp_uart_tx_fifo.in_index < bsp_uart_tx_fifo.out_index)
-            {
-                tx_size = BSP_UART_TX_BUFFER_SIZE_BYTES - bsp_uart_tx_fifo.out_index;
-            }
-            else
-            {
-                tx_size = bsp_uart_tx_fifo.in_index - bsp_uart_tx_fifo.out_index;
-            }
+#if BSP_UART_RX_DMA
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    if (huart->Instance == USART2)
+    {
+        // Size is the offset into bsp_uart_rx_buffer the circular DMA has written up to.  If the DMA has lapped the
+        // reader, the commit overshoots its tail and the reader skips ahead and counts the loss on its next access.
+        uint32_t count = (Size - bsp_uart_rx_fifo.head) & bsp_uart_rx_fifo.mask;
 
-            HAL_UART_Transmit_IT(&uart_drv_handle, (bsp_uart_tx_fifo.buffer + bsp_uart_tx_fifo.out_index), tx_size);
+        if (count > 0)
+        {
+            bsp_ring_commit(&bsp_uart_rx_fifo, count);
+            bsp_uart_rx_notify();
         }
     }
 
-    bsp_irq_count++;
-
     return;
 }
-
+#else
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *UartHandle)
 {
     if (UartHandle->Instance == USART2)
     {
-        // Update fifo
-        bsp_uart_rx_fifo.in_index++;
-        bsp_uart_rx_fifo.in_index %= bsp_uart_rx_fifo.size;
-        bsp_uart_rx_fifo.level++;
-
-        // If fifo is not full
-        if (bsp_uart_rx_fifo.level < bsp_uart_rx_fifo.size)
+        if (bsp_ring_push(&bsp_uart_rx_fifo, bsp_uart_rx_it_byte))
         {
-            HAL_UART_Receive_IT(&uart_drv_handle, (bsp_uart_rx_fifo.buffer + bsp_uart_rx_fifo.in_index), 1);
+            bsp_uart_rx_notify();
         }
-
-        if (bsp_getchar_cb != NULL)
+        else
         {
-            bsp_getchar_cb(BSP_STATUS_OK, bsp_getchar_cb_arg);
+            bsp_uart_stats.rx_overrun_bytes++;
         }
-    }
 
-    bsp_irq_count++;
+        HAL_UART_Receive_IT(&uart_drv_handle, &bsp_uart_rx_it_byte, 1);
+    }
 
     return;
 }
+#endif
 
- void HAL_UART_ErrorCallback(UART_HandleTypeDef *UartHandle)
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *UartHandle)
 {
     if (UartHandle->Instance == USART2)
     {
-        bsp_error_handler();
-    }
+        bsp_uart_stats.rx_errors++;
 
-    bsp_irq_count++;
+        // Blocking errors (overrun, or any error while DMA is receiving) abort the HAL reception, so restart it
+        if (UartHandle->RxState == HAL_UART_STATE_READY)
+        {
+            bsp_uart_rx_start();
+        }
+    }
 
     return;
 }
@@ -487,8 +894,26 @@ uint32_t bsp_init(void)
 {
     HAL_Init();
     bsp_system_clock_config();
-    bsp_tim2_init();
+    bsp_prof_init();
+    bsp_timer_init();
+    if (bsp_led_init() != BSP_STATUS_OK)
+    {
+        bsp_error_handler();
+    }
+    bsp_power_init();
     bsp_uart_init();
+    if (bsp_spi_init() != BSP_STATUS_OK)
+    {
+        bsp_error_handler();
+    }
+    if (bsp_i2c_init() != BSP_STATUS_OK)
+    {
+        bsp_error_handler();
+    }
+    if (bsp_kv_init() != BSP_STATUS_OK)
+    {
+        bsp_error_handler();
+    }
 
     bsp_set_gpio(BSP_GPIO_ID_LD2, BSP_GPIO_LOW);
 
@@ -497,26 +922,32 @@ uint32_t bsp_init(void)
 
 uint32_t bsp_set_timer(uint32_t duration_ms, bsp_callback_t cb, void *cb_arg)
 {
-    bsp_timer_cb = cb;
-    bsp_timer_cb_arg = cb_arg;
-
-    bsp_tim2_stop();
+    uint32_t ret;
 
-    bsp_tim2_state = BSP_TIM2_STATE_RESET;
+    // bsp_set_timer() owns one timer of the timer service and re-arming it replaces the previous timeout
+    bsp_timer_cancel(bsp_set_timer_handle);
 
-    bsp_tim2_start(duration_ms * 10);
     if (cb == NULL)
     {
-        uint8_t temp_tim2_state = BSP_TIM2_STATE_RESET;
-        while (temp_tim2_state != BSP_TIM2_STATE_TIMEOUT)
+        bsp_set_timer_expired = false;
+        ret = bsp_timer_start(&bsp_set_timer_handle, duration_ms, 0, bsp_set_timer_blocking_cb, NULL);
+        while ((ret == BSP_STATUS_OK) && !bsp_set_timer_expired)
         {
+            // As in bsp_uart_tx_write_blocking(), an expiry between the check and WFI still wakes the core
             __disable_irq();
-            temp_tim2_state = bsp_tim2_state;
+            if (!bsp_set_timer_expired)
+            {
+                __WFI();
+            }
             __enable_irq();
         }
     }
+    else
+    {
+        ret = bsp_timer_start(&bsp_set_timer_handle, duration_ms, 0, cb, cb_arg);
+    }
 
-    return BSP_STATUS_OK;
+    return ret;
 }
 
 uint32_t bsp_set_gpio(uint32_t gpio_id, uint8_t gpio_state)
@@ -524,7 +955,8 @@ uint32_t bsp_set_gpio(uint32_t gpio_id, uint8_t gpio_state)
     switch (gpio_id)
     {
         case BSP_GPIO_ID_LD2:
-            HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, (GPIO_PinState) gpio_state);
+            // Stops any pattern playing on LD2
+            bsp_led_set((gpio_state != BSP_GPIO_LOW) ? BSP_LED_ON : BSP_LED_OFF, 0);
             break;
 
         default:
@@ -536,20 +968,25 @@ uint32_t bsp_set_gpio(uint32_t gpio_id, uint8_t gpio_state)
 
 void bsp_sleep(void)
 {
-    __disable_irq();
-    bsp_irq_count--;
+    // Do not leave a partial line in the stdout buffer while idle
+    bsp_console_flush();
 
-    if (bsp_irq_count <= 0)
+    // Compact the key/value store a record at a time, going back to the main loop for events in between
+    if (bsp_kv_compact_step())
     {
-        bsp_irq_count = 0;
-        __enable_irq();
-        __WFI();
+        return;
     }
-    else
+
+    // Sleep with interrupts masked so an event posted after the check still wakes the core, then runs on unmasking
+    __disable_irq();
+
+    if (!bsp_event_pending())
     {
-        __enable_irq();
+        bsp_power_idle();
     }
 
+    __enable_irq();
+
     return;
 }
 
@@ -561,41 +998,64 @@ uint32_t bsp_register_user_pb_cb(bsp_callback_t cb, void *cb_arg)
     return BSP_STATUS_OK;
 }
 
-int __io_putchar(int ch)
+size_t bsp_uart_write_with_policy(const uint8_t *buf, size_t len, uint32_t policy)
 {
-    int ret = ch;
+    size_t count = 0;
 
-    // If buffer is not full
-    if (bsp_uart_tx_fifo.level < bsp_uart_tx_fifo.size)
+    // The TX FIFO has a single producer, the main loop, so writes from interrupt context are dropped
+    if (__get_IPSR() != 0)
     {
-        uint32_t hal_ret;
-
-        // Add ch to buffer
-        bsp_uart_tx_fifo.buffer[bsp_uart_tx_fifo.in_index] = ch;
-
-        //If UART is not currently transmitting, kick off transmiting of buffer with just this single byte
-        hal_ret = HAL_UART_GetState(&uart_drv_handle);
-        if ((hal_ret == HAL_UART_STATE_READY) || (hal_ret == HAL_UART_STATE_BUSY_RX))
-        {
-            hal_ret = HAL_UART_Transmit_IT(&uart_drv_handle, &(bsp_uart_tx_fifo.buffer[bsp_uart_tx_fifo.in_index]), 1);
-            if (hal_ret == HAL_OK)
-            {
-                bsp_uart_tx_fifo.in_index++;
-                bsp_uart_tx_fifo.level++;
-            }
-            else
-            {
-                errno = EIO;
-                ret = EOF;
-            }
-        }
-        else
+        bsp_uart_stats.tx_dropped_bytes += len;
+    }
+    else
+    {
+        switch (policy)
         {
-            bsp_uart_tx_fifo.in_index++;
-            bsp_uart_tx_fifo.level++;
+            case BSP_UART_TX_POLICY_BLOCK:
+                count = bsp_uart_tx_write_blocking(buf, len);
+                break;
+
+            case BSP_UART_TX_POLICY_OVERWRITE_OLDEST:
+                count = bsp_uart_tx_write_overwrite(buf, len);
+                break;
+
+            case BSP_UART_TX_POLICY_DROP_NEWEST:
+            default:
+                count = bsp_uart_tx_fifo_put(buf, len);
+                bsp_uart_stats.tx_dropped_bytes += len - count;
+                break;
         }
     }
-    else
+
+    return count;
+}
+
+size_t bsp_uart_write(const uint8_t *buf, size_t len)
+{
+    return bsp_uart_write_with_policy(buf, len, bsp_uart_tx_policy);
+}
+
+uint32_t bsp_uart_set_tx_policy(uint32_t policy)
+{
+    uint32_t ret = BSP_STATUS_FAIL;
+
+    if ((policy == BSP_UART_TX_POLICY_BLOCK) ||
+        (policy == BSP_UART_TX_POLICY_DROP_NEWEST) ||
+        (policy == BSP_UART_TX_POLICY_OVERWRITE_OLDEST))
+    {
+        bsp_uart_tx_policy = policy;
+        ret = BSP_STATUS_OK;
+    }
+
+    return ret;
+}
+
+int __io_putchar(int ch)
+{
+    int ret = ch;
+    uint8_t c = (uint8_t) ch;
+
+    if (bsp_uart_write(&c, 1) != 1)
     {
         errno = EIO;
         ret = EOF;
@@ -607,22 +1067,32 @@ int __io_putchar(int ch)
 int __io_getchar(void)
 {
     int32_t ret = EOF;
+    uint8_t ch;
+    bool got_ch;
 
-    __disable_irq();
+#if BSP_UART_RX_DMA
+    bool restarted;
 
-    if (bsp_uart_rx_fifo.level > 0)
+    // If reception restarted while the byte was being read, it may be one the restart discarded
+    do
+    {
+        bsp_uart_rx_resync();
+        got_ch = bsp_ring_pop(&bsp_uart_rx_fifo, &ch);
+        restarted = bsp_uart_rx_resync();
+    } while (got_ch && restarted);
+#else
+    got_ch = bsp_ring_pop(&bsp_uart_rx_fifo, &ch);
+#endif
+
+    if (got_ch)
     {
-        ret = bsp_uart_rx_fifo.buffer[bsp_uart_rx_fifo.out_index++];
-        bsp_uart_rx_fifo.out_index %= bsp_uart_rx_fifo.size;
-        bsp_uart_rx_fifo.level--;
+        ret = ch;
     }
     else
     {
         errno = 0;
     }
 
-    __enable_irq();
-
     return ret;
 }
 
@@ -632,4 +1102,74 @@ uint32_t bsp_register_getchar_cb(bsp_callback_t cb, void *cb_arg)
     bsp_getchar_cb_arg = cb_arg;
 
     return BSP_STATUS_OK;
+}
+
+uint32_t bsp_uart_get_stats(bsp_uart_stats_t *stats)
+{
+    uint32_t ret = BSP_STATUS_FAIL;
+
+    if (stats != NULL)
+    {
+        uint32_t primask = bsp_critical_enter();
+
+        *stats = bsp_uart_stats;
+        bsp_critical_exit(primask);
+
+        stats->rx_overrun_bytes += bsp_uart_rx_fifo.dropped;
+#if BSP_UART_RX_DMA
+        stats->rx_overrun_bytes += bsp_uart_rx_flushed_bytes;
+#endif
+
+        ret = BSP_STATUS_OK;
+    }
+
+    return ret;
+}
+
+void bsp_uart_reset_stats(void)
+{
+    uint32_t primask = bsp_critical_enter();
+
+    memset(&bsp_uart_stats, 0, sizeof(bsp_uart_stats));
+    bsp_critical_exit(primask);
+
+    // Both are only written by the main loop, as the RX FIFO's consumer
+    bsp_uart_rx_fifo.dropped = 0;
+#if BSP_UART_RX_DMA
+    bsp_uart_rx_flushed_bytes = 0;
+#endif
+
+    return;
+}
+
+void bsp_console_flush(void)
+{
+#if BSP_UART_STDOUT_BUFFER_SIZE_BYTES
+    fflush(stdout);
+#endif
+
+    return;
+}
+
+void bsp_uart_flush(void)
+{
+    bsp_console_flush();
+
+    // Each block in flight ends with a completion interrupt, as in bsp_uart_tx_write_blocking()
+    while (bsp_ring_level(&bsp_uart_tx_fifo) != 0)
+    {
+        __disable_irq();
+        if (bsp_ring_level(&bsp_uart_tx_fifo) != 0)
+        {
+            __WFI();
+        }
+        __enable_irq();
+    }
+
+    // The last byte leaving the shift register raises no interrupt, but is at most two character times away
+    while (!bsp_uart_tx_idle())
+    {
+    }
+
+    return;
 }
\ No newline at end of file
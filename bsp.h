@@ -51,6 +51,27 @@ extern "C" {
 #define BSP_GPIO_LOW                (0)
 #define BSP_GPIO_HIGH               (1)
 
+/**
+ * @brief Console UART TX backpressure policies, applied when the TX FIFO has no room for a write
+ *
+ * - BLOCK:             sleep with __WFI() until the transmitter frees space; degrades to DROP_NEWEST when called with
+ *                      interrupts masked
+ * - DROP_NEWEST:       discard the part of the write that does not fit
+ * - OVERWRITE_OLDEST:  discard the oldest queued bytes not yet being transmitted to make room
+ *
+ * @see bsp_uart_set_tx_policy, bsp_uart_write_with_policy
+ *
+ */
+#define BSP_UART_TX_POLICY_BLOCK                (0)
+#define BSP_UART_TX_POLICY_DROP_NEWEST          (1)
+#define BSP_UART_TX_POLICY_OVERWRITE_OLDEST     (2)
+
+/**
+ * @brief Console UART line rate; frames are 8N1, so 10 bits per byte
+ *
+ */
+#define BSP_UART_BAUD_RATE                      (115200)
+
 #define BSP_PB_ID_USER                  (0)
 #define BSP_GPIO_ID_LD2                 (0)
 
@@ -72,6 +93,25 @@ extern "C" {
  */
 typedef void (*bsp_callback_t)(uint32_t status, void* arg);
 
+/**
+ * Console UART statistics
+ *
+ * @see bsp_uart_get_stats
+ *
+ */
+typedef struct
+{
+    uint32_t rx_overrun_bytes;      ///< Received bytes lost because the RX FIFO was not read in time
+    uint32_t rx_errors;             ///< Overrun/framing/noise errors reported by USART2
+    uint32_t tx_dropped_bytes;      ///< Bytes discarded as they did not fit (DROP_NEWEST) or came from an ISR
+    uint32_t tx_overwritten_bytes;  ///< Queued bytes discarded to make room for newer output (OVERWRITE_OLDEST)
+    uint32_t tx_block_count;        ///< Writes that had to wait for FIFO space (BLOCK)
+    uint32_t tx_blocked_ms;         ///< Total time spent waiting for FIFO space (BLOCK)
+    uint32_t tx_bytes;              ///< Bytes queued for transmission
+    uint32_t tx_irq_count;          ///< Interrupts taken by the transmitter, per block with DMA or per byte without
+    uint32_t tx_fifo_peak;          ///< Highest TX FIFO level seen, in bytes
+} bsp_uart_stats_t;
+
 /***********************************************************************************************************************
  * GLOBAL VARIABLES
  **********************************************************************************************************************/
@@ -84,6 +124,55 @@ uint32_t bsp_set_timer(uint32_t duration_ms, bsp_callback_t cb, void *cb_arg);
 uint32_t bsp_set_gpio(uint32_t gpio_id, uint8_t gpio_state);
 uint32_t bsp_register_user_pb_cb(bsp_callback_t cb, void *cb_arg);
 uint32_t bsp_register_getchar_cb(bsp_callback_t cb, void *cb_arg);
+
+/**
+ * Queue a buffer for transmission on the console UART
+ *
+ * The buffer is copied into the UART TX FIFO in at most two blocks and at most one transfer is started.  If the FIFO
+ * has no room, the policy set with bsp_uart_set_tx_policy() applies.
+ *
+ * @param [in] buf              Bytes to transmit
+ * @param [in] len              Number of bytes in buf
+ *
+ * @return Number of bytes of buf queued; any shortfall was discarded and counted in bsp_uart_stats_t
+ *
+ * @warning The TX FIFO has a single producer: call from the main loop only.  Writes from interrupt context are
+ *          discarded and counted as dropped.
+ *
+ */
+size_t bsp_uart_write(const uint8_t *buf, size_t len);
+size_t bsp_uart_write_with_policy(const uint8_t *buf, size_t len, uint32_t policy);
+uint32_t bsp_uart_set_tx_policy(uint32_t policy);
+uint32_t bsp_uart_get_stats(bsp_uart_stats_t *stats);
+void bsp_uart_reset_stats(void);
+
+/**
+ * Hand any partial line in the stdout buffer to the TX FIFO as one block, without waiting for it to be sent
+ *
+ * stdout is line buffered, while bsp_uart_write(), bsp_log() and BSP_TLOG() go straight to the TX FIFO: call this
+ * before mixing them within a line.  Reading stdin and bsp_sleep() flush stdout too.
+ *
+ * @warning Call from the main loop only
+ *
+ */
+void bsp_console_flush(void);
+
+/**
+ * Wait until everything queued for the console, including the stdout buffer, has left the USART, sleeping while
+ * blocks are in flight
+ *
+ * @warning Call from the main loop with interrupts enabled
+ *
+ */
+void bsp_uart_flush(void);
+
+/**
+ * Sleep until an interrupt, unless an event is pending; a pending compaction step of the key/value store is taken
+ * instead, see bsp_kv_compact_step()
+ *
+ * @warning Call from the main loop, once it has dispatched every event
+ *
+ */
 void bsp_sleep(void);
 
 /**********************************************************************************************************************/
@@ -0,0 +1,379 @@
+/**
+ * @file bsp_adc.c
+ *
+ * @brief Implementation of continuous ADC1 acquisition, see bsp_adc.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include "bsp_adc.h"
+#include "bsp_internal.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define BSP_ADC_DMA_PREPRIO             (0x8)
+
+// ADC1 runs at PCLK2 / 4, 21 MHz with the 84 MHz clock tree, inside its 36 MHz limit
+#define BSP_ADC_CLOCK_DIV               (4)
+
+// Successive approximation of 12 bits, added to the sampling time of every conversion
+#define BSP_ADC_CONVERSION_CYCLES       (12)
+
+// The temperature sensor and VREFINT need at least 10 us of sampling
+#define BSP_ADC_INTERNAL_SAMPLE_CYCLES  (480)
+
+// Longest buffer, set by the 16-bit DMA transfer count
+#define BSP_ADC_BUFFER_MAX              (0xFFFF)
+
+// Channels 2, 3 and 5 are on PA2, PA3 and PA5, taken by USART2 and LD2; 16 is not connected on the F401
+#define BSP_ADC_CHANNELS_VALID          ((0xFFFFU & ~((1U << 2) | (1U << 3) | (1U << 5))) | \
+                                         (1U << BSP_ADC_CHANNEL_VREFINT) | (1U << BSP_ADC_CHANNEL_TEMP))
+
+#if BSP_ADC_SAMPLE_CYCLES == 3
+#define BSP_ADC_SAMPLETIME              ADC_SAMPLETIME_3CYCLES
+#elif BSP_ADC_SAMPLE_CYCLES == 15
+#define BSP_ADC_SAMPLETIME              ADC_SAMPLETIME_15CYCLES
+#elif BSP_ADC_SAMPLE_CYCLES == 28
+#define BSP_ADC_SAMPLETIME              ADC_SAMPLETIME_28CYCLES
+#elif BSP_ADC_SAMPLE_CYCLES == 56
+#define BSP_ADC_SAMPLETIME              ADC_SAMPLETIME_56CYCLES
+#elif BSP_ADC_SAMPLE_CYCLES == 84
+#define BSP_ADC_SAMPLETIME              ADC_SAMPLETIME_84CYCLES
+#elif BSP_ADC_SAMPLE_CYCLES == 112
+#define BSP_ADC_SAMPLETIME              ADC_SAMPLETIME_112CYCLES
+#elif BSP_ADC_SAMPLE_CYCLES == 144
+#define BSP_ADC_SAMPLETIME              ADC_SAMPLETIME_144CYCLES
+#elif BSP_ADC_SAMPLE_CYCLES == 480
+#define BSP_ADC_SAMPLETIME              ADC_SAMPLETIME_480CYCLES
+#else
+#error "BSP_ADC_SAMPLE_CYCLES must be one of 3, 15, 28, 56, 84, 112, 144 or 480"
+#endif
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static TIM_HandleTypeDef bsp_adc_trigger_handle;
+
+static bool bsp_adc_running = false;
+static bsp_callback_t bsp_adc_cb = NULL;
+static void *bsp_adc_cb_arg = NULL;
+static uint16_t *bsp_adc_blocks[2];
+static const uint16_t *bsp_adc_block = NULL;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+ADC_HandleTypeDef adc_drv_handle;
+DMA_HandleTypeDef adc_dma_handle;
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static bool bsp_adc_is_internal(uint8_t channel)
+{
+    return ((channel == BSP_ADC_CHANNEL_VREFINT) || (channel == BSP_ADC_CHANNEL_TEMP));
+}
+
+/**
+ * Put the pin of an external channel in analog mode: IN0-7 are PA0-7, IN8-9 PB0-1 and IN10-15 PC0-5
+ *
+ */
+static void bsp_adc_pin_init(uint8_t channel)
+{
+    GPIO_InitTypeDef gpio_init = {0};
+    GPIO_TypeDef *port;
+
+    if (channel < 8)
+    {
+        port = GPIOA;
+        gpio_init.Pin = 1U << channel;
+    }
+    else if (channel < 10)
+    {
+        __HAL_RCC_GPIOB_CLK_ENABLE();
+        port = GPIOB;
+        gpio_init.Pin = 1U << (channel - 8);
+    }
+    else
+    {
+        port = GPIOC;
+        gpio_init.Pin = 1U << (channel - 10);
+    }
+    gpio_init.Mode = GPIO_MODE_ANALOG;
+    gpio_init.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init(port, &gpio_init);
+
+    return;
+}
+
+/**
+ * Program the regular sequence, one rank per channel of the scan
+ *
+ */
+static uint32_t bsp_adc_sequence_init(const bsp_adc_stream_t *stream)
+{
+    ADC_ChannelConfTypeDef channel_conf = {0};
+    uint32_t i;
+
+    for (i = 0; i < stream->channel_count; i++)
+    {
+        uint8_t channel = stream->channels[i];
+
+        if (channel == BSP_ADC_CHANNEL_VREFINT)
+        {
+            channel_conf.Channel = ADC_CHANNEL_VREFINT;
+        }
+        else if (channel == BSP_ADC_CHANNEL_TEMP)
+        {
+            channel_conf.Channel = ADC_CHANNEL_TEMPSENSOR;
+        }
+        else
+        {
+            // ADC_CHANNEL_0 to ADC_CHANNEL_15 are the channel numbers themselves
+            channel_conf.Channel = channel;
+            bsp_adc_pin_init(channel);
+        }
+        channel_conf.Rank = i + 1;
+        channel_conf.SamplingTime = bsp_adc_is_internal(channel) ? ADC_SAMPLETIME_480CYCLES : BSP_ADC_SAMPLETIME;
+
+        // Configuring either internal channel also powers up the temperature sensor and VREFINT
+        if (HAL_ADC_ConfigChannel(&adc_drv_handle, &channel_conf) != HAL_OK)
+        {
+            return BSP_STATUS_FAIL;
+        }
+    }
+
+    return BSP_STATUS_OK;
+}
+
+/**
+ * Set TIM3 to emit one trigger output pulse per scan period, on its update event
+ *
+ */
+static uint32_t bsp_adc_trigger_init(uint32_t scan_rate_hz)
+{
+    TIM_MasterConfigTypeDef master_conf = {0};
+    uint32_t ticks = bsp_apb1_timer_hz() / scan_rate_hz;
+    uint32_t prescaler = (ticks - 1) / 0x10000;
+
+    __HAL_RCC_TIM3_CLK_ENABLE();
+
+    // The smallest prescaler that fits the period in 16 bits, for the finest rate resolution
+    bsp_adc_trigger_handle.Instance = TIM3;
+    bsp_adc_trigger_handle.Init.Prescaler = prescaler;
+    bsp_adc_trigger_handle.Init.Period = (ticks / (prescaler + 1)) - 1;
+    bsp_adc_trigger_handle.Init.ClockDivision = 0;
+    bsp_adc_trigger_handle.Init.CounterMode = TIM_COUNTERMODE_UP;
+    bsp_adc_trigger_handle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_Base_Init(&bsp_adc_trigger_handle) != HAL_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    master_conf.MasterOutputTrigger = TIM_TRGO_UPDATE;
+    master_conf.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+    if (HAL_TIMEx_MasterConfigSynchronization(&bsp_adc_trigger_handle, &master_conf) != HAL_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    return BSP_STATUS_OK;
+}
+
+static void bsp_adc_block_done(uint32_t half)
+{
+    bsp_adc_block = bsp_adc_blocks[half];
+    if (bsp_adc_cb != NULL)
+    {
+        bsp_adc_cb(BSP_STATUS_OK, bsp_adc_cb_arg);
+    }
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * BSP INTERNAL FUNCTIONS
+ **********************************************************************************************************************/
+bool bsp_adc_stream_running(void)
+{
+    return bsp_adc_running;
+}
+
+/***********************************************************************************************************************
+ * MCU HAL FUNCTIONS
+ **********************************************************************************************************************/
+void HAL_ADC_MspInit(ADC_HandleTypeDef *hadc)
+{
+    __HAL_RCC_ADC1_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    // ADC1 is mapped to DMA2 Stream4, channel 0
+    adc_dma_handle.Instance                 = DMA2_Stream4;
+    adc_dma_handle.Init.Channel             = DMA_CHANNEL_0;
+    adc_dma_handle.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+    adc_dma_handle.Init.PeriphInc           = DMA_PINC_DISABLE;
+    adc_dma_handle.Init.MemInc              = DMA_MINC_ENABLE;
+    adc_dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    adc_dma_handle.Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
+    adc_dma_handle.Init.Mode                = DMA_CIRCULAR;
+    adc_dma_handle.Init.Priority            = DMA_PRIORITY_HIGH;
+    adc_dma_handle.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&adc_dma_handle) != HAL_OK)
+    {
+        // Left unlinked, which bsp_adc_stream_start() reports
+        return;
+    }
+    __HAL_LINKDMA(hadc, DMA_Handle, adc_dma_handle);
+
+    HAL_NVIC_SetPriority(DMA2_Stream4_IRQn, BSP_ADC_DMA_PREPRIO, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream4_IRQn);
+
+    // Only for overrun, which stops the stream
+    HAL_NVIC_SetPriority(ADC_IRQn, BSP_ADC_DMA_PREPRIO, 0);
+    HAL_NVIC_EnableIRQ(ADC_IRQn);
+
+    return;
+}
+
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    bsp_adc_block_done(0);
+
+    return;
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    bsp_adc_block_done(1);
+
+    return;
+}
+
+void HAL_ADC_ErrorCallback(ADC_HandleTypeDef *hadc)
+{
+    bsp_callback_t cb = bsp_adc_cb;
+
+    bsp_adc_stream_stop();
+    if (cb != NULL)
+    {
+        cb(BSP_STATUS_FAIL, bsp_adc_cb_arg);
+    }
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+uint32_t bsp_adc_stream_start(const bsp_adc_stream_t *stream)
+{
+    uint64_t scan_cycles = 0;
+    uint32_t block_samples;
+    uint32_t i;
+
+    if (bsp_adc_running || (stream == NULL) || (stream->channels == NULL) || (stream->channel_count == 0) ||
+        (stream->channel_count > BSP_ADC_SCAN_MAX) || (stream->buffer == NULL) || (stream->block_scans == 0) ||
+        (stream->scan_rate_hz == 0) || (stream->scan_rate_hz > bsp_apb1_timer_hz()) ||
+        ((uint64_t) 2 * stream->block_scans * stream->channel_count > BSP_ADC_BUFFER_MAX))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    for (i = 0; i < stream->channel_count; i++)
+    {
+        uint8_t channel = stream->channels[i];
+
+        if ((channel > BSP_ADC_CHANNEL_TEMP) || ((BSP_ADC_CHANNELS_VALID & (1U << channel)) == 0))
+        {
+            return BSP_STATUS_FAIL;
+        }
+        scan_cycles += (bsp_adc_is_internal(channel) ? BSP_ADC_INTERNAL_SAMPLE_CYCLES : BSP_ADC_SAMPLE_CYCLES) +
+                       BSP_ADC_CONVERSION_CYCLES;
+    }
+
+    // A trigger arriving mid-scan is ignored, so every scan must finish within one scan period
+    if ((scan_cycles * stream->scan_rate_hz) > (HAL_RCC_GetPCLK2Freq() / BSP_ADC_CLOCK_DIV))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    adc_drv_handle.Instance = ADC1;
+    adc_drv_handle.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+    adc_drv_handle.Init.Resolution = ADC_RESOLUTION_12B;
+    adc_drv_handle.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+    adc_drv_handle.Init.ScanConvMode = ENABLE;
+    adc_drv_handle.Init.ContinuousConvMode = DISABLE;
+    adc_drv_handle.Init.DiscontinuousConvMode = DISABLE;
+    adc_drv_handle.Init.NbrOfDiscConversion = 0;
+    adc_drv_handle.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+    adc_drv_handle.Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T3_TRGO;
+    adc_drv_handle.Init.NbrOfConversion = stream->channel_count;
+    // DMA requests carry on past the end of the buffer, which the circular stream wraps to the start
+    adc_drv_handle.Init.DMAContinuousRequests = ENABLE;
+    adc_drv_handle.Init.EOCSelection = ADC_EOC_SEQ_CONV;
+    if ((HAL_ADC_Init(&adc_drv_handle) != HAL_OK) || (adc_drv_handle.DMA_Handle == NULL) ||
+        (bsp_adc_sequence_init(stream) != BSP_STATUS_OK) ||
+        (bsp_adc_trigger_init(stream->scan_rate_hz) != BSP_STATUS_OK))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    block_samples = stream->block_scans * stream->channel_count;
+    bsp_adc_blocks[0] = stream->buffer;
+    bsp_adc_blocks[1] = stream->buffer + block_samples;
+    bsp_adc_block = NULL;
+    bsp_adc_cb = stream->cb;
+    bsp_adc_cb_arg = stream->cb_arg;
+
+    if (HAL_ADC_Start_DMA(&adc_drv_handle, (uint32_t *) stream->buffer, 2 * block_samples) != HAL_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    bsp_power_lock_stop();
+    bsp_adc_running = true;
+
+    // Scans only start on the trigger, so the timer goes last
+    HAL_TIM_Base_Start(&bsp_adc_trigger_handle);
+
+    return BSP_STATUS_OK;
+}
+
+void bsp_adc_stream_stop(void)
+{
+    uint32_t primask = bsp_critical_enter();
+
+    if (bsp_adc_running)
+    {
+        HAL_TIM_Base_Stop(&bsp_adc_trigger_handle);
+        HAL_ADC_Stop_DMA(&adc_drv_handle);
+        bsp_power_unlock_stop();
+        bsp_adc_running = false;
+        bsp_adc_cb = NULL;
+    }
+
+    bsp_critical_exit(primask);
+
+    return;
+}
+
+const uint16_t *bsp_adc_stream_block(void)
+{
+    return bsp_adc_block;
+}
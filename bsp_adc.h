@@ -0,0 +1,146 @@
+/**
+ * @file bsp_adc.h
+ *
+ * @brief Continuous ADC1 acquisition: timer-triggered scans written by DMA into a ping-pong buffer
+ *
+ * TIM3 triggers one scan of the configured channels at a fixed rate and DMA2 Stream4 writes each conversion into the
+ * caller's buffer, going round it for ever.  The buffer is two blocks of block_scans scans each.  When DMA fills one
+ * block the stream callback is called and the block can be read while DMA fills the other, so the core is only
+ * involved twice per buffer, never per sample.
+ *
+ * TIM3, ADC1 and DMA are not clocked in STOP, so STOP is held off while a stream runs.  TIM3 is also used by
+ * bench/bench_timer.c, which never starts a stream.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_ADC_H
+#define BSP_ADC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdint.h>
+#include "bsp.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief Channel numbers for the internal sources; external channels 0 to 15 are ADC1_IN0 to ADC1_IN15
+ *
+ * Channels 2, 3 and 5 are on the pins of USART2 and LD2 and cannot be streamed.
+ *
+ */
+#define BSP_ADC_CHANNEL_VREFINT         (17)
+#define BSP_ADC_CHANNEL_TEMP            (18)
+
+/**
+ * @brief Most channels in a scan, the length of the ADC regular sequence
+ *
+ */
+#define BSP_ADC_SCAN_MAX                (16)
+
+/**
+ * @brief Full-scale value of a sample, at 12-bit resolution
+ *
+ */
+#define BSP_ADC_FULL_SCALE              (4095)
+
+/**
+ * @brief Sampling time of the external channels, in ADC clock cycles: one of 3, 15, 28, 56, 84, 112, 144 or 480
+ *
+ * The temperature sensor and VREFINT need 10 us and always take 480 cycles.
+ *
+ */
+#ifndef BSP_ADC_SAMPLE_CYCLES
+#define BSP_ADC_SAMPLE_CYCLES           (56)
+#endif
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * A stream of scans
+ *
+ * Samples are stored as they are converted, scan after scan, in the order of channels: a block is block_scans rows of
+ * channel_count samples.
+ *
+ * @see bsp_adc_stream_start
+ *
+ */
+typedef struct
+{
+    const uint8_t *channels;        ///< Channels of each scan, in order; a channel may appear more than once
+    uint32_t channel_count;         ///< Channels per scan, 1 to BSP_ADC_SCAN_MAX
+    uint32_t scan_rate_hz;          ///< Scans per second
+    uint16_t *buffer;               ///< Room for 2 * block_scans * channel_count samples, written by DMA
+    uint32_t block_scans;           ///< Scans per block, i.e. per callback
+    bsp_callback_t cb;              ///< Called from the DMA interrupt with BSP_STATUS_OK for each block completed
+    void *cb_arg;                   ///< Passed to cb
+} bsp_adc_stream_t;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Start sampling continuously until bsp_adc_stream_stop()
+ *
+ * The first scan is taken one scan period after the call.
+ *
+ * The callback runs in interrupt context, once per block, and reads the block through bsp_adc_stream_block().  It
+ * has one block period to finish with the block before DMA comes back round to it, so anything lengthy belongs in the
+ * main loop, e.g. by copying the block out or posting an event.  If the ADC overruns, because DMA could not keep up,
+ * the stream stops and the callback is called once more with BSP_STATUS_FAIL.
+ *
+ * @param [in] stream           Stream to start; the channel list may go out of scope on return, the buffer may not
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if a stream is already running, a channel cannot be streamed, the buffer
+ *         is larger than one DMA transfer or the ADC cannot convert a scan in one scan period
+ *
+ */
+uint32_t bsp_adc_stream_start(const bsp_adc_stream_t *stream);
+
+/**
+ * Stop the stream, if one is running; no callback is called once this returns
+ *
+ */
+void bsp_adc_stream_stop(void);
+
+/**
+ * The block most recently completed, or NULL if none has been since the stream started
+ *
+ * @return block_scans * channel_count samples, valid until DMA returns to them one block period after the callback
+ *
+ */
+const uint16_t *bsp_adc_stream_block(void);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_ADC_H
@@ -0,0 +1,164 @@
+/**
+ * @file bsp_board.h
+ *
+ * @brief Board description for the Nucleo-F401RE: every pin the BSP uses, resolved to registers at compile time
+ *
+ * Each pin is described once, below, by port letter, pin number and its GPIO configuration.  The BSP_PIN_*() macros
+ * take the pin's name and expand to constant register addresses and masks, so with no lookup and no HAL call:
+ * - BSP_PIN_SET(), BSP_PIN_CLEAR() and BSP_PIN_WRITE() are a single store to the port's BSRR
+ * - BSP_PIN_TOGGLE() is one ODR load and one BSRR store
+ * - bsp_gpio_write_port() sets and clears any pins of one port together in a single BSRR store
+ * BSRR stores are atomic, so none of these need a critical section against interrupts driving other pins.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_BOARD_H
+#define BSP_BOARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief Board pin table
+ *
+ * The pin number must be a plain decimal literal, as it is pasted into GPIO_PIN_<n> and EXTI_LINE_<n>.
+ *
+ */
+//                          port  pin  mode                   pull          speed                       alternate
+#define BSP_PIN_LD2         A,    5,   GPIO_MODE_AF_PP,       GPIO_NOPULL,  GPIO_SPEED_FREQ_LOW,        GPIO_AF1_TIM2
+#define BSP_PIN_USER_PB     C,    13,  GPIO_MODE_IT_FALLING,  GPIO_NOPULL,  GPIO_SPEED_FREQ_LOW,        0
+#define BSP_PIN_UART_TX     A,    2,   GPIO_MODE_AF_PP,       GPIO_PULLUP,  GPIO_SPEED_FAST,            GPIO_AF7_USART2
+#define BSP_PIN_UART_RX     A,    3,   GPIO_MODE_AF_PP,       GPIO_PULLUP,  GPIO_SPEED_FAST,            GPIO_AF7_USART2
+#define BSP_PIN_SPI_SCK     B,    3,   GPIO_MODE_AF_PP,       GPIO_NOPULL,  GPIO_SPEED_FREQ_VERY_HIGH,  GPIO_AF5_SPI1
+#define BSP_PIN_SPI_MISO    B,    4,   GPIO_MODE_AF_PP,       GPIO_PULLUP,  GPIO_SPEED_FREQ_VERY_HIGH,  GPIO_AF5_SPI1
+#define BSP_PIN_SPI_MOSI    B,    5,   GPIO_MODE_AF_PP,       GPIO_NOPULL,  GPIO_SPEED_FREQ_VERY_HIGH,  GPIO_AF5_SPI1
+#define BSP_PIN_SPI_CS      B,    6,   GPIO_MODE_OUTPUT_PP,   GPIO_NOPULL,  GPIO_SPEED_FREQ_HIGH,       0
+#define BSP_PIN_I2C1_SCL    B,    8,   GPIO_MODE_AF_OD,       GPIO_PULLUP,  GPIO_SPEED_FREQ_VERY_HIGH,  GPIO_AF4_I2C1
+#define BSP_PIN_I2C1_SDA    B,    9,   GPIO_MODE_AF_OD,       GPIO_PULLUP,  GPIO_SPEED_FREQ_VERY_HIGH,  GPIO_AF4_I2C1
+#define BSP_PIN_I2C3_SCL    A,    8,   GPIO_MODE_AF_OD,       GPIO_PULLUP,  GPIO_SPEED_FREQ_VERY_HIGH,  GPIO_AF4_I2C3
+#define BSP_PIN_I2C3_SDA    C,    9,   GPIO_MODE_AF_OD,       GPIO_PULLUP,  GPIO_SPEED_FREQ_VERY_HIGH,  GPIO_AF4_I2C3
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+/**
+ * @brief Registers and constants of a pin, by name, e.g. BSP_PIN_PORT(LD2) is GPIOA
+ *
+ */
+#define BSP_PIN_PORT(name)              BSP_PIN_EXPAND_(BSP_PIN_PORT_, BSP_PIN_##name)
+#define BSP_PIN_MASK(name)              BSP_PIN_EXPAND_(BSP_PIN_MASK_, BSP_PIN_##name)
+#define BSP_PIN_EXTI_PORT(name)         BSP_PIN_EXPAND_(BSP_PIN_EXTI_PORT_, BSP_PIN_##name)
+#define BSP_PIN_EXTI_LINE(name)         BSP_PIN_EXPAND_(BSP_PIN_EXTI_LINE_, BSP_PIN_##name)
+
+/**
+ * @brief Drive, toggle or read a pin by name
+ *
+ * @warning BSP_PIN_TOGGLE() reads ODR before writing BSRR, so it must not race another toggle of the same pin
+ *
+ */
+#define BSP_PIN_SET(name)               (BSP_PIN_PORT(name)->BSRR = BSP_PIN_MASK(name))
+#define BSP_PIN_CLEAR(name)             (BSP_PIN_PORT(name)->BSRR = (uint32_t) BSP_PIN_MASK(name) << 16)
+#define BSP_PIN_WRITE(name, state) \
+    (BSP_PIN_PORT(name)->BSRR = ((state) != 0) ? BSP_PIN_MASK(name) : ((uint32_t) BSP_PIN_MASK(name) << 16))
+#define BSP_PIN_TOGGLE(name)            bsp_gpio_toggle(BSP_PIN_PORT(name), BSP_PIN_MASK(name))
+#define BSP_PIN_READ(name)              ((BSP_PIN_PORT(name)->IDR & BSP_PIN_MASK(name)) != 0)
+
+/**
+ * @brief Configure a pin as described in the pin table, or return it to its reset state
+ *
+ * The port clock must already be enabled.
+ *
+ */
+#define BSP_PIN_INIT(name)              BSP_PIN_EXPAND_(BSP_PIN_INIT_, BSP_PIN_##name)
+#define BSP_PIN_DEINIT(name)            HAL_GPIO_DeInit(BSP_PIN_PORT(name), BSP_PIN_MASK(name))
+
+// Expand a pin's table entry into the arguments of macro
+#define BSP_PIN_EXPAND_(macro, ...)     macro(__VA_ARGS__)
+
+#define BSP_PIN_PORT_(port, pin, mode, pull, speed, alternate)          (GPIO##port)
+#define BSP_PIN_MASK_(port, pin, mode, pull, speed, alternate)          ((uint16_t) GPIO_PIN_##pin)
+#define BSP_PIN_EXTI_PORT_(port, pin, mode, pull, speed, alternate)     (EXTI_GPIO##port)
+#define BSP_PIN_EXTI_LINE_(port, pin, mode, pull, speed, alternate)     (EXTI_LINE_##pin)
+#define BSP_PIN_INIT_(port, pin, mode, pull, speed, alternate) \
+    HAL_GPIO_Init(GPIO##port, &(GPIO_InitTypeDef) \
+                  { \
+                      .Pin = GPIO_PIN_##pin, \
+                      .Mode = (mode), \
+                      .Pull = (pull), \
+                      .Speed = (speed), \
+                      .Alternate = (alternate), \
+                  })
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Invert the pins in mask with a single BSRR store
+ *
+ * @param [in] port             GPIO port, e.g. BSP_PIN_PORT(LD2)
+ * @param [in] mask             Pins to invert
+ *
+ */
+static inline __attribute__((always_inline)) void bsp_gpio_toggle(GPIO_TypeDef *port, uint16_t mask)
+{
+    uint32_t odr = port->ODR;
+
+    port->BSRR = ((odr & mask) << 16) | (~odr & mask);
+
+    return;
+}
+
+/**
+ * Drive the pins in mask to the matching bits of value, all in the same cycle, with a single BSRR store
+ *
+ * Pins of the port outside mask are untouched, even if an interrupt drives them concurrently.
+ *
+ * @param [in] port             GPIO port shared by all the pins, e.g. BSP_PIN_PORT(LD2)
+ * @param [in] mask             Pins to drive, e.g. BSP_PIN_MASK(LD2) | BSP_PIN_MASK(...)
+ * @param [in] value            Levels for those pins, 1 for high
+ *
+ */
+static inline __attribute__((always_inline)) void bsp_gpio_write_port(GPIO_TypeDef *port, uint16_t mask,
+                                                                      uint16_t value)
+{
+    port->BSRR = ((uint32_t) (mask & ~value) << 16) | (mask & value);
+
+    return;
+}
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_BOARD_H
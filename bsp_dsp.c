@@ -0,0 +1,523 @@
+/**
+ * @file bsp_dsp.c
+ *
+ * @brief Implementation of the q15 filter and statistics kernels
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stddef.h>
+#include <string.h>
+#include "bsp.h"
+#include "bsp_dsp.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define BSP_DSP_Q15_FRAC_BITS           (15)
+
+// Both halves of a packed pair set to 1, to sum a pair with one SMLALD
+#define BSP_DSP_Q15X2_ONES              (0x00010001UL)
+
+#define BSP_DSP_Q15X2_MIN               (0x80008000UL)
+#define BSP_DSP_Q15X2_MAX               (0x7FFF7FFFUL)
+
+// The shared loops take one of these to pick the dual-MAC or the reference inner product
+#define BSP_DSP_SIMD                    (true)
+#define BSP_DSP_REF                     (false)
+
+#define BSP_DSP_ALWAYS_INLINE           inline __attribute__((always_inline))
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Two adjacent samples as one packed word, the first in the low half
+ *
+ * The Cortex-M4 allows unaligned single-word loads, which memcpy() compiles to, so p need only be halfword-aligned.
+ *
+ */
+static inline uint32_t bsp_dsp_read_q15x2(const int16_t *p)
+{
+    uint32_t pair;
+
+    memcpy(&pair, p, sizeof(pair));
+
+    return pair;
+}
+
+static inline void bsp_dsp_write_q15x2(int16_t *p, uint32_t pair)
+{
+    memcpy(p, &pair, sizeof(pair));
+
+    return;
+}
+
+/**
+ * acc + x.lo * y.lo + x.hi * y.hi, in one cycle
+ *
+ */
+static inline int64_t bsp_dsp_smlald(uint32_t x, uint32_t y, int64_t acc)
+{
+#if defined(__ARM_FEATURE_DSP)
+    return (int64_t) __SMLALD(x, y, (uint64_t) acc);
+#else
+    return acc + ((int32_t) (int16_t) x * (int16_t) y) + ((int32_t) (int16_t) (x >> 16) * (int16_t) (y >> 16));
+#endif
+}
+
+/**
+ * sample in the low half and the low half of pair in the high half, i.e. pair shifted along by one sample
+ *
+ */
+static inline uint32_t bsp_dsp_shift_in(int16_t sample, uint32_t pair)
+{
+#if defined(__ARM_FEATURE_DSP)
+    return __PKHBT((uint32_t) sample, pair, 16);
+#else
+    return (uint16_t) sample | (pair << 16);
+#endif
+}
+
+/**
+ * Halfwise maximum and minimum of two packed pairs
+ *
+ * SSUB16 only sets the GE flags, one per half, which SEL then uses to pick each half from a or b.
+ *
+ */
+static inline uint32_t bsp_dsp_max_q15x2(uint32_t a, uint32_t b)
+{
+#if defined(__ARM_FEATURE_DSP)
+    (void) __SSUB16(a, b);
+    return __SEL(a, b);
+#else
+    uint32_t lo = ((int16_t) a >= (int16_t) b) ? (a & 0xFFFF) : (b & 0xFFFF);
+    uint32_t hi = ((int16_t) (a >> 16) >= (int16_t) (b >> 16)) ? (a & 0xFFFF0000) : (b & 0xFFFF0000);
+
+    return hi | lo;
+#endif
+}
+
+static inline uint32_t bsp_dsp_min_q15x2(uint32_t a, uint32_t b)
+{
+    return bsp_dsp_max_q15x2(b, a) ^ a ^ b;
+}
+
+/**
+ * An accumulator shifted down to q15, saturated
+ *
+ */
+static inline int16_t bsp_dsp_sat_q15(int64_t acc, uint32_t frac_bits)
+{
+    int64_t value = acc >> frac_bits;
+
+    if (value > INT16_MAX)
+    {
+        return INT16_MAX;
+    }
+    if (value < INT16_MIN)
+    {
+        return INT16_MIN;
+    }
+
+    return (int16_t) value;
+}
+
+static BSP_DSP_ALWAYS_INLINE int64_t bsp_dsp_dot_q15(const int16_t *a, const int16_t *b, uint32_t count, bool simd)
+{
+    int64_t acc = 0;
+
+    if (simd)
+    {
+        // Four products per pass, two to each SMLALD
+        for (; count >= 4; count -= 4)
+        {
+            acc = bsp_dsp_smlald(bsp_dsp_read_q15x2(a), bsp_dsp_read_q15x2(b), acc);
+            acc = bsp_dsp_smlald(bsp_dsp_read_q15x2(a + 2), bsp_dsp_read_q15x2(b + 2), acc);
+            a += 4;
+            b += 4;
+        }
+    }
+    for (; count > 0; count--)
+    {
+        acc += (int32_t) *a++ * *b++;
+    }
+
+    return acc;
+}
+
+/**
+ * FIR filter every input and keep every factor-th output, the last of each group of factor inputs
+ *
+ */
+static BSP_DSP_ALWAYS_INLINE void bsp_dsp_fir_run(bsp_dsp_fir_t *fir, uint32_t factor, const int16_t *in,
+                                                  int16_t *out, uint32_t count, bool simd)
+{
+    uint32_t history = fir->tap_count - 1;
+
+    while (count > 0)
+    {
+        uint32_t block = (count < fir->block_max) ? count : fir->block_max;
+        uint32_t i;
+
+        // Copied in first, which lets out overwrite in
+        memcpy(&fir->state[history], in, block * sizeof(int16_t));
+        for (i = factor - 1; i < block; i += factor)
+        {
+            // The window of the output for input i is state[i] to state[i + history], oldest first
+            *out++ = bsp_dsp_sat_q15(bsp_dsp_dot_q15(fir->coeffs, &fir->state[i], fir->tap_count, simd),
+                                     BSP_DSP_Q15_FRAC_BITS);
+        }
+        memmove(fir->state, &fir->state[block], history * sizeof(int16_t));
+
+        in += block;
+        count -= block;
+    }
+
+    return;
+}
+
+static BSP_DSP_ALWAYS_INLINE void bsp_dsp_mavg_run(bsp_dsp_mavg_t *mavg, const int16_t *in, int16_t *out,
+                                                   uint32_t count, bool running)
+{
+    uint32_t history = mavg->window - 1;
+
+    while (count > 0)
+    {
+        uint32_t block = (count < mavg->block_max) ? count : mavg->block_max;
+        uint32_t i;
+
+        memcpy(&mavg->state[history], in, block * sizeof(int16_t));
+        for (i = 0; i < block; i++)
+        {
+            int32_t sum;
+
+            if (running)
+            {
+                // The newest input joins the sum of the window - 1 before it, then the oldest leaves it
+                sum = mavg->sum + mavg->state[i + history];
+                mavg->sum = sum - mavg->state[i];
+            }
+            else
+            {
+                uint32_t j;
+
+                sum = 0;
+                for (j = 0; j <= history; j++)
+                {
+                    sum += mavg->state[i + j];
+                }
+            }
+            out[i] = (int16_t) (sum / (int32_t) mavg->window);
+        }
+        memmove(mavg->state, &mavg->state[block], history * sizeof(int16_t));
+
+        if (!running)
+        {
+            mavg->sum = 0;
+            for (i = 0; i < history; i++)
+            {
+                mavg->sum += mavg->state[i];
+            }
+        }
+
+        in += block;
+        out += block;
+        count -= block;
+    }
+
+    return;
+}
+
+static BSP_DSP_ALWAYS_INLINE void bsp_dsp_stats_finish(uint32_t count, int64_t sum, uint64_t sum_sq, int16_t min,
+                                                       int16_t max, bsp_dsp_stats_t *stats)
+{
+    uint64_t mean_sq = sum_sq / count;
+    uint32_t root = 0;
+    uint32_t bit;
+
+    // Bitwise square root; mean_sq is at most 2^30, so the root fits in 16 bits
+    for (bit = 1UL << 15; bit != 0; bit >>= 1)
+    {
+        if (((uint64_t) (root | bit) * (root | bit)) <= mean_sq)
+        {
+            root |= bit;
+        }
+    }
+
+    stats->min = min;
+    stats->max = max;
+    stats->mean = (int16_t) (sum / (int64_t) count);
+    stats->rms = (root > INT16_MAX) ? INT16_MAX : (int16_t) root;
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+bool bsp_dsp_fir_init(bsp_dsp_fir_t *fir, const int16_t *coeffs, uint32_t tap_count, int16_t *state,
+                      uint32_t block_max)
+{
+    if ((fir == NULL) || (coeffs == NULL) || (tap_count == 0) || (state == NULL) || (block_max == 0))
+    {
+        return false;
+    }
+
+    fir->coeffs = coeffs;
+    fir->tap_count = tap_count;
+    fir->state = state;
+    fir->block_max = block_max;
+    memset(state, 0, (tap_count - 1) * sizeof(int16_t));
+
+    return true;
+}
+
+void bsp_dsp_fir(bsp_dsp_fir_t *fir, const int16_t *in, int16_t *out, uint32_t count)
+{
+    bsp_dsp_fir_run(fir, 1, in, out, count, BSP_DSP_SIMD);
+
+    return;
+}
+
+void bsp_dsp_fir_ref(bsp_dsp_fir_t *fir, const int16_t *in, int16_t *out, uint32_t count)
+{
+    bsp_dsp_fir_run(fir, 1, in, out, count, BSP_DSP_REF);
+
+    return;
+}
+
+bool bsp_dsp_decim_init(bsp_dsp_decim_t *decim, const int16_t *coeffs, uint32_t tap_count, uint32_t factor,
+                        int16_t *state, uint32_t block_max)
+{
+    if ((decim == NULL) || (factor == 0) || ((block_max % factor) != 0))
+    {
+        return false;
+    }
+
+    decim->factor = factor;
+
+    return bsp_dsp_fir_init(&decim->fir, coeffs, tap_count, state, block_max);
+}
+
+void bsp_dsp_decim(bsp_dsp_decim_t *decim, const int16_t *in, int16_t *out, uint32_t count)
+{
+    bsp_dsp_fir_run(&decim->fir, decim->factor, in, out, count, BSP_DSP_SIMD);
+
+    return;
+}
+
+void bsp_dsp_decim_ref(bsp_dsp_decim_t *decim, const int16_t *in, int16_t *out, uint32_t count)
+{
+    bsp_dsp_fir_run(&decim->fir, decim->factor, in, out, count, BSP_DSP_REF);
+
+    return;
+}
+
+bool bsp_dsp_biquad_init(bsp_dsp_biquad_t *biquad, const bsp_dsp_biquad_coeffs_t *coeffs, uint32_t section_count,
+                         int16_t *state)
+{
+    if ((biquad == NULL) || (coeffs == NULL) || (section_count == 0) || (state == NULL))
+    {
+        return false;
+    }
+
+    biquad->coeffs = coeffs;
+    biquad->section_count = section_count;
+    biquad->state = state;
+    memset(state, 0, 4 * section_count * sizeof(int16_t));
+
+    return true;
+}
+
+void bsp_dsp_biquad(bsp_dsp_biquad_t *biquad, const int16_t *in, int16_t *out, uint32_t count)
+{
+    uint32_t section;
+
+    // A section at a time over the whole block, so its coefficients and history stay in registers
+    for (section = 0; section < biquad->section_count; section++)
+    {
+        const bsp_dsp_biquad_coeffs_t *c = &biquad->coeffs[section];
+        int16_t *state = &biquad->state[4 * section];
+        uint32_t b12 = (uint16_t) c->b1 | ((uint32_t) c->b2 << 16);
+        uint32_t a12 = (uint16_t) c->a1 | ((uint32_t) c->a2 << 16);
+        uint32_t x12 = bsp_dsp_read_q15x2(&state[0]);
+        uint32_t y12 = bsp_dsp_read_q15x2(&state[2]);
+        const int16_t *src = (section == 0) ? in : out;
+        uint32_t i;
+
+        for (i = 0; i < count; i++)
+        {
+            int16_t x = src[i];
+            int64_t acc = (int32_t) c->b0 * x;
+            int16_t y;
+
+            acc = bsp_dsp_smlald(b12, x12, acc);
+            acc = bsp_dsp_smlald(a12, y12, acc);
+            y = bsp_dsp_sat_q15(acc, BSP_DSP_BIQUAD_FRAC_BITS);
+
+            x12 = bsp_dsp_shift_in(x, x12);
+            y12 = bsp_dsp_shift_in(y, y12);
+            out[i] = y;
+        }
+
+        bsp_dsp_write_q15x2(&state[0], x12);
+        bsp_dsp_write_q15x2(&state[2], y12);
+    }
+
+    return;
+}
+
+void bsp_dsp_biquad_ref(bsp_dsp_biquad_t *biquad, const int16_t *in, int16_t *out, uint32_t count)
+{
+    uint32_t i;
+
+    // A sample at a time through every section
+    for (i = 0; i < count; i++)
+    {
+        int16_t x = in[i];
+        uint32_t section;
+
+        for (section = 0; section < biquad->section_count; section++)
+        {
+            const bsp_dsp_biquad_coeffs_t *c = &biquad->coeffs[section];
+            int16_t *state = &biquad->state[4 * section];
+            int64_t acc = 0;
+            int16_t y;
+
+            acc += (int32_t) c->b0 * x;
+            acc += (int32_t) c->b1 * state[0];
+            acc += (int32_t) c->b2 * state[1];
+            acc += (int32_t) c->a1 * state[2];
+            acc += (int32_t) c->a2 * state[3];
+            y = bsp_dsp_sat_q15(acc, BSP_DSP_BIQUAD_FRAC_BITS);
+
+            state[1] = state[0];
+            state[0] = x;
+            state[3] = state[2];
+            state[2] = y;
+            x = y;
+        }
+        out[i] = x;
+    }
+
+    return;
+}
+
+bool bsp_dsp_mavg_init(bsp_dsp_mavg_t *mavg, uint32_t window, int16_t *state, uint32_t block_max)
+{
+    if ((mavg == NULL) || (window == 0) || (window > (1UL << 16)) || (state == NULL) || (block_max == 0))
+    {
+        return false;
+    }
+
+    mavg->window = window;
+    mavg->state = state;
+    mavg->block_max = block_max;
+    mavg->sum = 0;
+    memset(state, 0, (window - 1) * sizeof(int16_t));
+
+    return true;
+}
+
+void bsp_dsp_mavg(bsp_dsp_mavg_t *mavg, const int16_t *in, int16_t *out, uint32_t count)
+{
+    bsp_dsp_mavg_run(mavg, in, out, count, true);
+
+    return;
+}
+
+void bsp_dsp_mavg_ref(bsp_dsp_mavg_t *mavg, const int16_t *in, int16_t *out, uint32_t count)
+{
+    bsp_dsp_mavg_run(mavg, in, out, count, false);
+
+    return;
+}
+
+bool bsp_dsp_stats(const int16_t *in, uint32_t count, bsp_dsp_stats_t *stats)
+{
+    uint32_t max12 = BSP_DSP_Q15X2_MIN;
+    uint32_t min12 = BSP_DSP_Q15X2_MAX;
+    int64_t sum = 0;
+    int64_t sum_sq = 0;
+    int16_t max;
+    int16_t min;
+    uint32_t i;
+
+    if ((in == NULL) || (count == 0) || (stats == NULL))
+    {
+        return false;
+    }
+
+    // Two samples per word, in both halves of every accumulator
+    for (i = 0; (i + 2) <= count; i += 2)
+    {
+        uint32_t x12 = bsp_dsp_read_q15x2(&in[i]);
+
+        max12 = bsp_dsp_max_q15x2(x12, max12);
+        min12 = bsp_dsp_min_q15x2(x12, min12);
+        sum = bsp_dsp_smlald(x12, BSP_DSP_Q15X2_ONES, sum);
+        sum_sq = bsp_dsp_smlald(x12, x12, sum_sq);
+    }
+
+    max = ((int16_t) max12 > (int16_t) (max12 >> 16)) ? (int16_t) max12 : (int16_t) (max12 >> 16);
+    min = ((int16_t) min12 < (int16_t) (min12 >> 16)) ? (int16_t) min12 : (int16_t) (min12 >> 16);
+    if (i < count)
+    {
+        max = (in[i] > max) ? in[i] : max;
+        min = (in[i] < min) ? in[i] : min;
+        sum += in[i];
+        sum_sq += (int32_t) in[i] * in[i];
+    }
+
+    bsp_dsp_stats_finish(count, sum, (uint64_t) sum_sq, min, max, stats);
+
+    return true;
+}
+
+bool bsp_dsp_stats_ref(const int16_t *in, uint32_t count, bsp_dsp_stats_t *stats)
+{
+    int16_t max = INT16_MIN;
+    int16_t min = INT16_MAX;
+    int64_t sum = 0;
+    uint64_t sum_sq = 0;
+    uint32_t i;
+
+    if ((in == NULL) || (count == 0) || (stats == NULL))
+    {
+        return false;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        max = (in[i] > max) ? in[i] : max;
+        min = (in[i] < min) ? in[i] : min;
+        sum += in[i];
+        sum_sq += (uint64_t) ((int32_t) in[i] * in[i]);
+    }
+
+    bsp_dsp_stats_finish(count, sum, sum_sq, min, max, stats);
+
+    return true;
+}
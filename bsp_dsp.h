@@ -0,0 +1,256 @@
+/**
+ * @file bsp_dsp.h
+ *
+ * @brief q15 fixed-point filter and statistics kernels using the Cortex-M4 packed 16-bit SIMD instructions
+ *
+ * Samples and coefficients are q15 (int16_t, 1.0 = 32768) unless stated otherwise.  Each kernel has a dual-MAC
+ * implementation, which reads two samples per 32-bit load and multiplies both with one SMLALD, and a plain C
+ * reference, bsp_dsp_*_ref(), which gives bit-identical results one sample at a time.  Products are accumulated
+ * exactly in 64 bits and truncated and saturated to q15 once per output, so neither can overflow part-way through a
+ * sum.  On the host the SIMD instructions are replaced by C equivalents, which lets bench/bench_dsp.c check the two
+ * versions against each other there too.
+ *
+ * bsp_dsp.c is compiled with -O2 even in debug builds, see the makefile.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_DSP_H
+#define BSP_DSP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief Fractional bits of the biquad coefficients, q1.14, so that they range over [-2, 2)
+ *
+ */
+#define BSP_DSP_BIQUAD_FRAC_BITS        (14)
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * FIR filter
+ *
+ * The state holds the last tap_count - 1 inputs followed by room for block_max new ones, so the inner product always
+ * runs over contiguous memory.  Longer calls are split into blocks of block_max.
+ *
+ * @see bsp_dsp_fir_init
+ *
+ */
+typedef struct
+{
+    const int16_t *coeffs;          ///< tap_count taps in time-reversed order, b[tap_count - 1] first
+    uint32_t tap_count;
+    int16_t *state;                 ///< tap_count - 1 + block_max samples
+    uint32_t block_max;
+} bsp_dsp_fir_t;
+
+/**
+ * FIR filter keeping every factor-th output
+ *
+ * Only the outputs kept are computed.
+ *
+ * @see bsp_dsp_decim_init
+ *
+ */
+typedef struct
+{
+    bsp_dsp_fir_t fir;              ///< block_max is a multiple of factor
+    uint32_t factor;
+} bsp_dsp_decim_t;
+
+/**
+ * Coefficients of one biquad section, q1.14
+ *
+ * y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2]
+ *
+ * The feedback coefficients are added, so a1 and a2 are the negated denominator coefficients of the usual form.
+ *
+ */
+typedef struct
+{
+    int16_t b0;
+    int16_t b1;
+    int16_t b2;
+    int16_t a1;
+    int16_t a2;
+} bsp_dsp_biquad_coeffs_t;
+
+/**
+ * Cascade of direct form I biquad sections
+ *
+ * Each section's output is saturated to q15 before it feeds the next.
+ *
+ * @see bsp_dsp_biquad_init
+ *
+ */
+typedef struct
+{
+    const bsp_dsp_biquad_coeffs_t *coeffs;  ///< One per section
+    uint32_t section_count;
+    int16_t *state;                 ///< 4 samples per section: x[n-1], x[n-2], y[n-1], y[n-2]
+} bsp_dsp_biquad_t;
+
+/**
+ * Moving average of the last window inputs
+ *
+ * The state is laid out as for bsp_dsp_fir_t, with window - 1 past inputs.  Until window inputs have been seen, the
+ * missing ones count as 0.  The running sum makes the cost per output independent of the window.
+ *
+ * @see bsp_dsp_mavg_init
+ *
+ */
+typedef struct
+{
+    uint32_t window;
+    int16_t *state;                 ///< window - 1 + block_max samples
+    uint32_t block_max;
+    int32_t sum;                    ///< Sum of the last window - 1 inputs
+} bsp_dsp_mavg_t;
+
+/**
+ * Statistics of a block of samples
+ *
+ * @see bsp_dsp_stats
+ *
+ */
+typedef struct
+{
+    int16_t min;
+    int16_t max;
+    int16_t mean;                   ///< Truncated towards zero
+    int16_t rms;                    ///< Truncated
+} bsp_dsp_stats_t;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Set up a FIR filter with a zero history
+ *
+ * @param [out] fir             Filter
+ * @param [in] coeffs           tap_count taps in time-reversed order; only the pointer is stored
+ * @param [in] tap_count        Number of taps, at least 1
+ * @param [in] state            tap_count - 1 + block_max samples, owned by the filter from now on
+ * @param [in] block_max        Most samples processed per pass, at least 1
+ *
+ * @return false if an argument is out of range
+ *
+ */
+bool bsp_dsp_fir_init(bsp_dsp_fir_t *fir, const int16_t *coeffs, uint32_t tap_count, int16_t *state,
+                      uint32_t block_max);
+
+/**
+ * Filter count samples; in and out may be the same buffer
+ *
+ */
+void bsp_dsp_fir(bsp_dsp_fir_t *fir, const int16_t *in, int16_t *out, uint32_t count);
+void bsp_dsp_fir_ref(bsp_dsp_fir_t *fir, const int16_t *in, int16_t *out, uint32_t count);
+
+/**
+ * Set up a decimating FIR filter with a zero history
+ *
+ * As bsp_dsp_fir_init(), with block_max a multiple of factor.
+ *
+ * @return false if an argument is out of range
+ *
+ */
+bool bsp_dsp_decim_init(bsp_dsp_decim_t *decim, const int16_t *coeffs, uint32_t tap_count, uint32_t factor,
+                        int16_t *state, uint32_t block_max);
+
+/**
+ * Filter count samples, a multiple of factor, and write count / factor outputs; in and out may be the same buffer
+ *
+ */
+void bsp_dsp_decim(bsp_dsp_decim_t *decim, const int16_t *in, int16_t *out, uint32_t count);
+void bsp_dsp_decim_ref(bsp_dsp_decim_t *decim, const int16_t *in, int16_t *out, uint32_t count);
+
+/**
+ * Set up a biquad cascade with a zero history
+ *
+ * @param [out] biquad          Filter
+ * @param [in] coeffs           section_count sections; only the pointer is stored
+ * @param [in] section_count    Number of sections, at least 1
+ * @param [in] state            4 * section_count samples, owned by the filter from now on
+ *
+ * @return false if an argument is out of range
+ *
+ */
+bool bsp_dsp_biquad_init(bsp_dsp_biquad_t *biquad, const bsp_dsp_biquad_coeffs_t *coeffs, uint32_t section_count,
+                         int16_t *state);
+
+/**
+ * Filter count samples; in and out may be the same buffer
+ *
+ */
+void bsp_dsp_biquad(bsp_dsp_biquad_t *biquad, const int16_t *in, int16_t *out, uint32_t count);
+void bsp_dsp_biquad_ref(bsp_dsp_biquad_t *biquad, const int16_t *in, int16_t *out, uint32_t count);
+
+/**
+ * Set up a moving average with a zero history
+ *
+ * @param [out] mavg            Filter
+ * @param [in] window           Number of inputs averaged, 1 to 65536
+ * @param [in] state            window - 1 + block_max samples, owned by the filter from now on
+ * @param [in] block_max        Most samples processed per pass, at least 1
+ *
+ * @return false if an argument is out of range
+ *
+ */
+bool bsp_dsp_mavg_init(bsp_dsp_mavg_t *mavg, uint32_t window, int16_t *state, uint32_t block_max);
+
+/**
+ * Average count samples, truncating towards zero; in and out may be the same buffer
+ *
+ * The reference recomputes the whole window sum for every output.
+ *
+ */
+void bsp_dsp_mavg(bsp_dsp_mavg_t *mavg, const int16_t *in, int16_t *out, uint32_t count);
+void bsp_dsp_mavg_ref(bsp_dsp_mavg_t *mavg, const int16_t *in, int16_t *out, uint32_t count);
+
+/**
+ * Minimum, maximum, mean and RMS of a block
+ *
+ * @return false, leaving stats untouched, if count is 0
+ *
+ */
+bool bsp_dsp_stats(const int16_t *in, uint32_t count, bsp_dsp_stats_t *stats);
+bool bsp_dsp_stats_ref(const int16_t *in, uint32_t count, bsp_dsp_stats_t *stats);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_DSP_H
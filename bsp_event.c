@@ -0,0 +1,122 @@
+/**
+ * @file bsp_event.c
+ *
+ * @brief Implementation of the event dispatcher
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stddef.h>
+#include "bsp_event.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+typedef struct
+{
+    bsp_event_handler_t handler;
+    void *arg;
+    volatile uint32_t payload;
+    volatile uint32_t count;        ///< Posts since the handler was last called
+} bsp_event_t;
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static bsp_event_t bsp_events[BSP_EVENT_MAX];
+
+// Bit n set while event n is pending
+static volatile uint32_t bsp_event_pending_mask = 0;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+uint32_t bsp_event_register(uint32_t event, bsp_event_handler_t handler, void *arg)
+{
+    uint32_t ret = BSP_STATUS_FAIL;
+
+    if (event < BSP_EVENT_MAX)
+    {
+        bsp_events[event].arg = arg;
+        bsp_events[event].handler = handler;
+
+        ret = BSP_STATUS_OK;
+    }
+
+    return ret;
+}
+
+uint32_t bsp_event_post(uint32_t event, uint32_t payload)
+{
+    uint32_t ret = BSP_STATUS_FAIL;
+
+    if (event < BSP_EVENT_MAX)
+    {
+        bsp_event_t *e = &bsp_events[event];
+
+        // Payload and count are published before the pending bit, which is set last with release ordering
+        __atomic_store_n(&e->payload, payload, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&e->count, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_or(&bsp_event_pending_mask, 1UL << event, __ATOMIC_RELEASE);
+
+        ret = BSP_STATUS_OK;
+    }
+
+    return ret;
+}
+
+bool bsp_event_dispatch(void)
+{
+    bool ret = false;
+    uint32_t pending = __atomic_load_n(&bsp_event_pending_mask, __ATOMIC_ACQUIRE);
+
+    if (pending != 0)
+    {
+        uint32_t event = __builtin_ctz(pending);
+        bsp_event_t *e = &bsp_events[event];
+        uint32_t count;
+        uint32_t payload;
+
+        // Clear the bit before taking the count, so a post that lands in between is either counted now or leaves the
+        // bit set for the next dispatch.  A bit set again by a post already counted here is dispatched with count 0
+        // and skipped.
+        __atomic_fetch_and(&bsp_event_pending_mask, ~(1UL << event), __ATOMIC_ACQUIRE);
+        count = __atomic_exchange_n(&e->count, 0, __ATOMIC_ACQUIRE);
+        payload = __atomic_load_n(&e->payload, __ATOMIC_RELAXED);
+
+        if ((count != 0) && (e->handler != NULL))
+        {
+            e->handler(event, payload, count, e->arg);
+        }
+
+        ret = true;
+    }
+
+    return ret;
+}
+
+bool bsp_event_pending(void)
+{
+    return (__atomic_load_n(&bsp_event_pending_mask, __ATOMIC_ACQUIRE) != 0);
+}
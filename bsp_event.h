@@ -0,0 +1,102 @@
+/**
+ * @file bsp_event.h
+ *
+ * @brief Event dispatcher for handing work from interrupt context to the main loop
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_EVENT_H
+#define BSP_EVENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include "bsp.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief Number of event IDs
+ *
+ * Event IDs are 0 to BSP_EVENT_MAX - 1 and double as priorities: when several events are pending, the lowest ID is
+ * dispatched first.
+ *
+ */
+#define BSP_EVENT_MAX                   (32)
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * Event handler, called from bsp_event_dispatch() in main-loop context
+ *
+ * @param [in] event            ID the handler was registered for
+ * @param [in] payload          Payload of the most recent bsp_event_post() for this event
+ * @param [in] count            Number of posts coalesced into this call, at least 1
+ * @param [in] arg              Argument registered with the handler
+ *
+ */
+typedef void (*bsp_event_handler_t)(uint32_t event, uint32_t payload, uint32_t count, void *arg);
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+uint32_t bsp_event_register(uint32_t event, bsp_event_handler_t handler, void *arg);
+
+/**
+ * Mark an event pending
+ *
+ * Lock-free and safe to call from any interrupt priority.  Posting an event that is already pending does not queue a
+ * second call: the posts are coalesced, the handler sees the latest payload and the number of posts.
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if event is out of range
+ *
+ */
+uint32_t bsp_event_post(uint32_t event, uint32_t payload);
+
+/**
+ * Call the handler of the highest-priority pending event
+ *
+ * Costs the same however many events are registered or pending.
+ *
+ * @return true if an event was dispatched, false if none was pending
+ *
+ * @warning Main loop only
+ *
+ */
+bool bsp_event_dispatch(void);
+bool bsp_event_pending(void);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_EVENT_H
@@ -0,0 +1,750 @@
+/**
+ * @file bsp_i2c.c
+ *
+ * @brief Implementation of the asynchronous I2C1/I2C3 master
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include "bsp_board.h"
+#include "bsp_i2c.h"
+#include "bsp_internal.h"
+#include "bsp_prof.h"
+#include "bsp_timer.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define BSP_I2C_PREPRIO                 (0x8)
+
+// Bus recovery clocks SCL at 100 kHz, for any target, and 9 clocks finish whatever byte a target was sending
+#define BSP_I2C_RECOVERY_HALF_BIT_US    (5)
+#define BSP_I2C_RECOVERY_CLOCKS         (9)
+
+// A STOP ending the previous access clears BUSY a few bit times after its completion interrupt
+#define BSP_I2C_STOP_WAIT_US            ((4 * 1000000) / BSP_I2C_CLOCK_HZ)
+
+// Bits of an access besides its data: START, address and register address, and a repeated START and address to read
+#define BSP_I2C_OVERHEAD_BYTES          (5)
+
+typedef struct
+{
+    const bsp_i2c_dev_t *dev;
+    const bsp_i2c_op_t *ops;
+    uint32_t op_count;
+    // Copy of the access of bsp_i2c_read_async() and bsp_i2c_write_async(), which ops then points to
+    bsp_i2c_op_t single;
+    bsp_callback_t cb;
+    void *cb_arg;
+} bsp_i2c_job_t;
+
+// Callback of a job that failed to start, held until the job before it has been called back
+typedef struct
+{
+    bsp_callback_t cb;
+    void *cb_arg;
+} bsp_i2c_failed_t;
+
+typedef struct
+{
+    I2C_TypeDef *instance;
+    DMA_Stream_TypeDef *rx_stream;
+    uint32_t rx_channel;
+    IRQn_Type ev_irqn;
+    IRQn_Type er_irqn;
+    IRQn_Type rx_dma_irqn;
+    // Set by bsp_i2c_init()
+    I2C_HandleTypeDef *hi2c;
+    DMA_HandleTypeDef *rx_dma;
+
+    // Ring of this bus's jobs; the job at tail holds the bus until its last access ends or one fails.  Both indices
+    // run free, wrapping at 2^32, and the bus's interrupts only move tail, with bsp_i2c_enqueue() masking them
+    bsp_i2c_job_t jobs[BSP_I2C_QUEUE_LEN];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    // Access of the job at tail in progress, and its sequence number, which tags its timeout
+    uint32_t op;
+    uint32_t seq;
+    uint32_t timeout_ms;
+    bsp_timer_handle_t timer;
+    // Tag of an access whose timeout expired, for the bus's event interrupt to act on
+    volatile bool expired;
+    volatile uint32_t expired_tag;
+
+    bsp_i2c_stats_t stats;
+} bsp_i2c_bus_t;
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static bsp_i2c_bus_t bsp_i2c_buses[BSP_I2C_BUS_MAX] =
+{
+    [BSP_I2C_BUS_1] =
+    {
+        .instance = I2C1,
+        .rx_stream = DMA1_Stream0,
+        .rx_channel = DMA_CHANNEL_1,
+        .ev_irqn = I2C1_EV_IRQn,
+        .er_irqn = I2C1_ER_IRQn,
+        .rx_dma_irqn = DMA1_Stream0_IRQn,
+    },
+    [BSP_I2C_BUS_3] =
+    {
+        .instance = I2C3,
+        .rx_stream = DMA1_Stream2,
+        .rx_channel = DMA_CHANNEL_3,
+        .ev_irqn = I2C3_EV_IRQn,
+        .er_irqn = I2C3_ER_IRQn,
+        .rx_dma_irqn = DMA1_Stream2_IRQn,
+    },
+};
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+I2C_HandleTypeDef i2c1_drv_handle;
+I2C_HandleTypeDef i2c3_drv_handle;
+DMA_HandleTypeDef i2c1_rx_dma_handle;
+DMA_HandleTypeDef i2c3_rx_dma_handle;
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static uint32_t bsp_i2c_bus_id(const I2C_HandleTypeDef *hi2c)
+{
+    return (hi2c->Instance == I2C1) ? BSP_I2C_BUS_1 : BSP_I2C_BUS_3;
+}
+
+static void bsp_i2c_delay_us(uint32_t us)
+{
+    uint32_t start = bsp_cycles_now();
+    uint32_t cycles = us * (SystemCoreClock / 1000000);
+
+    while ((bsp_cycles_now() - start) < cycles)
+    {
+    }
+
+    return;
+}
+
+static void bsp_i2c_pins_init(uint32_t id)
+{
+    if (id == BSP_I2C_BUS_1)
+    {
+        BSP_PIN_INIT(I2C1_SCL);
+        BSP_PIN_INIT(I2C1_SDA);
+    }
+    else
+    {
+        BSP_PIN_INIT(I2C3_SCL);
+        BSP_PIN_INIT(I2C3_SDA);
+    }
+
+    return;
+}
+
+/**
+ * Free SDA from a target stopped part-way through a byte, and end whatever it thought was in progress with a STOP
+ *
+ * The pins are driven by hand as open-drain outputs and handed back to the I2C peripheral afterwards.
+ *
+ */
+static void bsp_i2c_bus_clear(uint32_t id)
+{
+    GPIO_TypeDef *scl_port = (id == BSP_I2C_BUS_1) ? BSP_PIN_PORT(I2C1_SCL) : BSP_PIN_PORT(I2C3_SCL);
+    GPIO_TypeDef *sda_port = (id == BSP_I2C_BUS_1) ? BSP_PIN_PORT(I2C1_SDA) : BSP_PIN_PORT(I2C3_SDA);
+    uint16_t scl = (id == BSP_I2C_BUS_1) ? BSP_PIN_MASK(I2C1_SCL) : BSP_PIN_MASK(I2C3_SCL);
+    uint16_t sda = (id == BSP_I2C_BUS_1) ? BSP_PIN_MASK(I2C1_SDA) : BSP_PIN_MASK(I2C3_SDA);
+    uint32_t i;
+
+    // Released before they become outputs, so neither line glitches low
+    HAL_GPIO_WritePin(scl_port, scl, GPIO_PIN_SET);
+    HAL_GPIO_WritePin(sda_port, sda, GPIO_PIN_SET);
+    HAL_GPIO_Init(scl_port, &(GPIO_InitTypeDef) { .Pin = scl, .Mode = GPIO_MODE_OUTPUT_OD, .Pull = GPIO_PULLUP });
+    HAL_GPIO_Init(sda_port, &(GPIO_InitTypeDef) { .Pin = sda, .Mode = GPIO_MODE_OUTPUT_OD, .Pull = GPIO_PULLUP });
+    bsp_i2c_delay_us(BSP_I2C_RECOVERY_HALF_BIT_US);
+
+    for (i = 0; (i < BSP_I2C_RECOVERY_CLOCKS) && (HAL_GPIO_ReadPin(sda_port, sda) == GPIO_PIN_RESET); i++)
+    {
+        HAL_GPIO_WritePin(scl_port, scl, GPIO_PIN_RESET);
+        bsp_i2c_delay_us(BSP_I2C_RECOVERY_HALF_BIT_US);
+        HAL_GPIO_WritePin(scl_port, scl, GPIO_PIN_SET);
+        bsp_i2c_delay_us(BSP_I2C_RECOVERY_HALF_BIT_US);
+    }
+
+    // STOP: SDA rises while SCL is high
+    HAL_GPIO_WritePin(sda_port, sda, GPIO_PIN_RESET);
+    bsp_i2c_delay_us(BSP_I2C_RECOVERY_HALF_BIT_US);
+    HAL_GPIO_WritePin(sda_port, sda, GPIO_PIN_SET);
+    bsp_i2c_delay_us(BSP_I2C_RECOVERY_HALF_BIT_US);
+
+    bsp_i2c_pins_init(id);
+
+    return;
+}
+
+/**
+ * Clear the bus and reset the peripheral, abandoning any access in progress without completing it
+ *
+ */
+static void bsp_i2c_recover(uint32_t id)
+{
+    bsp_i2c_bus_t *bus = &bsp_i2c_buses[id];
+
+    if ((bus->hi2c->hdmarx != NULL) && (bus->hi2c->hdmarx->State == HAL_DMA_STATE_BUSY))
+    {
+        HAL_DMA_Abort(bus->hi2c->hdmarx);
+    }
+    __HAL_I2C_DISABLE(bus->hi2c);
+
+    bsp_i2c_bus_clear(id);
+
+    // Re-initialisation resets the peripheral, so nothing of the abandoned access can raise an interrupt afterwards
+    HAL_I2C_Init(bus->hi2c);
+    HAL_NVIC_ClearPendingIRQ(bus->ev_irqn);
+    HAL_NVIC_ClearPendingIRQ(bus->er_irqn);
+    HAL_NVIC_ClearPendingIRQ(bus->rx_dma_irqn);
+    bus->stats.recoveries++;
+
+    return;
+}
+
+static bool bsp_i2c_busy(const bsp_i2c_bus_t *bus)
+{
+    uint32_t start = bsp_cycles_now();
+    uint32_t cycles = BSP_I2C_STOP_WAIT_US * (SystemCoreClock / 1000000);
+
+    while (__HAL_I2C_GET_FLAG(bus->hi2c, I2C_FLAG_BUSY) == SET)
+    {
+        if ((bsp_cycles_now() - start) >= cycles)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static uint32_t bsp_i2c_timeout_tag(uint32_t id)
+{
+    return (bsp_i2c_buses[id].seq * BSP_I2C_BUS_MAX) + id;
+}
+
+/**
+ * An access whose interrupt is waiting to be taken has not hung: the CPU was held up past its timeout, by a flash
+ * erase for instance
+ *
+ */
+static bool bsp_i2c_irq_pending(const bsp_i2c_bus_t *bus)
+{
+    return ((HAL_NVIC_GetPendingIRQ(bus->ev_irqn) != 0) || (HAL_NVIC_GetPendingIRQ(bus->er_irqn) != 0) ||
+            (HAL_NVIC_GetPendingIRQ(bus->rx_dma_irqn) != 0));
+}
+
+static void bsp_i2c_timeout_cb(uint32_t status, void *arg);
+
+static void bsp_i2c_timeout_start(uint32_t id)
+{
+    bsp_i2c_bus_t *bus = &bsp_i2c_buses[id];
+
+    // Without a timer the access still runs, only unguarded against a target holding SCL low
+    bsp_timer_start(&bus->timer, bus->timeout_ms, 0, bsp_i2c_timeout_cb,
+                    (void *) (uintptr_t) bsp_i2c_timeout_tag(id));
+
+    return;
+}
+
+/**
+ * Hand an expired timeout over to the bus's event interrupt, unless the access is only waiting for the CPU
+ *
+ * The timer service runs at a higher priority than the bus's interrupts, and could otherwise reset the peripheral
+ * under a HAL interrupt handler it preempted.
+ *
+ */
+static void bsp_i2c_timeout_cb(uint32_t status, void *arg)
+{
+    uint32_t tag = (uint32_t) (uintptr_t) arg;
+    uint32_t id = tag % BSP_I2C_BUS_MAX;
+    bsp_i2c_bus_t *bus = &bsp_i2c_buses[id];
+    uint32_t primask = bsp_critical_enter();
+
+    // The access may have completed while this callback waited to run
+    if ((bus->head != bus->tail) && (bsp_i2c_timeout_tag(id) == tag))
+    {
+        bus->timer = BSP_TIMER_HANDLE_INVALID;
+        if (bsp_i2c_irq_pending(bus))
+        {
+            bsp_i2c_timeout_start(id);
+        }
+        else
+        {
+            bus->expired_tag = tag;
+            bus->expired = true;
+            HAL_NVIC_SetPendingIRQ(bus->ev_irqn);
+        }
+    }
+
+    bsp_critical_exit(primask);
+
+    return;
+}
+
+/**
+ * Start the current access of the job at the tail of the queue
+ *
+ * Called with the queue not empty and the bus idle, from a critical section or the bus's interrupts.
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if the bus could not be recovered or the HAL refused the access
+ *
+ */
+static uint32_t bsp_i2c_op_start(uint32_t id)
+{
+    bsp_i2c_bus_t *bus = &bsp_i2c_buses[id];
+    bsp_i2c_job_t *job = &bus->jobs[bus->tail % BSP_I2C_QUEUE_LEN];
+    const bsp_i2c_op_t *op = &job->ops[bus->op];
+    uint16_t addr = (uint16_t) (job->dev->addr << 1);
+    uint16_t reg_size = (job->dev->reg_size == 2) ? I2C_MEMADD_SIZE_16BIT : I2C_MEMADD_SIZE_8BIT;
+    HAL_StatusTypeDef status;
+
+    // The HAL would spin for 25 ms before giving up on a busy bus
+    if (bsp_i2c_busy(bus))
+    {
+        bsp_i2c_recover(id);
+        if (__HAL_I2C_GET_FLAG(bus->hi2c, I2C_FLAG_BUSY) == SET)
+        {
+            return BSP_STATUS_FAIL;
+        }
+    }
+
+    if (op->dir == BSP_I2C_OP_WRITE)
+    {
+        status = HAL_I2C_Mem_Write_IT(bus->hi2c, addr, op->reg, reg_size, op->data, op->len);
+    }
+    else if ((op->len >= BSP_I2C_DMA_MIN_LEN) && (bus->hi2c->hdmarx != NULL))
+    {
+        status = HAL_I2C_Mem_Read_DMA(bus->hi2c, addr, op->reg, reg_size, op->data, op->len);
+    }
+    else
+    {
+        status = HAL_I2C_Mem_Read_IT(bus->hi2c, addr, op->reg, reg_size, op->data, op->len);
+    }
+
+    if (status != HAL_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    bus->seq++;
+    bus->timeout_ms = BSP_I2C_TIMEOUT_MS + (((op->len + BSP_I2C_OVERHEAD_BYTES) * 9 * 1000) / BSP_I2C_CLOCK_HZ);
+    bsp_i2c_timeout_start(id);
+
+    return BSP_STATUS_OK;
+}
+
+/**
+ * Count the job at tail as done and give the bus to the next job before calling back
+ *
+ * A job queued from the callback so goes behind the jobs already waiting instead of starting ahead of them.  A next
+ * job whose first access is refused, or whose bus stays BUSY after recovery, fails at once and the one behind it gets
+ * the bus; such jobs are called back after the done job, in queue order.  STOP is unlocked once the ring is empty.
+ *
+ */
+static void bsp_i2c_retire(uint32_t id, uint32_t status)
+{
+    bsp_i2c_bus_t *bus = &bsp_i2c_buses[id];
+    bsp_i2c_job_t done = bus->jobs[bus->tail % BSP_I2C_QUEUE_LEN];
+    bsp_i2c_failed_t failed[BSP_I2C_QUEUE_LEN];
+    uint32_t failed_count = 0;
+    uint32_t i;
+
+    bus->stats.jobs++;
+    bus->stats.failed += (status != BSP_STATUS_OK) ? 1 : 0;
+    bus->tail++;
+
+    while (bus->tail != bus->head)
+    {
+        bsp_i2c_job_t *next = &bus->jobs[bus->tail % BSP_I2C_QUEUE_LEN];
+
+        bus->op = 0;
+        if (bsp_i2c_op_start(id) == BSP_STATUS_OK)
+        {
+            break;
+        }
+
+        // Copied out, as the slot is free once tail moves past it
+        failed[failed_count].cb = next->cb;
+        failed[failed_count].cb_arg = next->cb_arg;
+        failed_count++;
+
+        bus->stats.jobs++;
+        bus->stats.failed++;
+        bus->tail++;
+    }
+
+    if (bus->tail == bus->head)
+    {
+        bsp_power_unlock_stop();
+    }
+
+    if (done.cb != NULL)
+    {
+        done.cb(status, done.cb_arg);
+    }
+
+    for (i = 0; i < failed_count; i++)
+    {
+        if (failed[i].cb != NULL)
+        {
+            failed[i].cb(BSP_STATUS_FAIL, failed[i].cb_arg);
+        }
+    }
+
+    return;
+}
+
+/**
+ * Move on from the access in progress: to the next access of its job, or to the next job
+ *
+ */
+static void bsp_i2c_op_done(uint32_t id, uint32_t status)
+{
+    bsp_i2c_bus_t *bus = &bsp_i2c_buses[id];
+    bsp_i2c_job_t *job = &bus->jobs[bus->tail % BSP_I2C_QUEUE_LEN];
+
+    bsp_timer_cancel(bus->timer);
+    bus->timer = BSP_TIMER_HANDLE_INVALID;
+    bus->expired = false;
+
+    if ((status == BSP_STATUS_OK) && (++bus->op < job->op_count))
+    {
+        if (bsp_i2c_op_start(id) == BSP_STATUS_OK)
+        {
+            return;
+        }
+        status = BSP_STATUS_FAIL;
+    }
+
+    bsp_i2c_retire(id, status);
+
+    return;
+}
+
+static uint32_t bsp_i2c_enqueue(const bsp_i2c_dev_t *dev, const bsp_i2c_op_t *ops, uint32_t op_count,
+                                const bsp_i2c_op_t *single, bsp_callback_t cb, void *cb_arg)
+{
+    bsp_i2c_bus_t *bus;
+    uint32_t ret = BSP_STATUS_OK;
+    uint32_t primask;
+    uint32_t i;
+
+    if ((dev == NULL) || (dev->bus >= BSP_I2C_BUS_MAX) || (ops == NULL) || (op_count == 0))
+    {
+        return BSP_STATUS_FAIL;
+    }
+    for (i = 0; i < op_count; i++)
+    {
+        if ((ops[i].data == NULL) || (ops[i].len == 0) ||
+            ((ops[i].dir != BSP_I2C_OP_WRITE) && (ops[i].dir != BSP_I2C_OP_READ)))
+        {
+            return BSP_STATUS_FAIL;
+        }
+    }
+
+    bus = &bsp_i2c_buses[dev->bus];
+    primask = bsp_critical_enter();
+
+    if ((bus->head - bus->tail) >= BSP_I2C_QUEUE_LEN)
+    {
+        ret = BSP_STATUS_FAIL;
+    }
+    else
+    {
+        bsp_i2c_job_t *job = &bus->jobs[bus->head % BSP_I2C_QUEUE_LEN];
+
+        job->dev = dev;
+        job->ops = ops;
+        job->op_count = op_count;
+        job->cb = cb;
+        job->cb_arg = cb_arg;
+        if (single != NULL)
+        {
+            job->single = *single;
+            job->ops = &job->single;
+        }
+        bus->head++;
+
+        // Only the first job on a bus starts its first access here, and locks out STOP until bsp_i2c_retire()
+        // empties the ring; any later job is started by the access that ends ahead of it
+        if ((bus->head - bus->tail) == 1)
+        {
+            bsp_power_lock_stop();
+            bus->op = 0;
+            if (bsp_i2c_op_start(dev->bus) != BSP_STATUS_OK)
+            {
+                bus->head--;
+                bsp_power_unlock_stop();
+                ret = BSP_STATUS_FAIL;
+            }
+        }
+    }
+
+    bsp_critical_exit(primask);
+
+    return ret;
+}
+
+/***********************************************************************************************************************
+ * BSP INTERNAL FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Clear both buses and configure I2C1 and I2C3 as masters
+ *
+ * A target that was part-way through a read when the MCU reset still holds SDA low, so each bus is cleared first.
+ *
+ */
+uint32_t bsp_i2c_init(void)
+{
+    uint32_t id;
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    __HAL_RCC_GPIOC_CLK_ENABLE();
+
+    bsp_i2c_buses[BSP_I2C_BUS_1].hi2c = &i2c1_drv_handle;
+    bsp_i2c_buses[BSP_I2C_BUS_1].rx_dma = &i2c1_rx_dma_handle;
+    bsp_i2c_buses[BSP_I2C_BUS_3].hi2c = &i2c3_drv_handle;
+    bsp_i2c_buses[BSP_I2C_BUS_3].rx_dma = &i2c3_rx_dma_handle;
+
+    for (id = 0; id < BSP_I2C_BUS_MAX; id++)
+    {
+        I2C_HandleTypeDef *hi2c = bsp_i2c_buses[id].hi2c;
+
+        bsp_i2c_bus_clear(id);
+
+        hi2c->Instance = bsp_i2c_buses[id].instance;
+        hi2c->Init.ClockSpeed = BSP_I2C_CLOCK_HZ;
+        hi2c->Init.DutyCycle = I2C_DUTYCYCLE_2;
+        hi2c->Init.OwnAddress1 = 0;
+        hi2c->Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+        hi2c->Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+        hi2c->Init.OwnAddress2 = 0;
+        hi2c->Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+        hi2c->Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
+        if (HAL_I2C_Init(hi2c) != HAL_OK)
+        {
+            return BSP_STATUS_FAIL;
+        }
+    }
+
+    return BSP_STATUS_OK;
+}
+
+/**
+ * Fail the access in progress if its timeout expired, from the bus's event interrupt after the HAL has served it
+ *
+ * The access may have completed in the HAL's handler, or raised another of the bus's interrupts since the timeout;
+ * if it did, its timer is started again instead.
+ *
+ */
+void bsp_i2c_ev_irq(I2C_HandleTypeDef *hi2c)
+{
+    uint32_t id = bsp_i2c_bus_id(hi2c);
+    bsp_i2c_bus_t *bus = &bsp_i2c_buses[id];
+
+    if (!bus->expired)
+    {
+        return;
+    }
+    bus->expired = false;
+
+    if ((bus->head == bus->tail) || (bsp_i2c_timeout_tag(id) != bus->expired_tag))
+    {
+        return;
+    }
+
+    if (bsp_i2c_irq_pending(bus))
+    {
+        bsp_i2c_timeout_start(id);
+        return;
+    }
+
+    bus->stats.timeouts++;
+    bsp_i2c_recover(id);
+    bsp_i2c_op_done(id, BSP_STATUS_FAIL);
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * MCU HAL FUNCTIONS
+ **********************************************************************************************************************/
+void HAL_I2C_MspInit(I2C_HandleTypeDef *hi2c)
+{
+    uint32_t id = bsp_i2c_bus_id(hi2c);
+    bsp_i2c_bus_t *bus = &bsp_i2c_buses[id];
+
+    if (id == BSP_I2C_BUS_1)
+    {
+        __HAL_RCC_I2C1_CLK_ENABLE();
+    }
+    else
+    {
+        __HAL_RCC_I2C3_CLK_ENABLE();
+    }
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    bsp_i2c_pins_init(id);
+
+    HAL_NVIC_SetPriority(bus->ev_irqn, BSP_I2C_PREPRIO, 0);
+    HAL_NVIC_EnableIRQ(bus->ev_irqn);
+    HAL_NVIC_SetPriority(bus->er_irqn, BSP_I2C_PREPRIO, 0);
+    HAL_NVIC_EnableIRQ(bus->er_irqn);
+
+    // Only reads use DMA; writes are short register updates, cheaper by interrupt than setting up a stream
+    bus->rx_dma->Instance                 = bus->rx_stream;
+    bus->rx_dma->Init.Channel             = bus->rx_channel;
+    bus->rx_dma->Init.Direction           = DMA_PERIPH_TO_MEMORY;
+    bus->rx_dma->Init.PeriphInc           = DMA_PINC_DISABLE;
+    bus->rx_dma->Init.MemInc              = DMA_MINC_ENABLE;
+    bus->rx_dma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    bus->rx_dma->Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+    bus->rx_dma->Init.Mode                = DMA_NORMAL;
+    bus->rx_dma->Init.Priority            = DMA_PRIORITY_MEDIUM;
+    bus->rx_dma->Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(bus->rx_dma) != HAL_OK)
+    {
+        // Left unlinked, so that long reads fall back to an interrupt per byte
+        return;
+    }
+    __HAL_LINKDMA(hi2c, hdmarx, *bus->rx_dma);
+
+    HAL_NVIC_SetPriority(bus->rx_dma_irqn, BSP_I2C_PREPRIO, 0);
+    HAL_NVIC_EnableIRQ(bus->rx_dma_irqn);
+
+    return;
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    bsp_i2c_op_done(bsp_i2c_bus_id(hi2c), BSP_STATUS_OK);
+
+    return;
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    bsp_i2c_op_done(bsp_i2c_bus_id(hi2c), BSP_STATUS_OK);
+
+    return;
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    uint32_t id = bsp_i2c_bus_id(hi2c);
+    uint32_t error = HAL_I2C_GetError(hi2c);
+
+    if ((error & HAL_I2C_ERROR_AF) != 0)
+    {
+        bsp_i2c_buses[id].stats.nacks++;
+    }
+
+    // A missing acknowledge leaves the bus idle; anything else may not have
+    if ((error & ~HAL_I2C_ERROR_AF) != 0)
+    {
+        bsp_i2c_recover(id);
+    }
+
+    bsp_i2c_op_done(id, BSP_STATUS_FAIL);
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+uint32_t bsp_i2c_dev_init(bsp_i2c_dev_t *dev, uint32_t bus, uint16_t addr, uint32_t reg_size)
+{
+    if ((dev == NULL) || (bus >= BSP_I2C_BUS_MAX) || (addr > 0x7F) || (reg_size < 1) || (reg_size > 2))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    dev->bus = bus;
+    dev->addr = addr;
+    dev->reg_size = (uint16_t) reg_size;
+
+    return BSP_STATUS_OK;
+}
+
+uint32_t bsp_i2c_batch_async(const bsp_i2c_dev_t *dev, const bsp_i2c_op_t *ops, uint32_t op_count,
+                             bsp_callback_t cb, void *cb_arg)
+{
+    return bsp_i2c_enqueue(dev, ops, op_count, NULL, cb, cb_arg);
+}
+
+uint32_t bsp_i2c_read_async(const bsp_i2c_dev_t *dev, uint16_t reg, uint8_t *data, uint32_t len,
+                            bsp_callback_t cb, void *cb_arg)
+{
+    bsp_i2c_op_t op = { .reg = reg, .dir = BSP_I2C_OP_READ, .len = (uint16_t) len, .data = data };
+
+    if (len > BSP_I2C_ACCESS_MAX)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    return bsp_i2c_enqueue(dev, &op, 1, &op, cb, cb_arg);
+}
+
+uint32_t bsp_i2c_write_async(const bsp_i2c_dev_t *dev, uint16_t reg, const uint8_t *data, uint32_t len,
+                             bsp_callback_t cb, void *cb_arg)
+{
+    bsp_i2c_op_t op = { .reg = reg, .dir = BSP_I2C_OP_WRITE, .len = (uint16_t) len, .data = (uint8_t *) data };
+
+    if (len > BSP_I2C_ACCESS_MAX)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    return bsp_i2c_enqueue(dev, &op, 1, &op, cb, cb_arg);
+}
+
+uint32_t bsp_i2c_pending(uint32_t bus)
+{
+    if (bus >= BSP_I2C_BUS_MAX)
+    {
+        return 0;
+    }
+
+    return bsp_i2c_buses[bus].head - bsp_i2c_buses[bus].tail;
+}
+
+uint32_t bsp_i2c_get_stats(uint32_t bus, bsp_i2c_stats_t *stats)
+{
+    uint32_t primask;
+
+    if ((bus >= BSP_I2C_BUS_MAX) || (stats == NULL))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    primask = bsp_critical_enter();
+    *stats = bsp_i2c_buses[bus].stats;
+    bsp_critical_exit(primask);
+
+    return BSP_STATUS_OK;
+}
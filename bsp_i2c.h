@@ -0,0 +1,223 @@
+/**
+ * @file bsp_i2c.h
+ *
+ * @brief Asynchronous I2C1/I2C3 master: queued jobs of register accesses to one device, run from interrupts
+ *
+ * A job is a list of register accesses to one device, each a register address write followed by a write of data or a
+ * repeated start and a read.  Each bus runs its queue of jobs from its own interrupts: an access completing starts
+ * the next one of the job, and the last one calls the job's callback after starting the next job.  Writes and short
+ * reads move a byte per interrupt; reads of BSP_I2C_DMA_MIN_LEN bytes or more use DMA.
+ *
+ * I2C1 is on PB8 (SCL) and PB9 (SDA), Arduino D15 and D14, with its reads on DMA1 Stream0.  I2C3 is on PA8 (SCL) and
+ * PC9 (SDA), with its reads on DMA1 Stream2.  Both need external pull-ups.
+ *
+ * A bus that is left busy, e.g. by a target reset part-way through a read, is recovered before the next access:
+ * SCL is clocked by hand until the target releases SDA, a STOP is sent and the I2C peripheral is reset.  The same
+ * happens after a bus error, a lost arbitration or an access taking more than BSP_I2C_TIMEOUT_MS longer than it
+ * should.  A target that does not acknowledge only fails the job.
+ *
+ * I2C and DMA are not clocked in STOP, so STOP is held off while a queue is not empty.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_I2C_H
+#define BSP_I2C_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdint.h>
+#include "bsp.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief Buses
+ *
+ */
+#define BSP_I2C_BUS_1                   (0)
+#define BSP_I2C_BUS_3                   (1)
+#define BSP_I2C_BUS_MAX                 (2)
+
+/**
+ * @brief SCL rate of both buses, 100 kHz standard or up to 400 kHz fast mode
+ *
+ */
+#ifndef BSP_I2C_CLOCK_HZ
+#define BSP_I2C_CLOCK_HZ                (400000)
+#endif
+
+/**
+ * @brief Jobs that can be queued at once on each bus, including the one in progress
+ *
+ */
+#ifndef BSP_I2C_QUEUE_LEN
+#define BSP_I2C_QUEUE_LEN               (8)
+#endif
+
+/**
+ * @brief Shortest read that uses DMA rather than an interrupt per byte
+ *
+ */
+#ifndef BSP_I2C_DMA_MIN_LEN
+#define BSP_I2C_DMA_MIN_LEN             (16)
+#endif
+
+/**
+ * @brief Time an access may overrun its length at the bus rate before the bus is recovered and the job failed
+ *
+ */
+#ifndef BSP_I2C_TIMEOUT_MS
+#define BSP_I2C_TIMEOUT_MS              (10)
+#endif
+
+/**
+ * @brief Longest access, set by the 16-bit transfer count
+ *
+ */
+#define BSP_I2C_ACCESS_MAX              (0xFFFF)
+
+/**
+ * @brief Direction of a register access
+ *
+ */
+#define BSP_I2C_OP_WRITE                (0)
+#define BSP_I2C_OP_READ                 (1)
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * A target on one of the buses
+ *
+ * @see bsp_i2c_dev_init
+ *
+ */
+typedef struct
+{
+    uint32_t bus;
+    uint16_t addr;                  ///< 7-bit address
+    uint16_t reg_size;              ///< Bytes of register address, 1 or 2, sent most significant first
+} bsp_i2c_dev_t;
+
+/**
+ * One register access of a job
+ *
+ * Data is read or written from reg onwards, as the target's register address auto-increments.
+ *
+ */
+typedef struct
+{
+    uint16_t reg;
+    uint8_t dir;                    ///< BSP_I2C_OP_WRITE or BSP_I2C_OP_READ
+    uint16_t len;                   ///< 1 to BSP_I2C_ACCESS_MAX
+    uint8_t *data;                  ///< Only read from for a write
+} bsp_i2c_op_t;
+
+/**
+ * Bus statistics
+ *
+ * @see bsp_i2c_get_stats
+ *
+ */
+typedef struct
+{
+    uint32_t jobs;                  ///< Jobs completed, whether they succeeded or not
+    uint32_t failed;                ///< Jobs that failed
+    uint32_t nacks;                 ///< Accesses not acknowledged by the target
+    uint32_t timeouts;              ///< Accesses that overran BSP_I2C_TIMEOUT_MS
+    uint32_t recoveries;            ///< Times the bus was cleared and the peripheral reset
+} bsp_i2c_stats_t;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Describe a target
+ *
+ * @param [out] dev             Target, which must stay valid while jobs to it are queued
+ * @param [in] bus              BSP_I2C_BUS_1 or BSP_I2C_BUS_3
+ * @param [in] addr             7-bit address
+ * @param [in] reg_size         Bytes of register address, 1 or 2
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if an argument is out of range
+ *
+ */
+uint32_t bsp_i2c_dev_init(bsp_i2c_dev_t *dev, uint32_t bus, uint16_t addr, uint32_t reg_size);
+
+/**
+ * Queue a job of op_count register accesses to dev, which starts at once if the bus is idle
+ *
+ * Safe to call from interrupt context, including from a job callback.  The callback is called from the bus's
+ * interrupts with BSP_STATUS_OK once every access is complete, or BSP_STATUS_FAIL as soon as one fails, in which case
+ * the rest are skipped.  The ops and their buffers belong to the driver until then.
+ *
+ * @param [in] dev              Target
+ * @param [in] ops              Accesses, in order
+ * @param [in] op_count         At least 1
+ * @param [in] cb               Called when the job is over, or NULL
+ * @param [in] cb_arg           Passed to cb
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if the bus's queue is full, an access is out of range or the bus could
+ *         not be started
+ *
+ */
+uint32_t bsp_i2c_batch_async(const bsp_i2c_dev_t *dev, const bsp_i2c_op_t *ops, uint32_t op_count,
+                             bsp_callback_t cb, void *cb_arg);
+
+/**
+ * Queue a job of a single register read or write, as bsp_i2c_batch_async()
+ *
+ * The access is copied, so only the data buffer must stay valid until the callback.
+ *
+ */
+uint32_t bsp_i2c_read_async(const bsp_i2c_dev_t *dev, uint16_t reg, uint8_t *data, uint32_t len,
+                            bsp_callback_t cb, void *cb_arg);
+uint32_t bsp_i2c_write_async(const bsp_i2c_dev_t *dev, uint16_t reg, const uint8_t *data, uint32_t len,
+                             bsp_callback_t cb, void *cb_arg);
+
+/**
+ * Number of jobs queued or in progress on a bus
+ *
+ */
+uint32_t bsp_i2c_pending(uint32_t bus);
+
+/**
+ * Get a bus's statistics since start-up
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if bus or stats is invalid
+ *
+ */
+uint32_t bsp_i2c_get_stats(uint32_t bus, bsp_i2c_stats_t *stats);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_I2C_H
@@ -0,0 +1,138 @@
+/**
+ * @file bsp_internal.h
+ *
+ * @brief Functions shared between the BSP modules but not exported to the application
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_INTERNAL_H
+#define BSP_INTERNAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bsp_ring.h"
+#include "stm32f4xx_hal.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Enter a critical section that nests, including when already in interrupt context
+ *
+ * @return PRIMASK on entry, to pass to bsp_critical_exit()
+ *
+ */
+static inline uint32_t bsp_critical_enter(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    return primask;
+}
+
+static inline void bsp_critical_exit(uint32_t primask)
+{
+    __set_PRIMASK(primask);
+
+    return;
+}
+
+
+// bsp.c - the console TX FIFO, for producers that format in place and publish with bsp_uart_tx_commit()
+extern bsp_ring_t bsp_uart_tx_fifo;
+
+// bsp.c
+void bsp_system_clock_config(void);
+bool bsp_uart_tx_idle(void);
+bool bsp_uart_rx_idle(void);
+size_t bsp_uart_tx_commit(uint32_t count, uint32_t dropped);
+void bsp_uart_count_tx_irq(void);
+uint32_t bsp_apb1_timer_hz(void);
+uint32_t bsp_apb2_timer_hz(void);
+
+// bsp_adc.c
+bool bsp_adc_stream_running(void);
+
+// bsp_timer.c
+void bsp_timer_init(void);
+void bsp_timer_expired(void);
+bool bsp_timer_next_expiry(uint32_t *expiry);
+
+// bsp_i2c.c
+uint32_t bsp_i2c_init(void);
+void bsp_i2c_ev_irq(I2C_HandleTypeDef *hi2c);
+
+// bsp_kv.c
+uint32_t bsp_kv_init(void);
+
+// bsp_led.c
+uint32_t bsp_led_init(void);
+
+// bsp_prof.c
+void bsp_prof_init(void);
+
+// bsp_spi.c
+uint32_t bsp_spi_init(void);
+
+// bsp_tick.c - TIM5 microsecond time base behind HAL_GetTick(), and the compare channel used by the timer service
+#define BSP_TICK_TICKS_PER_MS           (1000)
+
+uint64_t bsp_tick_now_us(void);
+uint32_t bsp_tick_now(void);
+void bsp_tick_set_alarm(uint32_t expiry);
+void bsp_tick_cancel_alarm(void);
+void bsp_tick_advance(uint32_t us);
+void bsp_tick_overflow(void);
+
+// bsp_power.c - STOP is held off for this long after console input, since STOP loses received characters
+#define BSP_POWER_RX_HOLDOFF_MS         (5000)
+
+void bsp_power_init(void);
+void bsp_power_idle(void);
+void bsp_power_hold_off_stop(uint32_t holdoff_ms);
+void bsp_power_lock_stop(void);
+void bsp_power_unlock_stop(void);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_INTERNAL_H
@@ -0,0 +1,182 @@
+/**
+ * @file bsp_irq_prof.c
+ *
+ * @brief Implementation of the per-vector interrupt entry latency and duration histograms
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stddef.h>
+#include <string.h>
+#include "bsp_irq_prof.h"
+#include "bsp_internal.h"
+
+#if BSP_IRQ_PROF
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+typedef struct
+{
+    bsp_irq_prof_hist_t latency;
+    bsp_irq_prof_hist_t duration;
+} bsp_irq_prof_vector_t;
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+// Each vector's entry is only written by its own handler, which cannot preempt itself, so recording needs no lock
+static bsp_irq_prof_vector_t bsp_irq_prof_vectors[BSP_IRQ_PROF_ID_MAX];
+
+static const char * const bsp_irq_prof_names[BSP_IRQ_PROF_ID_MAX] =
+{
+    "USART2",
+    "EXTI15_10",
+    "DMA1_Stream5",
+    "DMA1_Stream6",
+    "TIM5",
+    "DMA2_Stream4",
+    "DMA2_Stream2",
+    "DMA2_Stream3",
+    "DMA1_Stream0",
+    "DMA1_Stream2",
+    "I2C1_EV",
+    "I2C1_ER",
+    "I2C3_EV",
+    "I2C3_ER",
+};
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static void bsp_irq_prof_hist_add(bsp_irq_prof_hist_t *hist, uint32_t cycles)
+{
+    uint32_t bucket = (cycles == 0) ? 0 : (32 - __builtin_clz(cycles));
+
+    if (bucket >= BSP_IRQ_PROF_BUCKETS)
+    {
+        bucket = BSP_IRQ_PROF_BUCKETS - 1;
+    }
+
+    hist->buckets[bucket]++;
+    hist->count++;
+    if (cycles > hist->worst)
+    {
+        hist->worst = cycles;
+    }
+
+    return;
+}
+
+static void bsp_irq_prof_hist_print(const char *name, const char *kind, const bsp_irq_prof_hist_t *hist)
+{
+    uint32_t i;
+
+    printf("%-12s %-8s n %-8lu worst %-8lu",
+           name,
+           kind,
+           (unsigned long) hist->count,
+           (unsigned long) hist->worst);
+
+    for (i = 0; i < BSP_IRQ_PROF_BUCKETS; i++)
+    {
+        if (hist->buckets[i] != 0)
+        {
+            // Label each bucket with its exclusive upper bound; the last one is open-ended
+            if (i == (BSP_IRQ_PROF_BUCKETS - 1))
+            {
+                printf(" >=%lu:%lu", 1UL << (i - 1), (unsigned long) hist->buckets[i]);
+            }
+            else
+            {
+                printf(" <%lu:%lu", 1UL << i, (unsigned long) hist->buckets[i]);
+            }
+        }
+    }
+    printf("\r\n");
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+uint32_t bsp_irq_prof_tim5_latency(void)
+{
+    uint32_t ret = BSP_IRQ_PROF_NO_LATENCY;
+
+    // CCR2 holds the counter value the compare event was raised at, including events forced by bsp_tick_set_alarm()
+    if (((TIM5->SR & TIM_SR_CC2IF) != 0) && ((TIM5->DIER & TIM_DIER_CC2IE) != 0))
+    {
+        ret = (TIM5->CNT - TIM5->CCR2) * (SystemCoreClock / (BSP_TICK_TICKS_PER_MS * 1000));
+    }
+
+    return ret;
+}
+
+void bsp_irq_prof_record(uint32_t id, uint32_t latency, uint32_t duration)
+{
+    if (id < BSP_IRQ_PROF_ID_MAX)
+    {
+        if (latency != BSP_IRQ_PROF_NO_LATENCY)
+        {
+            bsp_irq_prof_hist_add(&bsp_irq_prof_vectors[id].latency, latency);
+        }
+        bsp_irq_prof_hist_add(&bsp_irq_prof_vectors[id].duration, duration);
+    }
+
+    return;
+}
+
+void bsp_irq_prof_reset(void)
+{
+    uint32_t primask = bsp_critical_enter();
+
+    memset(bsp_irq_prof_vectors, 0, sizeof(bsp_irq_prof_vectors));
+
+    bsp_critical_exit(primask);
+
+    return;
+}
+
+void bsp_irq_prof_dump(void)
+{
+    uint32_t i;
+
+    printf("IRQ profile (cycles at %lu Hz)\r\n", (unsigned long) SystemCoreClock);
+
+    for (i = 0; i < BSP_IRQ_PROF_ID_MAX; i++)
+    {
+        bsp_irq_prof_vector_t vector;
+        uint32_t primask = bsp_critical_enter();
+
+        vector = bsp_irq_prof_vectors[i];
+
+        bsp_critical_exit(primask);
+
+        if (vector.latency.count != 0)
+        {
+            bsp_irq_prof_hist_print(bsp_irq_prof_names[i], "latency", &vector.latency);
+        }
+        bsp_irq_prof_hist_print(bsp_irq_prof_names[i], "duration", &vector.duration);
+    }
+
+    return;
+}
+#endif
@@ -0,0 +1,150 @@
+/**
+ * @file bsp_irq_prof.h
+ *
+ * @brief Optional per-vector interrupt entry latency and duration histograms
+ *
+ * Enabled by building with BSP_IRQ_PROF non-zero ('make IRQ_PROF=1').  Otherwise the instrumentation macros expand to
+ * nothing and the handlers in stm32f4xx_it.c are unchanged.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_IRQ_PROF_H
+#define BSP_IRQ_PROF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdint.h>
+#include "bsp_prof.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+#ifndef BSP_IRQ_PROF
+#define BSP_IRQ_PROF                    (0)
+#endif
+
+/**
+ * @brief Number of log2 histogram buckets
+ *
+ * Bucket 0 counts samples of 0 cycles and bucket n samples of [2^(n-1), 2^n) cycles.  The last bucket also counts
+ * everything longer.
+ *
+ */
+#define BSP_IRQ_PROF_BUCKETS            (20)
+
+/**
+ * @brief Entry latency value for vectors whose trigger time cannot be read back from the hardware
+ *
+ */
+#define BSP_IRQ_PROF_NO_LATENCY         (0xFFFFFFFF)
+
+/**
+ * @brief Instrumented vectors
+ *
+ */
+#define BSP_IRQ_PROF_ID_USART2          (0)
+#define BSP_IRQ_PROF_ID_EXTI15_10       (1)
+#define BSP_IRQ_PROF_ID_DMA1_STREAM5    (2)
+#define BSP_IRQ_PROF_ID_DMA1_STREAM6    (3)
+#define BSP_IRQ_PROF_ID_TIM5            (4)
+#define BSP_IRQ_PROF_ID_DMA2_STREAM4    (5)
+#define BSP_IRQ_PROF_ID_DMA2_STREAM2    (6)
+#define BSP_IRQ_PROF_ID_DMA2_STREAM3    (7)
+#define BSP_IRQ_PROF_ID_DMA1_STREAM0    (8)
+#define BSP_IRQ_PROF_ID_DMA1_STREAM2    (9)
+#define BSP_IRQ_PROF_ID_I2C1_EV         (10)
+#define BSP_IRQ_PROF_ID_I2C1_ER         (11)
+#define BSP_IRQ_PROF_ID_I2C3_EV         (12)
+#define BSP_IRQ_PROF_ID_I2C3_ER         (13)
+#define BSP_IRQ_PROF_ID_MAX             (14)
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+/**
+ * @brief Bracket the body of an interrupt handler
+ *
+ * BSP_IRQ_PROF_ENTER() must be the first statement of the handler, so that latency is sampled before the handler
+ * clears or changes anything it is derived from.  Pass BSP_IRQ_PROF_NO_LATENCY for vectors without a timestamp.
+ *
+ * Durations are measured from entry to exit and so include any time spent in higher-priority handlers.
+ *
+ */
+#if BSP_IRQ_PROF
+#define BSP_IRQ_PROF_ENTER(latency) \
+    uint32_t bsp_irq_prof_entry = bsp_cycles_now(); \
+    uint32_t bsp_irq_prof_latency = (latency)
+#define BSP_IRQ_PROF_EXIT(id) \
+    bsp_irq_prof_record((id), bsp_irq_prof_latency, bsp_cycles_now() - bsp_irq_prof_entry)
+#else
+#define BSP_IRQ_PROF_ENTER(latency)
+#define BSP_IRQ_PROF_EXIT(id)
+#endif
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * log2 histogram of cycle counts
+ *
+ */
+typedef struct
+{
+    uint32_t count;
+    uint32_t worst;
+    uint32_t buckets[BSP_IRQ_PROF_BUCKETS];
+} bsp_irq_prof_hist_t;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+#if BSP_IRQ_PROF
+/**
+ * Cycles since the TIM5 channel 2 compare event of the timer service, to pass to BSP_IRQ_PROF_ENTER() in
+ * TIM5_IRQHandler
+ *
+ * @return Latency, rounded down to whole TIM5 counter ticks, or BSP_IRQ_PROF_NO_LATENCY if the compare event is not
+ *         pending, e.g. for the overflow or a HAL_Delay() wake-up
+ *
+ */
+uint32_t bsp_irq_prof_tim5_latency(void);
+
+void bsp_irq_prof_record(uint32_t id, uint32_t latency, uint32_t duration);
+void bsp_irq_prof_reset(void);
+
+/**
+ * Print the count, worst case and non-empty histogram buckets of every vector on the console
+ *
+ * @warning Console output is main-loop only, see bsp_uart_write()
+ *
+ */
+void bsp_irq_prof_dump(void);
+#endif
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_IRQ_PROF_H
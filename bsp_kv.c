@@ -0,0 +1,891 @@
+/**
+ * @file bsp_kv.c
+ *
+ * @brief Implementation of the log-structured key/value store in flash
+ *
+ * Each sector starts with a 16-byte header: magic, sequence number, state and a reserved word.  The sequence number is
+ * programmed before the magic, so a sector is only taken as part of the store once both are; the state word is
+ * cleared once compaction has copied everything out, so an erase cut short by a reset is finished at start-up.
+ *
+ * Records follow the header back to back, word aligned: a word of key and length, the value padded with 0xFF, and the
+ * inverted CRC-32 of both.  Flash bits can be programmed from 1 to 0 at any time, which is how a torn record is marked
+ * superseded, by clearing its key.  A record of length 0 deletes its key.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "bsp_i2c.h"
+#include "bsp_internal.h"
+#include "bsp_kv.h"
+#include "bsp_spi.h"
+#include "bsp_timer.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#if (BSP_KV_SECTOR_FIRST < 5) || (BSP_KV_SECTOR_COUNT < 2) || ((BSP_KV_SECTOR_FIRST + BSP_KV_SECTOR_COUNT) > 8)
+#error "BSP_KV_SECTOR_FIRST and BSP_KV_SECTOR_COUNT must select two or more of the 128 KiB sectors 5 to 7"
+#endif
+
+#if ((BSP_KV_KEYS_MAX & (BSP_KV_KEYS_MAX - 1)) != 0) || (BSP_KV_KEYS_MAX > 0x8000)
+#error "BSP_KV_KEYS_MAX must be a power of two, up to 32768"
+#endif
+
+#if (BSP_KV_VALUE_MAX < 1) || (BSP_KV_VALUE_MAX > 0x4000)
+#error "BSP_KV_VALUE_MAX must be 1 to 16384"
+#endif
+
+// Sectors 5 to 7 of the STM32F401RE, which are all 128 KiB
+#define BSP_KV_SECTOR_SIZE              (0x20000U)
+#define BSP_KV_SECTOR_5_OFFSET          (0x20000U)
+#define BSP_KV_BASE                     (FLASH_BASE + BSP_KV_SECTOR_5_OFFSET + \
+                                         ((BSP_KV_SECTOR_FIRST - 5) * BSP_KV_SECTOR_SIZE))
+
+#define BSP_KV_STRINGIFY(x)             #x
+#define BSP_KV_STR(x)                   BSP_KV_STRINGIFY(x)
+
+#define BSP_KV_ERASED                   (0xFFFFFFFFU)
+
+// Sector header
+#define BSP_KV_MAGIC                    (0x564B5342U)
+#define BSP_KV_HDR_MAGIC                (0x0)
+#define BSP_KV_HDR_SEQ                  (0x4)
+#define BSP_KV_HDR_STATE                (0x8)
+#define BSP_KV_HDR_SIZE                 (0x10)
+#define BSP_KV_STATE_OBSOLETE           (0x0U)
+
+// Records: the key and length word, the padded value, then the CRC word
+#define BSP_KV_KEY_DEAD                 (0x0000U)
+#define BSP_KV_KEY_MASK                 (0xFFFFU)
+#define BSP_KV_LEN_SHIFT                (16)
+#define BSP_KV_RECORD_SIZE(len)         (8U + (((uint32_t) (len) + 3U) & ~3U))
+#define BSP_KV_RECORD_MAX               BSP_KV_RECORD_SIZE(BSP_KV_VALUE_MAX)
+
+// The oldest sector's live data must fit in an empty head alongside the write that moved the head there
+#define BSP_KV_PAYLOAD                  (BSP_KV_SECTOR_SIZE - BSP_KV_HDR_SIZE)
+#define BSP_KV_LIVE_MAX                 (BSP_KV_PAYLOAD - (2 * BSP_KV_RECORD_MAX))
+
+// Open addressing with linear probing, at most half full
+#define BSP_KV_INDEX_SLOTS              (2 * BSP_KV_KEYS_MAX)
+#define BSP_KV_INDEX_MASK               (BSP_KV_INDEX_SLOTS - 1)
+#define BSP_KV_HASH_MULT                (0x9E3779B1U)
+
+#define BSP_KV_CRC_INIT                 (0xFFFFFFFFU)
+
+// How often an erase held back from idle time is tried again; nothing else may wake the core once input stops
+#define BSP_KV_ERASE_RETRY_MS           (500)
+
+typedef struct
+{
+    uint16_t key;                   ///< 0 when the slot is empty
+    uint16_t len;
+    uint32_t addr;                  ///< Flash address of the latest record of key
+} bsp_kv_slot_t;
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+// CRC-32 (IEEE 802.3, reflected) a nibble at a time
+static const uint32_t bsp_kv_crc_table[16] =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+static bsp_kv_slot_t bsp_kv_index[BSP_KV_INDEX_SLOTS];
+static uint32_t bsp_kv_live_bytes = 0;
+
+// Head sector, its sequence number, and where the next record goes in it
+static uint32_t bsp_kv_head = 0;
+static uint32_t bsp_kv_head_seq = 0;
+static uint32_t bsp_kv_write_addr = 0;
+
+// Sector being compacted, the next record to look at in it, and the bytes of its records still to copy
+static bool bsp_kv_gc_active = false;
+static uint32_t bsp_kv_gc_src = 0;
+static uint32_t bsp_kv_gc_cursor = 0;
+static uint32_t bsp_kv_gc_live = 0;
+
+static bsp_kv_stats_t bsp_kv_stats = {0};
+
+static bsp_timer_handle_t bsp_kv_retry_timer = BSP_TIMER_HANDLE_INVALID;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+// BSP_KV_BASE as an absolute symbol, for bsp_kv.ld to check that the image ends below the store; the assembler takes
+// no U suffixes, so the sector layout is spelled out again
+__asm__(".globl bsp_kv_flash_start\n"
+        ".set bsp_kv_flash_start, 0x08000000 + (0x20000 * (" BSP_KV_STR(BSP_KV_SECTOR_FIRST) " - 4))\n");
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static uint32_t bsp_kv_sector_addr(uint32_t sector)
+{
+    return BSP_KV_BASE + (sector * BSP_KV_SECTOR_SIZE);
+}
+
+static uint32_t bsp_kv_head_free(void)
+{
+    return bsp_kv_sector_addr(bsp_kv_head) + BSP_KV_SECTOR_SIZE - bsp_kv_write_addr;
+}
+
+static uint32_t bsp_kv_word(uint32_t addr)
+{
+    return *(const uint32_t *) (uintptr_t) addr;
+}
+
+static bool bsp_kv_in_sector(uint32_t addr, uint32_t sector)
+{
+    return (addr - bsp_kv_sector_addr(sector)) < BSP_KV_SECTOR_SIZE;
+}
+
+static uint32_t bsp_kv_crc(uint32_t crc, const void *data, uint32_t len)
+{
+    const uint8_t *bytes = data;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ bsp_kv_crc_table[crc & 0xF];
+        crc = (crc >> 4) ^ bsp_kv_crc_table[crc & 0xF];
+    }
+
+    return crc;
+}
+
+/**
+ * Whether the record at addr holds the CRC of its key, length and value
+ *
+ */
+static bool bsp_kv_record_valid(uint32_t addr, uint32_t len)
+{
+    uint32_t data_size = BSP_KV_RECORD_SIZE(len) - 4;
+    uint32_t crc = bsp_kv_crc(BSP_KV_CRC_INIT, (const void *) (uintptr_t) addr, data_size);
+
+    return bsp_kv_word(addr + data_size) == ~crc;
+}
+
+static void bsp_kv_unlock(void)
+{
+    HAL_FLASH_Unlock();
+    // Errors left over from an earlier operation would fail the next one
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR |
+                           FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+
+    return;
+}
+
+static void bsp_kv_lock(void)
+{
+    HAL_FLASH_Lock();
+
+    return;
+}
+
+static uint32_t bsp_kv_program(uint32_t addr, uint32_t word)
+{
+    if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr, word) != HAL_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    return BSP_STATUS_OK;
+}
+
+static uint32_t bsp_kv_erase(uint32_t sector)
+{
+    FLASH_EraseInitTypeDef erase =
+    {
+        .TypeErase = FLASH_TYPEERASE_SECTORS,
+        .Sector = BSP_KV_SECTOR_FIRST + sector,
+        .NbSectors = 1,
+        .VoltageRange = FLASH_VOLTAGE_RANGE_3,
+    };
+    uint32_t sector_error;
+
+    if (HAL_FLASHEx_Erase(&erase, &sector_error) != HAL_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    return BSP_STATUS_OK;
+}
+
+static bool bsp_kv_sector_blank(uint32_t sector)
+{
+    const uint32_t *words = (const uint32_t *) (uintptr_t) bsp_kv_sector_addr(sector);
+
+    for (uint32_t i = 0; i < (BSP_KV_SECTOR_SIZE / sizeof(uint32_t)); i++)
+    {
+        if (words[i] != BSP_KV_ERASED)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool bsp_kv_sector_live(uint32_t sector)
+{
+    uint32_t addr = bsp_kv_sector_addr(sector);
+
+    return (bsp_kv_word(addr + BSP_KV_HDR_MAGIC) == BSP_KV_MAGIC) &&
+           (bsp_kv_word(addr + BSP_KV_HDR_STATE) == BSP_KV_ERASED);
+}
+
+static bsp_kv_slot_t *bsp_kv_index_find(uint32_t key)
+{
+    uint32_t i = ((key * BSP_KV_HASH_MULT) >> 16) & BSP_KV_INDEX_MASK;
+
+    while (bsp_kv_index[i].key != 0)
+    {
+        if (bsp_kv_index[i].key == key)
+        {
+            return &bsp_kv_index[i];
+        }
+        i = (i + 1) & BSP_KV_INDEX_MASK;
+    }
+
+    return NULL;
+}
+
+/**
+ * Point key at a new record, adding it to the index if it is not there
+ *
+ * Keeps the live byte count and, if the superseded record is still to be copied by compaction, the compaction's.
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if the key is new and BSP_KV_KEYS_MAX are already stored
+ *
+ */
+static uint32_t bsp_kv_index_set(uint32_t key, uint32_t len, uint32_t addr)
+{
+    uint32_t i = ((key * BSP_KV_HASH_MULT) >> 16) & BSP_KV_INDEX_MASK;
+
+    while ((bsp_kv_index[i].key != 0) && (bsp_kv_index[i].key != key))
+    {
+        i = (i + 1) & BSP_KV_INDEX_MASK;
+    }
+
+    if (bsp_kv_index[i].key == key)
+    {
+        bsp_kv_live_bytes -= BSP_KV_RECORD_SIZE(bsp_kv_index[i].len);
+        if (bsp_kv_gc_active && bsp_kv_in_sector(bsp_kv_index[i].addr, bsp_kv_gc_src))
+        {
+            bsp_kv_gc_live -= BSP_KV_RECORD_SIZE(bsp_kv_index[i].len);
+        }
+    }
+    else if (bsp_kv_stats.keys >= BSP_KV_KEYS_MAX)
+    {
+        return BSP_STATUS_FAIL;
+    }
+    else
+    {
+        bsp_kv_index[i].key = (uint16_t) key;
+        bsp_kv_stats.keys++;
+    }
+
+    bsp_kv_index[i].len = (uint16_t) len;
+    bsp_kv_index[i].addr = addr;
+    bsp_kv_live_bytes += BSP_KV_RECORD_SIZE(len);
+
+    return BSP_STATUS_OK;
+}
+
+/**
+ * Remove key from the index, shifting back any entry of its probe run that could no longer be found
+ *
+ */
+static void bsp_kv_index_remove(uint32_t key)
+{
+    bsp_kv_slot_t *slot = bsp_kv_index_find(key);
+    uint32_t hole;
+    uint32_t i;
+
+    if (slot == NULL)
+    {
+        return;
+    }
+
+    bsp_kv_live_bytes -= BSP_KV_RECORD_SIZE(slot->len);
+    if (bsp_kv_gc_active && bsp_kv_in_sector(slot->addr, bsp_kv_gc_src))
+    {
+        bsp_kv_gc_live -= BSP_KV_RECORD_SIZE(slot->len);
+    }
+    bsp_kv_stats.keys--;
+
+    hole = (uint32_t) (slot - bsp_kv_index);
+    i = hole;
+    while (1)
+    {
+        uint32_t home;
+
+        i = (i + 1) & BSP_KV_INDEX_MASK;
+        if (bsp_kv_index[i].key == 0)
+        {
+            break;
+        }
+
+        // The entry stays unless its home slot is outside the cyclic range (hole, i]
+        home = ((bsp_kv_index[i].key * BSP_KV_HASH_MULT) >> 16) & BSP_KV_INDEX_MASK;
+        if (((i - home) & BSP_KV_INDEX_MASK) >= ((i - hole) & BSP_KV_INDEX_MASK))
+        {
+            bsp_kv_index[hole] = bsp_kv_index[i];
+            hole = i;
+        }
+    }
+    bsp_kv_index[hole].key = 0;
+
+    return;
+}
+
+/**
+ * Program a record at the write address of the head, which the caller has made room for
+ *
+ * The space is taken even if programming fails, as it is no longer erased; the record is then marked superseded.
+ *
+ */
+static uint32_t bsp_kv_append(uint32_t key, const void *data, uint32_t len, uint32_t *addr)
+{
+    const uint8_t *bytes = data;
+    uint32_t at = bsp_kv_write_addr;
+    uint32_t word = key | (len << BSP_KV_LEN_SHIFT);
+    uint32_t crc = bsp_kv_crc(BSP_KV_CRC_INIT, &word, sizeof(word));
+    uint32_t ret = bsp_kv_program(at, word);
+
+    bsp_kv_write_addr += BSP_KV_RECORD_SIZE(len);
+
+    for (uint32_t i = 0; (ret == BSP_STATUS_OK) && (i < len); i += sizeof(word))
+    {
+        word = BSP_KV_ERASED;
+        memcpy(&word, &bytes[i], ((len - i) < sizeof(word)) ? (len - i) : sizeof(word));
+        crc = bsp_kv_crc(crc, &word, sizeof(word));
+        ret = bsp_kv_program(at + 4 + i, word);
+    }
+
+    if (ret == BSP_STATUS_OK)
+    {
+        ret = bsp_kv_program(bsp_kv_write_addr - 4, ~crc);
+    }
+
+    if (ret != BSP_STATUS_OK)
+    {
+        bsp_kv_program(at, len << BSP_KV_LEN_SHIFT);
+        return BSP_STATUS_FAIL;
+    }
+
+    *addr = at;
+
+    return BSP_STATUS_OK;
+}
+
+/**
+ * Make an erased sector the head, erasing it first if anything is left in it
+ *
+ */
+static uint32_t bsp_kv_head_start(uint32_t sector, uint32_t seq)
+{
+    uint32_t addr = bsp_kv_sector_addr(sector);
+
+    if (!bsp_kv_sector_blank(sector) && (bsp_kv_erase(sector) != BSP_STATUS_OK))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    if ((bsp_kv_program(addr + BSP_KV_HDR_SEQ, seq) != BSP_STATUS_OK) ||
+        (bsp_kv_program(addr + BSP_KV_HDR_MAGIC, BSP_KV_MAGIC) != BSP_STATUS_OK))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    bsp_kv_head = sector;
+    bsp_kv_head_seq = seq;
+    bsp_kv_write_addr = addr + BSP_KV_HDR_SIZE;
+
+    return BSP_STATUS_OK;
+}
+
+/**
+ * Start compacting a sector, counting the live records it holds
+ *
+ */
+static void bsp_kv_gc_start(uint32_t sector)
+{
+    bsp_kv_gc_active = true;
+    bsp_kv_gc_src = sector;
+    bsp_kv_gc_cursor = bsp_kv_sector_addr(sector) + BSP_KV_HDR_SIZE;
+    bsp_kv_gc_live = 0;
+
+    for (uint32_t i = 0; i < BSP_KV_INDEX_SLOTS; i++)
+    {
+        if ((bsp_kv_index[i].key != 0) && bsp_kv_in_sector(bsp_kv_index[i].addr, sector))
+        {
+            bsp_kv_gc_live += BSP_KV_RECORD_SIZE(bsp_kv_index[i].len);
+        }
+    }
+
+    return;
+}
+
+/**
+ * Copy the next live record of the sector being compacted into the head, or erase the sector if none are left
+ *
+ * Called with flash unlocked.
+ *
+ */
+static uint32_t bsp_kv_gc_step(void)
+{
+    uint32_t end = bsp_kv_sector_addr(bsp_kv_gc_src) + BSP_KV_SECTOR_SIZE;
+
+    while ((end - bsp_kv_gc_cursor) >= BSP_KV_RECORD_SIZE(0))
+    {
+        uint32_t rec = bsp_kv_gc_cursor;
+        uint32_t word = bsp_kv_word(rec);
+        uint32_t len = word >> BSP_KV_LEN_SHIFT;
+        bsp_kv_slot_t *slot;
+
+        if ((word == BSP_KV_ERASED) || (len > BSP_KV_VALUE_MAX) || (BSP_KV_RECORD_SIZE(len) > (end - rec)))
+        {
+            break;
+        }
+        bsp_kv_gc_cursor += BSP_KV_RECORD_SIZE(len);
+
+        // Only the record the index points at is live; superseded ones and deletions go with the sector
+        slot = bsp_kv_index_find(word & BSP_KV_KEY_MASK);
+        if ((slot != NULL) && (slot->addr == rec))
+        {
+            // The head always has room for what is left to copy, see bsp_kv_make_room()
+            if ((bsp_kv_head_free() < BSP_KV_RECORD_SIZE(len)) ||
+                (bsp_kv_append(slot->key, (const void *) (uintptr_t) (rec + 4), len, &slot->addr) != BSP_STATUS_OK))
+            {
+                bsp_kv_gc_cursor = rec;
+                return BSP_STATUS_FAIL;
+            }
+            bsp_kv_gc_live -= BSP_KV_RECORD_SIZE(len);
+            bsp_kv_stats.copies++;
+            return BSP_STATUS_OK;
+        }
+    }
+
+    if ((bsp_kv_program(end - BSP_KV_SECTOR_SIZE + BSP_KV_HDR_STATE, BSP_KV_STATE_OBSOLETE) != BSP_STATUS_OK) ||
+        (bsp_kv_erase(bsp_kv_gc_src) != BSP_STATUS_OK))
+    {
+        return BSP_STATUS_FAIL;
+    }
+    bsp_kv_gc_active = false;
+    bsp_kv_stats.compactions++;
+
+    return BSP_STATUS_OK;
+}
+
+/**
+ * Whether idle time may be spent erasing: the 1 to 2 s stall would lose ADC blocks, overrun the console's RX DMA ring
+ * and stall queued SPI and I2C jobs, which I2C would take for hung targets
+ *
+ */
+static bool bsp_kv_erase_quiet(void)
+{
+    return (!bsp_adc_stream_running() &&
+            (bsp_spi_pending() == 0) &&
+            (bsp_i2c_pending(BSP_I2C_BUS_1) == 0) &&
+            (bsp_i2c_pending(BSP_I2C_BUS_3) == 0) &&
+            bsp_uart_rx_idle());
+}
+
+// Only the interrupt matters: it ends bsp_sleep(), and the main loop's next call takes the erase if it may
+static void bsp_kv_retry_cb(uint32_t status, void *arg)
+{
+    return;
+}
+
+/**
+ * Make room in the head for a record of size bytes, leaving room for what compaction still has to copy
+ *
+ * Called with flash unlocked.
+ *
+ */
+static uint32_t bsp_kv_make_room(uint32_t size)
+{
+    uint32_t next;
+
+    if (bsp_kv_gc_active && (bsp_kv_head_free() < (size + bsp_kv_gc_live)))
+    {
+        bsp_kv_stats.foreground++;
+        while (bsp_kv_gc_active)
+        {
+            if (bsp_kv_gc_step() != BSP_STATUS_OK)
+            {
+                return BSP_STATUS_FAIL;
+            }
+        }
+    }
+
+    if (bsp_kv_head_free() >= size)
+    {
+        return BSP_STATUS_OK;
+    }
+
+    // The next sector was erased by the compaction just finished, or has not been used yet
+    next = (bsp_kv_head + 1) % BSP_KV_SECTOR_COUNT;
+    if (bsp_kv_head_start(next, bsp_kv_head_seq + 1) != BSP_STATUS_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    next = (next + 1) % BSP_KV_SECTOR_COUNT;
+    if (bsp_kv_sector_live(next))
+    {
+        bsp_kv_gc_start(next);
+    }
+
+    return BSP_STATUS_OK;
+}
+
+/**
+ * Index the records of a sector, oldest first, so later records of a key replace earlier ones
+ *
+ * Only the head can end in a record torn by a reset, as nothing is written anywhere else after it; its last record is
+ * checked against its CRC and marked superseded if it does not match.
+ *
+ */
+static void bsp_kv_scan(uint32_t sector, bool head)
+{
+    uint32_t addr = bsp_kv_sector_addr(sector) + BSP_KV_HDR_SIZE;
+    uint32_t end = bsp_kv_sector_addr(sector) + BSP_KV_SECTOR_SIZE;
+
+    while ((end - addr) >= BSP_KV_RECORD_SIZE(0))
+    {
+        uint32_t word = bsp_kv_word(addr);
+        uint32_t key = word & BSP_KV_KEY_MASK;
+        uint32_t len = word >> BSP_KV_LEN_SHIFT;
+        uint32_t size = BSP_KV_RECORD_SIZE(len);
+
+        if (word == BSP_KV_ERASED)
+        {
+            break;
+        }
+
+        // A length that cannot be right can only come from a torn write, and leaves nowhere safe to write after it
+        if ((len > BSP_KV_VALUE_MAX) || (size > (end - addr)))
+        {
+            addr = end;
+            break;
+        }
+
+        if (head && (((end - addr) == size) || (bsp_kv_word(addr + size) == BSP_KV_ERASED)) &&
+            !bsp_kv_record_valid(addr, len))
+        {
+            bsp_kv_program(addr, word & ~BSP_KV_KEY_MASK);
+            bsp_kv_stats.torn++;
+            key = BSP_KV_KEY_DEAD;
+        }
+
+        if (key == BSP_KV_KEY_DEAD)
+        {
+            // Superseded
+        }
+        else if (len == 0)
+        {
+            bsp_kv_index_remove(key);
+        }
+        else
+        {
+            // Keys beyond BSP_KV_KEYS_MAX, from a build that allowed more, are dropped
+            bsp_kv_index_set(key, len, addr);
+        }
+
+        addr += size;
+    }
+
+    if (head)
+    {
+        bsp_kv_write_addr = addr;
+    }
+
+    return;
+}
+
+static void bsp_kv_reset(void)
+{
+    memset(bsp_kv_index, 0, sizeof(bsp_kv_index));
+    memset(&bsp_kv_stats, 0, sizeof(bsp_kv_stats));
+    bsp_kv_live_bytes = 0;
+    bsp_kv_gc_active = false;
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * BSP INTERNAL FUNCTIONS
+ **********************************************************************************************************************/
+uint32_t bsp_kv_init(void)
+{
+    uint32_t order[BSP_KV_SECTOR_COUNT];
+    uint32_t seqs[BSP_KV_SECTOR_COUNT];
+    uint32_t count = 0;
+    uint32_t ret = BSP_STATUS_OK;
+    uint32_t next;
+
+    bsp_kv_reset();
+    bsp_kv_unlock();
+
+    // Sort the sectors in use by sequence number, and erase any left by a compaction or head change cut short
+    for (uint32_t sector = 0; (ret == BSP_STATUS_OK) && (sector < BSP_KV_SECTOR_COUNT); sector++)
+    {
+        uint32_t addr = bsp_kv_sector_addr(sector);
+        uint32_t seq = bsp_kv_word(addr + BSP_KV_HDR_SEQ);
+        uint32_t i;
+
+        if (bsp_kv_sector_live(sector))
+        {
+            for (i = count; (i > 0) && (seqs[i - 1] > seq); i--)
+            {
+                order[i] = order[i - 1];
+                seqs[i] = seqs[i - 1];
+            }
+            order[i] = sector;
+            seqs[i] = seq;
+            count++;
+        }
+        else if ((bsp_kv_word(addr + BSP_KV_HDR_MAGIC) != BSP_KV_ERASED) || (seq != BSP_KV_ERASED) ||
+                 (bsp_kv_word(addr + BSP_KV_HDR_STATE) != BSP_KV_ERASED))
+        {
+            ret = bsp_kv_erase(sector);
+        }
+    }
+
+    if (ret != BSP_STATUS_OK)
+    {
+        // Flash failed
+    }
+    else if (count == 0)
+    {
+        ret = bsp_kv_head_start(0, 1);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            bsp_kv_scan(order[i], i == (count - 1));
+        }
+        bsp_kv_head = order[count - 1];
+        bsp_kv_head_seq = seqs[count - 1];
+
+        // A compaction cut short starts again from the beginning; records it already copied are no longer live there
+        next = (bsp_kv_head + 1) % BSP_KV_SECTOR_COUNT;
+        if (bsp_kv_sector_live(next))
+        {
+            bsp_kv_gc_start(next);
+        }
+    }
+
+    bsp_kv_lock();
+
+    return ret;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+uint32_t bsp_kv_get(uint32_t key, void *buf, uint32_t size, uint32_t *len)
+{
+    const bsp_kv_slot_t *slot;
+
+    if ((key < BSP_KV_KEY_MIN) || (key > BSP_KV_KEY_MAX) || ((buf == NULL) && (size != 0)))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    slot = bsp_kv_index_find(key);
+    if (slot == NULL)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    if (size != 0)
+    {
+        memcpy(buf, (const void *) (uintptr_t) (slot->addr + 4), (slot->len < size) ? slot->len : size);
+    }
+    if (len != NULL)
+    {
+        *len = slot->len;
+    }
+
+    return BSP_STATUS_OK;
+}
+
+uint32_t bsp_kv_set(uint32_t key, const void *data, uint32_t len)
+{
+    const bsp_kv_slot_t *slot;
+    uint32_t old_size;
+    uint32_t addr;
+    uint32_t ret;
+
+    if ((key < BSP_KV_KEY_MIN) || (key > BSP_KV_KEY_MAX) || (data == NULL) || (len == 0) ||
+        (len > BSP_KV_VALUE_MAX))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    slot = bsp_kv_index_find(key);
+    if (slot == NULL)
+    {
+        if (bsp_kv_stats.keys >= BSP_KV_KEYS_MAX)
+        {
+            return BSP_STATUS_FAIL;
+        }
+        old_size = 0;
+    }
+    else if ((slot->len == len) && (memcmp((const void *) (uintptr_t) (slot->addr + 4), data, len) == 0))
+    {
+        // Already stored; saves the flash a write
+        return BSP_STATUS_OK;
+    }
+    else
+    {
+        old_size = BSP_KV_RECORD_SIZE(slot->len);
+    }
+
+    if ((bsp_kv_live_bytes - old_size + BSP_KV_RECORD_SIZE(len)) > BSP_KV_LIVE_MAX)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    bsp_kv_unlock();
+    ret = bsp_kv_make_room(BSP_KV_RECORD_SIZE(len));
+    if (ret == BSP_STATUS_OK)
+    {
+        ret = bsp_kv_append(key, data, len, &addr);
+    }
+    bsp_kv_lock();
+
+    if (ret != BSP_STATUS_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    bsp_kv_index_set(key, len, addr);
+    bsp_kv_stats.writes++;
+
+    return BSP_STATUS_OK;
+}
+
+uint32_t bsp_kv_delete(uint32_t key)
+{
+    uint32_t addr;
+    uint32_t ret;
+
+    if ((key < BSP_KV_KEY_MIN) || (key > BSP_KV_KEY_MAX))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    if (bsp_kv_index_find(key) == NULL)
+    {
+        return BSP_STATUS_OK;
+    }
+
+    bsp_kv_unlock();
+    ret = bsp_kv_make_room(BSP_KV_RECORD_SIZE(0));
+    if (ret == BSP_STATUS_OK)
+    {
+        ret = bsp_kv_append(key, NULL, 0, &addr);
+    }
+    bsp_kv_lock();
+
+    if (ret != BSP_STATUS_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    bsp_kv_index_remove(key);
+    bsp_kv_stats.writes++;
+
+    return BSP_STATUS_OK;
+}
+
+uint32_t bsp_kv_format(void)
+{
+    uint32_t ret = BSP_STATUS_OK;
+
+    bsp_kv_reset();
+    bsp_kv_unlock();
+
+    for (uint32_t sector = 0; (ret == BSP_STATUS_OK) && (sector < BSP_KV_SECTOR_COUNT); sector++)
+    {
+        if (!bsp_kv_sector_blank(sector))
+        {
+            ret = bsp_kv_erase(sector);
+        }
+    }
+
+    if (ret == BSP_STATUS_OK)
+    {
+        ret = bsp_kv_head_start(0, 1);
+    }
+
+    bsp_kv_lock();
+
+    return ret;
+}
+
+bool bsp_kv_compact_step(void)
+{
+    uint32_t ret;
+
+    if (!bsp_kv_gc_active)
+    {
+        return false;
+    }
+
+    // With every live record copied only the erase is left, which waits for the peripherals to go quiet; a write that
+    // runs out of room before then erases regardless
+    if ((bsp_kv_gc_live == 0) && !bsp_kv_erase_quiet())
+    {
+        if (!bsp_timer_is_running(bsp_kv_retry_timer))
+        {
+            bsp_timer_start(&bsp_kv_retry_timer, BSP_KV_ERASE_RETRY_MS, 0, bsp_kv_retry_cb, NULL);
+        }
+        return false;
+    }
+
+    bsp_kv_unlock();
+    ret = bsp_kv_gc_step();
+    bsp_kv_lock();
+
+    // A failed step is retried from the next idle period rather than straight away
+    return ret == BSP_STATUS_OK;
+}
+
+uint32_t bsp_kv_get_stats(bsp_kv_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    *stats = bsp_kv_stats;
+    stats->live_bytes = bsp_kv_live_bytes;
+    stats->live_max = BSP_KV_LIVE_MAX;
+    stats->head_free = bsp_kv_head_free();
+
+    return BSP_STATUS_OK;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file bsp_kv.h
+ *
+ * @brief Log-structured key/value store in on-chip flash, with a RAM index built at start-up
+ *
+ * Values of up to BSP_KV_VALUE_MAX bytes are kept under 16-bit keys in BSP_KV_SECTOR_COUNT of the 128 KiB flash
+ * sectors, used as a ring.  A write appends a record to the newest sector, the head, and never erases in the common
+ * case; the previous record of the key is only superseded.  Each record ends with a CRC-32 programmed last, so a
+ * record torn by a reset is found and skipped at the next start-up.
+ *
+ * Start-up reads every record header once to build a hash index in RAM of where the latest value of each key is, so a
+ * read is a hash lookup and a copy out of flash, taking a few microseconds.
+ *
+ * When the head fills, writes move on to the next sector of the ring, which compaction has already erased.  The
+ * sector after that, now the oldest, is compacted from idle time: bsp_sleep() copies its live records into the head
+ * one per call with bsp_kv_compact_step(), then erases it once no ADC stream, SPI or I2C job or console input is
+ * active.  A write that would otherwise run out of room finishes the compaction itself.  Sectors take their turn as the
+ * head, which spreads erases over all of them.
+ *
+ * Live data, counted as whole records, is limited to one sector less room for two of the largest records, so the
+ * oldest sector always fits in the head.  More sectors mean fewer and cheaper compactions, not more capacity.
+ *
+ * @warning The flash has a single bank, so the CPU stalls while it is programmed or erased, including interrupts whose
+ *          handler or vector is in flash: about 16 us per word written and 1 to 2 s per sector erased.  Erases only
+ *          happen in bsp_kv_compact_step(), bsp_kv_format(), at start-up, and in a write that has to finish a
+ *          compaction.  Peripherals served by interrupt rather than DMA can overrun meanwhile.
+ *
+ * @warning The image must end below the store, at 0x08040000 with the default sectors.  The linker script does not
+ *          reserve them, but bsp_kv.ld fails the link of an image that reaches them.
+ *
+ * The store is main-loop only.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_KV_H
+#define BSP_KV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include "bsp.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief First flash sector of the store, and how many it uses; only the 128 KiB sectors 5 to 7 can be used
+ *
+ */
+#ifndef BSP_KV_SECTOR_FIRST
+#define BSP_KV_SECTOR_FIRST             (6)
+#endif
+
+#ifndef BSP_KV_SECTOR_COUNT
+#define BSP_KV_SECTOR_COUNT             (2)
+#endif
+
+/**
+ * @brief Keys that can be stored at once; a power of two, as the index has twice as many slots
+ *
+ */
+#ifndef BSP_KV_KEYS_MAX
+#define BSP_KV_KEYS_MAX                 (128)
+#endif
+
+/**
+ * @brief Longest value
+ *
+ */
+#ifndef BSP_KV_VALUE_MAX
+#define BSP_KV_VALUE_MAX                (256)
+#endif
+
+/**
+ * @brief Range of keys; 0 and 0xFFFF mark superseded and unwritten records in flash
+ *
+ */
+#define BSP_KV_KEY_MIN                  (0x0001)
+#define BSP_KV_KEY_MAX                  (0xFFFE)
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * Store statistics
+ *
+ * @see bsp_kv_get_stats
+ *
+ */
+typedef struct
+{
+    uint32_t keys;                  ///< Keys stored
+    uint32_t live_bytes;            ///< Flash taken by the latest record of each key, headers included
+    uint32_t live_max;              ///< Most live_bytes can reach
+    uint32_t head_free;             ///< Bytes left in the head sector
+    uint32_t writes;                ///< Records appended by bsp_kv_set() and bsp_kv_delete() since start-up
+    uint32_t copies;                ///< Records copied forward by compaction since start-up
+    uint32_t compactions;           ///< Sectors compacted and erased since start-up
+    uint32_t foreground;            ///< Compactions a write had to finish itself
+    uint32_t torn;                  ///< Torn records found at start-up
+} bsp_kv_stats_t;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Copy the value of a key
+ *
+ * @param [in] key              BSP_KV_KEY_MIN to BSP_KV_KEY_MAX
+ * @param [out] buf             Receives up to size bytes of the value
+ * @param [in] size             Size of buf
+ * @param [out] len             Length of the value, which may be more than size, or NULL
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if the key is not stored
+ *
+ */
+uint32_t bsp_kv_get(uint32_t key, void *buf, uint32_t size, uint32_t *len);
+
+/**
+ * Store a value, replacing any previous one of the key
+ *
+ * Appends a record to the head sector, moving the head on to the next sector if it is full.  May finish a compaction
+ * first, erasing a sector, see the warning above.
+ *
+ * @param [in] key              BSP_KV_KEY_MIN to BSP_KV_KEY_MAX
+ * @param [in] data             Value
+ * @param [in] len              1 to BSP_KV_VALUE_MAX
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if an argument is out of range, the store is full or flash failed
+ *
+ */
+uint32_t bsp_kv_set(uint32_t key, const void *data, uint32_t len);
+
+/**
+ * Remove a key, appending a record that marks it deleted
+ *
+ * @return BSP_STATUS_OK, including if the key was not stored, or BSP_STATUS_FAIL if key is out of range or flash
+ *         failed
+ *
+ */
+uint32_t bsp_kv_delete(uint32_t key);
+
+/**
+ * Erase every sector of the store, leaving it empty
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if flash failed
+ *
+ */
+uint32_t bsp_kv_format(void);
+
+/**
+ * Take one step of a pending compaction: copy one live record of the oldest sector into the head, or erase the oldest
+ * sector once it holds none
+ *
+ * Called from bsp_sleep(), so compaction runs while the application is idle, one step between events.  The erase is
+ * held back while an ADC stream runs, SPI or I2C jobs are queued, or console input arrived in the last few seconds,
+ * as none of them would survive the CPU stalling for it.
+ *
+ * @return Whether there was a step to take
+ *
+ */
+bool bsp_kv_compact_step(void);
+
+/**
+ * Get the store's statistics
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if stats is NULL
+ *
+ */
+uint32_t bsp_kv_get_stats(bsp_kv_stats_t *stats);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_KV_H
@@ -0,0 +1,252 @@
+/**
+ * @file bsp_led.c
+ *
+ * @brief Implementation of the LD2 pattern engine, see bsp_led.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include "bsp_led.h"
+#include "bsp_internal.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+// TIM2 counts microseconds, so duty table entries and periods are written to it as they are
+#define BSP_LED_PWM_CLOCK_HZ            (1000000)
+
+// TIM1 counts tenths of a millisecond, for steps of up to 6.5 s on its 16-bit counter
+#define BSP_LED_STEP_CLOCK_HZ           (10000)
+#define BSP_LED_STEP_TICKS_PER_MS       (BSP_LED_STEP_CLOCK_HZ / 1000)
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static TIM_HandleTypeDef bsp_led_pwm_handle;
+static TIM_HandleTypeDef bsp_led_step_handle;
+static DMA_HandleTypeDef bsp_led_dma_handle;
+
+// True while STOP is locked out because the LED needs TIM2 running
+static bool bsp_led_stop_locked = false;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static void bsp_led_set_stop_locked(bool locked)
+{
+    if (locked && !bsp_led_stop_locked)
+    {
+        bsp_power_lock_stop();
+    }
+    else if (!locked && bsp_led_stop_locked)
+    {
+        bsp_power_unlock_stop();
+    }
+    bsp_led_stop_locked = locked;
+
+    return;
+}
+
+/**
+ * Stop the step clock and its DMA stream, leaving TIM2 at the duty last written
+ *
+ */
+static void bsp_led_halt(void)
+{
+    __HAL_TIM_DISABLE(&bsp_led_step_handle);
+    __HAL_TIM_DISABLE_DMA(&bsp_led_step_handle, TIM_DMA_UPDATE);
+
+    if (bsp_led_dma_handle.State == HAL_DMA_STATE_BUSY)
+    {
+        HAL_DMA_Abort(&bsp_led_dma_handle);
+    }
+
+    return;
+}
+
+/**
+ * Load a period and duty into TIM2 now, restarting the PWM period, rather than when the current period ends
+ *
+ */
+static void bsp_led_load(uint32_t on_us, uint32_t period_us)
+{
+    __HAL_TIM_SET_AUTORELOAD(&bsp_led_pwm_handle, period_us - 1);
+    __HAL_TIM_SET_COMPARE(&bsp_led_pwm_handle, TIM_CHANNEL_1, on_us);
+    bsp_led_pwm_handle.Instance->EGR = TIM_EGR_UG;
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * BSP INTERNAL FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Start the TIM2 PWM carrier with LD2 off, and prepare TIM1 and DMA2 Stream5 to step patterns
+ *
+ */
+uint32_t bsp_led_init(void)
+{
+    TIM_OC_InitTypeDef oc_init = {0};
+
+    __HAL_RCC_TIM1_CLK_ENABLE();
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    // Auto-reload and compare are preloaded, so a period or duty written mid-period applies from the next one
+    bsp_led_pwm_handle.Instance = TIM2;
+    bsp_led_pwm_handle.Init.Prescaler = (bsp_apb1_timer_hz() / BSP_LED_PWM_CLOCK_HZ) - 1;
+    bsp_led_pwm_handle.Init.Period = BSP_LED_PERIOD_US - 1;
+    bsp_led_pwm_handle.Init.ClockDivision = 0;
+    bsp_led_pwm_handle.Init.CounterMode = TIM_COUNTERMODE_UP;
+    bsp_led_pwm_handle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    if (HAL_TIM_PWM_Init(&bsp_led_pwm_handle) != HAL_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    // PWM mode 1: LD2 is on while the counter is below CCR1, so 0 is off and anything above the period fully on
+    oc_init.OCMode = TIM_OCMODE_PWM1;
+    oc_init.Pulse = BSP_LED_OFF;
+    oc_init.OCPolarity = TIM_OCPOLARITY_HIGH;
+    oc_init.OCFastMode = TIM_OCFAST_DISABLE;
+    if ((HAL_TIM_PWM_ConfigChannel(&bsp_led_pwm_handle, &oc_init, TIM_CHANNEL_1) != HAL_OK) ||
+        (HAL_TIM_PWM_Start(&bsp_led_pwm_handle, TIM_CHANNEL_1) != HAL_OK))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    // The step clock only runs while a pattern plays; its update events are DMA requests, never interrupts
+    bsp_led_step_handle.Instance = TIM1;
+    bsp_led_step_handle.Init.Prescaler = (bsp_apb2_timer_hz() / BSP_LED_STEP_CLOCK_HZ) - 1;
+    bsp_led_step_handle.Init.Period = BSP_LED_STEP_TICKS_PER_MS - 1;
+    bsp_led_step_handle.Init.ClockDivision = 0;
+    bsp_led_step_handle.Init.CounterMode = TIM_COUNTERMODE_UP;
+    bsp_led_step_handle.Init.RepetitionCounter = 0;
+    bsp_led_step_handle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_Base_Init(&bsp_led_step_handle) != HAL_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    // TIM1_UP is mapped to DMA2 Stream5, channel 6.  DMA2, unlike DMA1, can reach the APB1 bus TIM2 sits on.
+    bsp_led_dma_handle.Instance                 = DMA2_Stream5;
+    bsp_led_dma_handle.Init.Channel             = DMA_CHANNEL_6;
+    bsp_led_dma_handle.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+    bsp_led_dma_handle.Init.PeriphInc           = DMA_PINC_DISABLE;
+    bsp_led_dma_handle.Init.MemInc              = DMA_MINC_ENABLE;
+    bsp_led_dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    bsp_led_dma_handle.Init.MemDataAlignment    = DMA_MDATAALIGN_WORD;
+    bsp_led_dma_handle.Init.Mode                = DMA_CIRCULAR;
+    bsp_led_dma_handle.Init.Priority            = DMA_PRIORITY_LOW;
+    bsp_led_dma_handle.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&bsp_led_dma_handle) != HAL_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    return BSP_STATUS_OK;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+uint32_t bsp_led_play(const bsp_led_pattern_t *pattern)
+{
+    uint32_t ret = BSP_STATUS_FAIL;
+    uint32_t period_us;
+    uint32_t primask;
+
+    if ((pattern == NULL) || (pattern->duty == NULL) || (pattern->count == 0) ||
+        (pattern->count > BSP_LED_STEPS_MAX) || (pattern->step_ms == 0) || (pattern->step_ms > BSP_LED_STEP_MAX_MS) ||
+        (pattern->period_us == 1))
+    {
+        return BSP_STATUS_FAIL;
+    }
+    period_us = (pattern->period_us != 0) ? pattern->period_us : BSP_LED_PERIOD_US;
+
+    primask = bsp_critical_enter();
+
+    bsp_led_halt();
+    bsp_led_load(BSP_LED_OFF, period_us);
+    bsp_led_set_stop_locked(true);
+
+    if (HAL_DMA_Start(&bsp_led_dma_handle, (uint32_t) (uintptr_t) pattern->duty,
+                      (uint32_t) (uintptr_t) &bsp_led_pwm_handle.Instance->CCR1, pattern->count) == HAL_OK)
+    {
+        __HAL_TIM_SET_AUTORELOAD(&bsp_led_step_handle, (pattern->step_ms * BSP_LED_STEP_TICKS_PER_MS) - 1);
+        __HAL_TIM_SET_COUNTER(&bsp_led_step_handle, 0);
+        __HAL_TIM_ENABLE_DMA(&bsp_led_step_handle, TIM_DMA_UPDATE);
+
+        // The update event generated here requests the first entry, so the first step starts now, not after one step
+        bsp_led_step_handle.Instance->EGR = TIM_EGR_UG;
+        __HAL_TIM_ENABLE(&bsp_led_step_handle);
+        ret = BSP_STATUS_OK;
+    }
+    else
+    {
+        bsp_led_set_stop_locked(false);
+    }
+
+    bsp_critical_exit(primask);
+
+    return ret;
+}
+
+uint32_t bsp_led_set(uint32_t on_us, uint32_t period_us)
+{
+    uint32_t primask;
+
+    if (period_us == 1)
+    {
+        return BSP_STATUS_FAIL;
+    }
+    period_us = (period_us != 0) ? period_us : BSP_LED_PERIOD_US;
+
+    primask = bsp_critical_enter();
+
+    bsp_led_halt();
+    bsp_led_load(on_us, period_us);
+
+    // A steady level is held through STOP, when TIM2 stops with its output as it was
+    bsp_led_set_stop_locked((on_us != BSP_LED_OFF) && (on_us < period_us));
+
+    bsp_critical_exit(primask);
+
+    return BSP_STATUS_OK;
+}
+
+void bsp_led_fill_breathe(uint32_t *duty, uint32_t count, uint32_t period_us)
+{
+    uint32_t half = count / 2;
+    uint32_t i;
+
+    period_us = (period_us != 0) ? period_us : BSP_LED_PERIOD_US;
+
+    for (i = 0; (half > 0) && (i < count); i++)
+    {
+        uint64_t level = (i <= half) ? i : (count - i);
+
+        duty[i] = (uint32_t) ((period_us * level * level) / ((uint64_t) half * half));
+    }
+
+    return;
+}
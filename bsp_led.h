@@ -0,0 +1,150 @@
+/**
+ * @file bsp_led.h
+ *
+ * @brief LD2 pattern engine: hardware PWM on TIM2 channel 1 (PA5), its duty stepped from a table by DMA
+ *
+ * TIM2 generates the PWM carrier on LD2.  TIM1 is the step clock: each of its update events requests DMA2 Stream5,
+ * which copies the next entry of the pattern's duty table into TIM2 CCR1, wrapping round to the first entry for ever.
+ * CCR1 is preloaded, so a new duty takes effect at the start of the next PWM period and never cuts one short.
+ *
+ * Once a pattern is playing the core has nothing to do: neither timer nor the DMA stream has an interrupt enabled, so
+ * the main loop sleeps through whole patterns.  The timers and DMA are not clocked in STOP though, so STOP is held off
+ * while a pattern plays or a level between fully off and fully on is set.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_LED_H
+#define BSP_LED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdint.h>
+#include "bsp.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief Duty table entry for fully on: longer than any PWM period, so the output never goes inactive
+ *
+ */
+#define BSP_LED_ON                      (0xFFFFFFFF)
+
+/**
+ * @brief Duty table entry for fully off
+ *
+ */
+#define BSP_LED_OFF                     (0)
+
+/**
+ * @brief PWM period used by bsp_set_gpio() and by patterns that leave period_us at 0
+ *
+ */
+#ifndef BSP_LED_PERIOD_US
+#define BSP_LED_PERIOD_US               (1000)
+#endif
+
+/**
+ * @brief Longest step, set by the 16-bit TIM1 counting at 10 kHz
+ *
+ */
+#define BSP_LED_STEP_MAX_MS             (6553)
+
+/**
+ * @brief Most entries in a duty table, set by the 16-bit DMA transfer count
+ *
+ */
+#define BSP_LED_STEPS_MAX               (0xFFFF)
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * A looping LED pattern
+ *
+ * Every step lasts step_ms and drives LD2 at the PWM duty of its entry in the table: the time on in each period, in
+ * microseconds, from BSP_LED_OFF to BSP_LED_ON.  A blink is a table of BSP_LED_ON and BSP_LED_OFF entries, a breathing
+ * effect a ramp filled by bsp_led_fill_breathe().
+ *
+ * @see bsp_led_play
+ *
+ */
+typedef struct
+{
+    const uint32_t *duty;           ///< Time on per PWM period for each step, read by DMA while the pattern plays
+    uint32_t count;                 ///< Steps in the table, 1 to BSP_LED_STEPS_MAX
+    uint32_t step_ms;               ///< Length of every step, 1 to BSP_LED_STEP_MAX_MS
+    uint32_t period_us;             ///< PWM period, at least 2; 0 for BSP_LED_PERIOD_US
+} bsp_led_pattern_t;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Play a pattern on LD2 until the next bsp_led_play() or bsp_led_set()
+ *
+ * The first step starts at once and the pattern then loops with no further work from the core.
+ *
+ * @param [in] pattern          Pattern to play; only the table must outlive the call
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if the pattern is out of range, leaving the LED as it was, or if the DMA
+ *         stream could not be started, leaving it off
+ *
+ * @warning The duty table is read by DMA for as long as the pattern plays, so it must not change or go out of scope
+ *
+ */
+uint32_t bsp_led_play(const bsp_led_pattern_t *pattern);
+
+/**
+ * Stop any pattern and hold LD2 at a steady PWM duty
+ *
+ * @param [in] on_us            Time on per period, from BSP_LED_OFF to BSP_LED_ON
+ * @param [in] period_us        PWM period, at least 2; 0 for BSP_LED_PERIOD_US
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if period_us is out of range
+ *
+ */
+uint32_t bsp_led_set(uint32_t on_us, uint32_t period_us);
+
+/**
+ * Fill a duty table with one breath: a ramp up from off to fully on and back down, squared so that the brightness
+ * looks linear to the eye
+ *
+ * @param [out] duty            Table of count entries
+ * @param [in] count            Steps per breath, at least 2
+ * @param [in] period_us        PWM period the table will be played with; 0 for BSP_LED_PERIOD_US
+ *
+ */
+void bsp_led_fill_breathe(uint32_t *duty, uint32_t count, uint32_t period_us);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_LED_H
@@ -0,0 +1,506 @@
+/**
+ * @file bsp_log.c
+ *
+ * @brief Implementation of the in-place console formatter
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include "bsp_log.h"
+#include "bsp_ring.h"
+#include "bsp_internal.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define BSP_LOG_FLAG_LEFT               (1 << 0)
+#define BSP_LOG_FLAG_ZERO               (1 << 1)
+#define BSP_LOG_FLAG_PLUS               (1 << 2)
+
+#define BSP_LOG_LENGTH_INT              (0)
+#define BSP_LOG_LENGTH_LONG             (1)
+#define BSP_LOG_LENGTH_SIZE             (2)
+
+// Room for a sign-less 64-bit integer part, the point and BSP_LOG_FLOAT_PRECISION_MAX decimals
+#define BSP_LOG_NUM_BUFFER_SIZE         (32)
+
+/**
+ * Destination of a message: the free space of the TX FIFO, as a span up to the end of the buffer and, if the free
+ * space wraps, a second span from its start
+ *
+ * Bytes past the free space are counted but not stored, so an oversized message is measured exactly before it is
+ * dropped.
+ *
+ */
+typedef struct
+{
+    uint8_t *first;
+    uint32_t first_size;
+    uint8_t *second;
+    uint32_t space;
+    uint32_t count;
+} bsp_log_sink_t;
+
+typedef struct
+{
+    uint32_t flags;
+    uint32_t width;
+    int32_t precision;              ///< -1 when none was given
+    uint32_t length;
+} bsp_log_spec_t;
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static const uint32_t bsp_log_pow10[BSP_LOG_FLOAT_PRECISION_MAX + 1] =
+{
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static const char bsp_log_digits_lower[] = "0123456789abcdef";
+static const char bsp_log_digits_upper[] = "0123456789ABCDEF";
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static inline void bsp_log_put(bsp_log_sink_t *sink, char c)
+{
+    uint32_t i = sink->count++;
+
+    if (i < sink->first_size)
+    {
+        sink->first[i] = (uint8_t) c;
+    }
+    else if (i < sink->space)
+    {
+        sink->second[i - sink->first_size] = (uint8_t) c;
+    }
+
+    return;
+}
+
+static void bsp_log_pad(bsp_log_sink_t *sink, char c, uint32_t count)
+{
+    while (count-- > 0)
+    {
+        bsp_log_put(sink, c);
+    }
+
+    return;
+}
+
+/**
+ * Emit a converted field with its sign, padded out to the field width
+ *
+ */
+static void bsp_log_field(bsp_log_sink_t *sink, const bsp_log_spec_t *spec, char sign, const char *text, uint32_t len)
+{
+    uint32_t total = len + ((sign != 0) ? 1 : 0);
+    uint32_t pad = (spec->width > total) ? (spec->width - total) : 0;
+
+    if ((spec->flags & (BSP_LOG_FLAG_LEFT | BSP_LOG_FLAG_ZERO)) == 0)
+    {
+        bsp_log_pad(sink, ' ', pad);
+    }
+    if (sign != 0)
+    {
+        bsp_log_put(sink, sign);
+    }
+    if ((spec->flags & (BSP_LOG_FLAG_LEFT | BSP_LOG_FLAG_ZERO)) == BSP_LOG_FLAG_ZERO)
+    {
+        bsp_log_pad(sink, '0', pad);
+    }
+    while (len-- > 0)
+    {
+        bsp_log_put(sink, *text++);
+    }
+    if ((spec->flags & BSP_LOG_FLAG_LEFT) != 0)
+    {
+        bsp_log_pad(sink, ' ', pad);
+    }
+
+    return;
+}
+
+/**
+ * Convert value to digits ending just before end
+ *
+ * @return Start of the digits
+ *
+ */
+static char *bsp_log_utoa(char *end, uint64_t value, uint32_t base, const char *digits)
+{
+    uint32_t value32;
+
+    // 64-bit division is a library call on the Cortex-M4, so only use it for the digits that need it
+    while (value > UINT32_MAX)
+    {
+        *--end = digits[value % base];
+        value /= base;
+    }
+
+    value32 = (uint32_t) value;
+    do
+    {
+        *--end = digits[value32 % base];
+        value32 /= base;
+    } while (value32 != 0);
+
+    return end;
+}
+
+static void bsp_log_float(bsp_log_sink_t *sink, const bsp_log_spec_t *spec, double value)
+{
+    char buffer[BSP_LOG_NUM_BUFFER_SIZE];
+    char *end = buffer + sizeof(buffer);
+    char *start = end;
+    char sign = ((spec->flags & BSP_LOG_FLAG_PLUS) != 0) ? '+' : 0;
+    uint32_t precision = BSP_LOG_FLOAT_PRECISION_DEFAULT;
+
+    if (spec->precision >= 0)
+    {
+        precision = ((uint32_t) spec->precision > BSP_LOG_FLOAT_PRECISION_MAX) ?
+                    BSP_LOG_FLOAT_PRECISION_MAX : (uint32_t) spec->precision;
+    }
+
+    if (value != value)
+    {
+        bsp_log_field(sink, spec, 0, "nan", 3);
+        return;
+    }
+
+    if (__builtin_signbit(value))
+    {
+        sign = '-';
+        value = -value;
+    }
+
+    // Round half up at the last printed decimal
+    value += 0.5 / bsp_log_pow10[precision];
+
+    if (value >= 18446744073709551616.0)
+    {
+        bsp_log_field(sink, spec, sign, "inf", 3);
+        return;
+    }
+
+    if (precision > 0)
+    {
+        uint64_t integer = (uint64_t) value;
+        uint32_t fraction = (uint32_t) ((value - (double) integer) * bsp_log_pow10[precision]);
+        char *decimals = end - precision;
+
+        // Guard against the product rounding up to the next integer
+        if (fraction >= bsp_log_pow10[precision])
+        {
+            fraction = bsp_log_pow10[precision] - 1;
+        }
+
+        start = bsp_log_utoa(end, fraction, 10, bsp_log_digits_lower);
+        while (start > decimals)
+        {
+            *--start = '0';
+        }
+        *--start = '.';
+        start = bsp_log_utoa(start, integer, 10, bsp_log_digits_lower);
+    }
+    else
+    {
+        start = bsp_log_utoa(end, (uint64_t) value, 10, bsp_log_digits_lower);
+    }
+
+    bsp_log_field(sink, spec, sign, start, (uint32_t) (end - start));
+
+    return;
+}
+
+/**
+ * Parse flags, width, precision and length of a conversion, leaving *fmt at the conversion character
+ *
+ */
+static void bsp_log_parse_spec(const char **fmt, va_list *args, bsp_log_spec_t *spec)
+{
+    const char *p = *fmt;
+
+    spec->flags = 0;
+    spec->width = 0;
+    spec->precision = -1;
+    spec->length = BSP_LOG_LENGTH_INT;
+
+    for (;; p++)
+    {
+        if (*p == '-')
+        {
+            spec->flags |= BSP_LOG_FLAG_LEFT;
+        }
+        else if (*p == '0')
+        {
+            spec->flags |= BSP_LOG_FLAG_ZERO;
+        }
+        else if (*p == '+')
+        {
+            spec->flags |= BSP_LOG_FLAG_PLUS;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (*p == '*')
+    {
+        int width = va_arg(*args, int);
+
+        if (width < 0)
+        {
+            spec->flags |= BSP_LOG_FLAG_LEFT;
+            width = -width;
+        }
+        spec->width = (uint32_t) width;
+        p++;
+    }
+    else
+    {
+        while ((*p >= '0') && (*p <= '9'))
+        {
+            spec->width = (spec->width * 10) + (uint32_t) (*p++ - '0');
+        }
+    }
+
+    if (*p == '.')
+    {
+        p++;
+        spec->precision = 0;
+        if (*p == '*')
+        {
+            spec->precision = va_arg(*args, int);
+            p++;
+        }
+        else
+        {
+            while ((*p >= '0') && (*p <= '9'))
+            {
+                spec->precision = (spec->precision * 10) + (*p++ - '0');
+            }
+        }
+    }
+
+    // Arguments narrower than int arrive promoted, so 'h' and 'hh' need nothing
+    while (*p == 'h')
+    {
+        p++;
+    }
+    if (*p == 'l')
+    {
+        spec->length = BSP_LOG_LENGTH_LONG;
+        p++;
+    }
+    else if (*p == 'z')
+    {
+        spec->length = BSP_LOG_LENGTH_SIZE;
+        p++;
+    }
+
+    *fmt = p;
+
+    return;
+}
+
+static void bsp_log_format(bsp_log_sink_t *sink, const char *fmt, va_list args)
+{
+    va_list ap;
+
+    // Work on a copy so the argument list can be passed by address to the spec parser on every ABI
+    va_copy(ap, args);
+
+    while (*fmt != '\0')
+    {
+        char buffer[BSP_LOG_NUM_BUFFER_SIZE];
+        char *end = buffer + sizeof(buffer);
+        bsp_log_spec_t spec;
+        char *start;
+        char sign = 0;
+        uint64_t value;
+
+        if (*fmt != '%')
+        {
+            bsp_log_put(sink, *fmt++);
+            continue;
+        }
+
+        fmt++;
+        bsp_log_parse_spec(&fmt, &ap, &spec);
+
+        switch (*fmt)
+        {
+            case 'd':
+            case 'i':
+            {
+                int64_t svalue;
+
+                if (spec.length == BSP_LOG_LENGTH_LONG)
+                {
+                    svalue = va_arg(ap, long);
+                }
+                else if (spec.length == BSP_LOG_LENGTH_SIZE)
+                {
+                    svalue = (int64_t) va_arg(ap, size_t);
+                }
+                else
+                {
+                    svalue = va_arg(ap, int);
+                }
+
+                if (svalue < 0)
+                {
+                    sign = '-';
+                    value = (uint64_t) 0 - (uint64_t) svalue;
+                }
+                else
+                {
+                    sign = ((spec.flags & BSP_LOG_FLAG_PLUS) != 0) ? '+' : 0;
+                    value = (uint64_t) svalue;
+                }
+
+                start = bsp_log_utoa(end, value, 10, bsp_log_digits_lower);
+                bsp_log_field(sink, &spec, sign, start, (uint32_t) (end - start));
+                break;
+            }
+
+            case 'u':
+            case 'x':
+            case 'X':
+                if (spec.length == BSP_LOG_LENGTH_LONG)
+                {
+                    value = va_arg(ap, unsigned long);
+                }
+                else if (spec.length == BSP_LOG_LENGTH_SIZE)
+                {
+                    value = va_arg(ap, size_t);
+                }
+                else
+                {
+                    value = va_arg(ap, unsigned int);
+                }
+
+                start = bsp_log_utoa(end,
+                                     value,
+                                     (*fmt == 'u') ? 10 : 16,
+                                     (*fmt == 'X') ? bsp_log_digits_upper : bsp_log_digits_lower);
+                bsp_log_field(sink, &spec, 0, start, (uint32_t) (end - start));
+                break;
+
+            case 'p':
+                start = bsp_log_utoa(end, (uintptr_t) va_arg(ap, void *), 16, bsp_log_digits_lower);
+                *--start = 'x';
+                *--start = '0';
+                bsp_log_field(sink, &spec, 0, start, (uint32_t) (end - start));
+                break;
+
+            case 'c':
+                buffer[0] = (char) va_arg(ap, int);
+                bsp_log_field(sink, &spec, 0, buffer, 1);
+                break;
+
+            case 's':
+            {
+                const char *s = va_arg(ap, const char *);
+                uint32_t len = 0;
+
+                if (s == NULL)
+                {
+                    s = "(null)";
+                }
+                while ((s[len] != '\0') && ((spec.precision < 0) || (len < (uint32_t) spec.precision)))
+                {
+                    len++;
+                }
+
+                spec.flags &= ~BSP_LOG_FLAG_ZERO;
+                bsp_log_field(sink, &spec, 0, s, len);
+                break;
+            }
+
+            case 'f':
+            case 'F':
+                bsp_log_float(sink, &spec, va_arg(ap, double));
+                break;
+
+            case '%':
+                bsp_log_put(sink, '%');
+                break;
+
+            case '\0':
+                // A lone '%' at the end of the format
+                continue;
+
+            default:
+                // Unsupported conversion: print it as written rather than guess at its argument
+                bsp_log_put(sink, '%');
+                bsp_log_put(sink, *fmt);
+                break;
+        }
+
+        fmt++;
+    }
+
+    va_end(ap);
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+size_t bsp_vlog(const char *fmt, va_list args)
+{
+    bsp_log_sink_t sink = {0};
+
+    // Only the main loop may produce into the TX FIFO; from interrupt context the message is measured and dropped
+    if (__get_IPSR() == 0)
+    {
+        sink.space = bsp_ring_space(&bsp_uart_tx_fifo);
+        sink.first_size = bsp_ring_reserve_contiguous(&bsp_uart_tx_fifo, &sink.first);
+        sink.second = bsp_uart_tx_fifo.buffer;
+        if (sink.first_size > sink.space)
+        {
+            sink.first_size = sink.space;
+        }
+    }
+
+    bsp_log_format(&sink, fmt, args);
+
+    // A message that does not fit is dropped whole rather than cut off mid-line
+    return (sink.count <= sink.space) ? bsp_uart_tx_commit(sink.count, 0) : bsp_uart_tx_commit(0, sink.count);
+}
+
+size_t bsp_log(const char *fmt, ...)
+{
+    va_list args;
+    size_t ret;
+
+    va_start(args, fmt);
+    ret = bsp_vlog(fmt, args);
+    va_end(args);
+
+    return ret;
+}
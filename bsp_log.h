@@ -0,0 +1,92 @@
+/**
+ * @file bsp_log.h
+ *
+ * @brief Allocation-free formatted console output that formats in place into the UART TX FIFO
+ *
+ * bsp_log() is a replacement for printf() on hot paths.  It bypasses newlib stdio entirely: no FILE locking, no
+ * reentrancy struct, no heap and no per-byte _write() call.  The message is formatted straight into the free space of
+ * the TX FIFO and published to the transmitter as a whole, or dropped as a whole if it does not fit.
+ *
+ * Supported conversions are %d %i %u %x %X %c %s %p %f and %%, with the '-', '0' and '+' flags, a width, a precision
+ * (for %s and %f) and the 'h', 'l' and 'z' length modifiers.  %f prints at most BSP_LOG_FLOAT_PRECISION_MAX decimals
+ * and prints magnitudes of 2^64 or more as inf.
+ *
+ * The cost is a fixed call overhead plus a few cycles per output byte; %f adds software double arithmetic.  The
+ * 'bsp_log' rows of 'make BENCH=console' give cycles per byte next to the equivalent printf() workloads.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_LOG_H
+#define BSP_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief Decimals printed by %f without a precision, and the most printed with one
+ *
+ */
+#define BSP_LOG_FLOAT_PRECISION_DEFAULT (6)
+#define BSP_LOG_FLOAT_PRECISION_MAX     (9)
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Format a message into the console UART TX FIFO
+ *
+ * Never blocks and never allocates.  Stack use is bounded: there is no recursion and one 32-byte conversion buffer.
+ * The formatter keeps no state between calls, so it is re-entrant.
+ *
+ * @param [in] fmt              printf()-style format, limited to the conversions listed in bsp_log.h
+ *
+ * @return Number of bytes queued; 0 if the message did not fit in the TX FIFO and was dropped whole, which is
+ *         counted in bsp_uart_stats_t tx_dropped_bytes
+ *
+ * @warning As for bsp_uart_write(), the TX FIFO has a single producer: calls from interrupt context are dropped
+ *
+ */
+size_t bsp_log(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+size_t bsp_vlog(const char *fmt, va_list args) __attribute__((format(printf, 1, 0)));
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_LOG_H
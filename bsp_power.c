@@ -0,0 +1,378 @@
+/**
+ * @file bsp_power.c
+ *
+ * @brief Implementation of the tiered low-power idle
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stddef.h>
+#include "bsp_power.h"
+#include "bsp_internal.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define BSP_POWER_WAKE_PREPRIO          (0xF)
+
+// RTC clocked from the 32.768 kHz LSE with no asynchronous prescaler, so the sub-second counter resolves 30.5 us
+#define BSP_POWER_RTC_HZ                (32768)
+#define BSP_POWER_RTC_DAY_TICKS         (86400UL * BSP_POWER_RTC_HZ)
+
+// Wakeup timer clocked at RTCCLK/2; its 16-bit counter limits one STOP period to 4 s
+#define BSP_POWER_WUT_HZ                (BSP_POWER_RTC_HZ / 2)
+#define BSP_POWER_WUT_MAX               (0x10000)
+#define BSP_POWER_STOP_MAX_US           ((uint32_t) (((uint64_t) BSP_POWER_WUT_MAX * 1000000) / BSP_POWER_WUT_HZ))
+
+#define BSP_POWER_TICKS_PER_US          (BSP_TICK_TICKS_PER_MS / 1000)
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static bool bsp_power_rtc_ok = false;
+static bool bsp_power_latency_measured = false;
+static uint32_t bsp_power_stop_latency_us = BSP_POWER_STOP_LATENCY_INIT_US;
+static bool bsp_power_stop_enabled = true;
+static uint32_t bsp_power_stop_locks = 0;
+
+// STOP is held off until this TIM5 time
+static uint32_t bsp_power_stop_holdoff_until = 0;
+
+// TIM5 time the current run period started at
+static uint32_t bsp_power_mark = 0;
+
+static bsp_power_stats_t bsp_power_stats = {0};
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+RTC_HandleTypeDef rtc_drv_handle;
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Time of day in RTC ticks
+ *
+ */
+static uint32_t bsp_power_rtc_now(void)
+{
+    RTC_TimeTypeDef time;
+    RTC_DateTypeDef date;
+    uint32_t seconds;
+
+    HAL_RTC_GetTime(&rtc_drv_handle, &time, RTC_FORMAT_BIN);
+    // Reading the date unlocks the shadow registers latched by reading the time
+    HAL_RTC_GetDate(&rtc_drv_handle, &date, RTC_FORMAT_BIN);
+
+    seconds = (time.Hours * 3600) + (time.Minutes * 60) + time.Seconds;
+
+    // The sub-second register counts down from SynchPrediv
+    return (seconds * BSP_POWER_RTC_HZ) + (time.SecondFraction - time.SubSeconds);
+}
+
+static uint32_t bsp_power_rtc_elapsed_us(uint32_t start, uint32_t end)
+{
+    uint32_t ticks = ((end + BSP_POWER_RTC_DAY_TICKS) - start) % BSP_POWER_RTC_DAY_TICKS;
+
+    return (uint32_t) (((uint64_t) ticks * 1000000) / BSP_POWER_RTC_HZ);
+}
+
+static void bsp_power_account_run(uint32_t now)
+{
+    bsp_power_stats.run_us += (now - bsp_power_mark) / BSP_POWER_TICKS_PER_US;
+    bsp_power_mark = now;
+
+    return;
+}
+
+static bool bsp_power_stop_allowed(uint32_t now)
+{
+    return (bsp_power_rtc_ok &&
+            bsp_power_stop_enabled &&
+            (bsp_power_stop_locks == 0) &&
+            ((int32_t) (now - bsp_power_stop_holdoff_until) >= 0) &&
+            bsp_uart_tx_idle());
+}
+
+/**
+ * Enter STOP until the RTC wakeup timer, the user push-button or the start of a received character wakes the core
+ *
+ * Called with interrupts masked.  On the way out the PLL is re-locked and the time slept is measured on the RTC and
+ * added to TIM5, so the timer service and the HAL tick carry on as if they had kept counting.
+ *
+ */
+static void bsp_power_stop(uint32_t duration_us)
+{
+    uint32_t wut_ticks = (uint32_t) (((uint64_t) duration_us * BSP_POWER_WUT_HZ) / 1000000);
+    uint32_t programmed_us;
+    uint32_t start;
+    uint32_t slept_us;
+    bool rtc_woke;
+    bool rx_woke;
+
+    if (wut_ticks == 0)
+    {
+        wut_ticks = 1;
+    }
+    else if (wut_ticks > BSP_POWER_WUT_MAX)
+    {
+        wut_ticks = BSP_POWER_WUT_MAX;
+    }
+    programmed_us = (uint32_t) (((uint64_t) wut_ticks * 1000000) / BSP_POWER_WUT_HZ);
+
+    HAL_RTCEx_SetWakeUpTimer_IT(&rtc_drv_handle, wut_ticks - 1, RTC_WAKEUPCLOCK_RTCCLK_DIV2);
+
+    // USART2 is not clocked in STOP, so wake on the falling edge of a start bit on PA3 instead; that character is lost
+    __HAL_GPIO_EXTI_CLEAR_IT(GPIO_PIN_3);
+    EXTI->IMR |= EXTI_IMR_MR3;
+
+    start = bsp_power_rtc_now();
+
+    HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+
+    // STOP leaves the core running from HSI
+    bsp_system_clock_config();
+
+    EXTI->IMR &= ~EXTI_IMR_MR3;
+    rx_woke = (__HAL_GPIO_EXTI_GET_IT(GPIO_PIN_3) != 0);
+    __HAL_GPIO_EXTI_CLEAR_IT(GPIO_PIN_3);
+    HAL_NVIC_ClearPendingIRQ(EXTI3_IRQn);
+
+    // The calendar shadow registers are stale after STOP until resynchronised
+    __HAL_RTC_WRITEPROTECTION_DISABLE(&rtc_drv_handle);
+    HAL_RTC_WaitForSynchro(&rtc_drv_handle);
+    __HAL_RTC_WRITEPROTECTION_ENABLE(&rtc_drv_handle);
+    slept_us = bsp_power_rtc_elapsed_us(start, bsp_power_rtc_now());
+
+    rtc_woke = (__HAL_RTC_WAKEUPTIMER_GET_FLAG(&rtc_drv_handle, RTC_FLAG_WUTF) != 0);
+    HAL_RTCEx_DeactivateWakeUpTimer(&rtc_drv_handle);
+    __HAL_RTC_WAKEUPTIMER_CLEAR_FLAG(&rtc_drv_handle, RTC_FLAG_WUTF);
+    __HAL_RTC_WAKEUPTIMER_EXTI_CLEAR_FLAG();
+    HAL_NVIC_ClearPendingIRQ(RTC_WKUP_IRQn);
+
+    if (rtc_woke)
+    {
+        // Whatever the RTC measured beyond the programmed period is wake-up and PLL re-lock time.  The first
+        // measurement replaces the initial guess; after that the worst case is kept.
+        uint32_t latency_us = (slept_us > programmed_us) ? (slept_us - programmed_us) : 0;
+
+        if (!bsp_power_latency_measured || (latency_us > bsp_power_stop_latency_us))
+        {
+            bsp_power_stop_latency_us = latency_us;
+            bsp_power_latency_measured = true;
+        }
+        bsp_power_stats.stop_wake_latency_us = bsp_power_stop_latency_us;
+    }
+    else
+    {
+        bsp_power_stats.stop_early_wakes++;
+    }
+
+    bsp_tick_advance(slept_us);
+
+    bsp_power_stats.stop_us += slept_us;
+    bsp_power_stats.stop_count++;
+    bsp_power_mark = bsp_tick_now();
+
+    if (rx_woke)
+    {
+        bsp_power_hold_off_stop(BSP_POWER_RX_HOLDOFF_MS);
+    }
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * MCU HAL FUNCTIONS
+ *
+ * @warning - Function names below are expected in STM32 HAL code, do not change
+ **********************************************************************************************************************/
+void HAL_RTC_MspInit(RTC_HandleTypeDef *hrtc)
+{
+    __HAL_RCC_RTC_ENABLE();
+
+    HAL_NVIC_SetPriority(RTC_WKUP_IRQn, BSP_POWER_WAKE_PREPRIO, 0);
+    HAL_NVIC_EnableIRQ(RTC_WKUP_IRQn);
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * BSP INTERNAL FUNCTIONS
+ **********************************************************************************************************************/
+void bsp_power_init(void)
+{
+    RCC_OscInitTypeDef osc_init = {0};
+    RCC_PeriphCLKInitTypeDef clk_init = {0};
+
+    HAL_PWR_EnableBkUpAccess();
+
+    // Without the LSE there is no accurate clock to measure STOP periods with, so only the Sleep tier is used
+    osc_init.OscillatorType = RCC_OSCILLATORTYPE_LSE;
+    osc_init.LSEState = RCC_LSE_ON;
+    osc_init.PLL.PLLState = RCC_PLL_NONE;
+    if (HAL_RCC_OscConfig(&osc_init) == HAL_OK)
+    {
+        clk_init.PeriphClockSelection = RCC_PERIPHCLK_RTC;
+        clk_init.RTCClockSelection = RCC_RTCCLKSOURCE_LSE;
+        if (HAL_RCCEx_PeriphCLKConfig(&clk_init) == HAL_OK)
+        {
+            rtc_drv_handle.Instance = RTC;
+            rtc_drv_handle.Init.HourFormat = RTC_HOURFORMAT_24;
+            rtc_drv_handle.Init.AsynchPrediv = 0;
+            rtc_drv_handle.Init.SynchPrediv = BSP_POWER_RTC_HZ - 1;
+            rtc_drv_handle.Init.OutPut = RTC_OUTPUT_DISABLE;
+            rtc_drv_handle.Init.OutPutPolarity = RTC_OUTPUT_POLARITY_HIGH;
+            rtc_drv_handle.Init.OutPutType = RTC_OUTPUT_TYPE_OPENDRAIN;
+            bsp_power_rtc_ok = (HAL_RTC_Init(&rtc_drv_handle) == HAL_OK);
+        }
+    }
+
+    // EXTI line 3 watches PA3 (USART2 RX) for a start bit while in STOP; it is only unmasked around STOP
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    SYSCFG->EXTICR[0] &= ~SYSCFG_EXTICR1_EXTI3;
+    EXTI->FTSR |= EXTI_FTSR_TR3;
+    EXTI->IMR &= ~EXTI_IMR_MR3;
+    HAL_NVIC_SetPriority(EXTI3_IRQn, BSP_POWER_WAKE_PREPRIO, 0);
+    HAL_NVIC_EnableIRQ(EXTI3_IRQn);
+
+#ifdef DEBUG
+    // Keep the debug connection alive through STOP, at the cost of some of the saving
+    HAL_DBGMCU_EnableDBGStopMode();
+#endif
+
+    bsp_power_mark = bsp_tick_now();
+    bsp_power_stop_holdoff_until = bsp_power_mark;
+
+    return;
+}
+
+/**
+ * Idle until the next interrupt, in the deepest state the next timer deadline and the peripherals allow
+ *
+ * @warning Call with interrupts masked; returns with them still masked and the waking interrupt pending
+ *
+ */
+void bsp_power_idle(void)
+{
+    uint32_t now = bsp_tick_now();
+    uint32_t gap_us = BSP_POWER_STOP_MAX_US;
+    uint32_t expiry;
+
+    bsp_power_account_run(now);
+
+    if (bsp_timer_next_expiry(&expiry))
+    {
+        int32_t gap = (int32_t) (expiry - now);
+
+        gap_us = (gap > 0) ? ((uint32_t) gap / BSP_POWER_TICKS_PER_US) : 0;
+    }
+
+    if (bsp_power_stop_allowed(now) && (gap_us >= (BSP_POWER_STOP_MIN_US + bsp_power_stop_latency_us)))
+    {
+        // Wake early by the worst latency seen so the timer deadline is met; the rest of the gap is spent in Sleep
+        bsp_power_stop(gap_us - bsp_power_stop_latency_us);
+    }
+    else
+    {
+        __WFI();
+
+        now = bsp_tick_now();
+        bsp_power_stats.sleep_us += (now - bsp_power_mark) / BSP_POWER_TICKS_PER_US;
+        bsp_power_stats.sleep_count++;
+        bsp_power_mark = now;
+    }
+
+    return;
+}
+
+/**
+ * Forbid STOP for at least the next holdoff_ms
+ *
+ */
+void bsp_power_hold_off_stop(uint32_t holdoff_ms)
+{
+    uint32_t primask = bsp_critical_enter();
+    uint32_t until = bsp_tick_now() + (holdoff_ms * BSP_TICK_TICKS_PER_MS);
+
+    if ((int32_t) (until - bsp_power_stop_holdoff_until) > 0)
+    {
+        bsp_power_stop_holdoff_until = until;
+    }
+
+    bsp_critical_exit(primask);
+
+    return;
+}
+
+/**
+ * Forbid STOP while a peripheral that STOP would halt is in use; calls nest
+ *
+ */
+void bsp_power_lock_stop(void)
+{
+    uint32_t primask = bsp_critical_enter();
+
+    bsp_power_stop_locks++;
+
+    bsp_critical_exit(primask);
+
+    return;
+}
+
+void bsp_power_unlock_stop(void)
+{
+    uint32_t primask = bsp_critical_enter();
+
+    if (bsp_power_stop_locks > 0)
+    {
+        bsp_power_stop_locks--;
+    }
+
+    bsp_critical_exit(primask);
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+void bsp_power_set_stop_enabled(bool enabled)
+{
+    bsp_power_stop_enabled = enabled;
+
+    return;
+}
+
+uint32_t bsp_power_get_stats(bsp_power_stats_t *stats)
+{
+    uint32_t ret = BSP_STATUS_FAIL;
+
+    if (stats != NULL)
+    {
+        uint32_t primask = bsp_critical_enter();
+
+        bsp_power_account_run(bsp_tick_now());
+        *stats = bsp_power_stats;
+
+        bsp_critical_exit(primask);
+
+        ret = BSP_STATUS_OK;
+    }
+
+    return ret;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file bsp_power.h
+ *
+ * @brief Tiered low-power idle: Sleep for short gaps, STOP with RTC wakeup for long ones
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_POWER_H
+#define BSP_POWER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include "bsp.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief Shortest idle gap, on top of the measured wake-up latency, worth entering STOP for
+ *
+ */
+#ifndef BSP_POWER_STOP_MIN_US
+#define BSP_POWER_STOP_MIN_US           (2000)
+#endif
+
+/**
+ * @brief Wake-up latency assumed for STOP until one has been measured
+ *
+ */
+#define BSP_POWER_STOP_LATENCY_INIT_US  (500)
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * Time spent in each power state since bsp_init()
+ *
+ * @see bsp_power_get_stats
+ *
+ */
+typedef struct
+{
+    uint64_t run_us;
+    uint64_t sleep_us;
+    uint64_t stop_us;
+    uint32_t sleep_count;
+    uint32_t stop_count;
+    uint32_t stop_early_wakes;          ///< STOP periods ended by an interrupt before the RTC wakeup
+    uint32_t stop_wake_latency_us;      ///< Worst RTC wakeup to PLL re-locked time seen; 0 until first measured
+} bsp_power_stats_t;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Allow or forbid the STOP tier
+ *
+ * STOP is allowed by default, but is only entered when the LSE started, the console has been quiet for a while and
+ * no timer expires within BSP_POWER_STOP_MIN_US plus the wake-up latency.
+ *
+ */
+void bsp_power_set_stop_enabled(bool enabled);
+uint32_t bsp_power_get_stats(bsp_power_stats_t *stats);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_POWER_H
@@ -0,0 +1,206 @@
+/**
+ * @file bsp_prof.c
+ *
+ * @brief Implementation of the DWT cycle counter timestamps and profiling slots
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stddef.h>
+#include <string.h>
+#include "bsp_prof.h"
+#include "bsp_internal.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static bsp_prof_slot_t bsp_prof_slots[BSP_PROF_SLOTS_MAX];
+static uint32_t bsp_prof_slot_count = 0;
+
+// Cycles measured by an empty bsp_cycles_now()/bsp_prof_stop() pair, subtracted from every bsp_prof_stop() sample
+static uint32_t bsp_prof_overhead = 0;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static void bsp_prof_slot_clear(bsp_prof_slot_t *slot)
+{
+    slot->count = 0;
+    slot->min = 0;
+    slot->max = 0;
+    slot->total = 0;
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+void bsp_prof_init(void)
+{
+    uint32_t start;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    bsp_prof_overhead = 0;
+    start = bsp_cycles_now();
+    bsp_prof_overhead = bsp_cycles_now() - start;
+
+    return;
+}
+
+uint64_t bsp_cycles_to_ns(uint32_t cycles)
+{
+    return ((uint64_t) cycles * 1000000000) / SystemCoreClock;
+}
+
+uint32_t bsp_cycles_to_us(uint32_t cycles)
+{
+    return (uint32_t) (((uint64_t) cycles * 1000000) / SystemCoreClock);
+}
+
+uint32_t bsp_prof_register(const char *name, uint32_t *slot)
+{
+    uint32_t ret = BSP_STATUS_FAIL;
+    uint32_t primask = bsp_critical_enter();
+    uint32_t i;
+
+    *slot = BSP_PROF_SLOT_INVALID;
+
+    for (i = 0; i < bsp_prof_slot_count; i++)
+    {
+        if (strcmp(bsp_prof_slots[i].name, name) == 0)
+        {
+            *slot = i;
+            ret = BSP_STATUS_OK;
+            break;
+        }
+    }
+
+    if ((ret != BSP_STATUS_OK) && (bsp_prof_slot_count < BSP_PROF_SLOTS_MAX))
+    {
+        *slot = bsp_prof_slot_count++;
+        bsp_prof_slots[*slot].name = name;
+        bsp_prof_slot_clear(&bsp_prof_slots[*slot]);
+        ret = BSP_STATUS_OK;
+    }
+
+    bsp_critical_exit(primask);
+
+    return ret;
+}
+
+void bsp_prof_record(uint32_t slot, uint32_t cycles)
+{
+    if (slot < bsp_prof_slot_count)
+    {
+        bsp_prof_slot_t *s = &bsp_prof_slots[slot];
+        uint32_t primask = bsp_critical_enter();
+
+        if ((s->count == 0) || (cycles < s->min))
+        {
+            s->min = cycles;
+        }
+        if (cycles > s->max)
+        {
+            s->max = cycles;
+        }
+        s->total += cycles;
+        s->count++;
+
+        bsp_critical_exit(primask);
+    }
+
+    return;
+}
+
+void bsp_prof_stop(uint32_t slot, uint32_t start)
+{
+    uint32_t cycles = bsp_cycles_now() - start;
+
+    bsp_prof_record(slot, (cycles > bsp_prof_overhead) ? (cycles - bsp_prof_overhead) : 0);
+
+    return;
+}
+
+uint32_t bsp_prof_get(uint32_t slot, bsp_prof_slot_t *stats)
+{
+    uint32_t ret = BSP_STATUS_FAIL;
+
+    if ((slot < bsp_prof_slot_count) && (stats != NULL))
+    {
+        uint32_t primask = bsp_critical_enter();
+
+        *stats = bsp_prof_slots[slot];
+
+        bsp_critical_exit(primask);
+
+        ret = BSP_STATUS_OK;
+    }
+
+    return ret;
+}
+
+void bsp_prof_reset(void)
+{
+    uint32_t primask = bsp_critical_enter();
+    uint32_t i;
+
+    for (i = 0; i < bsp_prof_slot_count; i++)
+    {
+        bsp_prof_slot_clear(&bsp_prof_slots[i]);
+    }
+
+    bsp_critical_exit(primask);
+
+    return;
+}
+
+void bsp_prof_dump(void)
+{
+    uint32_t i;
+
+    printf("%-24s %10s %10s %10s %10s %10s\r\n", "slot", "count", "min", "avg", "max", "avg ns");
+
+    for (i = 0; i < bsp_prof_slot_count; i++)
+    {
+        bsp_prof_slot_t s;
+        uint32_t avg;
+
+        bsp_prof_get(i, &s);
+        avg = (s.count != 0) ? (uint32_t) (s.total / s.count) : 0;
+
+        printf("%-24s %10lu %10lu %10lu %10lu %10lu\r\n",
+               s.name,
+               (unsigned long) s.count,
+               (unsigned long) s.min,
+               (unsigned long) avg,
+               (unsigned long) s.max,
+               (unsigned long) bsp_cycles_to_ns(avg));
+    }
+
+    return;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file bsp_prof.h
+ *
+ * @brief Cycle-accurate timestamps and profiling slots using the Cortex-M4 DWT cycle counter
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_PROF_H
+#define BSP_PROF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include "bsp.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief Maximum number of named profiling slots
+ *
+ */
+#ifndef BSP_PROF_SLOTS_MAX
+#define BSP_PROF_SLOTS_MAX              (16)
+#endif
+
+/**
+ * @brief Slot ID never returned by bsp_prof_register()
+ *
+ */
+#define BSP_PROF_SLOT_INVALID           (0xFFFFFFFF)
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+/**
+ * @brief Profile the statement or block that follows into slot
+ *
+ * Usage:
+ *      BSP_PROF_SCOPE(slot)
+ *      {
+ *          ...
+ *      }
+ *
+ * @warning Leaving the block with break, return or goto skips the measurement
+ *
+ */
+#define BSP_PROF_SCOPE(slot) \
+    for (uint32_t bsp_prof_scope_start = bsp_cycles_now(), bsp_prof_scope_once = 1; \
+         bsp_prof_scope_once != 0; \
+         bsp_prof_scope_once = 0, bsp_prof_stop((slot), bsp_prof_scope_start))
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * Profiling slot statistics, in CPU cycles
+ *
+ * @see bsp_prof_get
+ *
+ */
+typedef struct
+{
+    const char *name;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;                 ///< Sum of all samples; average is total / count
+} bsp_prof_slot_t;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Current value of the free-running 32-bit DWT cycle counter
+ *
+ * Wraps after 2^32 cycles (about 51 s at 84 MHz); take differences as uint32_t.
+ *
+ */
+static inline uint32_t bsp_cycles_now(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * Convert a cycle count to time using the current SystemCoreClock
+ *
+ */
+uint64_t bsp_cycles_to_ns(uint32_t cycles);
+uint32_t bsp_cycles_to_us(uint32_t cycles);
+
+/**
+ * Find the profiling slot with the given name, claiming a free one if there is none
+ *
+ * @param [in] name             Slot name; must remain valid, as only the pointer is stored
+ * @param [out] slot            Slot ID for bsp_prof_stop() and bsp_prof_record()
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if all BSP_PROF_SLOTS_MAX slots are in use
+ *
+ */
+uint32_t bsp_prof_register(const char *name, uint32_t *slot);
+
+/**
+ * Add a sample to a profiling slot
+ *
+ * Safe to call from interrupt context.  Samples for an invalid slot ID are ignored.
+ *
+ */
+void bsp_prof_record(uint32_t slot, uint32_t cycles);
+
+/**
+ * Record the cycles elapsed since start, less the cost of reading the cycle counter, into slot
+ *
+ * @param [in] slot             Slot ID from bsp_prof_register()
+ * @param [in] start            Value of bsp_cycles_now() at the start of the measured section
+ *
+ */
+void bsp_prof_stop(uint32_t slot, uint32_t start);
+
+uint32_t bsp_prof_get(uint32_t slot, bsp_prof_slot_t *stats);
+void bsp_prof_reset(void);
+
+/**
+ * Print every registered slot on the console
+ *
+ * @warning Console output is main-loop only, see bsp_uart_write()
+ *
+ */
+void bsp_prof_dump(void);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_PROF_H
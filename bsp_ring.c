@@ -0,0 +1,266 @@
+/**
+ * @file bsp_ring.c
+ *
+ * @brief Implementation of the lock-free single-producer/single-consumer byte ring buffer
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stddef.h>
+#include <string.h>
+#include "bsp_ring.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Load the index owned by the other side
+ *
+ * Acquire ordering guarantees the buffer contents published before the index was stored are visible once the index is.
+ *
+ */
+static inline uint32_t bsp_ring_load_acquire(const volatile uint32_t *index)
+{
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Store an index owned by this side
+ *
+ * Release ordering keeps the buffer accesses made before the store from being reordered after it.
+ *
+ */
+static inline void bsp_ring_store_release(volatile uint32_t *index, uint32_t value)
+{
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+
+    return;
+}
+
+/**
+ * Number of bytes available to the consumer
+ *
+ * If the producer has lapped the consumer, the tail is first moved up to the oldest byte still in the buffer.
+ *
+ * @warning Consumer side only
+ *
+ */
+static uint32_t bsp_ring_consumer_level(bsp_ring_t *ring)
+{
+    uint32_t head = bsp_ring_load_acquire(&ring->head);
+    uint32_t level = head - ring->tail;
+
+    if (level > ring->size)
+    {
+        ring->dropped += level - ring->size;
+        bsp_ring_store_release(&ring->tail, head - ring->size);
+        level = ring->size;
+    }
+
+    return level;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+bool bsp_ring_init(bsp_ring_t *ring, uint8_t *buffer, uint32_t size)
+{
+    bool ret = false;
+
+    if ((ring != NULL) && (buffer != NULL) && (size != 0) && ((size & (size - 1)) == 0))
+    {
+        ring->buffer = buffer;
+        ring->size = size;
+        ring->mask = size - 1;
+        ring->head = 0;
+        ring->tail = 0;
+        ring->dropped = 0;
+
+        ret = true;
+    }
+
+    return ret;
+}
+
+uint32_t bsp_ring_level(const bsp_ring_t *ring)
+{
+    uint32_t level = ring->head - ring->tail;
+
+    if (level > ring->size)
+    {
+        level = ring->size;
+    }
+
+    return level;
+}
+
+uint32_t bsp_ring_space(const bsp_ring_t *ring)
+{
+    return ring->size - bsp_ring_level(ring);
+}
+
+bool bsp_ring_push(bsp_ring_t *ring, uint8_t byte)
+{
+    bool ret = false;
+    uint32_t head = ring->head;
+
+    if ((head - bsp_ring_load_acquire(&ring->tail)) < ring->size)
+    {
+        ring->buffer[head & ring->mask] = byte;
+        bsp_ring_store_release(&ring->head, head + 1);
+        ret = true;
+    }
+
+    return ret;
+}
+
+uint32_t bsp_ring_write(bsp_ring_t *ring, const uint8_t *buf, uint32_t len)
+{
+    uint32_t head = ring->head;
+    uint32_t offset = head & ring->mask;
+    uint32_t count = ring->size - (head - bsp_ring_load_acquire(&ring->tail));
+    uint32_t first_size;
+
+    if (count > len)
+    {
+        count = len;
+    }
+
+    // Copy in at most two blocks, split at the end of the buffer
+    first_size = ring->size - offset;
+    if (first_size > count)
+    {
+        first_size = count;
+    }
+    memcpy(ring->buffer + offset, buf, first_size);
+    memcpy(ring->buffer, buf + first_size, count - first_size);
+
+    bsp_ring_store_release(&ring->head, head + count);
+
+    return count;
+}
+
+uint32_t bsp_ring_reserve_contiguous(bsp_ring_t *ring, uint8_t **span)
+{
+    uint32_t head = ring->head;
+    uint32_t offset = head & ring->mask;
+    uint32_t count = ring->size - (head - bsp_ring_load_acquire(&ring->tail));
+
+    if (count > (ring->size - offset))
+    {
+        count = ring->size - offset;
+    }
+
+    *span = ring->buffer + offset;
+
+    return count;
+}
+
+void bsp_ring_commit(bsp_ring_t *ring, uint32_t count)
+{
+    bsp_ring_store_release(&ring->head, ring->head + count);
+
+    return;
+}
+
+/**
+ * Withdraw the newest count committed bytes
+ *
+ * @warning The caller must guarantee the consumer has not started reading any of them
+ *
+ */
+void bsp_ring_retract(bsp_ring_t *ring, uint32_t count)
+{
+    bsp_ring_store_release(&ring->head, ring->head - count);
+
+    return;
+}
+
+bool bsp_ring_pop(bsp_ring_t *ring, uint8_t *byte)
+{
+    bool ret = false;
+
+    if (bsp_ring_consumer_level(ring) > 0)
+    {
+        uint32_t tail = ring->tail;
+
+        *byte = ring->buffer[tail & ring->mask];
+        bsp_ring_store_release(&ring->tail, tail + 1);
+        ret = true;
+    }
+
+    return ret;
+}
+
+uint32_t bsp_ring_read(bsp_ring_t *ring, uint8_t *buf, uint32_t len)
+{
+    uint32_t count = bsp_ring_consumer_level(ring);
+    uint32_t tail = ring->tail;
+    uint32_t offset = tail & ring->mask;
+    uint32_t first_size;
+
+    if (count > len)
+    {
+        count = len;
+    }
+
+    // Copy out in at most two blocks, split at the end of the buffer
+    first_size = ring->size - offset;
+    if (first_size > count)
+    {
+        first_size = count;
+    }
+    memcpy(buf, ring->buffer + offset, first_size);
+    memcpy(buf + first_size, ring->buffer, count - first_size);
+
+    bsp_ring_store_release(&ring->tail, tail + count);
+
+    return count;
+}
+
+uint32_t bsp_ring_peek_contiguous(bsp_ring_t *ring, uint8_t **span)
+{
+    uint32_t count = bsp_ring_consumer_level(ring);
+    uint32_t offset = ring->tail & ring->mask;
+
+    if (count > (ring->size - offset))
+    {
+        count = ring->size - offset;
+    }
+
+    *span = ring->buffer + offset;
+
+    return count;
+}
+
+void bsp_ring_consume(bsp_ring_t *ring, uint32_t count)
+{
+    bsp_ring_store_release(&ring->tail, ring->tail + count);
+
+    return;
+}
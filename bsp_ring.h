@@ -0,0 +1,96 @@
+/**
+ * @file bsp_ring.h
+ *
+ * @brief Lock-free single-producer/single-consumer byte ring buffer
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_RING_H
+#define BSP_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * Single-producer/single-consumer ring buffer
+ *
+ * head and tail are free-running counters masked down to a buffer offset on access, so the capacity must be a power
+ * of two.  head is only ever written by the producer and tail only by the consumer, which lets one side live in an
+ * ISR and the other in the main loop without either masking interrupts.
+ *
+ * A producer that cannot be held off (e.g. circular DMA) may commit past the consumer.  The consumer then skips ahead
+ * to the newest 'size' bytes on its next access and adds what it skipped to 'dropped'.
+ *
+ */
+typedef struct
+{
+    uint8_t *buffer;
+    uint32_t size;                  ///< Capacity in bytes, a power of two
+    uint32_t mask;                  ///< size - 1
+    volatile uint32_t head;         ///< Total bytes committed; written by producer only
+    volatile uint32_t tail;         ///< Total bytes consumed; written by consumer only
+    volatile uint32_t dropped;      ///< Bytes overwritten before they were consumed; written by consumer only
+} bsp_ring_t;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+bool bsp_ring_init(bsp_ring_t *ring, uint8_t *buffer, uint32_t size);
+
+// Either side
+uint32_t bsp_ring_level(const bsp_ring_t *ring);
+uint32_t bsp_ring_space(const bsp_ring_t *ring);
+
+// Producer side
+bool bsp_ring_push(bsp_ring_t *ring, uint8_t byte);
+uint32_t bsp_ring_write(bsp_ring_t *ring, const uint8_t *buf, uint32_t len);
+uint32_t bsp_ring_reserve_contiguous(bsp_ring_t *ring, uint8_t **span);
+void bsp_ring_commit(bsp_ring_t *ring, uint32_t count);
+void bsp_ring_retract(bsp_ring_t *ring, uint32_t count);
+
+// Consumer side
+bool bsp_ring_pop(bsp_ring_t *ring, uint8_t *byte);
+uint32_t bsp_ring_read(bsp_ring_t *ring, uint8_t *buf, uint32_t len);
+uint32_t bsp_ring_peek_contiguous(bsp_ring_t *ring, uint8_t **span);
+void bsp_ring_consume(bsp_ring_t *ring, uint32_t count);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_RING_H
@@ -0,0 +1,413 @@
+/**
+ * @file bsp_spi.c
+ *
+ * @brief Implementation of the asynchronous SPI1 master
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "bsp_board.h"
+#include "bsp_internal.h"
+#include "bsp_spi.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+// The transmit stream completes first and must be taken first, as its HAL handle is busy until then.  Completions so
+// run at two priorities, and bsp_spi_complete() masks interrupts while it moves the queue on.
+#define BSP_SPI_TX_DMA_PREPRIO          (0x7)
+#define BSP_SPI_RX_DMA_PREPRIO          (0x8)
+
+// SPI1 may run at up to half of APB2, and no faster than 42 MHz
+#define BSP_SPI_MAX_HZ                  (42000000)
+#define BSP_SPI_PRESCALER_MIN_LOG2      (1)
+#define BSP_SPI_PRESCALER_MAX_LOG2      (8)
+
+// The CR1 fields that differ between devices
+#define BSP_SPI_CR1_DEV_MASK            (SPI_CR1_BR | SPI_CR1_CPOL | SPI_CR1_CPHA)
+
+typedef struct
+{
+    const bsp_spi_dev_t *dev;
+    const uint8_t *tx;
+    uint8_t *rx;
+    uint16_t len;
+    uint32_t flags;
+    bsp_callback_t cb;
+    void *cb_arg;
+} bsp_spi_xfer_t;
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+// Transfers queued, the one at tail in progress; head and tail are free-running and only change in critical sections
+static bsp_spi_xfer_t bsp_spi_queue_xfers[BSP_SPI_QUEUE_LEN];
+static volatile uint32_t bsp_spi_queue_head = 0;
+static volatile uint32_t bsp_spi_queue_tail = 0;
+
+// Device whose settings are in CR1, and the one holding chip select asserted after a BSP_SPI_KEEP_CS transfer
+static const bsp_spi_dev_t *bsp_spi_configured = NULL;
+static const bsp_spi_dev_t *bsp_spi_cs_held = NULL;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+SPI_HandleTypeDef spi_drv_handle;
+DMA_HandleTypeDef spi_rx_dma_handle;
+DMA_HandleTypeDef spi_tx_dma_handle;
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static void bsp_spi_cs_release(const bsp_spi_dev_t *dev)
+{
+    dev->cs_port->BSRR = dev->cs_mask;
+
+    return;
+}
+
+static void bsp_spi_cs_assert(const bsp_spi_dev_t *dev)
+{
+    dev->cs_port->BSRR = (uint32_t) dev->cs_mask << 16;
+
+    return;
+}
+
+/**
+ * Start the transfer at the tail of the queue
+ *
+ * Called with the queue not empty and the bus idle, from a critical section or the completion interrupt.
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if the HAL refused the transfer
+ *
+ */
+static uint32_t bsp_spi_start(void)
+{
+    bsp_spi_xfer_t *xfer = &bsp_spi_queue_xfers[bsp_spi_queue_tail % BSP_SPI_QUEUE_LEN];
+    const bsp_spi_dev_t *dev = xfer->dev;
+    HAL_StatusTypeDef status;
+
+    if ((bsp_spi_cs_held != NULL) && (bsp_spi_cs_held != dev))
+    {
+        bsp_spi_cs_release(bsp_spi_cs_held);
+    }
+    bsp_spi_cs_held = NULL;
+
+    // Rate and mode can only change with the SPI disabled; the HAL enables it again for the transfer
+    if (bsp_spi_configured != dev)
+    {
+        __HAL_SPI_DISABLE(&spi_drv_handle);
+        spi_drv_handle.Instance->CR1 = (spi_drv_handle.Instance->CR1 & ~BSP_SPI_CR1_DEV_MASK) | dev->cr1;
+        spi_drv_handle.Init.BaudRatePrescaler = dev->cr1 & SPI_CR1_BR;
+        spi_drv_handle.Init.CLKPolarity = dev->cr1 & SPI_CR1_CPOL;
+        spi_drv_handle.Init.CLKPhase = dev->cr1 & SPI_CR1_CPHA;
+        bsp_spi_configured = dev;
+    }
+
+    bsp_spi_cs_assert(dev);
+    if (xfer->tx == NULL)
+    {
+        // Sent from the receive buffer, which DMA reads each byte of before it overwrites it
+        memset(xfer->rx, BSP_SPI_FILL_BYTE, xfer->len);
+        status = HAL_SPI_TransmitReceive_DMA(&spi_drv_handle, xfer->rx, xfer->rx, xfer->len);
+    }
+    else if (xfer->rx == NULL)
+    {
+        status = HAL_SPI_Transmit_DMA(&spi_drv_handle, (uint8_t *) xfer->tx, xfer->len);
+    }
+    else
+    {
+        status = HAL_SPI_TransmitReceive_DMA(&spi_drv_handle, (uint8_t *) xfer->tx, xfer->rx, xfer->len);
+    }
+
+    if (status != HAL_OK)
+    {
+        bsp_spi_cs_release(dev);
+        return BSP_STATUS_FAIL;
+    }
+
+    return BSP_STATUS_OK;
+}
+
+/**
+ * Retire the transfer in progress, start the next one and only then report the one retired
+ *
+ * Runs in the completion interrupt.  A transfer the HAL refuses to start is reported as failed and the one after it
+ * tried, so that a queue never stalls with transfers in it.
+ *
+ * The queue moves on with interrupts masked: a short transfer started here can complete on the higher-priority transmit
+ * stream before the HAL has released its handle, and that completion must not run until it has.  Likewise only one
+ * completion may see the queue empty and release the STOP lock.
+ *
+ */
+static void bsp_spi_complete(uint32_t status)
+{
+    bsp_spi_xfer_t done = bsp_spi_queue_xfers[bsp_spi_queue_tail % BSP_SPI_QUEUE_LEN];
+    uint32_t primask;
+
+    if ((done.flags & BSP_SPI_KEEP_CS) != 0)
+    {
+        bsp_spi_cs_held = done.dev;
+    }
+    else
+    {
+        bsp_spi_cs_release(done.dev);
+    }
+
+    primask = bsp_critical_enter();
+    bsp_spi_queue_tail++;
+
+    while (bsp_spi_queue_tail != bsp_spi_queue_head)
+    {
+        // Copied, as the slot is free for bsp_spi_queue() once tail has passed it
+        bsp_spi_xfer_t next = bsp_spi_queue_xfers[bsp_spi_queue_tail % BSP_SPI_QUEUE_LEN];
+
+        if (bsp_spi_start() == BSP_STATUS_OK)
+        {
+            break;
+        }
+
+        bsp_spi_queue_tail++;
+        bsp_critical_exit(primask);
+        if (next.cb != NULL)
+        {
+            next.cb(BSP_STATUS_FAIL, next.cb_arg);
+        }
+        primask = bsp_critical_enter();
+    }
+
+    if (bsp_spi_queue_tail == bsp_spi_queue_head)
+    {
+        bsp_power_unlock_stop();
+    }
+    bsp_critical_exit(primask);
+
+    if (done.cb != NULL)
+    {
+        done.cb(status, done.cb_arg);
+    }
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * BSP INTERNAL FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Configure SPI1 as master, its pins and its DMA streams, and release the board's chip select
+ *
+ */
+uint32_t bsp_spi_init(void)
+{
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    BSP_PIN_SET(SPI_CS);
+    BSP_PIN_INIT(SPI_CS);
+
+    // Devices set the rate and mode before each transfer, see bsp_spi_start()
+    spi_drv_handle.Instance = SPI1;
+    spi_drv_handle.Init.Mode = SPI_MODE_MASTER;
+    spi_drv_handle.Init.Direction = SPI_DIRECTION_2LINES;
+    spi_drv_handle.Init.DataSize = SPI_DATASIZE_8BIT;
+    spi_drv_handle.Init.CLKPolarity = SPI_POLARITY_LOW;
+    spi_drv_handle.Init.CLKPhase = SPI_PHASE_1EDGE;
+    spi_drv_handle.Init.NSS = SPI_NSS_SOFT;
+    spi_drv_handle.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_256;
+    spi_drv_handle.Init.FirstBit = SPI_FIRSTBIT_MSB;
+    spi_drv_handle.Init.TIMode = SPI_TIMODE_DISABLE;
+    spi_drv_handle.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+    spi_drv_handle.Init.CRCPolynomial = 7;
+    if (HAL_SPI_Init(&spi_drv_handle) != HAL_OK)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    return BSP_STATUS_OK;
+}
+
+/***********************************************************************************************************************
+ * MCU HAL FUNCTIONS
+ **********************************************************************************************************************/
+void HAL_SPI_MspInit(SPI_HandleTypeDef *hspi)
+{
+    __HAL_RCC_SPI1_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    BSP_PIN_INIT(SPI_SCK);
+    BSP_PIN_INIT(SPI_MISO);
+    BSP_PIN_INIT(SPI_MOSI);
+
+    // SPI1 is mapped to DMA2 Stream2 for RX and Stream3 for TX, both channel 3; RX is served first so it never overruns
+    spi_rx_dma_handle.Instance                 = DMA2_Stream2;
+    spi_rx_dma_handle.Init.Channel             = DMA_CHANNEL_3;
+    spi_rx_dma_handle.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+    spi_rx_dma_handle.Init.PeriphInc           = DMA_PINC_DISABLE;
+    spi_rx_dma_handle.Init.MemInc              = DMA_MINC_ENABLE;
+    spi_rx_dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    spi_rx_dma_handle.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+    spi_rx_dma_handle.Init.Mode                = DMA_NORMAL;
+    spi_rx_dma_handle.Init.Priority            = DMA_PRIORITY_HIGH;
+    spi_rx_dma_handle.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&spi_rx_dma_handle) != HAL_OK)
+    {
+        // Left unlinked, so that every transfer fails to start
+        return;
+    }
+    __HAL_LINKDMA(hspi, hdmarx, spi_rx_dma_handle);
+
+    spi_tx_dma_handle.Instance                 = DMA2_Stream3;
+    spi_tx_dma_handle.Init.Channel             = DMA_CHANNEL_3;
+    spi_tx_dma_handle.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+    spi_tx_dma_handle.Init.PeriphInc           = DMA_PINC_DISABLE;
+    spi_tx_dma_handle.Init.MemInc              = DMA_MINC_ENABLE;
+    spi_tx_dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    spi_tx_dma_handle.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+    spi_tx_dma_handle.Init.Mode                = DMA_NORMAL;
+    spi_tx_dma_handle.Init.Priority            = DMA_PRIORITY_MEDIUM;
+    spi_tx_dma_handle.Init.FIFOMode            = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&spi_tx_dma_handle) != HAL_OK)
+    {
+        return;
+    }
+    __HAL_LINKDMA(hspi, hdmatx, spi_tx_dma_handle);
+
+    HAL_NVIC_SetPriority(DMA2_Stream2_IRQn, BSP_SPI_RX_DMA_PREPRIO, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream2_IRQn);
+    HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, BSP_SPI_TX_DMA_PREPRIO, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream3_IRQn);
+
+    // Only for errors, which the HAL enables during DMA transfers
+    HAL_NVIC_SetPriority(SPI1_IRQn, BSP_SPI_RX_DMA_PREPRIO, 0);
+    HAL_NVIC_EnableIRQ(SPI1_IRQn);
+
+    return;
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    bsp_spi_complete(BSP_STATUS_OK);
+
+    return;
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    bsp_spi_complete(BSP_STATUS_OK);
+
+    return;
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    bsp_spi_complete(BSP_STATUS_FAIL);
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+uint32_t bsp_spi_dev_init(bsp_spi_dev_t *dev, GPIO_TypeDef *cs_port, uint16_t cs_mask, uint32_t max_hz,
+                          uint32_t mode)
+{
+    uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+    uint32_t log2 = BSP_SPI_PRESCALER_MIN_LOG2;
+
+    if ((dev == NULL) || (cs_port == NULL) || (cs_mask == 0) || (mode > 3))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    max_hz = (max_hz < BSP_SPI_MAX_HZ) ? max_hz : BSP_SPI_MAX_HZ;
+    while ((log2 <= BSP_SPI_PRESCALER_MAX_LOG2) && ((pclk2 >> log2) > max_hz))
+    {
+        log2++;
+    }
+    if (log2 > BSP_SPI_PRESCALER_MAX_LOG2)
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    dev->cs_port = cs_port;
+    dev->cs_mask = cs_mask;
+    // BR divides by 2^(BR + 1); CPOL and CPHA are CR1 bits 1 and 0, as in the mode number
+    dev->cr1 = ((log2 - 1) << SPI_CR1_BR_Pos) | mode;
+    bsp_spi_cs_release(dev);
+
+    return BSP_STATUS_OK;
+}
+
+uint32_t bsp_spi_queue(const bsp_spi_dev_t *dev, const uint8_t *tx, uint8_t *rx, uint32_t len, uint32_t flags,
+                       bsp_callback_t cb, void *cb_arg)
+{
+    uint32_t ret = BSP_STATUS_OK;
+    uint32_t primask;
+
+    if ((dev == NULL) || ((tx == NULL) && (rx == NULL)) || (len == 0) || (len > BSP_SPI_TRANSFER_MAX))
+    {
+        return BSP_STATUS_FAIL;
+    }
+
+    primask = bsp_critical_enter();
+
+    if ((bsp_spi_queue_head - bsp_spi_queue_tail) >= BSP_SPI_QUEUE_LEN)
+    {
+        ret = BSP_STATUS_FAIL;
+    }
+    else
+    {
+        bsp_spi_queue_xfers[bsp_spi_queue_head % BSP_SPI_QUEUE_LEN] = (bsp_spi_xfer_t)
+        {
+            .dev = dev,
+            .tx = tx,
+            .rx = rx,
+            .len = (uint16_t) len,
+            .flags = flags,
+            .cb = cb,
+            .cb_arg = cb_arg,
+        };
+        bsp_spi_queue_head++;
+
+        // An idle bus is started here; otherwise the completion interrupt gets to this transfer in turn
+        if ((bsp_spi_queue_head - bsp_spi_queue_tail) == 1)
+        {
+            bsp_power_lock_stop();
+            if (bsp_spi_start() != BSP_STATUS_OK)
+            {
+                bsp_spi_queue_head--;
+                bsp_power_unlock_stop();
+                ret = BSP_STATUS_FAIL;
+            }
+        }
+    }
+
+    bsp_critical_exit(primask);
+
+    return ret;
+}
+
+uint32_t bsp_spi_transfer_async(const bsp_spi_dev_t *dev, const uint8_t *tx, uint8_t *rx, uint32_t len,
+                                bsp_callback_t cb, void *cb_arg)
+{
+    return bsp_spi_queue(dev, tx, rx, len, 0, cb, cb_arg);
+}
+
+uint32_t bsp_spi_pending(void)
+{
+    return bsp_spi_queue_head - bsp_spi_queue_tail;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file bsp_spi.h
+ *
+ * @brief Asynchronous SPI1 master: a queue of DMA transfers, each framed by its device's chip select
+ *
+ * SPI1 is on PB3 (SCK), PB4 (MISO) and PB5 (MOSI), Arduino D3, D5 and D4, clocked from the 84 MHz APB2 bus.  Each
+ * transfer moves its whole buffer by DMA, DMA2 Stream2 receiving and Stream3 transmitting, with no interrupt until it
+ * completes.  The completion interrupt releases chip select, starts the next queued transfer at once and only then
+ * calls the finished transfer's callback, so a queue of transfers runs back-to-back without waiting on main().
+ *
+ * SPI1 and DMA are not clocked in STOP, so STOP is held off while the queue is not empty.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_SPI_H
+#define BSP_SPI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdint.h>
+#include "bsp.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief Transfers that can be queued at once, including the one in progress
+ *
+ */
+#ifndef BSP_SPI_QUEUE_LEN
+#define BSP_SPI_QUEUE_LEN               (8)
+#endif
+
+/**
+ * @brief Longest transfer, set by the 16-bit DMA transfer count
+ *
+ */
+#define BSP_SPI_TRANSFER_MAX            (0xFFFF)
+
+/**
+ * @brief Byte clocked out by transfers with no transmit buffer
+ *
+ */
+#define BSP_SPI_FILL_BYTE               (0xFF)
+
+/**
+ * @brief Flags of bsp_spi_queue()
+ *
+ * BSP_SPI_KEEP_CS leaves chip select asserted when the transfer ends, so that the next transfer to the same device
+ * continues the same command, e.g. a flash read queued as a 4-byte command and then the data.  Chip select is
+ * released before a transfer to another device starts, but while the queue is empty it stays asserted.
+ *
+ */
+#define BSP_SPI_KEEP_CS                 (1UL << 0)
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * A part on the bus
+ *
+ * @see bsp_spi_dev_init
+ *
+ */
+typedef struct
+{
+    GPIO_TypeDef *cs_port;          ///< Active-low chip select, configured as an output by the caller
+    uint16_t cs_mask;
+    uint32_t cr1;                   ///< Clock rate and mode, as written to SPI1 CR1 when the device changes
+} bsp_spi_dev_t;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Describe a device and release its chip select
+ *
+ * The SPI clock is the fastest division of the APB2 clock by 2 to 256 that does not exceed max_hz, at most 42 MHz.
+ * The chip select on the board pin table, BSP_PIN_SPI_CS, is configured by bsp_init(); any other must be configured
+ * as an output before this is called.
+ *
+ * @param [out] dev             Device, which must stay valid while transfers to it are queued
+ * @param [in] cs_port          Chip select port, e.g. BSP_PIN_PORT(SPI_CS)
+ * @param [in] cs_mask          Chip select pin, e.g. BSP_PIN_MASK(SPI_CS)
+ * @param [in] max_hz           Fastest SCK the part accepts
+ * @param [in] mode             SPI mode 0 to 3: CPOL in bit 1, CPHA in bit 0
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if max_hz is below the slowest clock or mode is above 3
+ *
+ */
+uint32_t bsp_spi_dev_init(bsp_spi_dev_t *dev, GPIO_TypeDef *cs_port, uint16_t cs_mask, uint32_t max_hz,
+                          uint32_t mode);
+
+/**
+ * Queue a full-duplex transfer of len bytes, which starts at once if the bus is idle
+ *
+ * Safe to call from interrupt context, including from a transfer callback.  The callback is called from the DMA
+ * interrupt with BSP_STATUS_OK once the transfer is complete and chip select released, or BSP_STATUS_FAIL if SPI or
+ * DMA reported an error.  The buffers belong to the driver until then.
+ *
+ * @param [in] dev              Device to address
+ * @param [in] tx               Bytes to send, or NULL to send BSP_SPI_FILL_BYTE
+ * @param [out] rx              Where to store the bytes received, or NULL to discard them; when tx is NULL, it is
+ *                              filled with BSP_SPI_FILL_BYTE when the transfer starts
+ * @param [in] len              1 to BSP_SPI_TRANSFER_MAX
+ * @param [in] cb               Called when the transfer is over, or NULL
+ * @param [in] cb_arg           Passed to cb
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if the queue is full, tx and rx are both NULL or another argument is out
+ *         of range
+ *
+ */
+uint32_t bsp_spi_transfer_async(const bsp_spi_dev_t *dev, const uint8_t *tx, uint8_t *rx, uint32_t len,
+                                bsp_callback_t cb, void *cb_arg);
+
+/**
+ * As bsp_spi_transfer_async(), with BSP_SPI_* flags
+ *
+ */
+uint32_t bsp_spi_queue(const bsp_spi_dev_t *dev, const uint8_t *tx, uint8_t *rx, uint32_t len, uint32_t flags,
+                       bsp_callback_t cb, void *cb_arg);
+
+/**
+ * Number of transfers queued or in progress
+ *
+ */
+uint32_t bsp_spi_pending(void);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_SPI_H
@@ -0,0 +1,165 @@
+/**
+ * @file bsp_task.c
+ *
+ * @brief Implementation of the cooperative stackless task scheduler
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stddef.h>
+#include "bsp_task.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static bsp_task_t *bsp_tasks[BSP_TASK_MAX];
+
+// Bit n set while bsp_tasks[n] is ready to run
+static volatile uint32_t bsp_task_ready_mask = 0;
+
+static bool bsp_task_initialized = false;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static void bsp_task_make_ready(bsp_task_t *task)
+{
+    __atomic_fetch_or(&bsp_task_ready_mask, 1UL << task->id, __ATOMIC_RELEASE);
+    bsp_event_post(BSP_TASK_EVENT, 0);
+
+    return;
+}
+
+static void bsp_task_timer_cb(uint32_t status, void *arg)
+{
+    bsp_task_signal((bsp_task_t *) arg, BSP_TASK_SIGNAL_TIMER);
+
+    return;
+}
+
+/**
+ * Run every task that was ready when the scheduler event was dispatched
+ *
+ * Tasks made ready while these run, including ones that yield, post the event again and run on its next dispatch, so
+ * higher-priority events are never held off by more than one pass.
+ *
+ */
+static void bsp_task_event_handler(uint32_t event, uint32_t payload, uint32_t count, void *arg)
+{
+    uint32_t ready = __atomic_exchange_n(&bsp_task_ready_mask, 0, __ATOMIC_ACQUIRE);
+
+    while (ready != 0)
+    {
+        uint32_t id = __builtin_ctz(ready);
+        bsp_task_t *task = bsp_tasks[id];
+
+        ready &= ~(1UL << id);
+
+        if (task != NULL)
+        {
+            uint32_t ret = task->fn(task, task->arg);
+
+            if (ret == BSP_TASK_YIELDED)
+            {
+                bsp_task_make_ready(task);
+            }
+            else if (ret == BSP_TASK_EXITED)
+            {
+                bsp_timer_cancel(task->timer);
+                bsp_tasks[id] = NULL;
+            }
+        }
+    }
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+uint32_t bsp_task_create(bsp_task_t *task, bsp_task_fn_t fn, void *arg)
+{
+    uint32_t ret = BSP_STATUS_FAIL;
+    uint32_t i;
+
+    if (!bsp_task_initialized)
+    {
+        bsp_event_register(BSP_TASK_EVENT, bsp_task_event_handler, NULL);
+        bsp_task_initialized = true;
+    }
+
+    if ((task != NULL) && (fn != NULL))
+    {
+        for (i = 0; i < BSP_TASK_MAX; i++)
+        {
+            if (bsp_tasks[i] == NULL)
+            {
+                task->fn = fn;
+                task->arg = arg;
+                task->resume = NULL;
+                task->signals = 0;
+                task->received = 0;
+                task->timer = BSP_TIMER_HANDLE_INVALID;
+                task->id = i;
+                bsp_tasks[i] = task;
+
+                bsp_task_make_ready(task);
+
+                ret = BSP_STATUS_OK;
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+void bsp_task_signal(bsp_task_t *task, uint32_t signals)
+{
+    __atomic_fetch_or(&task->signals, signals, __ATOMIC_RELEASE);
+    bsp_task_make_ready(task);
+
+    return;
+}
+
+bool bsp_task_take_signals(bsp_task_t *task, uint32_t mask)
+{
+    task->received = __atomic_fetch_and(&task->signals, ~mask, __ATOMIC_ACQUIRE) & mask;
+
+    return (task->received != 0);
+}
+
+void bsp_task_delay_start(bsp_task_t *task, uint32_t delay_ms)
+{
+    bsp_task_take_signals(task, BSP_TASK_SIGNAL_TIMER);
+    bsp_timer_cancel(task->timer);
+
+    // If no timer is free, signal straight away so the delay degrades to a yield rather than a hang
+    if (bsp_timer_start(&task->timer, delay_ms, 0, bsp_task_timer_cb, task) != BSP_STATUS_OK)
+    {
+        bsp_task_signal(task, BSP_TASK_SIGNAL_TIMER);
+    }
+
+    return;
+}
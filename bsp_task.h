@@ -0,0 +1,214 @@
+/**
+ * @file bsp_task.h
+ *
+ * @brief Cooperative stackless task scheduler
+ *
+ * Tasks are protothreads: a task is a function that is re-entered from the top each time it runs and resumes at the
+ * point where it last waited.  All tasks share the main stack, so local variables do not survive a wait; keep state
+ * that must in static storage or in the task argument.
+ *
+ * Tasks run from the dispatcher in main-loop context and only when woken by a signal, so the main loop still reaches
+ * bsp_sleep() as soon as no task has anything to do.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_TASK_H
+#define BSP_TASK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include "bsp.h"
+#include "bsp_event.h"
+#include "bsp_timer.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief Maximum number of tasks
+ *
+ */
+#define BSP_TASK_MAX                    (32)
+
+/**
+ * @brief Event ID the scheduler runs tasks from
+ *
+ * The lowest-priority event, so handlers registered directly with bsp_event_register() run before any task.
+ *
+ */
+#define BSP_TASK_EVENT                  (BSP_EVENT_MAX - 1)
+
+/**
+ * @brief Signal raised by the timer started with BSP_TASK_DELAY_MS()
+ *
+ * The other signal bits are free for the application.
+ *
+ */
+#define BSP_TASK_SIGNAL_TIMER           (1UL << 31)
+
+/**
+ * @brief Task function return values
+ *
+ */
+#define BSP_TASK_WAITING                (0)
+#define BSP_TASK_YIELDED                (1)
+#define BSP_TASK_EXITED                 (2)
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+#define BSP_TASK_CONCAT_(a, b)          a##b
+#define BSP_TASK_CONCAT(a, b)           BSP_TASK_CONCAT_(a, b)
+#define BSP_TASK_LABEL                  BSP_TASK_CONCAT(bsp_task_resume_, __LINE__)
+
+/**
+ * @brief Open and close the body of a task function
+ *
+ * Resume points are recorded with GCC's labels-as-values, so unlike switch-based protothreads a task may use switch
+ * statements freely.  At most one wait macro may appear per source line.
+ *
+ */
+#define BSP_TASK_BEGIN(task) \
+    do \
+    { \
+        if ((task)->resume != NULL) \
+        { \
+            goto *((task)->resume); \
+        } \
+    } while (0)
+
+#define BSP_TASK_END(task) \
+    do \
+    { \
+        (task)->resume = NULL; \
+        return BSP_TASK_EXITED; \
+    } while (0)
+
+/**
+ * @brief Wait until cond is true, re-evaluating it each time the task is signalled
+ *
+ */
+#define BSP_TASK_WAIT_UNTIL(task, cond) \
+    do \
+    { \
+        (task)->resume = &&BSP_TASK_LABEL; \
+        BSP_TASK_LABEL: \
+        if (!(cond)) \
+        { \
+            return BSP_TASK_WAITING; \
+        } \
+    } while (0)
+
+/**
+ * @brief Wait for any of the signals in mask, then clear them and leave the ones received in (task)->received
+ *
+ */
+#define BSP_TASK_WAIT_SIGNAL(task, mask) \
+    BSP_TASK_WAIT_UNTIL((task), bsp_task_take_signals((task), (mask)))
+
+/**
+ * @brief Let every other ready task and pending event run before continuing
+ *
+ */
+#define BSP_TASK_YIELD(task) \
+    do \
+    { \
+        (task)->resume = &&BSP_TASK_LABEL; \
+        return BSP_TASK_YIELDED; \
+        BSP_TASK_LABEL: ; \
+    } while (0)
+
+/**
+ * @brief Wait for ms milliseconds
+ *
+ */
+#define BSP_TASK_DELAY_MS(task, ms) \
+    do \
+    { \
+        bsp_task_delay_start((task), (ms)); \
+        BSP_TASK_WAIT_SIGNAL((task), BSP_TASK_SIGNAL_TIMER); \
+    } while (0)
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+typedef struct bsp_task_s bsp_task_t;
+
+/**
+ * Task function
+ *
+ * @param [in] task             Task being run
+ * @param [in] arg              Argument passed to bsp_task_create()
+ *
+ * @return BSP_TASK_WAITING, BSP_TASK_YIELDED or BSP_TASK_EXITED, as returned by the task macros
+ *
+ */
+typedef uint32_t (*bsp_task_fn_t)(bsp_task_t *task, void *arg);
+
+/**
+ * Task control block, allocated by the caller and owned by the scheduler until the task exits
+ *
+ */
+struct bsp_task_s
+{
+    bsp_task_fn_t fn;
+    void *arg;
+    void *resume;                   ///< Where the task continues next time it runs; NULL to start from the top
+    volatile uint32_t signals;      ///< Signals raised and not yet taken
+    uint32_t received;              ///< Signals taken by the last BSP_TASK_WAIT_SIGNAL()
+    bsp_timer_handle_t timer;
+    uint32_t id;
+};
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Add a task to the scheduler and make it ready to run up to its first wait
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if task or fn is NULL or BSP_TASK_MAX tasks exist
+ *
+ */
+uint32_t bsp_task_create(bsp_task_t *task, bsp_task_fn_t fn, void *arg);
+
+/**
+ * Raise signals on a task and make it ready to run
+ *
+ * Lock-free and safe to call from any interrupt priority, including BSP callbacks and timer callbacks.
+ *
+ */
+void bsp_task_signal(bsp_task_t *task, uint32_t signals);
+
+// Used by the task macros
+bool bsp_task_take_signals(bsp_task_t *task, uint32_t mask);
+void bsp_task_delay_start(bsp_task_t *task, uint32_t delay_ms);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_TASK_H
@@ -0,0 +1,266 @@
+/**
+ * @file bsp_tick.c
+ *
+ * @brief Tickless HAL time base on the free-running 32-bit TIM5
+ *
+ * Replaces the HAL's 1 kHz SysTick interrupt: HAL_GetTick() is computed on demand from the TIM5 counter and HAL_Delay()
+ * sleeps until a TIM5 compare, so the core is no longer woken every millisecond.  The only periodic interrupt left is
+ * the TIM5 overflow, once every 71 minutes, which extends the counter to 64 bits.
+ *
+ * Channel 1 is HAL_Delay()'s; channel 2 is the alarm the timer service in bsp_timer.c multiplexes its timers onto.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stddef.h>
+#include "bsp_internal.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define BSP_TICK_COUNTER_CLOCK_HZ       (1000000)
+
+// Shared by the overflow, HAL_Delay() and the timer service, whose callbacks run at the timer service's priority
+#define BSP_TICK_PREPRIO                (0x4)
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+// Upper 32 bits of the microsecond count
+static volatile uint32_t bsp_tick_overflows = 0;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+TIM_HandleTypeDef tick_tim_handle;
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * MCU HAL FUNCTIONS
+ *
+ * @warning - Function names below are expected in STM32 HAL code, do not change
+ **********************************************************************************************************************/
+/**
+ * Start, or re-scale after a clock change, the 1 MHz TIM5 time base
+ *
+ * Called by HAL_Init() and again by HAL_RCC_ClockConfig() each time the clocks change, including on every wake from
+ * STOP.  The count is preserved across re-scaling so time stays monotonic.
+ *
+ */
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
+{
+    uint32_t prescaler = (bsp_apb1_timer_hz() / BSP_TICK_COUNTER_CLOCK_HZ) - 1;
+
+    if (TickPriority >= (1UL << __NVIC_PRIO_BITS))
+    {
+        return HAL_ERROR;
+    }
+
+    // Nothing uses SysTick any more
+    SysTick->CTRL = 0;
+
+    if (tick_tim_handle.State == HAL_TIM_STATE_RESET)
+    {
+        __HAL_RCC_TIM5_CLK_ENABLE();
+
+        tick_tim_handle.Instance = TIM5;
+        tick_tim_handle.Init.Period = 0xFFFFFFFF;
+        tick_tim_handle.Init.Prescaler = prescaler;
+        tick_tim_handle.Init.ClockDivision = 0;
+        tick_tim_handle.Init.CounterMode = TIM_COUNTERMODE_UP;
+        tick_tim_handle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+        if (HAL_TIM_Base_Init(&tick_tim_handle) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        // Only a real overflow may count as one, not the update events generated to load the prescaler
+        __HAL_TIM_URS_ENABLE(&tick_tim_handle);
+        __HAL_TIM_CLEAR_FLAG(&tick_tim_handle, TIM_FLAG_UPDATE);
+        HAL_TIM_Base_Start_IT(&tick_tim_handle);
+    }
+    else
+    {
+        uint32_t primask = bsp_critical_enter();
+        uint32_t count = __HAL_TIM_GET_COUNTER(&tick_tim_handle);
+
+        // The prescaler is buffered; an update event loads it at once but also clears the counter, so restore it
+        __HAL_TIM_SET_PRESCALER(&tick_tim_handle, prescaler);
+        tick_tim_handle.Instance->EGR = TIM_EGR_UG;
+        __HAL_TIM_SET_COUNTER(&tick_tim_handle, count);
+
+        bsp_critical_exit(primask);
+    }
+
+    // Nothing runs off a tick interrupt, so TickPriority is only recorded
+    HAL_NVIC_SetPriority(TIM5_IRQn, BSP_TICK_PREPRIO, 0);
+    HAL_NVIC_EnableIRQ(TIM5_IRQn);
+    uwTickPrio = TickPriority;
+
+    return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t) (bsp_tick_now_us() / 1000);
+}
+
+/**
+ * Wait for at least Delay milliseconds, sleeping until a TIM5 compare instead of polling a tick
+ *
+ * @warning Not re-entrant: do not call from an interrupt that may preempt another HAL_Delay()
+ *
+ */
+void HAL_Delay(uint32_t Delay)
+{
+    uint64_t start = bsp_tick_now_us();
+    uint64_t wait = (uint64_t) Delay * 1000;
+
+    __HAL_TIM_SET_COMPARE(&tick_tim_handle, TIM_CHANNEL_1, (uint32_t) (start + wait));
+    __HAL_TIM_CLEAR_FLAG(&tick_tim_handle, TIM_FLAG_CC1);
+    __HAL_TIM_ENABLE_IT(&tick_tim_handle, TIM_IT_CC1);
+
+    while ((bsp_tick_now_us() - start) < wait)
+    {
+        __WFI();
+    }
+
+    __HAL_TIM_DISABLE_IT(&tick_tim_handle, TIM_IT_CC1);
+
+    return;
+}
+
+// There is no periodic tick to suspend
+void HAL_SuspendTick(void)
+{
+    return;
+}
+
+void HAL_ResumeTick(void)
+{
+    return;
+}
+
+/***********************************************************************************************************************
+ * BSP INTERNAL FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Microseconds since HAL_Init()
+ *
+ * Safe with interrupts masked: an overflow whose interrupt is still pending is accounted for.
+ *
+ */
+uint64_t bsp_tick_now_us(void)
+{
+    uint32_t primask = bsp_critical_enter();
+    uint32_t high = bsp_tick_overflows;
+    uint32_t low = __HAL_TIM_GET_COUNTER(&tick_tim_handle);
+
+    // An overflow not yet serviced belongs to this reading; re-read the count, which may have been taken before it
+    if (__HAL_TIM_GET_FLAG(&tick_tim_handle, TIM_FLAG_UPDATE) != RESET)
+    {
+        low = __HAL_TIM_GET_COUNTER(&tick_tim_handle);
+        high++;
+    }
+
+    bsp_critical_exit(primask);
+
+    return ((uint64_t) high << 32) | low;
+}
+
+/**
+ * Microseconds since HAL_Init(), modulo 2^32: the free-running count the timer service compares against
+ *
+ */
+uint32_t bsp_tick_now(void)
+{
+    return __HAL_TIM_GET_COUNTER(&tick_tim_handle);
+}
+
+/**
+ * Arm TIM5 channel 2 to interrupt when the counter reaches expiry
+ *
+ * If the counter has already passed expiry by the time the compare register is written, the compare event is
+ * generated in software so the deadline is never missed.
+ *
+ */
+void bsp_tick_set_alarm(uint32_t expiry)
+{
+    __HAL_TIM_SET_COMPARE(&tick_tim_handle, TIM_CHANNEL_2, expiry);
+    __HAL_TIM_CLEAR_FLAG(&tick_tim_handle, TIM_FLAG_CC2);
+    __HAL_TIM_ENABLE_IT(&tick_tim_handle, TIM_IT_CC2);
+
+    if ((int32_t) (expiry - __HAL_TIM_GET_COUNTER(&tick_tim_handle)) <= 0)
+    {
+        // Move CCR2 up to now so it always holds the counter value its compare event was raised at
+        __HAL_TIM_SET_COMPARE(&tick_tim_handle, TIM_CHANNEL_2, __HAL_TIM_GET_COUNTER(&tick_tim_handle));
+        tick_tim_handle.Instance->EGR = TIM_EGR_CC2G;
+    }
+
+    return;
+}
+
+void bsp_tick_cancel_alarm(void)
+{
+    __HAL_TIM_DISABLE_IT(&tick_tim_handle, TIM_IT_CC2);
+    __HAL_TIM_CLEAR_FLAG(&tick_tim_handle, TIM_FLAG_CC2);
+
+    return;
+}
+
+/**
+ * Move the time base forward by time spent in STOP, when TIM5 was not clocked
+ *
+ */
+void bsp_tick_advance(uint32_t us)
+{
+    uint32_t primask = bsp_critical_enter();
+    uint32_t count = __HAL_TIM_GET_COUNTER(&tick_tim_handle);
+
+    __HAL_TIM_SET_COUNTER(&tick_tim_handle, count + us);
+
+    // Writing the counter past the top does not raise an update event, so account for the wrap here
+    if ((count + us) < count)
+    {
+        bsp_tick_overflows++;
+    }
+
+    // Jumping the counter can step over CCR2 without a compare match, so raise the event for an alarm now overdue
+    if ((__HAL_TIM_GET_IT_SOURCE(&tick_tim_handle, TIM_IT_CC2) != RESET) &&
+        ((int32_t) (__HAL_TIM_GET_COMPARE(&tick_tim_handle, TIM_CHANNEL_2) - (count + us)) <= 0))
+    {
+        __HAL_TIM_SET_COMPARE(&tick_tim_handle, TIM_CHANNEL_2, __HAL_TIM_GET_COUNTER(&tick_tim_handle));
+        tick_tim_handle.Instance->EGR = TIM_EGR_CC2G;
+    }
+
+    bsp_critical_exit(primask);
+
+    return;
+}
+
+/**
+ * TIM5 update interrupt: the counter wrapped
+ *
+ */
+void bsp_tick_overflow(void)
+{
+    bsp_tick_overflows++;
+
+    return;
+}
@@ -0,0 +1,339 @@
+/**
+ * @file bsp_timer.c
+ *
+ * @brief Implementation of the software timer service multiplexed onto TIM5 channel 2
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stddef.h>
+#include "bsp_timer.h"
+#include "bsp_internal.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define BSP_TIMER_SLOT_BITS             (8)
+#define BSP_TIMER_SLOT_MASK             ((1 << BSP_TIMER_SLOT_BITS) - 1)
+
+typedef struct bsp_timer_s
+{
+    struct bsp_timer_s *next;
+    uint32_t expiry;                ///< Absolute expiry time, in TIM5 ticks
+    uint32_t period;                ///< In TIM5 ticks; 0 for one-shot timers
+    bsp_callback_t cb;
+    void *cb_arg;
+    uint32_t generation;            ///< Bumped each time the slot is freed, invalidating old handles
+    bool in_use;
+} bsp_timer_t;
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static bsp_timer_t bsp_timer_pool[BSP_TIMER_MAX];
+
+// Running timers, sorted by expiry time.  Timers with equal expiry times fire in the order they were started.
+static bsp_timer_t *bsp_timer_list = NULL;
+
+// Expiry time TIM5 is currently armed for, valid while bsp_timer_armed is true
+static uint32_t bsp_timer_armed_expiry = 0;
+static bool bsp_timer_armed = false;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static uint32_t bsp_timer_now(void)
+{
+    return bsp_tick_now();
+}
+
+static bsp_timer_handle_t bsp_timer_to_handle(const bsp_timer_t *timer)
+{
+    uint32_t slot = (uint32_t) (timer - bsp_timer_pool);
+
+    // Slot is stored off by one so that no valid handle equals BSP_TIMER_HANDLE_INVALID
+    return (timer->generation << BSP_TIMER_SLOT_BITS) | (slot + 1);
+}
+
+static bsp_timer_t *bsp_timer_from_handle(bsp_timer_handle_t handle)
+{
+    bsp_timer_t *ret = NULL;
+    uint32_t slot = (handle & BSP_TIMER_SLOT_MASK);
+
+    if ((slot > 0) && (slot <= BSP_TIMER_MAX))
+    {
+        bsp_timer_t *timer = &bsp_timer_pool[slot - 1];
+
+        if (timer->in_use && (bsp_timer_to_handle(timer) == handle))
+        {
+            ret = timer;
+        }
+    }
+
+    return ret;
+}
+
+static void bsp_timer_free(bsp_timer_t *timer)
+{
+    timer->in_use = false;
+    timer->generation++;
+    timer->generation &= (0xFFFFFFFF >> BSP_TIMER_SLOT_BITS);
+
+    return;
+}
+
+/**
+ * Insert timer into bsp_timer_list after every timer expiring at or before it
+ *
+ * @warning Call inside a critical section
+ *
+ */
+static void bsp_timer_insert(bsp_timer_t *timer)
+{
+    bsp_timer_t **link = &bsp_timer_list;
+
+    // Compare the signed difference so the order survives the 32-bit time base wrapping
+    while ((*link != NULL) && ((int32_t) ((*link)->expiry - timer->expiry) <= 0))
+    {
+        link = &((*link)->next);
+    }
+
+    timer->next = *link;
+    *link = timer;
+
+    return;
+}
+
+/**
+ * Unlink timer from bsp_timer_list
+ *
+ * @warning Call inside a critical section
+ *
+ */
+static void bsp_timer_remove(bsp_timer_t *timer)
+{
+    bsp_timer_t **link = &bsp_timer_list;
+
+    while ((*link != NULL) && (*link != timer))
+    {
+        link = &((*link)->next);
+    }
+
+    if (*link != NULL)
+    {
+        *link = timer->next;
+    }
+    timer->next = NULL;
+
+    return;
+}
+
+/**
+ * Arm TIM5 for the earliest running timer, if it is not already armed for it
+ *
+ * @warning Call inside a critical section
+ *
+ */
+static void bsp_timer_rearm(void)
+{
+    if (bsp_timer_list == NULL)
+    {
+        if (bsp_timer_armed)
+        {
+            bsp_tick_cancel_alarm();
+            bsp_timer_armed = false;
+        }
+    }
+    else if (!bsp_timer_armed || (bsp_timer_armed_expiry != bsp_timer_list->expiry))
+    {
+        bsp_timer_armed_expiry = bsp_timer_list->expiry;
+        bsp_timer_armed = true;
+        bsp_tick_set_alarm(bsp_timer_armed_expiry);
+    }
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+void bsp_timer_init(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BSP_TIMER_MAX; i++)
+    {
+        bsp_timer_pool[i].in_use = false;
+        bsp_timer_pool[i].next = NULL;
+    }
+    bsp_timer_list = NULL;
+    bsp_timer_armed = false;
+
+    return;
+}
+
+/**
+ * Run the callbacks of every timer that has expired and re-arm TIM5 for the next one
+ *
+ * Called from the TIM5 interrupt.  Callbacks run outside the critical section, so they may start and cancel timers,
+ * including their own.
+ *
+ */
+void bsp_timer_expired(void)
+{
+    uint32_t primask = bsp_critical_enter();
+    uint32_t now = bsp_timer_now();
+
+    bsp_timer_armed = false;
+
+    while ((bsp_timer_list != NULL) && ((int32_t) (bsp_timer_list->expiry - now) <= 0))
+    {
+        bsp_timer_t *timer = bsp_timer_list;
+        bsp_callback_t cb = timer->cb;
+        void *cb_arg = timer->cb_arg;
+
+        bsp_timer_list = timer->next;
+        timer->next = NULL;
+
+        if (timer->period != 0)
+        {
+            // Keep periodic timers in phase; if expiries were missed entirely, skip them rather than fire in a burst
+            do
+            {
+                timer->expiry += timer->period;
+            } while ((int32_t) (timer->expiry - now) <= 0);
+
+            bsp_timer_insert(timer);
+        }
+        else
+        {
+            bsp_timer_free(timer);
+        }
+
+        bsp_critical_exit(primask);
+        cb(BSP_STATUS_OK, cb_arg);
+        primask = bsp_critical_enter();
+
+        now = bsp_timer_now();
+    }
+
+    bsp_timer_rearm();
+
+    bsp_critical_exit(primask);
+
+    return;
+}
+
+uint32_t bsp_timer_start(bsp_timer_handle_t *handle,
+                         uint32_t delay_ms,
+                         uint32_t period_ms,
+                         bsp_callback_t cb,
+                         void *cb_arg)
+{
+    uint32_t ret = BSP_STATUS_FAIL;
+    uint32_t primask;
+    uint32_t i;
+
+    if (handle != NULL)
+    {
+        *handle = BSP_TIMER_HANDLE_INVALID;
+    }
+
+    if ((cb != NULL) && (delay_ms <= BSP_TIMER_MAX_DELAY_MS) && (period_ms <= BSP_TIMER_MAX_DELAY_MS))
+    {
+        primask = bsp_critical_enter();
+
+        for (i = 0; i < BSP_TIMER_MAX; i++)
+        {
+            if (!bsp_timer_pool[i].in_use)
+            {
+                bsp_timer_t *timer = &bsp_timer_pool[i];
+                uint32_t now = bsp_timer_now();
+
+                timer->in_use = true;
+                timer->expiry = now + (delay_ms * BSP_TICK_TICKS_PER_MS);
+                timer->period = period_ms * BSP_TICK_TICKS_PER_MS;
+                timer->cb = cb;
+                timer->cb_arg = cb_arg;
+
+                bsp_timer_insert(timer);
+                bsp_timer_rearm();
+
+                if (handle != NULL)
+                {
+                    *handle = bsp_timer_to_handle(timer);
+                }
+                ret = BSP_STATUS_OK;
+                break;
+            }
+        }
+
+        bsp_critical_exit(primask);
+    }
+
+    return ret;
+}
+
+uint32_t bsp_timer_cancel(bsp_timer_handle_t handle)
+{
+    uint32_t ret = BSP_STATUS_FAIL;
+    uint32_t primask = bsp_critical_enter();
+    bsp_timer_t *timer = bsp_timer_from_handle(handle);
+
+    if (timer != NULL)
+    {
+        bsp_timer_remove(timer);
+        bsp_timer_free(timer);
+        bsp_timer_rearm();
+
+        ret = BSP_STATUS_OK;
+    }
+
+    bsp_critical_exit(primask);
+
+    return ret;
+}
+
+/**
+ * Expiry time of the earliest running timer
+ *
+ * @return false if no timer is running
+ *
+ */
+bool bsp_timer_next_expiry(uint32_t *expiry)
+{
+    bool ret = false;
+    uint32_t primask = bsp_critical_enter();
+
+    if (bsp_timer_list != NULL)
+    {
+        *expiry = bsp_timer_list->expiry;
+        ret = true;
+    }
+
+    bsp_critical_exit(primask);
+
+    return ret;
+}
+
+bool bsp_timer_is_running(bsp_timer_handle_t handle)
+{
+    return (bsp_timer_from_handle(handle) != NULL);
+}
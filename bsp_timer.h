@@ -0,0 +1,113 @@
+/**
+ * @file bsp_timer.h
+ *
+ * @brief Software timer service multiplexed onto TIM5 channel 2
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_TIMER_H
+#define BSP_TIMER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include "bsp.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief Maximum number of concurrently running timers
+ *
+ */
+#ifndef BSP_TIMER_MAX
+#define BSP_TIMER_MAX                   (32)
+#endif
+
+/**
+ * @brief Longest delay or period accepted by bsp_timer_start()
+ *
+ * Expiry times are compared as signed differences of the free-running 1 MHz TIM5 counter, so must lie within half
+ * of its 32-bit range.
+ *
+ */
+#define BSP_TIMER_MAX_DELAY_MS          (0x7FFFFFFF / 1000)
+
+/**
+ * @brief Handle value never returned by bsp_timer_start()
+ *
+ */
+#define BSP_TIMER_HANDLE_INVALID        (0)
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * Timer handle
+ *
+ * Encodes the timer slot and a per-slot generation count, so a handle to a timer that has since fired or been
+ * cancelled is rejected rather than cancelling whichever timer now occupies the slot.
+ *
+ */
+typedef uint32_t bsp_timer_handle_t;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Start a one-shot or periodic timer
+ *
+ * Timers are kept in a list sorted by expiry time and a TIM5 compare channel is only ever armed for the earliest one,
+ * so start, cancel and expiry are cheap enough to call from the timer callbacks themselves.  Callbacks run in TIM5
+ * interrupt context.
+ *
+ * @param [out] handle          Handle for bsp_timer_cancel(); may be NULL
+ * @param [in] delay_ms         Time until the first expiry
+ * @param [in] period_ms        Time between subsequent expiries, or 0 for a one-shot timer
+ * @param [in] cb               Called on every expiry
+ * @param [in] cb_arg           Passed to cb
+ *
+ * @return BSP_STATUS_OK, or BSP_STATUS_FAIL if cb is NULL, a time exceeds BSP_TIMER_MAX_DELAY_MS or all
+ *         BSP_TIMER_MAX timers are running
+ *
+ */
+uint32_t bsp_timer_start(bsp_timer_handle_t *handle,
+                         uint32_t delay_ms,
+                         uint32_t period_ms,
+                         bsp_callback_t cb,
+                         void *cb_arg);
+uint32_t bsp_timer_cancel(bsp_timer_handle_t handle);
+bool bsp_timer_is_running(bsp_timer_handle_t handle);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_TIMER_H
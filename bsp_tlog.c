@@ -0,0 +1,166 @@
+/**
+ * @file bsp_tlog.c
+ *
+ * @brief Tokenized binary logging, see bsp_tlog.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include "bsp_tlog.h"
+#include "bsp_internal.h"
+#include <string.h>
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+// Marker and length byte
+#define BSP_TLOG_HEADER_SIZE            (2)
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static inline void bsp_tlog_store(bsp_tlog_frame_t *frame, uint32_t i, uint8_t byte)
+{
+    if (i < frame->first_size)
+    {
+        frame->first[i] = byte;
+    }
+    else if (i < frame->space)
+    {
+        frame->second[i - frame->first_size] = byte;
+    }
+
+    return;
+}
+
+static inline void bsp_tlog_put(bsp_tlog_frame_t *frame, uint8_t byte)
+{
+    bsp_tlog_store(frame, frame->count++, byte);
+
+    return;
+}
+
+static void bsp_tlog_put_varint(bsp_tlog_frame_t *frame, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        bsp_tlog_put(frame, (uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    bsp_tlog_put(frame, (uint8_t) value);
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+void bsp_tlog_begin(bsp_tlog_frame_t *frame, const char *fmt)
+{
+    memset(frame, 0, sizeof(*frame));
+
+    // Only the main loop may produce into the TX FIFO; from interrupt context the frame is measured and dropped
+    if (__get_IPSR() == 0)
+    {
+        frame->space = bsp_ring_space(&bsp_uart_tx_fifo);
+        frame->first_size = bsp_ring_reserve_contiguous(&bsp_uart_tx_fifo, &frame->first);
+        frame->second = bsp_uart_tx_fifo.buffer;
+        if (frame->first_size > frame->space)
+        {
+            frame->first_size = frame->space;
+        }
+    }
+
+    // The length byte is filled in by bsp_tlog_end()
+    bsp_tlog_put(frame, BSP_TLOG_FRAME_MARKER);
+    bsp_tlog_put(frame, 0);
+    bsp_tlog_put_varint(frame, (uint32_t) (uintptr_t) fmt);
+
+    return;
+}
+
+void bsp_tlog_put_int(bsp_tlog_frame_t *frame, int64_t value)
+{
+    bsp_tlog_put_varint(frame, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+
+    return;
+}
+
+void bsp_tlog_put_float(bsp_tlog_frame_t *frame, double value)
+{
+    float single = (float) value;
+    uint32_t bits;
+
+    memcpy(&bits, &single, sizeof(bits));
+    bsp_tlog_put(frame, (uint8_t) bits);
+    bsp_tlog_put(frame, (uint8_t) (bits >> 8));
+    bsp_tlog_put(frame, (uint8_t) (bits >> 16));
+    bsp_tlog_put(frame, (uint8_t) (bits >> 24));
+
+    return;
+}
+
+void bsp_tlog_put_string(bsp_tlog_frame_t *frame, const char *str)
+{
+    uint32_t len = 0;
+
+    if (str == NULL)
+    {
+        str = "(null)";
+    }
+    while ((len < BSP_TLOG_STRING_MAX) && (str[len] != '\0'))
+    {
+        len++;
+    }
+
+    bsp_tlog_put_varint(frame, len);
+    while (len-- > 0)
+    {
+        bsp_tlog_put(frame, (uint8_t) *str++);
+    }
+
+    return;
+}
+
+void bsp_tlog_put_pointer(bsp_tlog_frame_t *frame, const void *ptr)
+{
+    bsp_tlog_put_int(frame, (int64_t) (uintptr_t) ptr);
+
+    return;
+}
+
+size_t bsp_tlog_end(bsp_tlog_frame_t *frame)
+{
+    uint32_t payload = frame->count - BSP_TLOG_HEADER_SIZE;
+
+    // A frame that does not fit is dropped whole, as a partial one would desynchronise the decoder
+    if ((frame->count > frame->space) || (payload > BSP_TLOG_PAYLOAD_MAX))
+    {
+        return bsp_uart_tx_commit(0, frame->count);
+    }
+
+    bsp_tlog_store(frame, 1, (uint8_t) payload);
+
+    return bsp_uart_tx_commit(frame->count, 0);
+}
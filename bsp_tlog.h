@@ -0,0 +1,163 @@
+/**
+ * @file bsp_tlog.h
+ *
+ * @brief Tokenized binary logging: the target sends a format string ID and its raw arguments, the host renders text
+ *
+ * BSP_TLOG() places its format string in the .bsp_tlog section, which bsp_tlog.ld links as a non-loaded (INFO) section
+ * at address 0: the strings cost no flash and the address of a string is its ID.  At run time only the ID and the
+ * argument values are encoded, in place into the UART TX FIFO, as one frame:
+ *
+ *      BSP_TLOG_FRAME_MARKER, payload length (1 byte), varint ID, argument, argument, ...
+ *
+ * Arguments are encoded by their C type, selected at compile time:
+ * - integers, enums, bool and char:    zigzag LEB128 varint of the value, so small magnitudes take one byte
+ * - float and double:                  IEEE 754 single precision, 4 bytes little endian
+ * - char * and const char *:           varint length, then at most BSP_TLOG_STRING_MAX bytes, without terminator
+ * - void * and const void *:           as an unsigned integer
+ * Other pointers must be cast to void * for %p, as printf() requires anyway.
+ *
+ * tools/bsp_tlog_decode.py reads the .bsp_tlog section of the ELF file and turns a console capture back into text,
+ * passing ordinary console output through unchanged.  It supports the conversions of bsp_log.h plus %e and %g.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BSP_TLOG_H
+#define BSP_TLOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+/**
+ * @brief First byte of every frame; ordinary console output must not contain it
+ *
+ */
+#define BSP_TLOG_FRAME_MARKER           (0x1E)
+
+/**
+ * @brief Largest frame payload, so that its length fits in the single length byte
+ *
+ */
+#define BSP_TLOG_PAYLOAD_MAX            (127)
+
+/**
+ * @brief Longest %s argument sent; longer strings are cut to this length
+ *
+ */
+#ifndef BSP_TLOG_STRING_MAX
+#define BSP_TLOG_STRING_MAX             (32)
+#endif
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+/**
+ * @brief Log fmt and up to 8 arguments as a binary frame
+ *
+ * The arguments are checked against fmt as for printf().  Evaluates to nothing; a frame that does not fit in the TX
+ * FIFO is dropped whole and counted in bsp_uart_stats_t tx_dropped_bytes.
+ *
+ * @warning As for bsp_log(), calls from interrupt context are dropped
+ *
+ */
+#define BSP_TLOG(fmt, ...) \
+    do \
+    { \
+        static const char bsp_tlog_fmt[] __attribute__((section(".bsp_tlog"), used)) = fmt; \
+        bsp_tlog_frame_t bsp_tlog_frame; \
+        (void) sizeof(bsp_tlog_check_format(fmt, ##__VA_ARGS__)); \
+        bsp_tlog_begin(&bsp_tlog_frame, bsp_tlog_fmt); \
+        BSP_TLOG_ARGS(BSP_TLOG_ARG_COUNT(__VA_ARGS__), ##__VA_ARGS__) \
+        bsp_tlog_end(&bsp_tlog_frame); \
+    } while (0)
+
+// Encode one argument with the encoder for its type
+#define BSP_TLOG_ARG(x) \
+    _Generic((x), \
+             float: bsp_tlog_put_float, \
+             double: bsp_tlog_put_float, \
+             char *: bsp_tlog_put_string, \
+             const char *: bsp_tlog_put_string, \
+             void *: bsp_tlog_put_pointer, \
+             const void *: bsp_tlog_put_pointer, \
+             default: bsp_tlog_put_int)(&bsp_tlog_frame, (x));
+
+#define BSP_TLOG_ARG_COUNT(...)         BSP_TLOG_ARG_COUNT_(_, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define BSP_TLOG_ARG_COUNT_(_, a1, a2, a3, a4, a5, a6, a7, a8, n, ...) n
+
+#define BSP_TLOG_ARGS(n, ...)           BSP_TLOG_ARGS_(n, ##__VA_ARGS__)
+#define BSP_TLOG_ARGS_(n, ...)          BSP_TLOG_ARGS_##n(__VA_ARGS__)
+#define BSP_TLOG_ARGS_0()
+#define BSP_TLOG_ARGS_1(a)              BSP_TLOG_ARG(a)
+#define BSP_TLOG_ARGS_2(a, ...)         BSP_TLOG_ARG(a) BSP_TLOG_ARGS_1(__VA_ARGS__)
+#define BSP_TLOG_ARGS_3(a, ...)         BSP_TLOG_ARG(a) BSP_TLOG_ARGS_2(__VA_ARGS__)
+#define BSP_TLOG_ARGS_4(a, ...)         BSP_TLOG_ARG(a) BSP_TLOG_ARGS_3(__VA_ARGS__)
+#define BSP_TLOG_ARGS_5(a, ...)         BSP_TLOG_ARG(a) BSP_TLOG_ARGS_4(__VA_ARGS__)
+#define BSP_TLOG_ARGS_6(a, ...)         BSP_TLOG_ARG(a) BSP_TLOG_ARGS_5(__VA_ARGS__)
+#define BSP_TLOG_ARGS_7(a, ...)         BSP_TLOG_ARG(a) BSP_TLOG_ARGS_6(__VA_ARGS__)
+#define BSP_TLOG_ARGS_8(a, ...)         BSP_TLOG_ARG(a) BSP_TLOG_ARGS_7(__VA_ARGS__)
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+/**
+ * A frame being encoded in place into the free space of the TX FIFO, for use by BSP_TLOG() only
+ *
+ */
+typedef struct
+{
+    uint8_t *first;
+    uint32_t first_size;
+    uint8_t *second;
+    uint32_t space;
+    uint32_t count;
+} bsp_tlog_frame_t;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+// Frame encoders behind BSP_TLOG()
+void bsp_tlog_begin(bsp_tlog_frame_t *frame, const char *fmt);
+void bsp_tlog_put_int(bsp_tlog_frame_t *frame, int64_t value);
+void bsp_tlog_put_float(bsp_tlog_frame_t *frame, double value);
+void bsp_tlog_put_string(bsp_tlog_frame_t *frame, const char *str);
+void bsp_tlog_put_pointer(bsp_tlog_frame_t *frame, const void *ptr);
+size_t bsp_tlog_end(bsp_tlog_frame_t *frame);
+
+// Never called: only lets the compiler check BSP_TLOG() arguments against the format
+static inline int __attribute__((format(printf, 1, 2))) bsp_tlog_check_format(const char *fmt, ...)
+{
+    return 0;
+}
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BSP_TLOG_H
@@ -0,0 +1,2863 @@
+/**
+ * @file hal_sim.c
+ *
+ * @brief Host simulation of the STM32F401RE peripherals used by the BSP, behind the stand-in HAL
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+// <termios.h> names its carriage-return delays after the peripheral control registers
+#undef CR1
+#undef CR2
+#undef CR3
+#include "hal_sim.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define HAL_SIM_HSI_HZ                  (16000000)
+#define HAL_SIM_NS_PER_S                (1000000000ULL)
+#define HAL_SIM_NS_PER_MS               (1000000ULL)
+#define HAL_SIM_NO_DEADLINE             (UINT64_MAX)
+#define HAL_SIM_PB_PRESSES_MAX          (64)
+#define HAL_SIM_TIM_CHANNELS            (4)
+#define HAL_SIM_TIM_IT_MASK             (TIM_DIER_UIE | TIM_IT_CC1 | TIM_IT_CC2 | TIM_IT_CC3 | TIM_IT_CC4)
+#define HAL_SIM_UART_BITS_PER_BYTE      (10)
+#define HAL_SIM_DMA_SxCR_EN             (0x1U)
+
+// The I2C target: an 8-bit register file on I2C1, whose WHO_AM_I register reads back its address
+#define HAL_SIM_I2C_TARGET_ADDR         (0x68)
+#define HAL_SIM_I2C_TARGET_WHO_AM_I     (0x75)
+#define HAL_SIM_I2C_BITS_PER_BYTE       (9)
+
+// Samples of the internal ADC channels: VREFINT at 1.21 V and the temperature sensor at 0.76 V, 25 C, with VDDA 3.3 V
+#define HAL_SIM_ADC_VREFINT_SAMPLE      (1502)
+#define HAL_SIM_ADC_TEMP_SAMPLE         (943)
+#define HAL_SIM_ADC_MID_SCALE           (2048)
+#define HAL_SIM_ADC_TONE_AMPLITUDE      (1000)
+#define HAL_SIM_ADC_TONE_STEP_HZ        (100)
+
+// The 512 KiB of flash, with typical program and erase times at 2.7 V to 3.6 V, x32 parallelism
+#define HAL_SIM_FLASH_SIZE              (0x80000U)
+#define HAL_SIM_FLASH_SECTORS           (8)
+#define HAL_SIM_FLASH_WORD_NS           (16000ULL)
+#define HAL_SIM_FLASH_ERASE_16K_MS      (250ULL)
+#define HAL_SIM_FLASH_ERASE_64K_MS      (550ULL)
+#define HAL_SIM_FLASH_ERASE_128K_MS     (1000ULL)
+
+// Fields of the GPIO_MODE_IT_* encoding
+#define HAL_SIM_GPIO_MODE_EXTI_IT       (0x00010000U)
+#define HAL_SIM_GPIO_MODE_RISING        (0x00100000U)
+#define HAL_SIM_GPIO_MODE_FALLING       (0x00200000U)
+
+typedef struct
+{
+    TIM_TypeDef *regs;
+    bool apb2;
+    // Stream the update event requests when DIER.UDE is set, or NULL
+    DMA_Stream_TypeDef *update_dma;
+    // Peripheral the trigger output drives when CR2.MMS selects the update event, and whether it is listening
+    void (*trgo)(uint64_t pulses);
+    bool (*trgo_armed)(void);
+    // Elapsed time multiplied by the timer clock, not yet a whole counter tick
+    unsigned __int128 residue;
+} hal_sim_tim_t;
+
+typedef struct
+{
+    DMA_Stream_TypeDef *regs;
+    // Transfer count given to HAL_DMA_Start(), which a circular stream reloads NDTR with
+    uint32_t length;
+    // Half and full transfer events not yet handled by HAL_DMA_IRQHandler(), when their interrupts are enabled
+    bool half_done;
+    bool done;
+} hal_sim_dma_t;
+
+typedef struct
+{
+    IRQn_Type irqn;
+    void (*handler)(void);
+    bool (*pending)(void);
+} hal_sim_vector_t;
+
+typedef struct
+{
+    UART_HandleTypeDef *huart;
+    uint64_t byte_ns;
+
+    bool tx_busy;
+    uint64_t tx_done_ns;
+    DMA_HandleTypeDef *tx_hdma;
+    bool tx_dma_done;
+    bool tx_it_done;
+
+    uint8_t *rx_buf;
+    uint32_t rx_size;
+    uint32_t rx_pos;
+    bool rx_dma;
+    bool rx_armed;
+    bool rx_event;
+    uint16_t rx_event_size;
+    // Bytes read from the host arrive no faster than the line rate would allow
+    uint64_t rx_ready_ns;
+} hal_sim_uart_t;
+
+typedef struct
+{
+    bool busy;
+    uint32_t len;
+    uint64_t done_ns;
+} hal_sim_spi_t;
+
+typedef struct
+{
+    I2C_TypeDef *regs;
+    DMA_Stream_TypeDef *rx_dma;
+    I2C_HandleTypeDef *hi2c;
+    bool busy;
+    uint64_t done_ns;
+    bool read;
+    bool dma;
+    uint16_t addr;
+    uint16_t reg;
+    uint8_t *data;
+    uint16_t len;
+    // Outcome of the access, for HAL_I2C_EV_IRQHandler() or HAL_I2C_ER_IRQHandler()
+    bool ev_pending;
+    bool er_pending;
+} hal_sim_i2c_t;
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static uint64_t hal_sim_now = 0;
+static uint32_t hal_sim_primask = 0;
+static uint32_t hal_sim_ipsr = 0;
+
+static bool hal_sim_nvic_enabled[SIM_IRQn_MAX];
+static uint8_t hal_sim_nvic_prio[SIM_IRQn_MAX];
+// Pended by software, on top of what the peripherals raise
+static bool hal_sim_nvic_pended[SIM_IRQn_MAX];
+
+// Defined with the other local functions, for the table below
+static void hal_sim_adc_trigger(uint64_t pulses);
+static bool hal_sim_adc_armed(void);
+
+static hal_sim_tim_t hal_sim_tims[] =
+{
+    { .regs = TIM1, .apb2 = true, .update_dma = DMA2_Stream5 },
+    { .regs = TIM2 },
+    { .regs = TIM3, .trgo = hal_sim_adc_trigger, .trgo_armed = hal_sim_adc_armed },
+    { .regs = TIM4 },
+    { .regs = TIM5 },
+};
+
+// Streams moving items between memory and SPI1, I2C1, I2C3, ADC1 or timer registers on peripheral requests
+static hal_sim_dma_t hal_sim_dmas[] =
+{
+    { .regs = DMA1_Stream0 },
+    { .regs = DMA1_Stream2 },
+    { .regs = DMA2_Stream2 },
+    { .regs = DMA2_Stream3 },
+    { .regs = DMA2_Stream4 },
+    { .regs = DMA2_Stream5 },
+};
+
+// Noise added to every ADC sample, from a linear congruential generator so runs are repeatable
+static uint32_t hal_sim_adc_noise = 1;
+
+// PA5 output as last traced, in tenths of a percent of each PWM period spent high
+static uint32_t hal_sim_pwm_traced = 0;
+
+static hal_sim_uart_t hal_sim_uart = {0};
+static hal_sim_spi_t hal_sim_spi = {0};
+
+static hal_sim_i2c_t hal_sim_i2cs[] =
+{
+    { .regs = I2C1, .rx_dma = DMA1_Stream0 },
+    { .regs = I2C3, .rx_dma = DMA1_Stream2 },
+};
+
+static uint8_t hal_sim_i2c_target[256] = { [HAL_SIM_I2C_TARGET_WHO_AM_I] = HAL_SIM_I2C_TARGET_ADDR };
+
+// SCL clocks the I2C target will need to let go of SDA once it hangs, and those it still needs while it holds SDA low
+static uint32_t hal_sim_i2c_hang_clocks = 0;
+static uint32_t hal_sim_i2c_stuck_clocks = 0;
+// Sector layout of the STM32F401RE: four of 16 KiB, one of 64 KiB, then three of 128 KiB
+static const struct
+{
+    uint32_t offset;
+    uint32_t size;
+    uint64_t erase_ms;
+} hal_sim_flash_sectors[HAL_SIM_FLASH_SECTORS] =
+{
+    { 0x00000, 0x04000, HAL_SIM_FLASH_ERASE_16K_MS },
+    { 0x04000, 0x04000, HAL_SIM_FLASH_ERASE_16K_MS },
+    { 0x08000, 0x04000, HAL_SIM_FLASH_ERASE_16K_MS },
+    { 0x0C000, 0x04000, HAL_SIM_FLASH_ERASE_16K_MS },
+    { 0x10000, 0x10000, HAL_SIM_FLASH_ERASE_64K_MS },
+    { 0x20000, 0x20000, HAL_SIM_FLASH_ERASE_128K_MS },
+    { 0x40000, 0x20000, HAL_SIM_FLASH_ERASE_128K_MS },
+    { 0x60000, 0x20000, HAL_SIM_FLASH_ERASE_128K_MS },
+};
+static bool hal_sim_flash_locked = true;
+
+static int hal_sim_uart_in_fd = STDIN_FILENO;
+static int hal_sim_uart_out_fd = STDOUT_FILENO;
+static bool hal_sim_uart_in_open = true;
+static bool hal_sim_uart_in_tty = false;
+
+static RCC_PLLInitTypeDef hal_sim_pll = {0};
+
+static DWT_Type hal_sim_dwt_regs = {0};
+static uint32_t hal_sim_dwt_last = 0;
+static uint32_t hal_sim_dwt_offset = 0;
+
+// EXTI lines raised by hal_sim_exti_inject(), possibly from a signal handler, not yet latched into EXTI->PR
+static volatile uint32_t hal_sim_exti_requests = 0;
+
+static bool hal_sim_fast = false;
+static bool hal_sim_trace_on = false;
+static uint64_t hal_sim_run_until = HAL_SIM_NO_DEADLINE;
+static uint64_t hal_sim_pb_presses[HAL_SIM_PB_PRESSES_MAX];
+static uint32_t hal_sim_pb_press_count = 0;
+static uint32_t hal_sim_pb_press_next = 0;
+
+static bool hal_sim_termios_saved = false;
+static struct termios hal_sim_termios;
+static int hal_sim_pty_slave_fd = -1;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+uint32_t SystemCoreClock = HAL_SIM_HSI_HZ;
+volatile uint32_t uwTick = 0;
+uint32_t uwTickPrio = (1UL << __NVIC_PRIO_BITS);
+
+SysTick_Type hal_sim_systick;
+CoreDebug_Type hal_sim_core_debug;
+RCC_TypeDef hal_sim_rcc;
+GPIO_TypeDef hal_sim_gpioa;
+GPIO_TypeDef hal_sim_gpiob;
+// The user push-button is pulled up and reads high while released
+GPIO_TypeDef hal_sim_gpioc = { .IDR = GPIO_PIN_13 };
+EXTI_TypeDef hal_sim_exti;
+SYSCFG_TypeDef hal_sim_syscfg;
+TIM_TypeDef hal_sim_tim1;
+TIM_TypeDef hal_sim_tim2;
+TIM_TypeDef hal_sim_tim3;
+TIM_TypeDef hal_sim_tim4;
+TIM_TypeDef hal_sim_tim5;
+USART_TypeDef hal_sim_usart2;
+SPI_TypeDef hal_sim_spi1;
+I2C_TypeDef hal_sim_i2c1;
+I2C_TypeDef hal_sim_i2c3;
+DMA_Stream_TypeDef hal_sim_dma1_stream0;
+DMA_Stream_TypeDef hal_sim_dma1_stream2;
+DMA_Stream_TypeDef hal_sim_dma1_stream5;
+DMA_Stream_TypeDef hal_sim_dma1_stream6;
+DMA_Stream_TypeDef hal_sim_dma2_stream2;
+DMA_Stream_TypeDef hal_sim_dma2_stream3;
+DMA_Stream_TypeDef hal_sim_dma2_stream4;
+DMA_Stream_TypeDef hal_sim_dma2_stream5;
+ADC_TypeDef hal_sim_adc1;
+RTC_TypeDef hal_sim_rtc;
+// Page aligned, so HAL_SIM_FLASH can map a file over it
+uint8_t hal_sim_flash[HAL_SIM_FLASH_SIZE] __attribute__((aligned(4096)));
+
+// syscalls.c
+int _read(int file, char *ptr, int len);
+int _write(int file, char *ptr, int len);
+
+// stm32f4xx_it.c, or the benchmark for TIM4
+void TIM4_IRQHandler(void);
+void TIM5_IRQHandler(void);
+void EXTI15_10_IRQHandler(void);
+void USART2_IRQHandler(void);
+void DMA1_Stream0_IRQHandler(void);
+void DMA1_Stream2_IRQHandler(void);
+void DMA1_Stream6_IRQHandler(void);
+void I2C1_EV_IRQHandler(void);
+void I2C1_ER_IRQHandler(void);
+void I2C3_EV_IRQHandler(void);
+void I2C3_ER_IRQHandler(void);
+void DMA2_Stream2_IRQHandler(void);
+void DMA2_Stream3_IRQHandler(void);
+void DMA2_Stream4_IRQHandler(void);
+void ADC_IRQHandler(void);
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static uint64_t hal_sim_host_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t) ts.tv_sec * HAL_SIM_NS_PER_S) + (uint64_t) ts.tv_nsec;
+}
+
+static void hal_sim_trace(const char *fmt, ...)
+{
+    va_list args;
+
+    if (hal_sim_trace_on)
+    {
+        fprintf(stderr,
+                "[%6llu.%06llu] ",
+                (unsigned long long) (hal_sim_now / HAL_SIM_NS_PER_S),
+                (unsigned long long) ((hal_sim_now % HAL_SIM_NS_PER_S) / 1000));
+        va_start(args, fmt);
+        vfprintf(stderr, fmt, args);
+        va_end(args);
+        fputc('\n', stderr);
+    }
+
+    return;
+}
+
+static uint32_t hal_sim_tim_clock_hz(const hal_sim_tim_t *t)
+{
+    // Timers run at twice PCLK whenever their APB is divided down from HCLK
+    if (t->apb2)
+    {
+        return ((RCC->CFGR & RCC_CFGR_PPRE2) < (RCC_HCLK_DIV2 << 3)) ? SystemCoreClock : (2 * HAL_RCC_GetPCLK2Freq());
+    }
+
+    return ((RCC->CFGR & RCC_CFGR_PPRE1) < RCC_HCLK_DIV2) ? SystemCoreClock : (2 * HAL_RCC_GetPCLK1Freq());
+}
+
+static hal_sim_dma_t *hal_sim_dma_find(DMA_Stream_TypeDef *regs)
+{
+    hal_sim_dma_t *ret = NULL;
+    uint32_t i;
+
+    for (i = 0; i < (sizeof(hal_sim_dmas) / sizeof(hal_sim_dmas[0])); i++)
+    {
+        if (hal_sim_dmas[i].regs == regs)
+        {
+            ret = &hal_sim_dmas[i];
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * Serve requests from a peripheral, moving one item of the stream's memory size per request
+ *
+ */
+static void hal_sim_dma_request(DMA_Stream_TypeDef *regs, uint64_t requests)
+{
+    hal_sim_dma_t *d = hal_sim_dma_find(regs);
+    uint32_t size = 1U << ((regs->CR & (0x3U << 13)) >> 13);
+
+    while ((d != NULL) && (requests-- > 0) && ((regs->CR & HAL_SIM_DMA_SxCR_EN) != 0) && (regs->NDTR != 0))
+    {
+        uint32_t item = d->length - regs->NDTR;
+        uint8_t *memory = (uint8_t *) (uintptr_t) regs->M0AR + ((size_t) item * size);
+        uint8_t *periph = (uint8_t *) (uintptr_t) regs->PAR;
+
+        if ((regs->CR & DMA_MEMORY_TO_PERIPH) != 0)
+        {
+            memcpy(periph, memory, size);
+        }
+        else
+        {
+            memcpy(memory, periph, size);
+        }
+
+        regs->NDTR--;
+        if (((item + 1) == (d->length / 2)) && ((regs->CR & DMA_IT_HT) != 0))
+        {
+            d->half_done = true;
+        }
+        if (regs->NDTR == 0)
+        {
+            d->done = d->done || ((regs->CR & DMA_IT_TC) != 0);
+            if ((regs->CR & DMA_CIRCULAR) != 0)
+            {
+                regs->NDTR = d->length;
+            }
+            else
+            {
+                regs->CR &= ~HAL_SIM_DMA_SxCR_EN;
+            }
+        }
+    }
+
+    return;
+}
+
+static hal_sim_tim_t *hal_sim_tim_find(TIM_TypeDef *regs)
+{
+    hal_sim_tim_t *ret = NULL;
+    uint32_t i;
+
+    for (i = 0; i < (sizeof(hal_sim_tims) / sizeof(hal_sim_tims[0])); i++)
+    {
+        if (hal_sim_tims[i].regs == regs)
+        {
+            ret = &hal_sim_tims[i];
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * Apply software-generated events written to EGR since the last look
+ *
+ * An update event would also clear the counter, but it is only seen here after the code that wrote it has carried on,
+ * e.g. bsp_tick.c restoring the count after re-loading the prescaler, so only its flag is simulated.
+ *
+ */
+static void hal_sim_tim_sync(hal_sim_tim_t *t)
+{
+    uint32_t egr = t->regs->EGR;
+
+    if (egr != 0)
+    {
+        t->regs->EGR = 0;
+        if (((egr & TIM_EGR_UG) != 0) && ((t->regs->CR1 & TIM_CR1_URS) == 0))
+        {
+            t->regs->SR |= TIM_SR_UIF;
+            if ((t->update_dma != NULL) && ((t->regs->DIER & TIM_DIER_UDE) != 0))
+            {
+                hal_sim_dma_request(t->update_dma, 1);
+            }
+        }
+        // CCxG and CCxIF share bit positions
+        t->regs->SR |= egr & (TIM_EGR_CC1G | TIM_EGR_CC2G | TIM_EGR_CC3G | TIM_EGR_CC4G);
+    }
+
+    return;
+}
+
+/**
+ * Counter ticks from the current count until compare channel ch next matches
+ *
+ */
+static uint64_t hal_sim_tim_ticks_to_compare(TIM_TypeDef *regs, uint32_t ch)
+{
+    uint64_t period = (uint64_t) regs->ARR + 1;
+    uint64_t ccr = (&regs->CCR1)[ch] % period;
+    uint64_t ticks = ((ccr + period) - (regs->CNT % period)) % period;
+
+    // A compare register equal to the count has already matched, so the next match is a full period away
+    return (ticks == 0) ? period : ticks;
+}
+
+static bool hal_sim_tim_trgo_armed(hal_sim_tim_t *t)
+{
+    return ((t->trgo != NULL) && ((t->regs->CR2 & TIM_CR2_MMS) == TIM_TRGO_UPDATE) && t->trgo_armed());
+}
+
+static void hal_sim_tim_advance(hal_sim_tim_t *t, uint64_t ns)
+{
+    TIM_TypeDef *regs = t->regs;
+
+    if ((regs->CR1 & TIM_CR1_CEN) != 0)
+    {
+        unsigned __int128 tick_scale = (unsigned __int128) (regs->PSC + 1) * HAL_SIM_NS_PER_S;
+        uint64_t period = (uint64_t) regs->ARR + 1;
+        uint64_t ticks;
+        uint32_t ch;
+
+        t->residue += (unsigned __int128) ns * hal_sim_tim_clock_hz(t);
+        ticks = (uint64_t) (t->residue / tick_scale);
+        t->residue %= tick_scale;
+
+        if (ticks > 0)
+        {
+            for (ch = 0; ch < HAL_SIM_TIM_CHANNELS; ch++)
+            {
+                if (hal_sim_tim_ticks_to_compare(regs, ch) <= ticks)
+                {
+                    regs->SR |= (TIM_SR_CC1IF << ch);
+                }
+            }
+            if (((regs->CNT % period) + ticks) >= period)
+            {
+                regs->SR |= TIM_SR_UIF;
+                if ((t->update_dma != NULL) && ((regs->DIER & TIM_DIER_UDE) != 0))
+                {
+                    hal_sim_dma_request(t->update_dma, ((regs->CNT % period) + ticks) / period);
+                }
+                if (hal_sim_tim_trgo_armed(t))
+                {
+                    t->trgo(((regs->CNT % period) + ticks) / period);
+                }
+            }
+            regs->CNT = (uint32_t) (((regs->CNT % period) + ticks) % period);
+        }
+    }
+
+    return;
+}
+
+/**
+ * Virtual time of the next interrupt the timer will raise, or DMA request or trigger output pulse it will make, if any
+ *
+ */
+static uint64_t hal_sim_tim_deadline(hal_sim_tim_t *t)
+{
+    TIM_TypeDef *regs = t->regs;
+    uint64_t ret = HAL_SIM_NO_DEADLINE;
+
+    hal_sim_tim_sync(t);
+
+    if ((regs->CR1 & TIM_CR1_CEN) != 0)
+    {
+        uint64_t ticks = UINT64_MAX;
+        uint32_t ch;
+
+        for (ch = 0; ch < HAL_SIM_TIM_CHANNELS; ch++)
+        {
+            if (((regs->DIER & (TIM_IT_CC1 << ch)) != 0) && ((regs->SR & (TIM_SR_CC1IF << ch)) == 0))
+            {
+                uint64_t to_compare = hal_sim_tim_ticks_to_compare(regs, ch);
+
+                ticks = (to_compare < ticks) ? to_compare : ticks;
+            }
+        }
+        if ((((regs->DIER & TIM_DIER_UIE) != 0) && ((regs->SR & TIM_SR_UIF) == 0)) ||
+            (((regs->DIER & TIM_DIER_UDE) != 0) && (t->update_dma != NULL) &&
+             ((t->update_dma->CR & HAL_SIM_DMA_SxCR_EN) != 0)) ||
+            hal_sim_tim_trgo_armed(t))
+        {
+            uint64_t to_update = ((uint64_t) regs->ARR + 1) - (regs->CNT % ((uint64_t) regs->ARR + 1));
+
+            ticks = (to_update < ticks) ? to_update : ticks;
+        }
+
+        if (ticks != UINT64_MAX)
+        {
+            unsigned __int128 needed = ((unsigned __int128) ticks * (regs->PSC + 1) * HAL_SIM_NS_PER_S) - t->residue;
+            uint32_t clock_hz = hal_sim_tim_clock_hz(t);
+
+            ret = hal_sim_now + (uint64_t) ((needed + clock_hz - 1) / clock_hz);
+        }
+    }
+
+    return ret;
+}
+
+static bool hal_sim_tim_pending(hal_sim_tim_t *t)
+{
+    hal_sim_tim_sync(t);
+
+    return ((t->regs->SR & t->regs->DIER & HAL_SIM_TIM_IT_MASK) != 0);
+}
+
+/**
+ * Load a timer's time base from its handle, the part of HAL_TIM_Base_Init() and HAL_TIM_PWM_Init() in common
+ *
+ */
+static void hal_sim_tim_init(TIM_HandleTypeDef *htim)
+{
+    hal_sim_tim_t *t;
+
+    htim->Instance->CR1 = (htim->Instance->CR1 & ~TIM_CR1_ARPE) | htim->Init.AutoReloadPreload;
+    htim->Instance->PSC = htim->Init.Prescaler;
+    htim->Instance->ARR = htim->Init.Period;
+    htim->Instance->CNT = 0;
+    // The update event generated to load the prescaler sets the update flag
+    htim->Instance->SR |= TIM_SR_UIF;
+
+    t = hal_sim_tim_find(htim->Instance);
+    if (t != NULL)
+    {
+        t->residue = 0;
+    }
+
+    htim->State = HAL_TIM_STATE_READY;
+
+    return;
+}
+
+static bool hal_sim_adc_armed(void)
+{
+    return (((ADC1->CR2 & (ADC_CR2_ADON | ADC_CR2_DMA)) == (ADC_CR2_ADON | ADC_CR2_DMA)) &&
+            ((ADC1->CR2 & ADC_CR2_EXTEN) != 0) && ((ADC1->CR2 & ADC_CR2_EXTSEL) == ADC_EXTERNALTRIGCONV_T3_TRGO) &&
+            ((DMA2_Stream4->CR & HAL_SIM_DMA_SxCR_EN) != 0));
+}
+
+/**
+ * The input of an ADC channel now: the internal channels at their typical levels, and on external channel n a
+ * triangle wave of (n + 1) * 100 Hz swinging 1000 either side of mid-scale, all with +/-2 LSB of noise
+ *
+ */
+static uint16_t hal_sim_adc_sample(uint32_t channel)
+{
+    int32_t sample;
+    int32_t noise;
+
+    if (channel == (ADC_CHANNEL_VREFINT & 0x1F))
+    {
+        sample = HAL_SIM_ADC_VREFINT_SAMPLE;
+    }
+    else if (channel == (ADC_CHANNEL_TEMPSENSOR & 0x1F))
+    {
+        sample = HAL_SIM_ADC_TEMP_SAMPLE;
+    }
+    else
+    {
+        uint64_t period_ns = HAL_SIM_NS_PER_S / ((channel + 1) * HAL_SIM_ADC_TONE_STEP_HZ);
+        int64_t phase = (int64_t) ((hal_sim_now % period_ns) * 4 * HAL_SIM_ADC_TONE_AMPLITUDE / period_ns);
+
+        // Rising from mid-scale over the first quarter, falling over the middle half, rising again to the end
+        if (phase < HAL_SIM_ADC_TONE_AMPLITUDE)
+        {
+            sample = HAL_SIM_ADC_MID_SCALE + (int32_t) phase;
+        }
+        else if (phase < (3 * HAL_SIM_ADC_TONE_AMPLITUDE))
+        {
+            sample = HAL_SIM_ADC_MID_SCALE + (int32_t) ((2 * HAL_SIM_ADC_TONE_AMPLITUDE) - phase);
+        }
+        else
+        {
+            sample = HAL_SIM_ADC_MID_SCALE + (int32_t) (phase - (4 * HAL_SIM_ADC_TONE_AMPLITUDE));
+        }
+    }
+
+    hal_sim_adc_noise = (hal_sim_adc_noise * 1664525U) + 1013904223U;
+    noise = (int32_t) ((hal_sim_adc_noise >> 16) % 5) - 2;
+
+    return (uint16_t) (sample + noise);
+}
+
+/**
+ * Convert the regular sequence once per trigger pulse, each conversion a request to the ADC's DMA stream
+ *
+ */
+static void hal_sim_adc_trigger(uint64_t pulses)
+{
+    uint32_t length = ((ADC1->SQR1 & ADC_SQR1_L) >> 20) + 1;
+
+    while ((pulses-- > 0) && hal_sim_adc_armed())
+    {
+        uint32_t rank;
+
+        for (rank = 0; rank < length; rank++)
+        {
+            volatile uint32_t *sqr = (rank < 6) ? &ADC1->SQR3 : ((rank < 12) ? &ADC1->SQR2 : &ADC1->SQR1);
+
+            ADC1->DR = hal_sim_adc_sample((*sqr >> ((rank % 6) * 5)) & 0x1F);
+            hal_sim_dma_request(DMA2_Stream4, 1);
+        }
+    }
+
+    return;
+}
+
+static bool hal_sim_tim4_pending(void)
+{
+    return hal_sim_tim_pending(hal_sim_tim_find(TIM4));
+}
+
+static bool hal_sim_tim5_pending(void)
+{
+    return hal_sim_tim_pending(hal_sim_tim_find(TIM5));
+}
+
+static bool hal_sim_exti15_10_pending(void)
+{
+    return ((EXTI->PR & EXTI->IMR & 0xFC00U) != 0);
+}
+
+static bool hal_sim_usart2_pending(void)
+{
+    return (hal_sim_uart.rx_event || hal_sim_uart.tx_it_done);
+}
+
+static bool hal_sim_dma1_stream6_pending(void)
+{
+    return hal_sim_uart.tx_dma_done;
+}
+
+static bool hal_sim_dma_pending(DMA_Stream_TypeDef *regs)
+{
+    hal_sim_dma_t *d = hal_sim_dma_find(regs);
+
+    return (d->half_done || d->done);
+}
+
+static bool hal_sim_dma1_stream0_pending(void)
+{
+    return hal_sim_dma_pending(DMA1_Stream0);
+}
+
+static bool hal_sim_dma1_stream2_pending(void)
+{
+    return hal_sim_dma_pending(DMA1_Stream2);
+}
+
+static bool hal_sim_dma2_stream2_pending(void)
+{
+    return hal_sim_dma_pending(DMA2_Stream2);
+}
+
+static bool hal_sim_dma2_stream3_pending(void)
+{
+    return hal_sim_dma_pending(DMA2_Stream3);
+}
+
+static bool hal_sim_dma2_stream4_pending(void)
+{
+    return hal_sim_dma_pending(DMA2_Stream4);
+}
+
+static bool hal_sim_adc_pending(void)
+{
+    return (((ADC1->SR & ADC_SR_OVR) != 0) && ((ADC1->CR1 & ADC_CR1_OVRIE) != 0));
+}
+
+static hal_sim_i2c_t *hal_sim_i2c_find(I2C_TypeDef *regs)
+{
+    return (regs == I2C1) ? &hal_sim_i2cs[0] : &hal_sim_i2cs[1];
+}
+
+static bool hal_sim_i2c1_ev_pending(void)
+{
+    return hal_sim_i2cs[0].ev_pending;
+}
+
+static bool hal_sim_i2c1_er_pending(void)
+{
+    return hal_sim_i2cs[0].er_pending;
+}
+
+static bool hal_sim_i2c3_ev_pending(void)
+{
+    return hal_sim_i2cs[1].ev_pending;
+}
+
+static bool hal_sim_i2c3_er_pending(void)
+{
+    return hal_sim_i2cs[1].er_pending;
+}
+
+// Vectors that can be raised, in IRQ number order so that equal priorities are taken lowest number first
+static const hal_sim_vector_t hal_sim_vectors[] =
+{
+    { DMA1_Stream0_IRQn,    DMA1_Stream0_IRQHandler,    hal_sim_dma1_stream0_pending },
+    { DMA1_Stream2_IRQn,    DMA1_Stream2_IRQHandler,    hal_sim_dma1_stream2_pending },
+    { DMA1_Stream6_IRQn,    DMA1_Stream6_IRQHandler,    hal_sim_dma1_stream6_pending },
+    { ADC_IRQn,             ADC_IRQHandler,             hal_sim_adc_pending },
+    { TIM4_IRQn,            TIM4_IRQHandler,            hal_sim_tim4_pending },
+    { I2C1_EV_IRQn,         I2C1_EV_IRQHandler,         hal_sim_i2c1_ev_pending },
+    { I2C1_ER_IRQn,         I2C1_ER_IRQHandler,         hal_sim_i2c1_er_pending },
+    { USART2_IRQn,          USART2_IRQHandler,          hal_sim_usart2_pending },
+    { EXTI15_10_IRQn,       EXTI15_10_IRQHandler,       hal_sim_exti15_10_pending },
+    { TIM5_IRQn,            TIM5_IRQHandler,            hal_sim_tim5_pending },
+    { DMA2_Stream2_IRQn,    DMA2_Stream2_IRQHandler,    hal_sim_dma2_stream2_pending },
+    { DMA2_Stream3_IRQn,    DMA2_Stream3_IRQHandler,    hal_sim_dma2_stream3_pending },
+    { DMA2_Stream4_IRQn,    DMA2_Stream4_IRQHandler,    hal_sim_dma2_stream4_pending },
+    { I2C3_EV_IRQn,         I2C3_EV_IRQHandler,         hal_sim_i2c3_ev_pending },
+    { I2C3_ER_IRQn,         I2C3_ER_IRQHandler,         hal_sim_i2c3_er_pending },
+};
+
+static void hal_sim_exti_latch(void)
+{
+    uint32_t lines = __atomic_exchange_n(&hal_sim_exti_requests, 0, __ATOMIC_ACQUIRE);
+
+    while (lines != 0)
+    {
+        uint32_t line = __builtin_ctz(lines);
+
+        lines &= ~(1UL << line);
+        if ((EXTI->FTSR & (1UL << line)) != 0)
+        {
+            EXTI->PR |= (1UL << line);
+            hal_sim_trace("EXTI%lu falling edge", (unsigned long) line);
+        }
+    }
+
+    return;
+}
+
+/**
+ * The highest-priority enabled vector with its interrupt pending, or NULL
+ *
+ */
+static const hal_sim_vector_t *hal_sim_next_vector(void)
+{
+    const hal_sim_vector_t *ret = NULL;
+    uint32_t i;
+
+    hal_sim_exti_latch();
+
+    for (i = 0; i < (sizeof(hal_sim_vectors) / sizeof(hal_sim_vectors[0])); i++)
+    {
+        const hal_sim_vector_t *v = &hal_sim_vectors[i];
+
+        if (hal_sim_nvic_enabled[v->irqn] &&
+            ((ret == NULL) || (hal_sim_nvic_prio[v->irqn] < hal_sim_nvic_prio[ret->irqn])) &&
+            (hal_sim_nvic_pended[v->irqn] || v->pending()))
+        {
+            ret = v;
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * Take pending interrupts while they are unmasked, as the NVIC would
+ *
+ */
+static void hal_sim_service(void)
+{
+    while ((hal_sim_primask == 0) && (hal_sim_ipsr == 0))
+    {
+        const hal_sim_vector_t *v = hal_sim_next_vector();
+
+        if (v == NULL)
+        {
+            break;
+        }
+
+        hal_sim_ipsr = v->irqn + 16;
+        hal_sim_nvic_pended[v->irqn] = false;
+        v->handler();
+        hal_sim_ipsr = 0;
+    }
+
+    return;
+}
+
+static void hal_sim_uart_emit(const uint8_t *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t count = write(hal_sim_uart_out_fd, buf, len);
+
+        if (count > 0)
+        {
+            buf += count;
+            len -= (size_t) count;
+        }
+        else if ((count < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        else
+        {
+            // Nobody is reading the pseudo-terminal; the bytes are lost as on an unconnected line
+            break;
+        }
+    }
+
+    return;
+}
+
+static void hal_sim_uart_tx_start(const uint8_t *buf, uint32_t len, DMA_HandleTypeDef *hdma)
+{
+    hal_sim_uart_emit(buf, len);
+
+    hal_sim_uart.tx_busy = true;
+    hal_sim_uart.tx_done_ns = hal_sim_now + (len * hal_sim_uart.byte_ns);
+    hal_sim_uart.tx_hdma = hdma;
+    USART2->SR &= ~USART_SR_TC;
+
+    return;
+}
+
+static bool hal_sim_uart_rx_waiting(void)
+{
+    return (hal_sim_uart_in_open &&
+            hal_sim_uart.rx_armed &&
+            !hal_sim_uart.rx_event &&
+            (hal_sim_uart.rx_ready_ns <= hal_sim_now));
+}
+
+/**
+ * Wait up to timeout for received data and deliver what has arrived to the reception in progress
+ *
+ * @param [in] timeout          Real time to wait, or NULL to wait until data or a signal arrives
+ *
+ */
+static void hal_sim_uart_rx_poll(const struct timespec *timeout)
+{
+    struct pollfd pfd = { .fd = hal_sim_uart_in_fd, .events = POLLIN };
+    nfds_t nfds = hal_sim_uart_rx_waiting() ? 1 : 0;
+
+    if ((ppoll(&pfd, nfds, timeout, NULL) > 0) && ((pfd.revents & (POLLIN | POLLHUP)) != 0))
+    {
+        ssize_t count = read(hal_sim_uart_in_fd,
+                             hal_sim_uart.rx_buf + hal_sim_uart.rx_pos,
+                             hal_sim_uart.rx_size - hal_sim_uart.rx_pos);
+
+        if (count == 0)
+        {
+            hal_sim_uart_in_open = false;
+        }
+        else if (count > 0)
+        {
+            hal_sim_uart.rx_pos += (uint32_t) count;
+            hal_sim_uart.rx_ready_ns = hal_sim_now + ((uint64_t) count * hal_sim_uart.byte_ns);
+
+            if (hal_sim_uart.rx_dma)
+            {
+                // As the circular DMA reports it: the offset written up to, or the full size on wrapping
+                hal_sim_uart.rx_event_size = (uint16_t) hal_sim_uart.rx_pos;
+                if (hal_sim_uart.rx_pos == hal_sim_uart.rx_size)
+                {
+                    hal_sim_uart.rx_pos = 0;
+                }
+                hal_sim_uart.huart->hdmarx->Instance->NDTR = hal_sim_uart.rx_size - hal_sim_uart.rx_pos;
+                hal_sim_uart.rx_event = true;
+            }
+            else if (hal_sim_uart.rx_pos == hal_sim_uart.rx_size)
+            {
+                hal_sim_uart.rx_armed = false;
+                hal_sim_uart.rx_event = true;
+            }
+        }
+        else if ((errno != EINTR) && (errno != EAGAIN))
+        {
+            hal_sim_uart_in_open = false;
+        }
+    }
+
+    return;
+}
+
+/**
+ * Shift the whole transfer through SPI1 once its last bit has been clocked
+ *
+ * MISO reads back MOSI, as with PB4 and PB5 jumpered together.  Each byte is a transmit request followed by a receive
+ * request, so the transmit stream completes first as on the target.
+ *
+ */
+static void hal_sim_spi_complete(void)
+{
+    uint32_t i;
+
+    hal_sim_spi.busy = false;
+    for (i = 0; i < hal_sim_spi.len; i++)
+    {
+        if ((SPI1->CR2 & SPI_CR2_TXDMAEN) != 0)
+        {
+            hal_sim_dma_request(DMA2_Stream3, 1);
+        }
+        if ((SPI1->CR2 & SPI_CR2_RXDMAEN) != 0)
+        {
+            hal_sim_dma_request(DMA2_Stream2, 1);
+        }
+    }
+
+    return;
+}
+
+/**
+ * Carry out an I2C access once its last bit has been clocked
+ *
+ * Only I2C1 has a target, at HAL_SIM_I2C_TARGET_ADDR; any other address is not acknowledged.  The target's register
+ * address auto-increments and wraps, and WHO_AM_I ignores writes.  A DMA read is one receive request per byte.
+ *
+ */
+static void hal_sim_i2c_complete(hal_sim_i2c_t *bus)
+{
+    uint8_t reg = (uint8_t) bus->reg;
+    uint32_t i;
+
+    bus->busy = false;
+    if ((bus->regs != I2C1) || (bus->addr != HAL_SIM_I2C_TARGET_ADDR))
+    {
+        bus->hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+        bus->er_pending = true;
+        return;
+    }
+
+    for (i = 0; i < bus->len; i++, reg++)
+    {
+        if (!bus->read)
+        {
+            if (reg != HAL_SIM_I2C_TARGET_WHO_AM_I)
+            {
+                hal_sim_i2c_target[reg] = bus->data[i];
+            }
+        }
+        else if (bus->dma)
+        {
+            bus->regs->DR = hal_sim_i2c_target[reg];
+            hal_sim_dma_request(bus->rx_dma, 1);
+        }
+        else
+        {
+            bus->data[i] = hal_sim_i2c_target[reg];
+        }
+    }
+
+    bus->ev_pending = !bus->dma;
+
+    return;
+}
+
+/**
+ * Follow SCL and SDA of I2C1 on PB8 and PB9 while the target holds SDA low
+ *
+ * Each rising edge of PB8 driven by hand clocks the target on; once it has had the clocks it needed it lets go of SDA.
+ * The bus reads busy throughout, as the peripheral would see it.
+ *
+ */
+static void hal_sim_i2c_lines(uint32_t changed, uint32_t odr)
+{
+    if ((hal_sim_i2c_stuck_clocks > 0) && ((changed & odr & GPIO_PIN_8) != 0) && (--hal_sim_i2c_stuck_clocks == 0))
+    {
+        hal_sim_trace("I2C1 target released SDA");
+    }
+
+    if (hal_sim_i2c_stuck_clocks > 0)
+    {
+        hal_sim_gpiob.IDR &= ~GPIO_PIN_9;
+        I2C1->SR2 |= I2C_SR2_BUSY;
+    }
+    else
+    {
+        hal_sim_gpiob.IDR = (hal_sim_gpiob.IDR & ~GPIO_PIN_9) | (odr & GPIO_PIN_9);
+        I2C1->SR2 &= ~I2C_SR2_BUSY;
+    }
+
+    return;
+}
+
+static uint64_t hal_sim_next_deadline(void)
+{
+    uint64_t ret = hal_sim_run_until;
+    uint32_t i;
+
+    for (i = 0; i < (sizeof(hal_sim_tims) / sizeof(hal_sim_tims[0])); i++)
+    {
+        uint64_t deadline = hal_sim_tim_deadline(&hal_sim_tims[i]);
+
+        ret = (deadline < ret) ? deadline : ret;
+    }
+    if (hal_sim_uart.tx_busy && (hal_sim_uart.tx_done_ns < ret))
+    {
+        ret = hal_sim_uart.tx_done_ns;
+    }
+    if (hal_sim_spi.busy && (hal_sim_spi.done_ns < ret))
+    {
+        ret = hal_sim_spi.done_ns;
+    }
+    for (i = 0; i < (sizeof(hal_sim_i2cs) / sizeof(hal_sim_i2cs[0])); i++)
+    {
+        if (hal_sim_i2cs[i].busy && (hal_sim_i2cs[i].done_ns < ret))
+        {
+            ret = hal_sim_i2cs[i].done_ns;
+        }
+    }
+    if (hal_sim_uart_in_open && (hal_sim_uart.rx_ready_ns > hal_sim_now) && (hal_sim_uart.rx_ready_ns < ret))
+    {
+        ret = hal_sim_uart.rx_ready_ns;
+    }
+    if ((hal_sim_pb_press_next < hal_sim_pb_press_count) && (hal_sim_pb_presses[hal_sim_pb_press_next] < ret))
+    {
+        ret = hal_sim_pb_presses[hal_sim_pb_press_next];
+    }
+
+    return ret;
+}
+
+/**
+ * Trace the TIM2 channel 1 PWM on PA5 when its duty has changed
+ *
+ * Only the duty is followed, not the edges inside each period, so a pattern stepping the duty by DMA traces one line
+ * per step.
+ *
+ */
+static void hal_sim_pwm_trace(void)
+{
+    uint64_t period = (uint64_t) TIM2->ARR + 1;
+    uint32_t duty = 0;
+
+    // Only while PA5 is in its alternate function, so GPIO writes are traced as before when it is an output
+    if (((hal_sim_gpioa.MODER >> (5 * 2)) & 0x3) != GPIO_MODE_AF_PP)
+    {
+        return;
+    }
+
+    if (((TIM2->CR1 & TIM_CR1_CEN) != 0) && ((TIM2->CCER & TIM_CCER_CC1E) != 0))
+    {
+        duty = (TIM2->CCR1 >= period) ? 1000 : (uint32_t) ((TIM2->CCR1 * 1000) / period);
+    }
+
+    if (duty != hal_sim_pwm_traced)
+    {
+        hal_sim_pwm_traced = duty;
+        if (duty == 0)
+        {
+            hal_sim_trace("PA5 low");
+        }
+        else if (duty == 1000)
+        {
+            hal_sim_trace("PA5 high");
+        }
+        else
+        {
+            hal_sim_trace("PA5 pwm %lu.%lu%%", (unsigned long) (duty / 10), (unsigned long) (duty % 10));
+        }
+    }
+
+    return;
+}
+
+static void hal_sim_advance(uint64_t ns)
+{
+    uint32_t i;
+
+    for (i = 0; i < (sizeof(hal_sim_tims) / sizeof(hal_sim_tims[0])); i++)
+    {
+        hal_sim_tim_advance(&hal_sim_tims[i], ns);
+    }
+    hal_sim_now += ns;
+
+    if (hal_sim_uart.tx_busy && (hal_sim_now >= hal_sim_uart.tx_done_ns))
+    {
+        hal_sim_uart.tx_busy = false;
+        USART2->SR |= USART_SR_TC;
+        if (hal_sim_uart.tx_hdma != NULL)
+        {
+            hal_sim_uart.tx_dma_done = true;
+        }
+        else
+        {
+            hal_sim_uart.tx_it_done = true;
+        }
+    }
+
+    if (hal_sim_spi.busy && (hal_sim_now >= hal_sim_spi.done_ns))
+    {
+        hal_sim_spi_complete();
+    }
+
+    for (i = 0; i < (sizeof(hal_sim_i2cs) / sizeof(hal_sim_i2cs[0])); i++)
+    {
+        if (hal_sim_i2cs[i].busy && (hal_sim_now >= hal_sim_i2cs[i].done_ns))
+        {
+            hal_sim_i2c_complete(&hal_sim_i2cs[i]);
+        }
+    }
+
+    while ((hal_sim_pb_press_next < hal_sim_pb_press_count) &&
+           (hal_sim_pb_presses[hal_sim_pb_press_next] <= hal_sim_now))
+    {
+        hal_sim_pb_press_next++;
+        hal_sim_exti_inject(EXTI_LINE_13);
+    }
+
+    hal_sim_pwm_trace();
+
+    return;
+}
+
+/**
+ * Let virtual time pass until an enabled interrupt is pending
+ *
+ */
+static void hal_sim_wait(void)
+{
+    while (1)
+    {
+        struct timespec no_wait = {0};
+        uint64_t deadline;
+
+        hal_sim_uart_rx_poll(&no_wait);
+        if (hal_sim_next_vector() != NULL)
+        {
+            break;
+        }
+
+        if ((hal_sim_now >= hal_sim_run_until) && !hal_sim_uart.tx_busy)
+        {
+            exit(0);
+        }
+
+        deadline = hal_sim_next_deadline();
+        if ((deadline == HAL_SIM_NO_DEADLINE) && !hal_sim_uart_in_open)
+        {
+            fprintf(stderr, "hal_sim: nothing left to wake the core\n");
+            exit(0);
+        }
+
+        if (hal_sim_fast && !hal_sim_uart_in_tty && hal_sim_uart_rx_waiting())
+        {
+            // Piped input is taken as soon as it arrives, so runs from a file are repeatable
+            hal_sim_uart_rx_poll(NULL);
+        }
+        else if (hal_sim_fast && (deadline != HAL_SIM_NO_DEADLINE))
+        {
+            hal_sim_advance(deadline - hal_sim_now);
+        }
+        else
+        {
+            uint64_t start = hal_sim_host_ns();
+            uint64_t elapsed;
+
+            if (deadline == HAL_SIM_NO_DEADLINE)
+            {
+                hal_sim_uart_rx_poll(NULL);
+            }
+            else
+            {
+                struct timespec timeout =
+                {
+                    .tv_sec = (time_t) ((deadline - hal_sim_now) / HAL_SIM_NS_PER_S),
+                    .tv_nsec = (long) ((deadline - hal_sim_now) % HAL_SIM_NS_PER_S),
+                };
+
+                hal_sim_uart_rx_poll(&timeout);
+            }
+
+            // In fast mode only input can end an open-ended wait, and it takes no virtual time
+            elapsed = hal_sim_fast ? 0 : (hal_sim_host_ns() - start);
+            if ((deadline != HAL_SIM_NO_DEADLINE) && (elapsed > (deadline - hal_sim_now)))
+            {
+                elapsed = deadline - hal_sim_now;
+            }
+            hal_sim_advance(elapsed);
+        }
+    }
+
+    return;
+}
+
+static void hal_sim_terminal_restore(void)
+{
+    if (hal_sim_termios_saved)
+    {
+        tcsetattr(hal_sim_uart_in_fd, TCSANOW, &hal_sim_termios);
+    }
+
+    return;
+}
+
+static void hal_sim_signal_exit(int sig)
+{
+    hal_sim_terminal_restore();
+    signal(sig, SIG_DFL);
+    raise(sig);
+
+    return;
+}
+
+static void hal_sim_signal_pb(int sig)
+{
+    hal_sim_exti_inject(EXTI_LINE_13);
+
+    return;
+}
+
+static ssize_t hal_sim_stdin_read(void *cookie, char *buf, size_t size)
+{
+    return _read(STDIN_FILENO, buf, (int) size);
+}
+
+static ssize_t hal_sim_stdout_write(void *cookie, const char *buf, size_t size)
+{
+    return _write(STDOUT_FILENO, (char *) buf, (int) size);
+}
+
+static void hal_sim_parse_env(void)
+{
+    const char *env;
+
+    hal_sim_fast = ((env = getenv("HAL_SIM_FAST")) != NULL) && (atoi(env) != 0);
+    hal_sim_trace_on = ((env = getenv("HAL_SIM_TRACE")) != NULL) && (atoi(env) != 0);
+
+    if ((env = getenv("HAL_SIM_RUN_MS")) != NULL)
+    {
+        hal_sim_run_until = strtoull(env, NULL, 0) * HAL_SIM_NS_PER_MS;
+    }
+
+    if ((env = getenv("HAL_SIM_PB_MS")) != NULL)
+    {
+        char *end = (char *) env;
+
+        while ((*end != '\0') && (hal_sim_pb_press_count < HAL_SIM_PB_PRESSES_MAX))
+        {
+            hal_sim_pb_presses[hal_sim_pb_press_count++] = strtoull(end, &end, 0) * HAL_SIM_NS_PER_MS;
+            end += strspn(end, ", ");
+        }
+    }
+
+    if ((env = getenv("HAL_SIM_I2C_STUCK")) != NULL)
+    {
+        hal_sim_i2c_hang_clocks = (uint32_t) strtoul(env, NULL, 0);
+    }
+
+    return;
+}
+
+/**
+ * Back the flash with a file, so the firmware finds what it stored in an earlier run
+ *
+ * A new file, or one of the wrong size, starts out erased.
+ *
+ */
+static void hal_sim_flash_open(const char *path)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    bool fresh;
+
+    if ((fd < 0) || (fstat(fd, &st) != 0))
+    {
+        perror("hal_sim: flash file");
+        exit(1);
+    }
+
+    fresh = (st.st_size != HAL_SIM_FLASH_SIZE);
+    if ((fresh && (ftruncate(fd, HAL_SIM_FLASH_SIZE) != 0)) ||
+        (mmap(hal_sim_flash, HAL_SIM_FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED))
+    {
+        perror("hal_sim: flash file");
+        exit(1);
+    }
+    close(fd);
+
+    if (fresh)
+    {
+        memset(hal_sim_flash, 0xFF, HAL_SIM_FLASH_SIZE);
+    }
+
+    return;
+}
+
+/**
+ * Put USART2 on a new pseudo-terminal, for a terminal emulator to attach to as it would to the ST-Link virtual COM port
+ *
+ */
+static void hal_sim_open_pty(void)
+{
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    struct termios tio;
+
+    if ((fd < 0) || (grantpt(fd) != 0) || (unlockpt(fd) != 0))
+    {
+        perror("hal_sim: pty");
+        exit(1);
+    }
+
+    // Holding the slave open keeps the master readable while no terminal is attached
+    hal_sim_pty_slave_fd = open(ptsname(fd), O_RDWR | O_NOCTTY);
+    if (tcgetattr(hal_sim_pty_slave_fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(hal_sim_pty_slave_fd, TCSANOW, &tio);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    fprintf(stderr, "hal_sim: USART2 on %s\n", ptsname(fd));
+
+    hal_sim_uart_in_fd = fd;
+    hal_sim_uart_out_fd = fd;
+
+    return;
+}
+
+/**
+ * Hand each key to the firmware as it is typed, as a serial terminal would
+ *
+ */
+static void hal_sim_terminal_raw(void)
+{
+    struct termios tio;
+
+    if (isatty(hal_sim_uart_in_fd) && (tcgetattr(hal_sim_uart_in_fd, &hal_sim_termios) == 0))
+    {
+        hal_sim_termios_saved = true;
+        atexit(hal_sim_terminal_restore);
+        signal(SIGINT, hal_sim_signal_exit);
+        signal(SIGTERM, hal_sim_signal_exit);
+
+        tio = hal_sim_termios;
+        tio.c_lflag &= ~(ICANON | ECHO);
+        tio.c_iflag &= ~ICRNL;
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(hal_sim_uart_in_fd, TCSANOW, &tio);
+    }
+
+    return;
+}
+
+/**
+ * Route the firmware's stdio through syscalls.c, as newlib does on the target, before main() runs
+ *
+ */
+__attribute__((constructor)) static void hal_sim_start(void)
+{
+    static const cookie_io_functions_t stdin_io = { .read = hal_sim_stdin_read };
+    static const cookie_io_functions_t stdout_io = { .write = hal_sim_stdout_write };
+    struct sigaction pb_action = { .sa_handler = hal_sim_signal_pb };
+    const char *env;
+
+    hal_sim_parse_env();
+
+    if ((env = getenv("HAL_SIM_FLASH")) != NULL)
+    {
+        hal_sim_flash_open(env);
+    }
+    else
+    {
+        memset(hal_sim_flash, 0xFF, HAL_SIM_FLASH_SIZE);
+    }
+
+    if (((env = getenv("HAL_SIM_PTY")) != NULL) && (atoi(env) != 0))
+    {
+        hal_sim_open_pty();
+    }
+    else
+    {
+        hal_sim_terminal_raw();
+    }
+
+    hal_sim_uart_in_tty = isatty(hal_sim_uart_in_fd);
+    sigaction(SIGUSR1, &pb_action, NULL);
+
+    stdin = fopencookie(NULL, "r", stdin_io);
+    stdout = fopencookie(NULL, "w", stdout_io);
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * MCU HAL FUNCTIONS
+ *
+ * @warning - Function names below are expected in STM32 HAL code, do not change
+ **********************************************************************************************************************/
+// Startup file: as there, a vector nothing else defines falls back to an empty handler
+__weak void TIM4_IRQHandler(void)
+{
+    return;
+}
+
+// CMSIS core
+void __disable_irq(void)
+{
+    hal_sim_primask = 1;
+
+    return;
+}
+
+void __enable_irq(void)
+{
+    hal_sim_primask = 0;
+    hal_sim_service();
+
+    return;
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return hal_sim_primask;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+    hal_sim_primask = priMask & 0x1;
+    hal_sim_service();
+
+    return;
+}
+
+uint32_t __get_IPSR(void)
+{
+    return hal_sim_ipsr;
+}
+
+/**
+ * Sleep until an enabled interrupt is pending, taking it at once unless interrupts are masked
+ *
+ */
+void __WFI(void)
+{
+    uint32_t i;
+
+    // Trace pending pin writes, and duties loaded by software-generated update events, at the time they were made
+    hal_sim_gpio(&hal_sim_gpioa);
+    hal_sim_gpio(&hal_sim_gpiob);
+    hal_sim_gpio(&hal_sim_gpioc);
+    for (i = 0; i < (sizeof(hal_sim_tims) / sizeof(hal_sim_tims[0])); i++)
+    {
+        hal_sim_tim_sync(&hal_sim_tims[i]);
+    }
+    hal_sim_pwm_trace();
+
+    hal_sim_wait();
+    hal_sim_service();
+
+    return;
+}
+
+/**
+ * The DWT registers, with CYCCNT counting host time in cycles of SystemCoreClock
+ *
+ * Profiling on the host therefore measures the host's cost of the code, not the target's.  A value written to CYCCNT
+ * is picked up as the new count.
+ *
+ */
+/**
+ * A GPIO port, with any pending BSRR write applied to ODR
+ *
+ * BSRR is an ordinary variable on the host, so a write to it only lands here.  Every GPIOA/GPIOB/GPIOC access passes
+ * through this, so ODR and IDR are current whenever code looks at them.
+ *
+ */
+GPIO_TypeDef *hal_sim_gpio(GPIO_TypeDef *port)
+{
+    uint32_t bsrr = port->BSRR;
+    uint32_t odr;
+    uint32_t changed;
+    uint32_t pin;
+
+    if (bsrr == 0)
+    {
+        return port;
+    }
+
+    // Set takes precedence over reset when both bits of a pin are written
+    odr = (port->ODR & ~(bsrr >> 16)) | (bsrr & 0xFFFF);
+    changed = port->ODR ^ odr;
+    port->BSRR = 0;
+    port->ODR = odr;
+    port->IDR = (port->IDR & ~changed) | (odr & changed);
+    if (port == &hal_sim_gpiob)
+    {
+        hal_sim_i2c_lines(changed, odr);
+    }
+
+    for (pin = 0; pin < 16; pin++)
+    {
+        if ((changed & (1UL << pin)) != 0)
+        {
+            hal_sim_trace("P%c%lu %s",
+                          (port == &hal_sim_gpioa) ? 'A' : ((port == &hal_sim_gpiob) ? 'B' : 'C'),
+                          (unsigned long) pin,
+                          ((odr & (1UL << pin)) != 0) ? "high" : "low");
+        }
+    }
+
+    return port;
+}
+
+DWT_Type *hal_sim_dwt(void)
+{
+    uint32_t cycles = (uint32_t) (((unsigned __int128) hal_sim_host_ns() * SystemCoreClock) / HAL_SIM_NS_PER_S);
+
+    if (hal_sim_dwt_regs.CYCCNT != hal_sim_dwt_last)
+    {
+        hal_sim_dwt_offset = cycles - hal_sim_dwt_regs.CYCCNT;
+    }
+    hal_sim_dwt_regs.CYCCNT = cycles - hal_sim_dwt_offset;
+    hal_sim_dwt_last = hal_sim_dwt_regs.CYCCNT;
+
+    return &hal_sim_dwt_regs;
+}
+
+// HAL
+HAL_StatusTypeDef HAL_Init(void)
+{
+    HAL_InitTick(TICK_INT_PRIORITY);
+    HAL_MspInit();
+
+    return HAL_OK;
+}
+
+void HAL_IncTick(void)
+{
+    uwTick++;
+
+    return;
+}
+
+void HAL_DBGMCU_EnableDBGStopMode(void)
+{
+    return;
+}
+
+__weak void HAL_MspInit(void)
+{
+    return;
+}
+
+__weak void HAL_MspDeInit(void)
+{
+    return;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+    hal_sim_nvic_prio[IRQn] = (uint8_t) PreemptPriority;
+
+    return;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    hal_sim_nvic_enabled[IRQn] = true;
+
+    return;
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    hal_sim_nvic_enabled[IRQn] = false;
+
+    return;
+}
+
+void HAL_NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+    hal_sim_nvic_pended[IRQn] = true;
+
+    return;
+}
+
+uint32_t HAL_NVIC_GetPendingIRQ(IRQn_Type IRQn)
+{
+    uint32_t i;
+
+    if (hal_sim_nvic_pended[IRQn])
+    {
+        return 1;
+    }
+    for (i = 0; i < (sizeof(hal_sim_vectors) / sizeof(hal_sim_vectors[0])); i++)
+    {
+        if (hal_sim_vectors[i].irqn == IRQn)
+        {
+            return hal_sim_vectors[i].pending() ? 1 : 0;
+        }
+    }
+
+    return 0;
+}
+
+// Only what software pended can be cleared; the rest is derived from the peripherals
+void HAL_NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+    hal_sim_nvic_pended[IRQn] = false;
+
+    return;
+}
+
+// RCC and PWR
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct)
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+
+    // Only the HSI and PLL are simulated.  Without the LSE, bsp_power.c finds no RTC and keeps to the Sleep tier.
+    if ((RCC_OscInitStruct->OscillatorType & ~RCC_OSCILLATORTYPE_HSI) != 0)
+    {
+        ret = HAL_ERROR;
+    }
+    else if (RCC_OscInitStruct->PLL.PLLState == RCC_PLL_ON)
+    {
+        hal_sim_pll = RCC_OscInitStruct->PLL;
+    }
+
+    return ret;
+}
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency)
+{
+    if ((RCC_ClkInitStruct->ClockType & RCC_CLOCKTYPE_SYSCLK) != 0)
+    {
+        if ((RCC_ClkInitStruct->SYSCLKSource == RCC_SYSCLKSOURCE_PLLCLK) && (hal_sim_pll.PLLM != 0))
+        {
+            SystemCoreClock = ((HAL_SIM_HSI_HZ / hal_sim_pll.PLLM) * hal_sim_pll.PLLN) / hal_sim_pll.PLLP;
+        }
+        else
+        {
+            SystemCoreClock = HAL_SIM_HSI_HZ;
+        }
+    }
+    if ((RCC_ClkInitStruct->ClockType & RCC_CLOCKTYPE_PCLK1) != 0)
+    {
+        RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_PPRE1) | RCC_ClkInitStruct->APB1CLKDivider;
+    }
+    if ((RCC_ClkInitStruct->ClockType & RCC_CLOCKTYPE_PCLK2) != 0)
+    {
+        RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_PPRE2) | (RCC_ClkInitStruct->APB2CLKDivider << 3);
+    }
+
+    // As the real HAL does, re-scale the time base to the new clock
+    return HAL_InitTick(uwTickPrio);
+}
+
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit)
+{
+    return HAL_ERROR;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+    uint32_t ppre1 = RCC->CFGR & RCC_CFGR_PPRE1;
+
+    return (ppre1 < RCC_HCLK_DIV2) ? SystemCoreClock : (SystemCoreClock >> (((ppre1 >> 10) & 0x3) + 1));
+}
+
+uint32_t HAL_RCC_GetPCLK2Freq(void)
+{
+    uint32_t ppre2 = (RCC->CFGR & RCC_CFGR_PPRE2) >> 3;
+
+    return (ppre2 < RCC_HCLK_DIV2) ? SystemCoreClock : (SystemCoreClock >> (((ppre2 >> 10) & 0x3) + 1));
+}
+
+void HAL_PWR_EnableBkUpAccess(void)
+{
+    return;
+}
+
+void HAL_PWR_EnterSTOPMode(uint32_t Regulator, uint8_t STOPEntry)
+{
+    __WFI();
+
+    return;
+}
+
+// GPIO and EXTI
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+    uint32_t pin;
+
+    for (pin = 0; pin < 16; pin++)
+    {
+        uint32_t bit = 1UL << pin;
+
+        if ((GPIO_Init->Pin & bit) != 0)
+        {
+            GPIOx->MODER = (GPIOx->MODER & ~(0x3UL << (pin * 2))) | ((GPIO_Init->Mode & 0x3) << (pin * 2));
+
+            if ((GPIO_Init->Mode & HAL_SIM_GPIO_MODE_EXTI_IT) != 0)
+            {
+                EXTI->IMR |= bit;
+                EXTI->RTSR = ((GPIO_Init->Mode & HAL_SIM_GPIO_MODE_RISING) != 0) ? (EXTI->RTSR | bit)
+                                                                                 : (EXTI->RTSR & ~bit);
+                EXTI->FTSR = ((GPIO_Init->Mode & HAL_SIM_GPIO_MODE_FALLING) != 0) ? (EXTI->FTSR | bit)
+                                                                                  : (EXTI->FTSR & ~bit);
+            }
+        }
+    }
+
+    return;
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin)
+{
+    uint32_t pin;
+
+    for (pin = 0; pin < 16; pin++)
+    {
+        if ((GPIO_Pin & (1UL << pin)) != 0)
+        {
+            GPIOx->MODER &= ~(0x3UL << (pin * 2));
+        }
+    }
+
+    return;
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    return ((GPIOx->IDR & GPIO_Pin) != 0) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    GPIOx->BSRR = (PinState != GPIO_PIN_RESET) ? GPIO_Pin : ((uint32_t) GPIO_Pin << 16);
+    hal_sim_gpio(GPIOx);
+
+    return;
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    HAL_GPIO_WritePin(GPIOx, GPIO_Pin, ((GPIOx->ODR & GPIO_Pin) != 0) ? GPIO_PIN_RESET : GPIO_PIN_SET);
+
+    return;
+}
+
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin)
+{
+    if ((EXTI->PR & GPIO_Pin) != 0)
+    {
+        EXTI->PR &= ~GPIO_Pin;
+        HAL_GPIO_EXTI_Callback(GPIO_Pin);
+    }
+
+    return;
+}
+
+__weak void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+    return;
+}
+
+HAL_StatusTypeDef HAL_EXTI_SetConfigLine(EXTI_HandleTypeDef *hexti, EXTI_ConfigTypeDef *pExtiConfig)
+{
+    uint32_t line = pExtiConfig->Line & 0x1F;
+    uint32_t bit = 1UL << line;
+
+    hexti->Line = pExtiConfig->Line;
+
+    EXTI->IMR = ((pExtiConfig->Mode & EXTI_MODE_INTERRUPT) != 0) ? (EXTI->IMR | bit) : (EXTI->IMR & ~bit);
+    EXTI->RTSR = ((pExtiConfig->Trigger & EXTI_TRIGGER_RISING) != 0) ? (EXTI->RTSR | bit) : (EXTI->RTSR & ~bit);
+    EXTI->FTSR = ((pExtiConfig->Trigger & EXTI_TRIGGER_FALLING) != 0) ? (EXTI->FTSR | bit) : (EXTI->FTSR & ~bit);
+
+    if (line < 16)
+    {
+        SYSCFG->EXTICR[line >> 2] &= ~(0xFUL << ((line & 0x3) * 4));
+        SYSCFG->EXTICR[line >> 2] |= pExtiConfig->GPIOSel << ((line & 0x3) * 4);
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_EXTI_RegisterCallback(EXTI_HandleTypeDef *hexti,
+                                            EXTI_CallbackIDTypeDef CallbackID,
+                                            void (*pPendingCbfn)(void))
+{
+    hexti->PendingCallback = pPendingCbfn;
+
+    return HAL_OK;
+}
+
+uint32_t HAL_EXTI_GetPending(EXTI_HandleTypeDef *hexti, uint32_t Edge)
+{
+    return (EXTI->PR >> (hexti->Line & 0x1F)) & 0x1;
+}
+
+void HAL_EXTI_IRQHandler(EXTI_HandleTypeDef *hexti)
+{
+    uint32_t bit = 1UL << (hexti->Line & 0x1F);
+
+    if ((EXTI->PR & bit) != 0)
+    {
+        EXTI->PR &= ~bit;
+        if (hexti->PendingCallback != NULL)
+        {
+            hexti->PendingCallback();
+        }
+    }
+
+    return;
+}
+
+// TIM
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim)
+{
+    if (htim == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    if (htim->State == HAL_TIM_STATE_RESET)
+    {
+        HAL_TIM_Base_MspInit(htim);
+    }
+    hal_sim_tim_init(htim);
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_DeInit(TIM_HandleTypeDef *htim)
+{
+    htim->Instance->CR1 &= ~TIM_CR1_CEN;
+    htim->Instance->DIER = 0;
+    htim->State = HAL_TIM_STATE_RESET;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim)
+{
+    htim->Instance->CR1 |= TIM_CR1_CEN;
+    htim->State = HAL_TIM_STATE_BUSY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim)
+{
+    htim->Instance->DIER |= TIM_DIER_UIE;
+
+    return HAL_TIM_Base_Start(htim);
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim)
+{
+    htim->Instance->CR1 &= ~TIM_CR1_CEN;
+    htim->State = HAL_TIM_STATE_READY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim)
+{
+    htim->Instance->DIER &= ~TIM_DIER_UIE;
+    htim->Instance->CR1 &= ~TIM_CR1_CEN;
+    htim->State = HAL_TIM_STATE_READY;
+
+    return HAL_OK;
+}
+
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim)
+{
+    uint32_t ch;
+
+    for (ch = 0; ch < HAL_SIM_TIM_CHANNELS; ch++)
+    {
+        if (((htim->Instance->SR & (TIM_SR_CC1IF << ch)) != 0) && ((htim->Instance->DIER & (TIM_IT_CC1 << ch)) != 0))
+        {
+            htim->Instance->SR &= ~(TIM_SR_CC1IF << ch);
+            htim->Channel = (HAL_TIM_ActiveChannel) (HAL_TIM_ACTIVE_CHANNEL_1 << ch);
+            HAL_TIM_OC_DelayElapsedCallback(htim);
+            htim->Channel = HAL_TIM_ACTIVE_CHANNEL_CLEARED;
+        }
+    }
+
+    if (((htim->Instance->SR & TIM_SR_UIF) != 0) && ((htim->Instance->DIER & TIM_DIER_UIE) != 0))
+    {
+        htim->Instance->SR &= ~TIM_SR_UIF;
+        HAL_TIM_PeriodElapsedCallback(htim);
+    }
+
+    return;
+}
+
+// PWM output: mode and compare value only, as preload is not simulated and a new duty applies at once
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim)
+{
+    if (htim == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    if (htim->State == HAL_TIM_STATE_RESET)
+    {
+        HAL_TIM_PWM_MspInit(htim);
+    }
+    hal_sim_tim_init(htim);
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel)
+{
+    uint32_t ch = Channel / TIM_CHANNEL_2;
+    volatile uint32_t *ccmr = (ch < 2) ? &htim->Instance->CCMR1 : &htim->Instance->CCMR2;
+    uint32_t shift = (ch % 2) * 8;
+
+    *ccmr = (*ccmr & ~((TIM_CCMR1_OC1M | TIM_CCMR1_OC1PE) << shift)) | ((sConfig->OCMode | TIM_CCMR1_OC1PE) << shift);
+    (&htim->Instance->CCR1)[ch] = sConfig->Pulse;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+    htim->Instance->CCER |= (TIM_CCER_CC1E << Channel);
+
+    return HAL_TIM_Base_Start(htim);
+}
+
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim, TIM_MasterConfigTypeDef *sMasterConfig)
+{
+    htim->Instance->CR2 = (htim->Instance->CR2 & ~TIM_CR2_MMS) | sMasterConfig->MasterOutputTrigger;
+
+    return HAL_OK;
+}
+
+__weak void HAL_TIM_PWM_MspInit(TIM_HandleTypeDef *htim)
+{
+    return;
+}
+
+__weak void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *htim)
+{
+    return;
+}
+
+__weak void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    return;
+}
+
+__weak void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    return;
+}
+
+// DMA, only as far as the console's USART2 transmit stream and the timer-driven streams need
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+    if (hdma == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    hdma->Instance->CR = hdma->Init.Channel | hdma->Init.Direction | hdma->Init.PeriphInc | hdma->Init.MemInc |
+                         hdma->Init.PeriphDataAlignment | hdma->Init.MemDataAlignment | hdma->Init.Mode |
+                         hdma->Init.Priority;
+    hdma->State = HAL_DMA_STATE_READY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma)
+{
+    hdma->Instance->CR = 0;
+    hdma->State = HAL_DMA_STATE_RESET;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress, uint32_t DataLength)
+{
+    hal_sim_dma_t *d = hal_sim_dma_find(hdma->Instance);
+
+    if (hdma->State != HAL_DMA_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    // Only streams served by peripheral requests, see hal_sim_dma_request()
+    if ((d == NULL) || (hdma->Init.Direction == DMA_MEMORY_TO_MEMORY) || (DataLength == 0))
+    {
+        return HAL_ERROR;
+    }
+
+    d->length = DataLength;
+    d->half_done = false;
+    d->done = false;
+    hdma->Instance->CR &= ~(DMA_IT_HT | DMA_IT_TC);
+    hdma->State = HAL_DMA_STATE_BUSY;
+    hdma->Instance->M0AR = (hdma->Init.Direction == DMA_MEMORY_TO_PERIPH) ? SrcAddress : DstAddress;
+    hdma->Instance->PAR = (hdma->Init.Direction == DMA_MEMORY_TO_PERIPH) ? DstAddress : SrcAddress;
+    hdma->Instance->NDTR = DataLength;
+    hdma->Instance->CR |= HAL_SIM_DMA_SxCR_EN;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+    hal_sim_dma_t *d = hal_sim_dma_find(hdma->Instance);
+
+    if (d != NULL)
+    {
+        d->half_done = false;
+        d->done = false;
+    }
+    hdma->Instance->CR &= ~(HAL_SIM_DMA_SxCR_EN | DMA_IT_HT | DMA_IT_TC);
+    hdma->State = HAL_DMA_STATE_READY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress,
+                                   uint32_t DataLength)
+{
+    if (hal_sim_dma_find(hdma->Instance) != NULL)
+    {
+        HAL_StatusTypeDef ret = HAL_DMA_Start(hdma, SrcAddress, DstAddress, DataLength);
+
+        if (ret == HAL_OK)
+        {
+            hdma->Instance->CR |= DMA_IT_HT | DMA_IT_TC;
+        }
+
+        return ret;
+    }
+
+    if (hdma->State != HAL_DMA_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    // Otherwise only the console's transmit stream; buffers are addressed in 32 bits as on the target, which holds for
+    // a non-PIE host build
+    if ((hdma->Init.Direction != DMA_MEMORY_TO_PERIPH) || (DstAddress != (uint32_t) (uintptr_t) &USART2->DR))
+    {
+        return HAL_ERROR;
+    }
+
+    hdma->State = HAL_DMA_STATE_BUSY;
+    hdma->Instance->NDTR = DataLength;
+    hdma->Instance->CR |= HAL_SIM_DMA_SxCR_EN;
+
+    hal_sim_uart_tx_start((const uint8_t *) (uintptr_t) SrcAddress, DataLength, hdma);
+
+    return HAL_OK;
+}
+
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+    hal_sim_dma_t *d = hal_sim_dma_find(hdma->Instance);
+
+    if (d != NULL)
+    {
+        if (d->half_done)
+        {
+            d->half_done = false;
+            if (hdma->XferHalfCpltCallback != NULL)
+            {
+                hdma->XferHalfCpltCallback(hdma);
+            }
+        }
+        if (d->done)
+        {
+            d->done = false;
+            if ((hdma->Instance->CR & DMA_CIRCULAR) == 0)
+            {
+                hdma->State = HAL_DMA_STATE_READY;
+            }
+            if (hdma->XferCpltCallback != NULL)
+            {
+                hdma->XferCpltCallback(hdma);
+            }
+        }
+    }
+    else if ((hdma == hal_sim_uart.tx_hdma) && hal_sim_uart.tx_dma_done)
+    {
+        hal_sim_uart.tx_dma_done = false;
+        hal_sim_uart.tx_hdma = NULL;
+        hdma->Instance->NDTR = 0;
+        hdma->Instance->CR &= ~HAL_SIM_DMA_SxCR_EN;
+        hdma->State = HAL_DMA_STATE_READY;
+        if (hdma->XferCpltCallback != NULL)
+        {
+            hdma->XferCpltCallback(hdma);
+        }
+    }
+
+    return;
+}
+
+// ADC, regular conversions on an external trigger into DMA only
+static void hal_sim_adc_dma_half_cplt(DMA_HandleTypeDef *hdma)
+{
+    HAL_ADC_ConvHalfCpltCallback((ADC_HandleTypeDef *) hdma->Parent);
+
+    return;
+}
+
+static void hal_sim_adc_dma_cplt(DMA_HandleTypeDef *hdma)
+{
+    HAL_ADC_ConvCpltCallback((ADC_HandleTypeDef *) hdma->Parent);
+
+    return;
+}
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc)
+{
+    if ((hadc == NULL) || (hadc->Init.NbrOfConversion == 0) || (hadc->Init.NbrOfConversion > 16))
+    {
+        return HAL_ERROR;
+    }
+
+    if (hadc->State == HAL_ADC_STATE_RESET)
+    {
+        HAL_ADC_MspInit(hadc);
+    }
+
+    hadc->Instance->CR1 = (hadc->Init.ScanConvMode != DISABLE) ? ADC_CR1_SCAN : 0;
+    hadc->Instance->CR2 = ADC_CR2_ADON | hadc->Init.ExternalTrigConv | hadc->Init.ExternalTrigConvEdge |
+                          ((hadc->Init.DMAContinuousRequests != DISABLE) ? ADC_CR2_DDS : 0);
+    hadc->Instance->SQR1 = (hadc->Instance->SQR1 & ~ADC_SQR1_L) | ((hadc->Init.NbrOfConversion - 1) << 20);
+    hadc->Instance->SR = 0;
+    hadc->State = HAL_ADC_STATE_READY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig)
+{
+    uint32_t channel = sConfig->Channel & 0x1F;
+    uint32_t rank = sConfig->Rank - 1;
+    volatile uint32_t *sqr = (rank < 6) ? &hadc->Instance->SQR3
+                                        : ((rank < 12) ? &hadc->Instance->SQR2 : &hadc->Instance->SQR1);
+    volatile uint32_t *smpr = (channel < 10) ? &hadc->Instance->SMPR2 : &hadc->Instance->SMPR1;
+
+    if ((channel > 18) || (rank > 15))
+    {
+        return HAL_ERROR;
+    }
+
+    *sqr = (*sqr & ~(0x1FUL << ((rank % 6) * 5))) | (channel << ((rank % 6) * 5));
+    *smpr = (*smpr & ~(0x7UL << ((channel % 10) * 3))) | (sConfig->SamplingTime << ((channel % 10) * 3));
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length)
+{
+    HAL_StatusTypeDef ret;
+
+    if (hadc->State != HAL_ADC_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    hadc->DMA_Handle->XferHalfCpltCallback = hal_sim_adc_dma_half_cplt;
+    hadc->DMA_Handle->XferCpltCallback = hal_sim_adc_dma_cplt;
+    ret = HAL_DMA_Start_IT(hadc->DMA_Handle, (uint32_t) (uintptr_t) &hadc->Instance->DR,
+                           (uint32_t) (uintptr_t) pData, Length);
+    if (ret == HAL_OK)
+    {
+        hadc->Instance->SR &= ~ADC_SR_OVR;
+        hadc->Instance->CR1 |= ADC_CR1_OVRIE;
+        hadc->Instance->CR2 |= ADC_CR2_DMA;
+        hadc->State = HAL_ADC_STATE_BUSY;
+    }
+
+    return ret;
+}
+
+HAL_StatusTypeDef HAL_ADC_Stop_DMA(ADC_HandleTypeDef *hadc)
+{
+    hadc->Instance->CR1 &= ~ADC_CR1_OVRIE;
+    hadc->Instance->CR2 &= ~(ADC_CR2_DMA | ADC_CR2_ADON);
+    HAL_DMA_Abort(hadc->DMA_Handle);
+    hadc->State = HAL_ADC_STATE_READY;
+
+    return HAL_OK;
+}
+
+void HAL_ADC_IRQHandler(ADC_HandleTypeDef *hadc)
+{
+    if (((hadc->Instance->SR & ADC_SR_OVR) != 0) && ((hadc->Instance->CR1 & ADC_CR1_OVRIE) != 0))
+    {
+        // As the real HAL does, the overrun leaves DMA stopped for the error callback to restart or give up
+        hadc->Instance->SR &= ~ADC_SR_OVR;
+        hadc->Instance->CR2 &= ~ADC_CR2_DMA;
+        hadc->State = HAL_ADC_STATE_READY;
+        HAL_ADC_ErrorCallback(hadc);
+    }
+
+    return;
+}
+
+__weak void HAL_ADC_MspInit(ADC_HandleTypeDef *hadc)
+{
+    return;
+}
+
+__weak void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    return;
+}
+
+__weak void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+    return;
+}
+
+__weak void HAL_ADC_ErrorCallback(ADC_HandleTypeDef *hadc)
+{
+    return;
+}
+
+// SPI, master transfers by DMA only, see hal_sim_spi_complete()
+static void hal_sim_spi_dma_tx_cplt(DMA_HandleTypeDef *hdma)
+{
+    SPI_HandleTypeDef *hspi = (SPI_HandleTypeDef *) hdma->Parent;
+
+    hspi->Instance->CR2 &= ~SPI_CR2_TXDMAEN;
+    hspi->State = HAL_SPI_STATE_READY;
+    HAL_SPI_TxCpltCallback(hspi);
+
+    return;
+}
+
+static void hal_sim_spi_dma_rx_cplt(DMA_HandleTypeDef *hdma)
+{
+    SPI_HandleTypeDef *hspi = (SPI_HandleTypeDef *) hdma->Parent;
+
+    hspi->Instance->CR2 &= ~(SPI_CR2_TXDMAEN | SPI_CR2_RXDMAEN);
+    hspi->State = HAL_SPI_STATE_READY;
+    HAL_SPI_TxRxCpltCallback(hspi);
+
+    return;
+}
+
+static void hal_sim_spi_start(SPI_HandleTypeDef *hspi, uint16_t Size)
+{
+    // SCK is PCLK2 divided by 2^(BR + 1)
+    uint64_t sck_hz = HAL_RCC_GetPCLK2Freq() >> (((hspi->Instance->CR1 & SPI_CR1_BR) >> SPI_CR1_BR_Pos) + 1);
+
+    __HAL_SPI_ENABLE(hspi);
+    hspi->State = HAL_SPI_STATE_BUSY;
+    hal_sim_spi.busy = true;
+    hal_sim_spi.len = Size;
+    hal_sim_spi.done_ns = hal_sim_now + (((uint64_t) Size * 8 * HAL_SIM_NS_PER_S) + sck_hz - 1) / sck_hz;
+
+    return;
+}
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi)
+{
+    if (hspi == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    if (hspi->State == HAL_SPI_STATE_RESET)
+    {
+        HAL_SPI_MspInit(hspi);
+    }
+
+    hspi->Instance->CR1 = hspi->Init.Mode | hspi->Init.Direction | hspi->Init.DataSize | hspi->Init.CLKPolarity |
+                          hspi->Init.CLKPhase | hspi->Init.NSS | hspi->Init.BaudRatePrescaler | hspi->Init.FirstBit;
+    hspi->Instance->CR2 = 0;
+    hspi->ErrorCode = 0;
+    hspi->State = HAL_SPI_STATE_READY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size)
+{
+    if (hspi->State != HAL_SPI_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+    if ((pData == NULL) || (Size == 0) || (hspi->hdmatx == NULL))
+    {
+        return HAL_ERROR;
+    }
+
+    hspi->hdmatx->XferHalfCpltCallback = NULL;
+    hspi->hdmatx->XferCpltCallback = hal_sim_spi_dma_tx_cplt;
+    if (HAL_DMA_Start_IT(hspi->hdmatx, (uint32_t) (uintptr_t) pData, (uint32_t) (uintptr_t) &hspi->Instance->DR,
+                         Size) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+    hspi->Instance->CR2 |= SPI_CR2_TXDMAEN;
+    hal_sim_spi_start(hspi, Size);
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData,
+                                              uint16_t Size)
+{
+    if (hspi->State != HAL_SPI_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+    if ((pTxData == NULL) || (pRxData == NULL) || (Size == 0) || (hspi->hdmatx == NULL) || (hspi->hdmarx == NULL))
+    {
+        return HAL_ERROR;
+    }
+
+    // As in the HAL, the receive stream ends the transfer and the transmit stream's completion does nothing
+    hspi->hdmarx->XferHalfCpltCallback = NULL;
+    hspi->hdmarx->XferCpltCallback = hal_sim_spi_dma_rx_cplt;
+    hspi->hdmatx->XferHalfCpltCallback = NULL;
+    hspi->hdmatx->XferCpltCallback = NULL;
+    if (HAL_DMA_Start_IT(hspi->hdmarx, (uint32_t) (uintptr_t) &hspi->Instance->DR, (uint32_t) (uintptr_t) pRxData,
+                         Size) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+    hspi->Instance->CR2 |= SPI_CR2_RXDMAEN;
+    if (HAL_DMA_Start_IT(hspi->hdmatx, (uint32_t) (uintptr_t) pTxData, (uint32_t) (uintptr_t) &hspi->Instance->DR,
+                         Size) != HAL_OK)
+    {
+        HAL_DMA_Abort(hspi->hdmarx);
+        hspi->Instance->CR2 &= ~SPI_CR2_RXDMAEN;
+        return HAL_ERROR;
+    }
+    hspi->Instance->CR2 |= SPI_CR2_TXDMAEN;
+    hal_sim_spi_start(hspi, Size);
+
+    return HAL_OK;
+}
+
+void HAL_SPI_IRQHandler(SPI_HandleTypeDef *hspi)
+{
+    // Mode faults, overruns and CRC errors are not simulated
+    return;
+}
+
+__weak void HAL_SPI_MspInit(SPI_HandleTypeDef *hspi)
+{
+    return;
+}
+
+__weak void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    return;
+}
+
+__weak void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    return;
+}
+
+__weak void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    return;
+}
+
+// I2C, register accesses as a master to the target of hal_sim_i2c_complete() only
+static void hal_sim_i2c_dma_rx_cplt(DMA_HandleTypeDef *hdma)
+{
+    I2C_HandleTypeDef *hi2c = (I2C_HandleTypeDef *) hdma->Parent;
+
+    hi2c->State = HAL_I2C_STATE_READY;
+    HAL_I2C_MemRxCpltCallback(hi2c);
+
+    return;
+}
+
+static HAL_StatusTypeDef hal_sim_i2c_start(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                           uint16_t MemAddSize, uint8_t *pData, uint16_t Size, bool read, bool dma)
+{
+    hal_sim_i2c_t *bus = hal_sim_i2c_find(hi2c->Instance);
+    uint64_t bits;
+
+    if (hi2c->State != HAL_I2C_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    // The HAL waits out a busy bus for 25 ms before giving up; here the wait is skipped
+    if (__HAL_I2C_GET_FLAG(hi2c, I2C_FLAG_BUSY) == SET)
+    {
+        hi2c->ErrorCode = HAL_I2C_ERROR_TIMEOUT;
+        return HAL_BUSY;
+    }
+
+    if ((pData == NULL) || (Size == 0))
+    {
+        return HAL_ERROR;
+    }
+
+    if (dma)
+    {
+        if (hi2c->hdmarx == NULL)
+        {
+            return HAL_ERROR;
+        }
+        hi2c->hdmarx->XferHalfCpltCallback = NULL;
+        hi2c->hdmarx->XferCpltCallback = hal_sim_i2c_dma_rx_cplt;
+        if (HAL_DMA_Start_IT(hi2c->hdmarx, (uint32_t) (uintptr_t) &hi2c->Instance->DR, (uint32_t) (uintptr_t) pData,
+                             Size) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    hi2c->State = read ? HAL_I2C_STATE_BUSY_RX : HAL_I2C_STATE_BUSY_TX;
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    bus->hi2c = hi2c;
+    bus->read = read;
+    bus->dma = dma;
+    bus->addr = DevAddress >> 1;
+    bus->reg = MemAddress;
+    bus->data = pData;
+    bus->len = Size;
+
+    // The target hangs part-way through its first access, leaving it to time out
+    if ((bus->regs == I2C1) && (bus->addr == HAL_SIM_I2C_TARGET_ADDR) && (hal_sim_i2c_hang_clocks > 0))
+    {
+        hal_sim_i2c_stuck_clocks = hal_sim_i2c_hang_clocks;
+        hal_sim_i2c_hang_clocks = 0;
+        hal_sim_i2c_lines(0, hal_sim_gpiob.ODR);
+        hal_sim_trace("I2C1 target hung holding SDA low");
+        return HAL_OK;
+    }
+
+    // START, address, register address, data and STOP, with a repeated START and address to read
+    bits = HAL_SIM_I2C_BITS_PER_BYTE * (1 + ((MemAddSize == I2C_MEMADD_SIZE_16BIT) ? 2 : 1) + (uint64_t) Size);
+    bits += read ? (HAL_SIM_I2C_BITS_PER_BYTE + 1) : 0;
+    bits += 2;
+    bus->busy = true;
+    bus->done_ns = hal_sim_now + ((bits * HAL_SIM_NS_PER_S) + hi2c->Init.ClockSpeed - 1) / hi2c->Init.ClockSpeed;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+    hal_sim_i2c_t *bus;
+
+    if ((hi2c == NULL) || (hi2c->Init.ClockSpeed == 0) || (hi2c->Init.ClockSpeed > 400000))
+    {
+        return HAL_ERROR;
+    }
+
+    if (hi2c->State == HAL_I2C_STATE_RESET)
+    {
+        HAL_I2C_MspInit(hi2c);
+    }
+
+    // As the software reset the HAL starts with, abandoning any access in progress
+    bus = hal_sim_i2c_find(hi2c->Instance);
+    bus->busy = false;
+    bus->ev_pending = false;
+    bus->er_pending = false;
+    hi2c->Instance->SR1 = 0;
+    hi2c->Instance->CR1 = I2C_CR1_PE;
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    hi2c->State = HAL_I2C_STATE_READY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    return hal_sim_i2c_start(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, false, false);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                      uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    return hal_sim_i2c_start(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, true, false);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    return hal_sim_i2c_start(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, true, true);
+}
+
+// Only the end of an interrupt-driven access is an event here, not every byte
+void HAL_I2C_EV_IRQHandler(I2C_HandleTypeDef *hi2c)
+{
+    hal_sim_i2c_t *bus = hal_sim_i2c_find(hi2c->Instance);
+
+    if (bus->ev_pending)
+    {
+        bus->ev_pending = false;
+        hi2c->State = HAL_I2C_STATE_READY;
+        if (bus->read)
+        {
+            HAL_I2C_MemRxCpltCallback(hi2c);
+        }
+        else
+        {
+            HAL_I2C_MemTxCpltCallback(hi2c);
+        }
+    }
+
+    return;
+}
+
+// Only a missing acknowledge is simulated
+void HAL_I2C_ER_IRQHandler(I2C_HandleTypeDef *hi2c)
+{
+    hal_sim_i2c_t *bus = hal_sim_i2c_find(hi2c->Instance);
+
+    if (bus->er_pending)
+    {
+        bus->er_pending = false;
+        if (bus->dma)
+        {
+            HAL_DMA_Abort(hi2c->hdmarx);
+        }
+        hi2c->State = HAL_I2C_STATE_READY;
+        HAL_I2C_ErrorCallback(hi2c);
+    }
+
+    return;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c)
+{
+    return hi2c->ErrorCode;
+}
+
+__weak void HAL_I2C_MspInit(I2C_HandleTypeDef *hi2c)
+{
+    return;
+}
+
+__weak void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    return;
+}
+
+__weak void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    return;
+}
+
+__weak void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    return;
+}
+
+// UART
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+    if ((huart == NULL) || (huart->Init.BaudRate == 0))
+    {
+        return HAL_ERROR;
+    }
+
+    if (huart->gState == HAL_UART_STATE_RESET)
+    {
+        HAL_UART_MspInit(huart);
+    }
+
+    hal_sim_uart.huart = huart;
+    hal_sim_uart.byte_ns = (HAL_SIM_UART_BITS_PER_BYTE * HAL_SIM_NS_PER_S) / huart->Init.BaudRate;
+    huart->Instance->SR = USART_SR_TC | USART_SR_TXE;
+    huart->gState = HAL_UART_STATE_READY;
+    huart->RxState = HAL_UART_STATE_READY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    if (huart->gState != HAL_UART_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    // Only the completion of the block is simulated, not an interrupt per byte
+    huart->Instance->CR1 |= USART_CR1_TCIE;
+    hal_sim_uart_tx_start(pData, Size, NULL);
+
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef hal_sim_uart_rx_start(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, bool dma)
+{
+    if (huart->RxState != HAL_UART_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    hal_sim_uart.rx_buf = pData;
+    hal_sim_uart.rx_size = Size;
+    hal_sim_uart.rx_pos = 0;
+    hal_sim_uart.rx_dma = dma;
+    hal_sim_uart.rx_armed = true;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    return hal_sim_uart_rx_start(huart, pData, Size, false);
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    return hal_sim_uart_rx_start(huart, pData, Size, true);
+}
+
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart)
+{
+    if (hal_sim_uart.rx_event)
+    {
+        hal_sim_uart.rx_event = false;
+        if (hal_sim_uart.rx_dma)
+        {
+            HAL_UARTEx_RxEventCallback(huart, hal_sim_uart.rx_event_size);
+        }
+        else
+        {
+            huart->RxState = HAL_UART_STATE_READY;
+            HAL_UART_RxCpltCallback(huart);
+        }
+    }
+
+    if (hal_sim_uart.tx_it_done)
+    {
+        hal_sim_uart.tx_it_done = false;
+        huart->Instance->CR1 &= ~USART_CR1_TCIE;
+        huart->gState = HAL_UART_STATE_READY;
+        HAL_UART_TxCpltCallback(huart);
+    }
+
+    return;
+}
+
+__weak void HAL_UART_MspInit(UART_HandleTypeDef *huart)
+{
+    return;
+}
+
+__weak void HAL_UART_MspDeInit(UART_HandleTypeDef *huart)
+{
+    return;
+}
+
+__weak void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    return;
+}
+
+__weak void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    return;
+}
+
+__weak void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    return;
+}
+
+__weak void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    return;
+}
+
+// Flash, programmed a word at a time; the CPU stalls for the operation, so virtual time moves on without __WFI()
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+    hal_sim_flash_locked = false;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+    hal_sim_flash_locked = true;
+
+    return HAL_OK;
+}
+
+// As on the target, programming can only clear bits, whatever the word held before
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+    uint32_t offset = Address - FLASH_BASE;
+    uint32_t word;
+
+    if (hal_sim_flash_locked || (TypeProgram != FLASH_TYPEPROGRAM_WORD) || (offset >= HAL_SIM_FLASH_SIZE) ||
+        ((offset % sizeof(word)) != 0))
+    {
+        return HAL_ERROR;
+    }
+
+    memcpy(&word, &hal_sim_flash[offset], sizeof(word));
+    word &= (uint32_t) Data;
+    memcpy(&hal_sim_flash[offset], &word, sizeof(word));
+    hal_sim_advance(HAL_SIM_FLASH_WORD_NS);
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError)
+{
+    *SectorError = 0xFFFFFFFFU;
+    if (hal_sim_flash_locked || (pEraseInit->TypeErase != FLASH_TYPEERASE_SECTORS) ||
+        (pEraseInit->NbSectors == 0) || (pEraseInit->Sector >= HAL_SIM_FLASH_SECTORS) ||
+        (pEraseInit->NbSectors > (HAL_SIM_FLASH_SECTORS - pEraseInit->Sector)))
+    {
+        return HAL_ERROR;
+    }
+
+    for (uint32_t i = pEraseInit->Sector; i < (pEraseInit->Sector + pEraseInit->NbSectors); i++)
+    {
+        memset(&hal_sim_flash[hal_sim_flash_sectors[i].offset], 0xFF, hal_sim_flash_sectors[i].size);
+        hal_sim_advance(hal_sim_flash_sectors[i].erase_ms * HAL_SIM_NS_PER_MS);
+        hal_sim_trace("flash sector %lu erased", (unsigned long) i);
+    }
+
+    return HAL_OK;
+}
+
+// RTC, which is never started because there is no LSE
+HAL_StatusTypeDef HAL_RTC_Init(RTC_HandleTypeDef *hrtc)
+{
+    return HAL_ERROR;
+}
+
+__weak void HAL_RTC_MspInit(RTC_HandleTypeDef *hrtc)
+{
+    return;
+}
+
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format)
+{
+    memset(sTime, 0, sizeof(*sTime));
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format)
+{
+    memset(sDate, 0, sizeof(*sDate));
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_WaitForSynchro(RTC_HandleTypeDef *hrtc)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTCEx_SetWakeUpTimer_IT(RTC_HandleTypeDef *hrtc, uint32_t WakeUpCounter, uint32_t WakeUpClock)
+{
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_RTCEx_DeactivateWakeUpTimer(RTC_HandleTypeDef *hrtc)
+{
+    return HAL_OK;
+}
+
+void HAL_RTCEx_WakeUpTimerIRQHandler(RTC_HandleTypeDef *hrtc)
+{
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+uint64_t hal_sim_now_ns(void)
+{
+    return hal_sim_now;
+}
+
+void hal_sim_exti_inject(uint32_t line)
+{
+    __atomic_fetch_or(&hal_sim_exti_requests, 1UL << (line & 0x1F), __ATOMIC_RELEASE);
+
+    return;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file hal_sim.h
+ *
+ * @brief Controls for the host simulation behind the stand-in HAL
+ *
+ * The simulation runs one virtual clock.  It only moves in __WFI(), which jumps it to the next simulated event (or
+ * waits for it in real time), so code between sleeps takes no virtual time and the timer service sees exact
+ * deadlines.  Interrupts are taken when they are unmasked and in __WFI(), one at a time; a higher-priority interrupt
+ * never preempts a running handler.
+ *
+ * Simulated peripherals:
+ * - TIM1, TIM2, TIM5: counters, prescaler, auto-reload, compare flags and the update and compare interrupts; TIM1
+ *                  update events also request DMA2 Stream5
+ * - TIM3:          counter and update events only, as the TRGO that starts each ADC1 scan
+ * - TIM4:          as TIM5, for the timer benchmark's re-initialised timeouts
+ * - TIM2 CH1:      PWM on PA5, traced as its duty with HAL_SIM_TRACE; preload is not simulated, so a new duty or
+ *                  period applies at once rather than at the next update
+ * - ADC1:          scans of the regular sequence on each TIM3 update, with DMA only; VREFINT and the temperature
+ *                  sensor read their typical 3.3 V, 25 C values and every other channel a noisy 100 Hz triangle wave
+ * - SPI1:          master transfers by DMA, each completing after its length in bits at the SCK rate set by CR1;
+ *                  MISO reads back MOSI, as with PB4 and PB5 jumpered together
+ * - I2C1, I2C3:    master register writes and reads, by interrupt or with DMA, each completing after its length in bits
+ *                  at the configured SCL rate; I2C1 has one target at 0x68, a 256-byte register file with an
+ *                  auto-incrementing address and WHO_AM_I (0x75) reading 0x68, and any other address is not
+ *                  acknowledged; SCL and SDA of I2C1 are followed on PB8 and PB9 while the target holds SDA low
+ * - DMA1 Stream0, Stream2: I2C1 and I2C3 receive
+ * - DMA2 Stream2-5: peripheral-to-memory or memory-to-peripheral transfers, one item per request, normal or
+ *                  circular, with the half and full transfer interrupts
+ * - USART2:        transmit and receive with or without DMA, paced at the configured baud rate, backed by
+ *                  stdin/stdout or a pseudo-terminal
+ * - EXTI13:        the user push-button, pressed with hal_sim_exti_inject(), SIGUSR1 or HAL_SIM_PB_MS
+ * - GPIO:          output pin state on ports A, B and C, from HAL calls or direct BSRR writes, traced with
+ *                  HAL_SIM_TRACE
+ * - Flash:         the 512 KiB array and its sectors, in RAM unless HAL_SIM_FLASH is set; programming a word only
+ *                  clears bits, and a word programmed or a sector erased moves virtual time on by its typical
+ *                  duration, as the CPU would stall for it
+ *
+ * There is no RTC or LSE, so STOP is never entered and every idle period takes the Sleep tier.
+ *
+ * Environment variables read at start-up:
+ * - HAL_SIM_FAST=1         jump the virtual clock to the next event instead of waiting for it in real time; input
+ *                          that is not a terminal is then read as soon as it arrives, before the clock moves on
+ * - HAL_SIM_RUN_MS=<ms>    exit once this much virtual time has passed and the console has drained
+ * - HAL_SIM_PB_MS=<ms,...> press the user push-button at these virtual times
+ * - HAL_SIM_PTY=1          use a new pseudo-terminal for USART2, printing its name on stderr
+ * - HAL_SIM_TRACE=1        log GPIO output changes and push-button presses on stderr
+ * - HAL_SIM_I2C_STUCK=<n>  hang the I2C1 target part-way through the first access to it, holding SDA low until SCL
+ *                          is clocked n times by hand
+ * - HAL_SIM_FLASH=<file>   keep the flash in this file, so it persists from one run to the next
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef HAL_SIM_H
+#define HAL_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+/**
+ * Virtual time since start-up
+ *
+ */
+uint64_t hal_sim_now_ns(void);
+
+/**
+ * Raise a falling edge on an EXTI line, e.g. EXTI_LINE_13 for a push-button press
+ *
+ * Safe to call from a signal handler; the edge is latched at the next point interrupts can be taken.
+ *
+ */
+void hal_sim_exti_inject(uint32_t line);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HAL_SIM_H
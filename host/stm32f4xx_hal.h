@@ -0,0 +1,1160 @@
+/**
+ * @file stm32f4xx_hal.h
+ *
+ * @brief Host stand-in for the parts of the STM32F4 HAL and CMSIS used by the BSP
+ *
+ * Found ahead of the real HAL on the include path by 'make host'.  Peripherals are plain structs laid out like the
+ * hardware registers, so BSP code that pokes registers through the HAL macros builds unchanged.  Their behaviour is
+ * simulated in hal_sim.c; anything not listed here is not simulated.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef STM32F4XX_HAL_H
+#define STM32F4XX_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+/***********************************************************************************************************************
+ * LITERALS & CONSTANTS
+ **********************************************************************************************************************/
+#define __weak                          __attribute__((weak))
+#define __NVIC_PRIO_BITS                (4)
+#define TICK_INT_PRIORITY               (0x0FU)
+
+#define SET_BIT(REG, BIT)               ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT)             ((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT)              ((REG) & (BIT))
+
+// CMSIS core
+#define DWT_CTRL_CYCCNTENA_Msk          (0x1U)
+#define CoreDebug_DEMCR_TRCENA_Msk      (0x1U << 24)
+
+// RCC
+#define RCC_CFGR_PPRE1                  (0x7U << 10)
+#define RCC_CFGR_PPRE2                  (0x7U << 13)
+#define RCC_OSCILLATORTYPE_HSE          (0x1U)
+#define RCC_OSCILLATORTYPE_HSI          (0x2U)
+#define RCC_OSCILLATORTYPE_LSE          (0x4U)
+#define RCC_OSCILLATORTYPE_LSI          (0x8U)
+#define RCC_HSI_ON                      (0x1U)
+#define RCC_LSE_ON                      (0x1U)
+#define RCC_HSICALIBRATION_DEFAULT      (0x10U)
+#define RCC_PLL_NONE                    (0x0U)
+#define RCC_PLL_OFF                     (0x1U)
+#define RCC_PLL_ON                      (0x2U)
+#define RCC_PLLSOURCE_HSI               (0x0U)
+#define RCC_PLLP_DIV2                   (0x2U)
+#define RCC_PLLP_DIV4                   (0x4U)
+#define RCC_PLLP_DIV6                   (0x6U)
+#define RCC_PLLP_DIV8                   (0x8U)
+#define RCC_CLOCKTYPE_SYSCLK            (0x1U)
+#define RCC_CLOCKTYPE_HCLK              (0x2U)
+#define RCC_CLOCKTYPE_PCLK1             (0x4U)
+#define RCC_CLOCKTYPE_PCLK2             (0x8U)
+#define RCC_SYSCLKSOURCE_HSI            (0x0U)
+#define RCC_SYSCLKSOURCE_PLLCLK         (0x2U)
+#define RCC_SYSCLK_DIV1                 (0x0U)
+#define RCC_HCLK_DIV1                   (0x0U)
+#define RCC_HCLK_DIV2                   (0x4U << 10)
+#define RCC_HCLK_DIV4                   (0x5U << 10)
+#define RCC_HCLK_DIV8                   (0x6U << 10)
+#define RCC_HCLK_DIV16                  (0x7U << 10)
+#define RCC_PERIPHCLK_RTC               (0x2U)
+#define RCC_RTCCLKSOURCE_LSE            (0x100U)
+#define FLASH_LATENCY_2                 (0x2U)
+#define PWR_REGULATOR_VOLTAGE_SCALE2    (0x2U)
+#define PWR_LOWPOWERREGULATOR_ON        (0x1U)
+#define PWR_STOPENTRY_WFI               (0x1U)
+
+// GPIO
+#define GPIO_PIN_0                      (0x0001U)
+#define GPIO_PIN_1                      (0x0002U)
+#define GPIO_PIN_2                      (0x0004U)
+#define GPIO_PIN_3                      (0x0008U)
+#define GPIO_PIN_4                      (0x0010U)
+#define GPIO_PIN_5                      (0x0020U)
+#define GPIO_PIN_6                      (0x0040U)
+#define GPIO_PIN_7                      (0x0080U)
+#define GPIO_PIN_8                      (0x0100U)
+#define GPIO_PIN_9                      (0x0200U)
+#define GPIO_PIN_10                     (0x0400U)
+#define GPIO_PIN_11                     (0x0800U)
+#define GPIO_PIN_12                     (0x1000U)
+#define GPIO_PIN_13                     (0x2000U)
+#define GPIO_PIN_14                     (0x4000U)
+#define GPIO_PIN_15                     (0x8000U)
+#define GPIO_MODE_INPUT                 (0x00000000U)
+#define GPIO_MODE_OUTPUT_PP             (0x00000001U)
+#define GPIO_MODE_AF_PP                 (0x00000002U)
+#define GPIO_MODE_OUTPUT_OD             (0x00000011U)
+#define GPIO_MODE_AF_OD                 (0x00000012U)
+#define GPIO_MODE_ANALOG                (0x00000003U)
+#define GPIO_MODE_IT_FALLING            (0x10210000U)
+#define GPIO_SPEED_FREQ_LOW             (0x0U)
+#define GPIO_SPEED_FREQ_MEDIUM          (0x1U)
+#define GPIO_SPEED_FREQ_HIGH            (0x2U)
+#define GPIO_SPEED_FREQ_VERY_HIGH       (0x3U)
+#define GPIO_SPEED_FAST                 GPIO_SPEED_FREQ_HIGH
+#define GPIO_NOPULL                     (0x0U)
+#define GPIO_PULLUP                     (0x1U)
+#define GPIO_PULLDOWN                   (0x2U)
+#define GPIO_AF1_TIM2                   (0x01U)
+#define GPIO_AF4_I2C1                   (0x04U)
+#define GPIO_AF4_I2C3                   (0x04U)
+#define GPIO_AF5_SPI1                   (0x05U)
+#define GPIO_AF7_USART2                 (0x07U)
+
+// EXTI, with the line number in the low bits as in the real encoding
+#define EXTI_LINE_3                     (0x03U)
+#define EXTI_LINE_13                    (0x0DU)
+#define EXTI_MODE_INTERRUPT             (0x1U)
+#define EXTI_TRIGGER_RISING             (0x1U)
+#define EXTI_TRIGGER_FALLING            (0x2U)
+#define EXTI_GPIOA                      (0x0U)
+#define EXTI_GPIOC                      (0x2U)
+#define EXTI_IMR_MR3                    (0x1U << 3)
+#define EXTI_FTSR_TR3                   (0x1U << 3)
+#define SYSCFG_EXTICR1_EXTI3            (0xFU << 12)
+
+// TIM
+#define TIM_CR1_CEN                     (0x1U << 0)
+#define TIM_CR1_URS                     (0x1U << 2)
+#define TIM_CR1_ARPE                    (0x1U << 7)
+#define TIM_SR_UIF                      (0x1U << 0)
+#define TIM_SR_CC1IF                    (0x1U << 1)
+#define TIM_SR_CC2IF                    (0x1U << 2)
+#define TIM_SR_CC3IF                    (0x1U << 3)
+#define TIM_SR_CC4IF                    (0x1U << 4)
+#define TIM_DIER_UIE                    (0x1U << 0)
+#define TIM_DIER_CC1IE                  (0x1U << 1)
+#define TIM_DIER_CC2IE                  (0x1U << 2)
+#define TIM_DIER_UDE                    (0x1U << 8)
+#define TIM_EGR_UG                      (0x1U << 0)
+#define TIM_EGR_CC1G                    (0x1U << 1)
+#define TIM_EGR_CC2G                    (0x1U << 2)
+#define TIM_EGR_CC3G                    (0x1U << 3)
+#define TIM_EGR_CC4G                    (0x1U << 4)
+#define TIM_CCMR1_OC1PE                 (0x1U << 3)
+#define TIM_CCMR1_OC1M                  (0x7U << 4)
+#define TIM_CCER_CC1E                   (0x1U << 0)
+#define TIM_CCER_CC1P                   (0x1U << 1)
+#define TIM_FLAG_UPDATE                 TIM_SR_UIF
+#define TIM_FLAG_CC1                    TIM_SR_CC1IF
+#define TIM_FLAG_CC2                    TIM_SR_CC2IF
+#define TIM_FLAG_CC3                    TIM_SR_CC3IF
+#define TIM_FLAG_CC4                    TIM_SR_CC4IF
+#define TIM_IT_UPDATE                   TIM_DIER_UIE
+#define TIM_IT_CC1                      (0x1U << 1)
+#define TIM_IT_CC2                      (0x1U << 2)
+#define TIM_IT_CC3                      (0x1U << 3)
+#define TIM_IT_CC4                      (0x1U << 4)
+#define TIM_CHANNEL_1                   (0x0U)
+#define TIM_CHANNEL_2                   (0x4U)
+#define TIM_CHANNEL_3                   (0x8U)
+#define TIM_CHANNEL_4                   (0xCU)
+#define TIM_DMA_UPDATE                  TIM_DIER_UDE
+#define TIM_CR2_MMS                     (0x7U << 4)
+#define TIM_TRGO_UPDATE                 (0x2U << 4)
+#define TIM_MASTERSLAVEMODE_DISABLE     (0x0U)
+#define TIM_COUNTERMODE_UP              (0x0U)
+#define TIM_AUTORELOAD_PRELOAD_DISABLE  (0x0U)
+#define TIM_AUTORELOAD_PRELOAD_ENABLE   TIM_CR1_ARPE
+#define TIM_OCMODE_PWM1                 (0x6U << 4)
+#define TIM_OCPOLARITY_HIGH             (0x0U)
+#define TIM_OCFAST_DISABLE              (0x0U)
+
+// USART
+#define USART_SR_TC                     (0x1U << 6)
+#define USART_SR_TXE                    (0x1U << 7)
+#define USART_CR1_TCIE                  (0x1U << 6)
+#define USART_CR1_TXEIE                 (0x1U << 7)
+#define USART_CR3_DMAR                  (0x1U << 6)
+#define USART_CR3_DMAT                  (0x1U << 7)
+#define UART_FLAG_TC                    USART_SR_TC
+#define UART_FLAG_TXE                   USART_SR_TXE
+#define UART_WORDLENGTH_8B              (0x0U)
+#define UART_STOPBITS_1                 (0x0U)
+#define UART_PARITY_NONE                (0x0U)
+#define UART_HWCONTROL_NONE             (0x0U)
+#define UART_MODE_TX_RX                 (0xCU)
+#define UART_OVERSAMPLING_16            (0x0U)
+
+// SPI
+#define SPI_CR1_CPHA                    (0x1U << 0)
+#define SPI_CR1_CPOL                    (0x1U << 1)
+#define SPI_CR1_MSTR                    (0x1U << 2)
+#define SPI_CR1_BR_Pos                  (3U)
+#define SPI_CR1_BR                      (0x7U << SPI_CR1_BR_Pos)
+#define SPI_CR1_SPE                     (0x1U << 6)
+#define SPI_CR1_SSI                     (0x1U << 8)
+#define SPI_CR1_SSM                     (0x1U << 9)
+#define SPI_CR2_RXDMAEN                 (0x1U << 0)
+#define SPI_CR2_TXDMAEN                 (0x1U << 1)
+#define SPI_MODE_MASTER                 (SPI_CR1_MSTR | SPI_CR1_SSI)
+#define SPI_DIRECTION_2LINES            (0x0U)
+#define SPI_DATASIZE_8BIT               (0x0U)
+#define SPI_POLARITY_LOW                (0x0U)
+#define SPI_POLARITY_HIGH               SPI_CR1_CPOL
+#define SPI_PHASE_1EDGE                 (0x0U)
+#define SPI_PHASE_2EDGE                 SPI_CR1_CPHA
+#define SPI_NSS_SOFT                    SPI_CR1_SSM
+#define SPI_BAUDRATEPRESCALER_2         (0x0U << SPI_CR1_BR_Pos)
+#define SPI_BAUDRATEPRESCALER_256       (0x7U << SPI_CR1_BR_Pos)
+#define SPI_FIRSTBIT_MSB                (0x0U)
+#define SPI_TIMODE_DISABLE              (0x0U)
+#define SPI_CRCCALCULATION_DISABLE      (0x0U)
+
+// I2C, with a flag in SR1 marked by 1 in its upper half, as in the real encoding
+#define I2C_CR1_PE                      (0x1U << 0)
+#define I2C_CR1_SWRST                   (0x1U << 15)
+#define I2C_SR2_BUSY                    (0x1U << 1)
+#define I2C_FLAG_BUSY                   (0x00100002U)
+#define I2C_DUTYCYCLE_2                 (0x0U)
+#define I2C_ADDRESSINGMODE_7BIT         (0x4000U)
+#define I2C_DUALADDRESS_DISABLE         (0x0U)
+#define I2C_GENERALCALL_DISABLE         (0x0U)
+#define I2C_NOSTRETCH_DISABLE           (0x0U)
+#define I2C_MEMADD_SIZE_8BIT            (0x1U)
+#define I2C_MEMADD_SIZE_16BIT           (0x10U)
+#define HAL_I2C_ERROR_NONE              (0x00U)
+#define HAL_I2C_ERROR_BERR              (0x01U)
+#define HAL_I2C_ERROR_ARLO              (0x02U)
+#define HAL_I2C_ERROR_AF                (0x04U)
+#define HAL_I2C_ERROR_OVR               (0x08U)
+#define HAL_I2C_ERROR_DMA               (0x10U)
+#define HAL_I2C_ERROR_TIMEOUT           (0x20U)
+
+// Flash
+#define FLASH_TYPEERASE_SECTORS         (0x0U)
+#define FLASH_VOLTAGE_RANGE_3           (0x2U)
+#define FLASH_TYPEPROGRAM_WORD          (0x2U)
+#define FLASH_FLAG_EOP                  (0x1U << 0)
+#define FLASH_FLAG_OPERR                (0x1U << 1)
+#define FLASH_FLAG_WRPERR               (0x1U << 4)
+#define FLASH_FLAG_PGAERR               (0x1U << 5)
+#define FLASH_FLAG_PGPERR               (0x1U << 6)
+#define FLASH_FLAG_PGSERR               (0x1U << 7)
+
+// ADC
+#define ADC_CR1_SCAN                    (0x1U << 8)
+#define ADC_CR1_OVRIE                   (0x1U << 26)
+#define ADC_CR2_ADON                    (0x1U << 0)
+#define ADC_CR2_DMA                     (0x1U << 8)
+#define ADC_CR2_DDS                     (0x1U << 9)
+#define ADC_CR2_EXTSEL                  (0xFU << 24)
+#define ADC_CR2_EXTEN                   (0x3U << 28)
+#define ADC_SR_OVR                      (0x1U << 5)
+#define ADC_SQR1_L                      (0xFU << 20)
+#define ADC_CHANNEL_VREFINT             (0x11U)
+#define ADC_CHANNEL_TEMPSENSOR          (0x12U | 0x10000000U)
+#define ADC_SAMPLETIME_3CYCLES          (0x0U)
+#define ADC_SAMPLETIME_15CYCLES         (0x1U)
+#define ADC_SAMPLETIME_28CYCLES         (0x2U)
+#define ADC_SAMPLETIME_56CYCLES         (0x3U)
+#define ADC_SAMPLETIME_84CYCLES         (0x4U)
+#define ADC_SAMPLETIME_112CYCLES        (0x5U)
+#define ADC_SAMPLETIME_144CYCLES        (0x6U)
+#define ADC_SAMPLETIME_480CYCLES        (0x7U)
+#define ADC_CLOCK_SYNC_PCLK_DIV4        (0x1U << 16)
+#define ADC_RESOLUTION_12B              (0x0U)
+#define ADC_DATAALIGN_RIGHT             (0x0U)
+#define ADC_EXTERNALTRIGCONVEDGE_RISING (0x1U << 28)
+#define ADC_EXTERNALTRIGCONV_T3_TRGO    (0x8U << 24)
+#define ADC_EOC_SEQ_CONV                (0x0U)
+
+// DMA
+#define DMA_CHANNEL_0                   (0x0U << 25)
+#define DMA_CHANNEL_1                   (0x1U << 25)
+#define DMA_CHANNEL_3                   (0x3U << 25)
+#define DMA_CHANNEL_4                   (0x4U << 25)
+#define DMA_CHANNEL_6                   (0x6U << 25)
+#define DMA_PERIPH_TO_MEMORY            (0x0U << 6)
+#define DMA_MEMORY_TO_PERIPH            (0x1U << 6)
+#define DMA_MEMORY_TO_MEMORY            (0x2U << 6)
+#define DMA_PINC_DISABLE                (0x0U)
+#define DMA_MINC_ENABLE                 (0x1U << 10)
+#define DMA_PDATAALIGN_BYTE             (0x0U)
+#define DMA_PDATAALIGN_HALFWORD         (0x1U << 11)
+#define DMA_PDATAALIGN_WORD             (0x2U << 11)
+#define DMA_MDATAALIGN_BYTE             (0x0U)
+#define DMA_MDATAALIGN_HALFWORD         (0x1U << 13)
+#define DMA_MDATAALIGN_WORD             (0x2U << 13)
+#define DMA_NORMAL                      (0x0U)
+#define DMA_CIRCULAR                    (0x1U << 8)
+#define DMA_PRIORITY_LOW                (0x0U)
+#define DMA_PRIORITY_MEDIUM             (0x1U << 16)
+#define DMA_PRIORITY_HIGH               (0x2U << 16)
+#define DMA_FIFOMODE_DISABLE            (0x0U)
+#define DMA_IT_HT                       (0x1U << 3)
+#define DMA_IT_TC                       (0x1U << 4)
+
+// RTC
+#define RTC_HOURFORMAT_24               (0x0U)
+#define RTC_OUTPUT_DISABLE              (0x0U)
+#define RTC_OUTPUT_POLARITY_HIGH        (0x0U)
+#define RTC_OUTPUT_TYPE_OPENDRAIN       (0x0U)
+#define RTC_FORMAT_BIN                  (0x0U)
+#define RTC_WAKEUPCLOCK_RTCCLK_DIV2     (0x3U)
+#define RTC_FLAG_WUTF                   (0x1U << 10)
+
+/***********************************************************************************************************************
+ * ENUMS, STRUCTS, UNIONS, TYPEDEFS
+ **********************************************************************************************************************/
+typedef enum
+{
+    RTC_WKUP_IRQn           = 3,
+    EXTI3_IRQn              = 9,
+    DMA1_Stream0_IRQn       = 11,
+    DMA1_Stream2_IRQn       = 13,
+    DMA1_Stream5_IRQn       = 16,
+    DMA1_Stream6_IRQn       = 17,
+    ADC_IRQn                = 18,
+    TIM2_IRQn               = 28,
+    TIM4_IRQn               = 30,
+    I2C1_EV_IRQn            = 31,
+    I2C1_ER_IRQn            = 32,
+    SPI1_IRQn               = 35,
+    USART2_IRQn             = 38,
+    EXTI15_10_IRQn          = 40,
+    TIM5_IRQn               = 50,
+    DMA2_Stream2_IRQn       = 58,
+    DMA2_Stream3_IRQn       = 59,
+    DMA2_Stream4_IRQn       = 60,
+    I2C3_EV_IRQn            = 72,
+    I2C3_ER_IRQn            = 73,
+    SIM_IRQn_MAX            = 85,
+} IRQn_Type;
+
+typedef enum
+{
+    HAL_OK                  = 0x00U,
+    HAL_ERROR               = 0x01U,
+    HAL_BUSY                = 0x02U,
+    HAL_TIMEOUT             = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+    RESET                   = 0U,
+    SET                     = !RESET
+} FlagStatus, ITStatus;
+
+typedef enum
+{
+    DISABLE                 = 0U,
+    ENABLE                  = !DISABLE
+} FunctionalState;
+
+typedef enum
+{
+    GPIO_PIN_RESET          = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+// Registers, as laid out in the reference manual
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+    volatile uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+    volatile uint32_t DHCSR;
+    volatile uint32_t DCRSR;
+    volatile uint32_t DCRDR;
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct
+{
+    volatile uint32_t CR;
+    volatile uint32_t PLLCFGR;
+    volatile uint32_t CFGR;
+} RCC_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t MODER;
+    volatile uint32_t OTYPER;
+    volatile uint32_t OSPEEDR;
+    volatile uint32_t PUPDR;
+    volatile uint32_t IDR;
+    volatile uint32_t ODR;
+    volatile uint32_t BSRR;
+    volatile uint32_t LCKR;
+    volatile uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t IMR;
+    volatile uint32_t EMR;
+    volatile uint32_t RTSR;
+    volatile uint32_t FTSR;
+    volatile uint32_t SWIER;
+    volatile uint32_t PR;
+} EXTI_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t MEMRMP;
+    volatile uint32_t PMC;
+    volatile uint32_t EXTICR[4];
+} SYSCFG_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t CR1;
+    volatile uint32_t CR2;
+    volatile uint32_t SMCR;
+    volatile uint32_t DIER;
+    volatile uint32_t SR;
+    volatile uint32_t EGR;
+    volatile uint32_t CCMR1;
+    volatile uint32_t CCMR2;
+    volatile uint32_t CCER;
+    volatile uint32_t CNT;
+    volatile uint32_t PSC;
+    volatile uint32_t ARR;
+    volatile uint32_t RCR;
+    volatile uint32_t CCR1;
+    volatile uint32_t CCR2;
+    volatile uint32_t CCR3;
+    volatile uint32_t CCR4;
+    volatile uint32_t BDTR;
+    volatile uint32_t DCR;
+    volatile uint32_t DMAR;
+    volatile uint32_t OR;
+} TIM_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t SR;
+    volatile uint32_t DR;
+    volatile uint32_t BRR;
+    volatile uint32_t CR1;
+    volatile uint32_t CR2;
+    volatile uint32_t CR3;
+    volatile uint32_t GTPR;
+} USART_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t CR1;
+    volatile uint32_t CR2;
+    volatile uint32_t SR;
+    volatile uint32_t DR;
+} SPI_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t CR1;
+    volatile uint32_t CR2;
+    volatile uint32_t OAR1;
+    volatile uint32_t OAR2;
+    volatile uint32_t DR;
+    volatile uint32_t SR1;
+    volatile uint32_t SR2;
+    volatile uint32_t CCR;
+    volatile uint32_t TRISE;
+    volatile uint32_t FLTR;
+} I2C_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t SR;
+    volatile uint32_t CR1;
+    volatile uint32_t CR2;
+    volatile uint32_t SMPR1;
+    volatile uint32_t SMPR2;
+    volatile uint32_t JOFR1;
+    volatile uint32_t JOFR2;
+    volatile uint32_t JOFR3;
+    volatile uint32_t JOFR4;
+    volatile uint32_t HTR;
+    volatile uint32_t LTR;
+    volatile uint32_t SQR1;
+    volatile uint32_t SQR2;
+    volatile uint32_t SQR3;
+    volatile uint32_t JSQR;
+    volatile uint32_t JDR1;
+    volatile uint32_t JDR2;
+    volatile uint32_t JDR3;
+    volatile uint32_t JDR4;
+    volatile uint32_t DR;
+} ADC_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t CR;
+    volatile uint32_t NDTR;
+    volatile uint32_t PAR;
+    volatile uint32_t M0AR;
+    volatile uint32_t M1AR;
+    volatile uint32_t FCR;
+} DMA_Stream_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t TR;
+    volatile uint32_t DR;
+    volatile uint32_t CR;
+    volatile uint32_t ISR;
+} RTC_TypeDef;
+
+// RCC
+typedef struct
+{
+    uint32_t PLLState;
+    uint32_t PLLSource;
+    uint32_t PLLM;
+    uint32_t PLLN;
+    uint32_t PLLP;
+    uint32_t PLLQ;
+} RCC_PLLInitTypeDef;
+
+typedef struct
+{
+    uint32_t OscillatorType;
+    uint32_t HSEState;
+    uint32_t LSEState;
+    uint32_t HSIState;
+    uint32_t HSICalibrationValue;
+    uint32_t LSIState;
+    RCC_PLLInitTypeDef PLL;
+} RCC_OscInitTypeDef;
+
+typedef struct
+{
+    uint32_t ClockType;
+    uint32_t SYSCLKSource;
+    uint32_t AHBCLKDivider;
+    uint32_t APB1CLKDivider;
+    uint32_t APB2CLKDivider;
+} RCC_ClkInitTypeDef;
+
+typedef struct
+{
+    uint32_t PeriphClockSelection;
+    uint32_t RTCClockSelection;
+} RCC_PeriphCLKInitTypeDef;
+
+// GPIO and EXTI
+typedef struct
+{
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+typedef enum
+{
+    HAL_EXTI_COMMON_CB_ID   = 0x00U
+} EXTI_CallbackIDTypeDef;
+
+typedef struct
+{
+    uint32_t Line;
+    void (* PendingCallback)(void);
+} EXTI_HandleTypeDef;
+
+typedef struct
+{
+    uint32_t Line;
+    uint32_t Mode;
+    uint32_t Trigger;
+    uint32_t GPIOSel;
+} EXTI_ConfigTypeDef;
+
+// TIM
+typedef enum
+{
+    HAL_TIM_STATE_RESET     = 0x00U,
+    HAL_TIM_STATE_READY     = 0x01U,
+    HAL_TIM_STATE_BUSY      = 0x02U
+} HAL_TIM_StateTypeDef;
+
+typedef enum
+{
+    HAL_TIM_ACTIVE_CHANNEL_1        = 0x01U,
+    HAL_TIM_ACTIVE_CHANNEL_2        = 0x02U,
+    HAL_TIM_ACTIVE_CHANNEL_3        = 0x04U,
+    HAL_TIM_ACTIVE_CHANNEL_4        = 0x08U,
+    HAL_TIM_ACTIVE_CHANNEL_CLEARED  = 0x00U
+} HAL_TIM_ActiveChannel;
+
+typedef struct
+{
+    uint32_t Prescaler;
+    uint32_t CounterMode;
+    uint32_t Period;
+    uint32_t ClockDivision;
+    uint32_t RepetitionCounter;
+    uint32_t AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef struct
+{
+    TIM_TypeDef *Instance;
+    TIM_Base_InitTypeDef Init;
+    HAL_TIM_ActiveChannel Channel;
+    volatile HAL_TIM_StateTypeDef State;
+} TIM_HandleTypeDef;
+
+typedef struct
+{
+    uint32_t OCMode;
+    uint32_t Pulse;
+    uint32_t OCPolarity;
+    uint32_t OCNPolarity;
+    uint32_t OCFastMode;
+    uint32_t OCIdleState;
+    uint32_t OCNIdleState;
+} TIM_OC_InitTypeDef;
+
+typedef struct
+{
+    uint32_t MasterOutputTrigger;
+    uint32_t MasterSlaveMode;
+} TIM_MasterConfigTypeDef;
+
+// DMA
+typedef enum
+{
+    HAL_DMA_STATE_RESET     = 0x00U,
+    HAL_DMA_STATE_READY     = 0x01U,
+    HAL_DMA_STATE_BUSY      = 0x02U
+} HAL_DMA_StateTypeDef;
+
+typedef struct
+{
+    uint32_t Channel;
+    uint32_t Direction;
+    uint32_t PeriphInc;
+    uint32_t MemInc;
+    uint32_t PeriphDataAlignment;
+    uint32_t MemDataAlignment;
+    uint32_t Mode;
+    uint32_t Priority;
+    uint32_t FIFOMode;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef
+{
+    DMA_Stream_TypeDef *Instance;
+    DMA_InitTypeDef Init;
+    volatile HAL_DMA_StateTypeDef State;
+    void *Parent;
+    void (* XferCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+    void (* XferHalfCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+    void (* XferErrorCallback)(struct __DMA_HandleTypeDef *hdma);
+} DMA_HandleTypeDef;
+
+// UART
+typedef enum
+{
+    HAL_UART_STATE_RESET    = 0x00U,
+    HAL_UART_STATE_READY    = 0x20U,
+    HAL_UART_STATE_BUSY_TX  = 0x21U,
+    HAL_UART_STATE_BUSY_RX  = 0x22U
+} HAL_UART_StateTypeDef;
+
+typedef struct
+{
+    uint32_t BaudRate;
+    uint32_t WordLength;
+    uint32_t StopBits;
+    uint32_t Parity;
+    uint32_t Mode;
+    uint32_t HwFlowCtl;
+    uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef struct
+{
+    USART_TypeDef *Instance;
+    UART_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    volatile HAL_UART_StateTypeDef gState;
+    volatile HAL_UART_StateTypeDef RxState;
+} UART_HandleTypeDef;
+
+// SPI
+typedef enum
+{
+    HAL_SPI_STATE_RESET     = 0x00U,
+    HAL_SPI_STATE_READY     = 0x01U,
+    HAL_SPI_STATE_BUSY      = 0x02U
+} HAL_SPI_StateTypeDef;
+
+typedef struct
+{
+    uint32_t Mode;
+    uint32_t Direction;
+    uint32_t DataSize;
+    uint32_t CLKPolarity;
+    uint32_t CLKPhase;
+    uint32_t NSS;
+    uint32_t BaudRatePrescaler;
+    uint32_t FirstBit;
+    uint32_t TIMode;
+    uint32_t CRCCalculation;
+    uint32_t CRCPolynomial;
+} SPI_InitTypeDef;
+
+typedef struct
+{
+    SPI_TypeDef *Instance;
+    SPI_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    volatile HAL_SPI_StateTypeDef State;
+    volatile uint32_t ErrorCode;
+} SPI_HandleTypeDef;
+
+// I2C
+typedef enum
+{
+    HAL_I2C_STATE_RESET     = 0x00U,
+    HAL_I2C_STATE_READY     = 0x20U,
+    HAL_I2C_STATE_BUSY_TX   = 0x21U,
+    HAL_I2C_STATE_BUSY_RX   = 0x22U
+} HAL_I2C_StateTypeDef;
+
+typedef struct
+{
+    uint32_t ClockSpeed;
+    uint32_t DutyCycle;
+    uint32_t OwnAddress1;
+    uint32_t AddressingMode;
+    uint32_t DualAddressMode;
+    uint32_t OwnAddress2;
+    uint32_t GeneralCallMode;
+    uint32_t NoStretchMode;
+} I2C_InitTypeDef;
+
+typedef struct
+{
+    I2C_TypeDef *Instance;
+    I2C_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    volatile HAL_I2C_StateTypeDef State;
+    volatile uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+// Flash
+typedef struct
+{
+    uint32_t TypeErase;
+    uint32_t Banks;
+    uint32_t Sector;
+    uint32_t NbSectors;
+    uint32_t VoltageRange;
+} FLASH_EraseInitTypeDef;
+
+// ADC
+typedef enum
+{
+    HAL_ADC_STATE_RESET     = 0x00U,
+    HAL_ADC_STATE_READY     = 0x01U,
+    HAL_ADC_STATE_BUSY      = 0x02U
+} HAL_ADC_StateTypeDef;
+
+typedef struct
+{
+    uint32_t ClockPrescaler;
+    uint32_t Resolution;
+    uint32_t DataAlign;
+    uint32_t ScanConvMode;
+    uint32_t EOCSelection;
+    FunctionalState ContinuousConvMode;
+    uint32_t NbrOfConversion;
+    FunctionalState DiscontinuousConvMode;
+    uint32_t NbrOfDiscConversion;
+    uint32_t ExternalTrigConv;
+    uint32_t ExternalTrigConvEdge;
+    FunctionalState DMAContinuousRequests;
+} ADC_InitTypeDef;
+
+typedef struct
+{
+    uint32_t Channel;
+    uint32_t Rank;
+    uint32_t SamplingTime;
+    uint32_t Offset;
+} ADC_ChannelConfTypeDef;
+
+typedef struct
+{
+    ADC_TypeDef *Instance;
+    ADC_InitTypeDef Init;
+    DMA_HandleTypeDef *DMA_Handle;
+    volatile HAL_ADC_StateTypeDef State;
+    volatile uint32_t ErrorCode;
+} ADC_HandleTypeDef;
+
+// RTC
+typedef struct
+{
+    uint32_t HourFormat;
+    uint32_t AsynchPrediv;
+    uint32_t SynchPrediv;
+    uint32_t OutPut;
+    uint32_t OutPutPolarity;
+    uint32_t OutPutType;
+} RTC_InitTypeDef;
+
+typedef struct
+{
+    RTC_TypeDef *Instance;
+    RTC_InitTypeDef Init;
+} RTC_HandleTypeDef;
+
+typedef struct
+{
+    uint8_t Hours;
+    uint8_t Minutes;
+    uint8_t Seconds;
+    uint32_t SubSeconds;
+    uint32_t SecondFraction;
+} RTC_TimeTypeDef;
+
+typedef struct
+{
+    uint8_t WeekDay;
+    uint8_t Month;
+    uint8_t Date;
+    uint8_t Year;
+} RTC_DateTypeDef;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+extern uint32_t SystemCoreClock;
+extern volatile uint32_t uwTick;
+extern uint32_t uwTickPrio;
+
+extern SysTick_Type hal_sim_systick;
+extern CoreDebug_Type hal_sim_core_debug;
+extern RCC_TypeDef hal_sim_rcc;
+extern GPIO_TypeDef hal_sim_gpioa;
+extern GPIO_TypeDef hal_sim_gpiob;
+extern GPIO_TypeDef hal_sim_gpioc;
+extern EXTI_TypeDef hal_sim_exti;
+extern SYSCFG_TypeDef hal_sim_syscfg;
+extern TIM_TypeDef hal_sim_tim1;
+extern TIM_TypeDef hal_sim_tim2;
+extern TIM_TypeDef hal_sim_tim3;
+extern TIM_TypeDef hal_sim_tim4;
+extern TIM_TypeDef hal_sim_tim5;
+extern USART_TypeDef hal_sim_usart2;
+extern SPI_TypeDef hal_sim_spi1;
+extern I2C_TypeDef hal_sim_i2c1;
+extern I2C_TypeDef hal_sim_i2c3;
+extern DMA_Stream_TypeDef hal_sim_dma1_stream0;
+extern DMA_Stream_TypeDef hal_sim_dma1_stream2;
+extern DMA_Stream_TypeDef hal_sim_dma1_stream5;
+extern DMA_Stream_TypeDef hal_sim_dma1_stream6;
+extern DMA_Stream_TypeDef hal_sim_dma2_stream2;
+extern DMA_Stream_TypeDef hal_sim_dma2_stream3;
+extern DMA_Stream_TypeDef hal_sim_dma2_stream4;
+extern DMA_Stream_TypeDef hal_sim_dma2_stream5;
+extern ADC_TypeDef hal_sim_adc1;
+extern RTC_TypeDef hal_sim_rtc;
+extern uint8_t hal_sim_flash[];
+
+/***********************************************************************************************************************
+ * MACROS
+ **********************************************************************************************************************/
+#define SysTick                         (&hal_sim_systick)
+#define CoreDebug                       (&hal_sim_core_debug)
+// The cycle counter is refreshed from the host clock on every access, see hal_sim_dwt()
+#define DWT                             (hal_sim_dwt())
+#define RCC                             (&hal_sim_rcc)
+// A BSRR write takes effect at the next access to the port or before time moves on, see hal_sim_gpio()
+#define GPIOA                           (hal_sim_gpio(&hal_sim_gpioa))
+#define GPIOB                           (hal_sim_gpio(&hal_sim_gpiob))
+#define GPIOC                           (hal_sim_gpio(&hal_sim_gpioc))
+#define EXTI                            (&hal_sim_exti)
+#define SYSCFG                          (&hal_sim_syscfg)
+#define TIM1                            (&hal_sim_tim1)
+#define TIM2                            (&hal_sim_tim2)
+#define TIM3                            (&hal_sim_tim3)
+#define TIM4                            (&hal_sim_tim4)
+#define TIM5                            (&hal_sim_tim5)
+#define USART2                          (&hal_sim_usart2)
+#define SPI1                            (&hal_sim_spi1)
+#define I2C1                            (&hal_sim_i2c1)
+#define I2C3                            (&hal_sim_i2c3)
+#define DMA1_Stream0                    (&hal_sim_dma1_stream0)
+#define DMA1_Stream2                    (&hal_sim_dma1_stream2)
+#define DMA1_Stream5                    (&hal_sim_dma1_stream5)
+#define DMA1_Stream6                    (&hal_sim_dma1_stream6)
+#define DMA2_Stream2                    (&hal_sim_dma2_stream2)
+#define DMA2_Stream3                    (&hal_sim_dma2_stream3)
+#define DMA2_Stream4                    (&hal_sim_dma2_stream4)
+#define DMA2_Stream5                    (&hal_sim_dma2_stream5)
+#define ADC1                            (&hal_sim_adc1)
+#define RTC                             (&hal_sim_rtc)
+// The flash array lies below 4 GiB in the non-PIE host build, so its address fits the 32-bit flash addresses
+#define FLASH_BASE                      ((uint32_t) (uintptr_t) hal_sim_flash)
+
+// Clock gating and power configuration have nothing to simulate
+#define __HAL_RCC_PWR_CLK_ENABLE()
+#define __HAL_RCC_SYSCFG_CLK_ENABLE()
+#define __HAL_RCC_GPIOA_CLK_ENABLE()
+#define __HAL_RCC_GPIOA_CLK_DISABLE()
+#define __HAL_RCC_GPIOB_CLK_ENABLE()
+#define __HAL_RCC_GPIOC_CLK_ENABLE()
+#define __HAL_RCC_GPIOC_CLK_DISABLE()
+#define __HAL_RCC_TIM1_CLK_ENABLE()
+#define __HAL_RCC_TIM2_CLK_ENABLE()
+#define __HAL_RCC_TIM3_CLK_ENABLE()
+#define __HAL_RCC_TIM4_CLK_ENABLE()
+#define __HAL_RCC_TIM5_CLK_ENABLE()
+#define __HAL_RCC_USART2_CLK_ENABLE()
+#define __HAL_RCC_SPI1_CLK_ENABLE()
+#define __HAL_RCC_I2C1_CLK_ENABLE()
+#define __HAL_RCC_I2C3_CLK_ENABLE()
+#define __HAL_RCC_USART2_FORCE_RESET()
+#define __HAL_RCC_USART2_RELEASE_RESET()
+#define __HAL_RCC_DMA1_CLK_ENABLE()
+#define __HAL_RCC_DMA2_CLK_ENABLE()
+#define __HAL_RCC_ADC1_CLK_ENABLE()
+#define __HAL_RCC_RTC_ENABLE()
+#define __HAL_PWR_VOLTAGESCALING_CONFIG(__REGULATOR__)
+
+#define __HAL_LINKDMA(__HANDLE__, __PPP_DMA_FIELD__, __DMA_HANDLE__) \
+    do { \
+        (__HANDLE__)->__PPP_DMA_FIELD__ = &(__DMA_HANDLE__); \
+        (__DMA_HANDLE__).Parent = (__HANDLE__); \
+    } while (0)
+
+#define __HAL_TIM_GET_COUNTER(__HANDLE__)               ((__HANDLE__)->Instance->CNT)
+#define __HAL_TIM_SET_COUNTER(__HANDLE__, __COUNTER__)  ((__HANDLE__)->Instance->CNT = (__COUNTER__))
+#define __HAL_TIM_SET_PRESCALER(__HANDLE__, __PRESC__)  ((__HANDLE__)->Instance->PSC = (__PRESC__))
+#define __HAL_TIM_SET_AUTORELOAD(__HANDLE__, __AUTORELOAD__) \
+    do { \
+        (__HANDLE__)->Instance->ARR = (__AUTORELOAD__); \
+        (__HANDLE__)->Init.Period = (__AUTORELOAD__); \
+    } while (0)
+#define __HAL_TIM_ENABLE(__HANDLE__)                    ((__HANDLE__)->Instance->CR1 |= TIM_CR1_CEN)
+#define __HAL_TIM_DISABLE(__HANDLE__)                   ((__HANDLE__)->Instance->CR1 &= ~TIM_CR1_CEN)
+#define __HAL_TIM_SET_COMPARE(__HANDLE__, __CHANNEL__, __COMPARE__) \
+    (*(&((__HANDLE__)->Instance->CCR1) + ((__CHANNEL__) >> 2)) = (__COMPARE__))
+#define __HAL_TIM_GET_COMPARE(__HANDLE__, __CHANNEL__) \
+    (*(&((__HANDLE__)->Instance->CCR1) + ((__CHANNEL__) >> 2)))
+#define __HAL_TIM_GET_FLAG(__HANDLE__, __FLAG__) \
+    ((((__HANDLE__)->Instance->SR & (__FLAG__)) == (__FLAG__)) ? SET : RESET)
+#define __HAL_TIM_CLEAR_FLAG(__HANDLE__, __FLAG__)      ((__HANDLE__)->Instance->SR &= ~(__FLAG__))
+#define __HAL_TIM_ENABLE_IT(__HANDLE__, __INTERRUPT__)  ((__HANDLE__)->Instance->DIER |= (__INTERRUPT__))
+#define __HAL_TIM_DISABLE_IT(__HANDLE__, __INTERRUPT__) ((__HANDLE__)->Instance->DIER &= ~(__INTERRUPT__))
+#define __HAL_TIM_GET_IT_SOURCE(__HANDLE__, __INTERRUPT__) \
+    ((((__HANDLE__)->Instance->DIER & (__INTERRUPT__)) == (__INTERRUPT__)) ? SET : RESET)
+#define __HAL_TIM_URS_ENABLE(__HANDLE__)                ((__HANDLE__)->Instance->CR1 |= TIM_CR1_URS)
+#define __HAL_TIM_ENABLE_DMA(__HANDLE__, __DMA__)       ((__HANDLE__)->Instance->DIER |= (__DMA__))
+#define __HAL_TIM_DISABLE_DMA(__HANDLE__, __DMA__)      ((__HANDLE__)->Instance->DIER &= ~(__DMA__))
+
+#define __HAL_UART_GET_FLAG(__HANDLE__, __FLAG__)       (((__HANDLE__)->Instance->SR & (__FLAG__)) == (__FLAG__))
+
+#define __HAL_SPI_ENABLE(__HANDLE__)                    ((__HANDLE__)->Instance->CR1 |= SPI_CR1_SPE)
+#define __HAL_SPI_DISABLE(__HANDLE__)                   ((__HANDLE__)->Instance->CR1 &= ~SPI_CR1_SPE)
+
+#define __HAL_I2C_DISABLE(__HANDLE__)                   ((__HANDLE__)->Instance->CR1 &= ~I2C_CR1_PE)
+#define __HAL_I2C_GET_FLAG(__HANDLE__, __FLAG__) \
+    ((((((__FLAG__) >> 16) == 1U) ? (__HANDLE__)->Instance->SR1 : (__HANDLE__)->Instance->SR2) & \
+      ((__FLAG__) & 0xFFFFU)) != 0 ? SET : RESET)
+
+// The flash status flags are not simulated; operations report failure through their return value instead
+#define __HAL_FLASH_CLEAR_FLAG(__FLAG__)
+
+#define __HAL_GPIO_EXTI_GET_IT(__EXTI_LINE__)           (EXTI->PR & (__EXTI_LINE__))
+#define __HAL_GPIO_EXTI_CLEAR_IT(__EXTI_LINE__)         (EXTI->PR &= ~(__EXTI_LINE__))
+
+#define __HAL_RTC_WRITEPROTECTION_DISABLE(__HANDLE__)
+#define __HAL_RTC_WRITEPROTECTION_ENABLE(__HANDLE__)
+#define __HAL_RTC_WAKEUPTIMER_GET_FLAG(__HANDLE__, __FLAG__)    ((__HANDLE__)->Instance->ISR & (__FLAG__))
+#define __HAL_RTC_WAKEUPTIMER_CLEAR_FLAG(__HANDLE__, __FLAG__)  ((__HANDLE__)->Instance->ISR &= ~(__FLAG__))
+#define __HAL_RTC_WAKEUPTIMER_EXTI_CLEAR_FLAG()
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+// CMSIS core intrinsics; interrupts are only taken where they are unmasked and in __WFI()
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+uint32_t __get_IPSR(void);
+void __WFI(void);
+DWT_Type *hal_sim_dwt(void);
+GPIO_TypeDef *hal_sim_gpio(GPIO_TypeDef *port);
+
+// HAL
+HAL_StatusTypeDef HAL_Init(void);
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority);
+void HAL_MspInit(void);
+void HAL_MspDeInit(void);
+void HAL_IncTick(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+void HAL_SuspendTick(void);
+void HAL_ResumeTick(void);
+void HAL_DBGMCU_EnableDBGStopMode(void);
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_SetPendingIRQ(IRQn_Type IRQn);
+uint32_t HAL_NVIC_GetPendingIRQ(IRQn_Type IRQn);
+void HAL_NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency);
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+uint32_t HAL_RCC_GetPCLK2Freq(void);
+
+void HAL_PWR_EnableBkUpAccess(void);
+void HAL_PWR_EnterSTOPMode(uint32_t Regulator, uint8_t STOPEntry);
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+
+HAL_StatusTypeDef HAL_EXTI_SetConfigLine(EXTI_HandleTypeDef *hexti, EXTI_ConfigTypeDef *pExtiConfig);
+HAL_StatusTypeDef HAL_EXTI_RegisterCallback(EXTI_HandleTypeDef *hexti,
+                                            EXTI_CallbackIDTypeDef CallbackID,
+                                            void (*pPendingCbfn)(void));
+uint32_t HAL_EXTI_GetPending(EXTI_HandleTypeDef *hexti, uint32_t Edge);
+void HAL_EXTI_IRQHandler(EXTI_HandleTypeDef *hexti);
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_DeInit(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim);
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim);
+void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *htim);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+void HAL_TIM_PWM_MspInit(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim,
+                                                        TIM_MasterConfigTypeDef *sMasterConfig);
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig);
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length);
+HAL_StatusTypeDef HAL_ADC_Stop_DMA(ADC_HandleTypeDef *hadc);
+void HAL_ADC_IRQHandler(ADC_HandleTypeDef *hadc);
+void HAL_ADC_MspInit(ADC_HandleTypeDef *hadc);
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc);
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc);
+void HAL_ADC_ErrorCallback(ADC_HandleTypeDef *hadc);
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma);
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma);
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress, uint32_t DataLength);
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress,
+                                   uint32_t DataLength);
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma);
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma);
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart);
+void HAL_UART_MspInit(UART_HandleTypeDef *huart);
+void HAL_UART_MspDeInit(UART_HandleTypeDef *huart);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData,
+                                              uint16_t Size);
+void HAL_SPI_IRQHandler(SPI_HandleTypeDef *hspi);
+void HAL_SPI_MspInit(SPI_HandleTypeDef *hspi);
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                      uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+void HAL_I2C_EV_IRQHandler(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ER_IRQHandler(I2C_HandleTypeDef *hi2c);
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MspInit(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError);
+
+HAL_StatusTypeDef HAL_RTC_Init(RTC_HandleTypeDef *hrtc);
+void HAL_RTC_MspInit(RTC_HandleTypeDef *hrtc);
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_WaitForSynchro(RTC_HandleTypeDef *hrtc);
+HAL_StatusTypeDef HAL_RTCEx_SetWakeUpTimer_IT(RTC_HandleTypeDef *hrtc, uint32_t WakeUpCounter, uint32_t WakeUpClock);
+HAL_StatusTypeDef HAL_RTCEx_DeactivateWakeUpTimer(RTC_HandleTypeDef *hrtc);
+void HAL_RTCEx_WakeUpTimerIRQHandler(RTC_HandleTypeDef *hrtc);
+
+/**********************************************************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STM32F4XX_HAL_H
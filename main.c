@@ -20,28 +20,168 @@
  * INCLUDES
  **********************************************************************************************************************/
 #include "bsp.h"
+#include "bsp_adc.h"
+#include "bsp_board.h"
+#include "bsp_event.h"
+#include "bsp_i2c.h"
+#include "bsp_irq_prof.h"
+#include "bsp_kv.h"
+#include "bsp_led.h"
+#include "bsp_log.h"
+#include "bsp_prof.h"
+#include "bsp_spi.h"
+#include "bsp_task.h"
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 /***********************************************************************************************************************
  * LOCAL LITERAL SUBSTITUTIONS
  **********************************************************************************************************************/
 #define APP_STATE_BLINK_LONG_ON     (0)
 #define APP_STATE_BLINK_LONG_OFF    (1)
-#define APP_STATE_MAX               (2)
+#define APP_STATE_BREATHE           (2)
+#define APP_STATE_MAX               (3)
 
-#define APP_LD2_SHORT_DELAY_MS      (150)
-#define APP_LD2_LONG_DELAY_MS       (650)
+#define APP_LD2_FIRST_DELAY_MS      (500)
+
+// Blinks are 650 ms one way and 150 ms the other, in 50 ms steps
+#define APP_LD2_BLINK_STEP_MS       (50)
+#define APP_LD2_BLINK_STEPS         (16)
+#define APP_LD2_BLINK_LONG_STEPS    (13)
+
+// One 2 s breath, with the PWM at 500 Hz to keep the dimmest steps from flickering
+#define APP_LD2_BREATHE_STEP_MS     (20)
+#define APP_LD2_BREATHE_STEPS       (100)
+#define APP_LD2_BREATHE_PERIOD_US   (2000)
+
+#define APP_IRQ_PROF_DUMP_CHAR      ('?')
+#define APP_ADC_TOGGLE_CHAR         ('a')
+#define APP_SPI_TEST_CHAR           ('s')
+#define APP_I2C_TEST_CHAR           ('i')
+#define APP_KV_TEST_CHAR            ('k')
+
+// VREFINT and the temperature sensor, averaged over 500 ms blocks of 1 kHz scans
+#define APP_ADC_CHANNELS            (2)
+#define APP_ADC_SCAN_RATE_HZ        (1000)
+#define APP_ADC_BLOCK_SCANS         (500)
+
+// Typical values from the datasheet; the factory calibration words would do better
+#define APP_ADC_VREFINT_MV          (1210)
+#define APP_ADC_TEMP_V25_MV         (760)
+#define APP_ADC_TEMP_DECI_C_PER_MV  (4)
+
+// 256 KiB through SPI1 at up to 21 MHz, as 1 KiB transfers kept BSP_SPI_QUEUE_LEN deep; MISO must be jumpered to MOSI
+#define APP_SPI_HZ                  (21000000)
+#define APP_SPI_XFER_BYTES          (1024)
+#define APP_SPI_XFERS               (256)
+
+// One job to a register-file target on I2C1, e.g. an MPU-6050 breakout: check WHO_AM_I, write a block of registers
+// and read it back, then read the first 32 registers by DMA
+#define APP_I2C_ADDR                (0x68)
+#define APP_I2C_WHO_AM_I_REG        (0x75)
+#define APP_I2C_SCRATCH_REG         (0x10)
+#define APP_I2C_SCRATCH_LEN         (8)
+#define APP_I2C_DUMP_LEN            (32)
+
+// A boot counter in the key/value store, and a burst of 64-byte settings spread over 16 keys to exercise compaction
+#define APP_KV_BOOTS_KEY            (0x0001)
+#define APP_KV_SETTINGS_KEY         (0x0100)
+#define APP_KV_SETTINGS_KEYS        (16)
+#define APP_KV_SETTINGS_LEN         (64)
+#define APP_KV_WRITES               (256)
+
+#define APP_SIGNAL_PB_PRESSED       (1 << 0)
+#define APP_SIGNAL_GETCHAR          (1 << 1)
+#define APP_SIGNAL_ADC_BLOCK        (1 << 2)
+#define APP_SIGNAL_ADC_FAIL         (1 << 3)
+#define APP_SIGNAL_SPI_DONE         (1 << 4)
+#define APP_SIGNAL_I2C_DONE         (1 << 5)
 
 /***********************************************************************************************************************
  * LOCAL VARIABLES
  **********************************************************************************************************************/
-static volatile bool app_pb_pressed = false;
-static volatile bool app_timeout = false;
-static volatile bool app_getchar = false;
-static bool app_ld2_state_on = false;
 static uint32_t app_state = 0;
 
+static const uint32_t app_ld2_long_on_duty[APP_LD2_BLINK_STEPS] =
+{
+    [0 ... (APP_LD2_BLINK_LONG_STEPS - 1)] = BSP_LED_ON,
+    [APP_LD2_BLINK_LONG_STEPS ... (APP_LD2_BLINK_STEPS - 1)] = BSP_LED_OFF,
+};
+
+static const uint32_t app_ld2_long_off_duty[APP_LD2_BLINK_STEPS] =
+{
+    [0 ... (APP_LD2_BLINK_STEPS - APP_LD2_BLINK_LONG_STEPS - 1)] = BSP_LED_ON,
+    [(APP_LD2_BLINK_STEPS - APP_LD2_BLINK_LONG_STEPS) ... (APP_LD2_BLINK_STEPS - 1)] = BSP_LED_OFF,
+};
+
+// Filled in by main()
+static uint32_t app_ld2_breathe_duty[APP_LD2_BREATHE_STEPS];
+
+static const bsp_led_pattern_t app_ld2_patterns[APP_STATE_MAX] =
+{
+    [APP_STATE_BLINK_LONG_ON] =
+    {
+        .duty = app_ld2_long_on_duty,
+        .count = APP_LD2_BLINK_STEPS,
+        .step_ms = APP_LD2_BLINK_STEP_MS,
+    },
+    [APP_STATE_BLINK_LONG_OFF] =
+    {
+        .duty = app_ld2_long_off_duty,
+        .count = APP_LD2_BLINK_STEPS,
+        .step_ms = APP_LD2_BLINK_STEP_MS,
+    },
+    [APP_STATE_BREATHE] =
+    {
+        .duty = app_ld2_breathe_duty,
+        .count = APP_LD2_BREATHE_STEPS,
+        .step_ms = APP_LD2_BREATHE_STEP_MS,
+        .period_us = APP_LD2_BREATHE_PERIOD_US,
+    },
+};
+
+static const uint8_t app_adc_channels[APP_ADC_CHANNELS] = {BSP_ADC_CHANNEL_VREFINT, BSP_ADC_CHANNEL_TEMP};
+static uint16_t app_adc_buffer[2 * APP_ADC_BLOCK_SCANS * APP_ADC_CHANNELS];
+static bool app_adc_streaming = false;
+
+// Per-channel sums of the last block, written by app_adc_block_callback()
+static volatile uint32_t app_adc_sum[APP_ADC_CHANNELS];
+
+static bsp_spi_dev_t app_spi_dev;
+static uint8_t app_spi_tx[APP_SPI_XFER_BYTES];
+static uint8_t app_spi_rx[BSP_SPI_QUEUE_LEN][APP_SPI_XFER_BYTES];
+static uint32_t app_spi_start_ms;
+
+// Transfers queued and completed by the test, and how many read back something other than they sent
+static volatile uint32_t app_spi_queued = 0;
+static volatile uint32_t app_spi_done = 0;
+static volatile uint32_t app_spi_bad = 0;
+
+static bsp_i2c_dev_t app_i2c_dev;
+static uint8_t app_i2c_who_am_i;
+static uint8_t app_i2c_tx[APP_I2C_SCRATCH_LEN];
+static uint8_t app_i2c_rx[APP_I2C_SCRATCH_LEN];
+static uint8_t app_i2c_dump[APP_I2C_DUMP_LEN];
+static const bsp_i2c_op_t app_i2c_ops[] =
+{
+    { .reg = APP_I2C_WHO_AM_I_REG, .dir = BSP_I2C_OP_READ, .len = 1, .data = &app_i2c_who_am_i },
+    { .reg = APP_I2C_SCRATCH_REG, .dir = BSP_I2C_OP_WRITE, .len = APP_I2C_SCRATCH_LEN, .data = app_i2c_tx },
+    { .reg = APP_I2C_SCRATCH_REG, .dir = BSP_I2C_OP_READ, .len = APP_I2C_SCRATCH_LEN, .data = app_i2c_rx },
+    { .reg = 0, .dir = BSP_I2C_OP_READ, .len = APP_I2C_DUMP_LEN, .data = app_i2c_dump },
+};
+static volatile uint32_t app_i2c_status;
+static uint32_t app_i2c_start_ms;
+
+static uint32_t app_kv_boots = 0;
+static uint32_t app_kv_load_cycles = 0;
+
+static bsp_task_t app_pb_task;
+static bsp_task_t app_console_task;
+static bsp_task_t app_adc_task;
+static bsp_task_t app_spi_task;
+static bsp_task_t app_i2c_task;
+
 /***********************************************************************************************************************
  * GLOBAL VARIABLES
  **********************************************************************************************************************/
@@ -53,7 +193,7 @@ void app_pb_pressed_callback(uint32_t status, void *arg)
 {
     if (status == BSP_STATUS_OK)
     {
-        app_pb_pressed = !app_pb_pressed;
+        bsp_task_signal(&app_pb_task, APP_SIGNAL_PB_PRESSED);
     }
     else
     {
@@ -63,108 +203,389 @@ void app_pb_pressed_callback(uint32_t status, void *arg)
     return;
 }
 
-void app_timeout_callback(uint32_t status, void *arg)
+void app_getchar_callback(uint32_t status, void *arg)
 {
-    app_timeout = true;
+    bsp_task_signal(&app_console_task, APP_SIGNAL_GETCHAR);
 
     return;
 }
 
-void app_getchar_callback(uint32_t status, void *arg)
+void app_adc_block_callback(uint32_t status, void *arg)
 {
-    app_getchar = true;
+    const uint16_t *block = bsp_adc_stream_block();
+    uint32_t sum[APP_ADC_CHANNELS] = {0};
+
+    if ((status != BSP_STATUS_OK) || (block == NULL))
+    {
+        bsp_task_signal(&app_adc_task, APP_SIGNAL_ADC_FAIL);
+        return;
+    }
+
+    // Reduce the block here, while DMA fills the other one
+    for (uint32_t i = 0; i < (APP_ADC_BLOCK_SCANS * APP_ADC_CHANNELS); i += APP_ADC_CHANNELS)
+    {
+        for (uint32_t ch = 0; ch < APP_ADC_CHANNELS; ch++)
+        {
+            sum[ch] += block[i + ch];
+        }
+    }
+    for (uint32_t ch = 0; ch < APP_ADC_CHANNELS; ch++)
+    {
+        app_adc_sum[ch] = sum[ch];
+    }
+    bsp_task_signal(&app_adc_task, APP_SIGNAL_ADC_BLOCK);
 
     return;
 }
 
-/***********************************************************************************************************************
- * API FUNCTIONS
- **********************************************************************************************************************/
-
-int main(void)
+void app_spi_xfer_callback(uint32_t status, void *arg)
 {
-    int ret_val = 0;
+    uint8_t *rx = arg;
 
-    bsp_init();
-    bsp_register_user_pb_cb(app_pb_pressed_callback, NULL);
-    bsp_register_getchar_cb(app_getchar_callback, NULL);
-    bsp_set_timer(500, app_timeout_callback, NULL);
-    printf("\n\rHello world!\n\r");
+    if ((status != BSP_STATUS_OK) || (memcmp(rx, app_spi_tx, APP_SPI_XFER_BYTES) != 0))
+    {
+        app_spi_bad++;
+    }
 
-    while (1)
+    // The next transfer is already running, so refilling the queue here keeps the bus busy without main()
+    if ((app_spi_queued < APP_SPI_XFERS) &&
+        (bsp_spi_transfer_async(&app_spi_dev, app_spi_tx, rx, APP_SPI_XFER_BYTES, app_spi_xfer_callback, rx) ==
+         BSP_STATUS_OK))
     {
-        bool temp_bool;
+        app_spi_queued++;
+    }
 
-        __disable_irq();
-        temp_bool = app_pb_pressed;
-        __enable_irq();
+    if (++app_spi_done == app_spi_queued)
+    {
+        bsp_task_signal(&app_spi_task, APP_SIGNAL_SPI_DONE);
+    }
+
+    return;
+}
 
-        if (temp_bool)
+static void app_spi_test(void)
+{
+    if (app_spi_done != app_spi_queued)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < APP_SPI_XFER_BYTES; i++)
+    {
+        app_spi_tx[i] = (uint8_t) (i * 7);
+    }
+    app_spi_done = 0;
+    app_spi_bad = 0;
+    app_spi_start_ms = HAL_GetTick();
+
+    // Counted up front, as the callbacks requeue from the first completion on; with the queue empty, only the first
+    // transfer can be refused here, as it is the only one started at once
+    app_spi_queued = BSP_SPI_QUEUE_LEN;
+    for (uint32_t slot = 0; slot < BSP_SPI_QUEUE_LEN; slot++)
+    {
+        if (bsp_spi_transfer_async(&app_spi_dev, app_spi_tx, app_spi_rx[slot], APP_SPI_XFER_BYTES,
+                                   app_spi_xfer_callback, app_spi_rx[slot]) != BSP_STATUS_OK)
         {
-            app_pb_pressed = false;
+            app_spi_queued = 0;
+            bsp_log("\r\nSPI test failed to start\r\n");
+            break;
+        }
+    }
 
-            app_state++;
-            app_state %= APP_STATE_MAX;
+    return;
+}
 
-            switch (app_state)
-            {
-                case APP_STATE_BLINK_LONG_ON:
-                    break;
+void app_i2c_job_callback(uint32_t status, void *arg)
+{
+    app_i2c_status = status;
+    bsp_task_signal(&app_i2c_task, APP_SIGNAL_I2C_DONE);
 
-                case APP_STATE_BLINK_LONG_OFF:
-                    break;
+    return;
+}
 
-                default:
-                    break;
-            }
-        }
+static void app_i2c_test(void)
+{
+    if (bsp_i2c_pending(BSP_I2C_BUS_1) != 0)
+    {
+        return;
+    }
 
-        __disable_irq();
-        temp_bool = app_getchar;
-        __enable_irq();
+    for (uint32_t i = 0; i < APP_I2C_SCRATCH_LEN; i++)
+    {
+        app_i2c_tx[i] = (uint8_t) (app_i2c_tx[i] + i + 1);
+    }
+    memset(app_i2c_rx, 0, sizeof(app_i2c_rx));
+    app_i2c_who_am_i = 0;
+    app_i2c_start_ms = HAL_GetTick();
+
+    if (bsp_i2c_batch_async(&app_i2c_dev, app_i2c_ops, sizeof(app_i2c_ops) / sizeof(app_i2c_ops[0]),
+                            app_i2c_job_callback, NULL) != BSP_STATUS_OK)
+    {
+        bsp_log("\r\nI2C test failed to start\r\n");
+    }
+
+    return;
+}
+
+/**
+ * Count this boot in the store, timing how long the previous count takes to load
+ *
+ */
+static void app_kv_count_boot(void)
+{
+    uint32_t start = bsp_cycles_now();
+
+    if (bsp_kv_get(APP_KV_BOOTS_KEY, &app_kv_boots, sizeof(app_kv_boots), NULL) != BSP_STATUS_OK)
+    {
+        app_kv_boots = 0;
+    }
+    app_kv_load_cycles = bsp_cycles_now() - start;
+
+    app_kv_boots++;
+    bsp_kv_set(APP_KV_BOOTS_KEY, &app_kv_boots, sizeof(app_kv_boots));
+
+    return;
+}
+
+static void app_kv_test(void)
+{
+    static uint8_t settings[APP_KV_SETTINGS_LEN];
+    bsp_kv_stats_t stats;
+    uint32_t start_ms = HAL_GetTick();
+    uint32_t failed = 0;
 
-        if (temp_bool)
+    for (uint32_t i = 0; i < APP_KV_WRITES; i++)
+    {
+        settings[i % APP_KV_SETTINGS_LEN]++;
+        if (bsp_kv_set(APP_KV_SETTINGS_KEY + (i % APP_KV_SETTINGS_KEYS), settings, sizeof(settings)) !=
+            BSP_STATUS_OK)
         {
-            app_getchar = false;
-            printf("%c", getchar());
+            failed++;
         }
+    }
 
-        __disable_irq();
-        temp_bool = app_timeout;
-        __enable_irq();
+    bsp_kv_get_stats(&stats);
+    bsp_log("\r\nKV %u writes in %lu ms, %lu failed\r\n", APP_KV_WRITES, (unsigned long) (HAL_GetTick() - start_ms),
+            (unsigned long) failed);
+    bsp_log("KV keys %lu, live %lu of %lu bytes, head free %lu, compactions %lu (%lu in a write), copies %lu\r\n",
+            (unsigned long) stats.keys, (unsigned long) stats.live_bytes, (unsigned long) stats.live_max,
+            (unsigned long) stats.head_free, (unsigned long) stats.compactions, (unsigned long) stats.foreground,
+            (unsigned long) stats.copies);
 
-        if (temp_bool)
-        {
-            uint32_t timer_delay_ms;
-            app_timeout = false;
+    return;
+}
+
+static void app_adc_toggle(void)
+{
+    static const bsp_adc_stream_t stream =
+    {
+        .channels = app_adc_channels,
+        .channel_count = APP_ADC_CHANNELS,
+        .scan_rate_hz = APP_ADC_SCAN_RATE_HZ,
+        .buffer = app_adc_buffer,
+        .block_scans = APP_ADC_BLOCK_SCANS,
+        .cb = app_adc_block_callback,
+        .cb_arg = NULL,
+    };
+
+    if (app_adc_streaming)
+    {
+        bsp_adc_stream_stop();
+        app_adc_streaming = false;
+        bsp_log("\r\nADC stream stopped\r\n");
+    }
+    else if (bsp_adc_stream_start(&stream) == BSP_STATUS_OK)
+    {
+        app_adc_streaming = true;
+    }
+    else
+    {
+        bsp_log("\r\nADC stream failed to start\r\n");
+    }
+
+    return;
+}
+
+static uint32_t app_pb_task_fn(bsp_task_t *task, void *arg)
+{
+    BSP_TASK_BEGIN(task);
+
+    // LD2 is then driven by the pattern engine alone; nothing here runs again until the button is pressed
+    BSP_TASK_DELAY_MS(task, APP_LD2_FIRST_DELAY_MS);
+    bsp_led_play(&app_ld2_patterns[app_state]);
+
+    while (1)
+    {
+        BSP_TASK_WAIT_SIGNAL(task, APP_SIGNAL_PB_PRESSED);
 
-            if (app_ld2_state_on)
+        app_state++;
+        app_state %= APP_STATE_MAX;
+
+        bsp_led_play(&app_ld2_patterns[app_state]);
+    }
+
+    BSP_TASK_END(task);
+}
+
+static uint32_t app_console_task_fn(bsp_task_t *task, void *arg)
+{
+    BSP_TASK_BEGIN(task);
+
+    printf("\r\nHello world!\r\n");
+    printf("Boot %lu, count loaded in %lu us\r\n", (unsigned long) app_kv_boots,
+           (unsigned long) bsp_cycles_to_us(app_kv_load_cycles));
+
+    while (1)
+    {
+        int ch;
+
+        BSP_TASK_WAIT_SIGNAL(task, APP_SIGNAL_GETCHAR);
+
+        // Received data is published in bursts, so echo everything that is pending
+        while ((ch = getchar()) != EOF)
+        {
+#if BSP_IRQ_PROF
+            if (ch == APP_IRQ_PROF_DUMP_CHAR)
             {
-                bsp_set_gpio(BSP_GPIO_ID_LD2, BSP_GPIO_HIGH);
-                if (app_state == APP_STATE_BLINK_LONG_ON)
-                {
-                    timer_delay_ms = APP_LD2_LONG_DELAY_MS;
-                }
-                else
-                {
-                    timer_delay_ms = APP_LD2_SHORT_DELAY_MS;
-                }
+                bsp_irq_prof_dump();
+                continue;
             }
-            else
+#endif
+            if (ch == APP_ADC_TOGGLE_CHAR)
             {
-                bsp_set_gpio(BSP_GPIO_ID_LD2, BSP_GPIO_LOW);
-                if (app_state == APP_STATE_BLINK_LONG_ON)
-                {
-                    timer_delay_ms = APP_LD2_SHORT_DELAY_MS;
-                }
-                else
-                {
-                    timer_delay_ms = APP_LD2_LONG_DELAY_MS;
-                }
+                app_adc_toggle();
+                continue;
             }
+            if (ch == APP_SPI_TEST_CHAR)
+            {
+                app_spi_test();
+                continue;
+            }
+            if (ch == APP_I2C_TEST_CHAR)
+            {
+                app_i2c_test();
+                continue;
+            }
+            if (ch == APP_KV_TEST_CHAR)
+            {
+                app_kv_test();
+                continue;
+            }
+            bsp_log("%c", ch);
+        }
+        clearerr(stdin);
+    }
+
+    BSP_TASK_END(task);
+}
+
+static uint32_t app_adc_task_fn(bsp_task_t *task, void *arg)
+{
+    BSP_TASK_BEGIN(task);
 
-            bsp_set_timer(timer_delay_ms, app_timeout_callback, NULL);
-            app_ld2_state_on = !app_ld2_state_on;
+    while (1)
+    {
+        uint32_t vref_raw;
+        uint32_t temp_raw;
+        uint32_t vdda_mv;
+        int32_t temp_mv;
+
+        BSP_TASK_WAIT_SIGNAL(task, APP_SIGNAL_ADC_BLOCK | APP_SIGNAL_ADC_FAIL);
+
+        if ((task->received & APP_SIGNAL_ADC_FAIL) != 0)
+        {
+            app_adc_streaming = false;
+            bsp_log("\r\nADC stream overrun\r\n");
+            continue;
+        }
+
+        vref_raw = (app_adc_sum[0] + (APP_ADC_BLOCK_SCANS / 2)) / APP_ADC_BLOCK_SCANS;
+        temp_raw = (app_adc_sum[1] + (APP_ADC_BLOCK_SCANS / 2)) / APP_ADC_BLOCK_SCANS;
+        if (vref_raw == 0)
+        {
+            continue;
+        }
+
+        // VREFINT gives VDDA, the reference of every other conversion
+        vdda_mv = (APP_ADC_VREFINT_MV * BSP_ADC_FULL_SCALE) / vref_raw;
+        temp_mv = (int32_t) ((temp_raw * vdda_mv) / BSP_ADC_FULL_SCALE);
+        bsp_log("VDDA %lu mV, %ld deci-C\r\n", (unsigned long) vdda_mv,
+                (long) (((temp_mv - APP_ADC_TEMP_V25_MV) * APP_ADC_TEMP_DECI_C_PER_MV) + 250));
+    }
+
+    BSP_TASK_END(task);
+}
+
+static uint32_t app_spi_task_fn(bsp_task_t *task, void *arg)
+{
+    BSP_TASK_BEGIN(task);
+
+    while (1)
+    {
+        uint32_t elapsed_ms;
+        uint32_t bytes;
+
+        BSP_TASK_WAIT_SIGNAL(task, APP_SIGNAL_SPI_DONE);
+
+        elapsed_ms = HAL_GetTick() - app_spi_start_ms;
+        bytes = app_spi_done * APP_SPI_XFER_BYTES;
+        bsp_log("\r\nSPI %lu bytes in %lu ms, %lu kB/s, %lu bad\r\n", (unsigned long) bytes,
+                (unsigned long) elapsed_ms, (unsigned long) ((elapsed_ms != 0) ? (bytes / elapsed_ms) : 0),
+                (unsigned long) app_spi_bad);
+    }
+
+    BSP_TASK_END(task);
+}
+
+static uint32_t app_i2c_task_fn(bsp_task_t *task, void *arg)
+{
+    BSP_TASK_BEGIN(task);
+
+    while (1)
+    {
+        bsp_i2c_stats_t stats;
+
+        BSP_TASK_WAIT_SIGNAL(task, APP_SIGNAL_I2C_DONE);
+
+        bsp_i2c_get_stats(BSP_I2C_BUS_1, &stats);
+        bsp_log("\r\nI2C %s in %lu ms, WHO_AM_I 0x%02x, readback %s\r\n",
+                (app_i2c_status == BSP_STATUS_OK) ? "ok" : "failed",
+                (unsigned long) (HAL_GetTick() - app_i2c_start_ms), (unsigned) app_i2c_who_am_i,
+                (memcmp(app_i2c_rx, app_i2c_tx, APP_I2C_SCRATCH_LEN) == 0) ? "matches" : "differs");
+        bsp_log("I2C1 jobs %lu, failed %lu, nacks %lu, timeouts %lu, recoveries %lu\r\n",
+                (unsigned long) stats.jobs, (unsigned long) stats.failed, (unsigned long) stats.nacks,
+                (unsigned long) stats.timeouts, (unsigned long) stats.recoveries);
+    }
+
+    BSP_TASK_END(task);
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+
+int main(void)
+{
+    int ret_val = 0;
+
+    bsp_init();
+    app_kv_count_boot();
+    bsp_led_fill_breathe(app_ld2_breathe_duty, APP_LD2_BREATHE_STEPS, APP_LD2_BREATHE_PERIOD_US);
+    bsp_task_create(&app_pb_task, app_pb_task_fn, NULL);
+    bsp_task_create(&app_console_task, app_console_task_fn, NULL);
+    bsp_task_create(&app_adc_task, app_adc_task_fn, NULL);
+    bsp_task_create(&app_spi_task, app_spi_task_fn, NULL);
+    bsp_task_create(&app_i2c_task, app_i2c_task_fn, NULL);
+    bsp_spi_dev_init(&app_spi_dev, BSP_PIN_PORT(SPI_CS), BSP_PIN_MASK(SPI_CS), APP_SPI_HZ, 0);
+    bsp_i2c_dev_init(&app_i2c_dev, BSP_I2C_BUS_1, APP_I2C_ADDR, 1);
+    bsp_register_user_pb_cb(app_pb_pressed_callback, NULL);
+    bsp_register_getchar_cb(app_getchar_callback, NULL);
+
+    while (1)
+    {
+        // Drain every pending event, highest priority first, before sleeping
+        while (bsp_event_dispatch())
+        {
         }
 
         bsp_sleep();
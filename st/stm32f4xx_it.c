@@ -19,6 +19,8 @@
  * INCLUDES
  **********************************************************************************************************************/
 #include "stm32f4xx_hal.h"
+#include "bsp_irq_prof.h"
+#include "bsp_internal.h"
 #ifdef USE_CMSIS_OS
 #include "cmsis_os.h"
 #endif
@@ -34,41 +36,218 @@
 /***********************************************************************************************************************
  * GLOBAL VARIABLES
  **********************************************************************************************************************/
-extern TIM_HandleTypeDef tim_drv_handle;
+extern TIM_HandleTypeDef tick_tim_handle;
 extern EXTI_HandleTypeDef exti_user_pb_handle;
 extern UART_HandleTypeDef uart_drv_handle;
+extern DMA_HandleTypeDef uart_tx_dma_handle;
+extern DMA_HandleTypeDef uart_rx_dma_handle;
+extern RTC_HandleTypeDef rtc_drv_handle;
+extern ADC_HandleTypeDef adc_drv_handle;
+extern DMA_HandleTypeDef adc_dma_handle;
+extern SPI_HandleTypeDef spi_drv_handle;
+extern DMA_HandleTypeDef spi_rx_dma_handle;
+extern DMA_HandleTypeDef spi_tx_dma_handle;
+extern I2C_HandleTypeDef i2c1_drv_handle;
+extern I2C_HandleTypeDef i2c3_drv_handle;
+extern DMA_HandleTypeDef i2c1_rx_dma_handle;
+extern DMA_HandleTypeDef i2c3_rx_dma_handle;
 
 /***********************************************************************************************************************
  * API FUNCTIONS
  **********************************************************************************************************************/
-
-void SysTick_Handler(void)
+void TIM5_IRQHandler(void)
 {
-    HAL_IncTick();
+    BSP_IRQ_PROF_ENTER(bsp_irq_prof_tim5_latency());
 
-    return;
-}
+    HAL_TIM_IRQHandler(&tick_tim_handle);
 
-void TIM2_IRQHandler(void)
-{
-    HAL_TIM_IRQHandler(&tim_drv_handle);
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_TIM5);
 
     return;
 }
 
 void EXTI15_10_IRQHandler(void)
 {
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
     if (HAL_EXTI_GetPending(&exti_user_pb_handle, EXTI_TRIGGER_FALLING))
     {
         HAL_EXTI_IRQHandler(&exti_user_pb_handle);
     }
 
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_EXTI15_10);
+
     return;
 }
 
 void USART2_IRQHandler(void)
 {
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
+    // TXE and TC sit at the same bit positions as their interrupt enables in CR1
+    if ((uart_drv_handle.Instance->SR & uart_drv_handle.Instance->CR1 & (USART_SR_TXE | USART_SR_TC)) != 0)
+    {
+        bsp_uart_count_tx_irq();
+    }
+
     HAL_UART_IRQHandler(&uart_drv_handle);
 
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_USART2);
+
+    return;
+}
+
+void DMA1_Stream5_IRQHandler(void)
+{
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
+    HAL_DMA_IRQHandler(&uart_rx_dma_handle);
+
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_DMA1_STREAM5);
+
+    return;
+}
+
+void DMA1_Stream6_IRQHandler(void)
+{
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
+    bsp_uart_count_tx_irq();
+    HAL_DMA_IRQHandler(&uart_tx_dma_handle);
+
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_DMA1_STREAM6);
+
     return;
-}
\ No newline at end of file
+}
+
+void DMA2_Stream4_IRQHandler(void)
+{
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
+    HAL_DMA_IRQHandler(&adc_dma_handle);
+
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_DMA2_STREAM4);
+
+    return;
+}
+
+void DMA2_Stream2_IRQHandler(void)
+{
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
+    HAL_DMA_IRQHandler(&spi_rx_dma_handle);
+
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_DMA2_STREAM2);
+
+    return;
+}
+
+void DMA2_Stream3_IRQHandler(void)
+{
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
+    HAL_DMA_IRQHandler(&spi_tx_dma_handle);
+
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_DMA2_STREAM3);
+
+    return;
+}
+
+void SPI1_IRQHandler(void)
+{
+    // Only errors are enabled, which fail the transfer in progress
+    HAL_SPI_IRQHandler(&spi_drv_handle);
+
+    return;
+}
+
+void DMA1_Stream0_IRQHandler(void)
+{
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
+    HAL_DMA_IRQHandler(&i2c1_rx_dma_handle);
+
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_DMA1_STREAM0);
+
+    return;
+}
+
+void DMA1_Stream2_IRQHandler(void)
+{
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
+    HAL_DMA_IRQHandler(&i2c3_rx_dma_handle);
+
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_DMA1_STREAM2);
+
+    return;
+}
+
+void I2C1_EV_IRQHandler(void)
+{
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
+    HAL_I2C_EV_IRQHandler(&i2c1_drv_handle);
+    bsp_i2c_ev_irq(&i2c1_drv_handle);
+
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_I2C1_EV);
+
+    return;
+}
+
+void I2C1_ER_IRQHandler(void)
+{
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
+    HAL_I2C_ER_IRQHandler(&i2c1_drv_handle);
+
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_I2C1_ER);
+
+    return;
+}
+
+void I2C3_EV_IRQHandler(void)
+{
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
+    HAL_I2C_EV_IRQHandler(&i2c3_drv_handle);
+    bsp_i2c_ev_irq(&i2c3_drv_handle);
+
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_I2C3_EV);
+
+    return;
+}
+
+void I2C3_ER_IRQHandler(void)
+{
+    BSP_IRQ_PROF_ENTER(BSP_IRQ_PROF_NO_LATENCY);
+
+    HAL_I2C_ER_IRQHandler(&i2c3_drv_handle);
+
+    BSP_IRQ_PROF_EXIT(BSP_IRQ_PROF_ID_I2C3_ER);
+
+    return;
+}
+
+void ADC_IRQHandler(void)
+{
+    // Only overrun is enabled, which ends the stream
+    HAL_ADC_IRQHandler(&adc_drv_handle);
+
+    return;
+}
+
+void RTC_WKUP_IRQHandler(void)
+{
+    HAL_RTCEx_WakeUpTimerIRQHandler(&rtc_drv_handle);
+
+    return;
+}
+
+void EXTI3_IRQHandler(void)
+{
+    // Only unmasked as a STOP wake-up source for USART2 RX, which is handled before interrupts are re-enabled
+    HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_3);
+
+    return;
+}
@@ -49,6 +49,7 @@
 /* Includes */
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <errno.h>
 #include <stdio.h>
 #include <signal.h>
@@ -62,6 +63,7 @@
 extern int errno;
 extern int __io_getchar(void);
 extern int __io_putchar(int ch);
+extern size_t bsp_uart_write(const uint8_t *buf, size_t len);
 
 register char * stack_ptr asm("sp");
 
@@ -121,24 +123,11 @@ int _read(int file, char *ptr, int len)
 
 int _write(int file, char *ptr, int len)
 {
-    int ret = 0;
-    int i = 0;
+    // Anything not queued was discarded by the BSP's TX backpressure policy and counted there, so report the whole
+    // buffer as written rather than have stdio retry it
+    bsp_uart_write((const uint8_t *) ptr, (size_t) len);
 
-    for (i = 0; i < len; i++)
-    {
-        ret = __io_putchar(*ptr++);
-        if (ret == EOF)
-        {
-            break;
-        }
-    }
-
-    if (ret != EOF)
-    {
-        ret = i;
-    }
-
-    return ret;
+    return len;
 }
 
 int _close(int file)
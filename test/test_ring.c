@@ -0,0 +1,285 @@
+/**
+ * @file test_ring.c
+ *
+ * @brief Host unit test of the bsp_ring.h single-producer/single-consumer ring buffer
+ *
+ * Built and run natively by 'make host-test'.  Each case starts its ring at chosen head/tail values so the free-running
+ * counters and the buffer offsets are where the case needs them, then checks the producer and consumer sides against
+ * each other.  Exits non-zero if any check fails.
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+/***********************************************************************************************************************
+ * INCLUDES
+ **********************************************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bsp_ring.h"
+
+/***********************************************************************************************************************
+ * LOCAL LITERAL SUBSTITUTIONS
+ **********************************************************************************************************************/
+#define TEST_RING_SIZE              (16)
+
+// Records a failed check with its line and carries on with the case
+#define TEST_CHECK(cond)            test_check((cond), #cond, __LINE__)
+
+/***********************************************************************************************************************
+ * LOCAL VARIABLES
+ **********************************************************************************************************************/
+static uint8_t test_buffer[TEST_RING_SIZE];
+static uint32_t test_checks = 0;
+static uint32_t test_failures = 0;
+
+/***********************************************************************************************************************
+ * GLOBAL VARIABLES
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * LOCAL FUNCTIONS
+ **********************************************************************************************************************/
+static void test_check(bool cond, const char *text, int line)
+{
+    test_checks++;
+    if (!cond)
+    {
+        test_failures++;
+        printf("FAIL test_ring.c:%d: %s\n", line, text);
+    }
+
+    return;
+}
+
+/**
+ * Set up the ring empty with both counters at start
+ *
+ * The buffer is filled with a pattern no case writes, so stale bytes show up as mismatches.
+ *
+ */
+static void test_ring_at(bsp_ring_t *ring, uint32_t start)
+{
+    TEST_CHECK(bsp_ring_init(ring, test_buffer, TEST_RING_SIZE));
+    memset(test_buffer, 0xEE, sizeof(test_buffer));
+    ring->head = start;
+    ring->tail = start;
+
+    return;
+}
+
+/**
+ * Single-byte push/pop across the 2^32 wrap of head and tail
+ *
+ */
+static void test_counter_wrap(void)
+{
+    bsp_ring_t ring;
+    uint8_t byte;
+    uint32_t i;
+
+    test_ring_at(&ring, UINT32_MAX - 5);
+
+    // Fill it so head wraps past zero while tail has not
+    for (i = 0; i < TEST_RING_SIZE; i++)
+    {
+        TEST_CHECK(bsp_ring_push(&ring, (uint8_t) i));
+    }
+    TEST_CHECK(ring.head < ring.tail);
+    TEST_CHECK(bsp_ring_level(&ring) == TEST_RING_SIZE);
+    TEST_CHECK(bsp_ring_space(&ring) == 0);
+    TEST_CHECK(!bsp_ring_push(&ring, 0xAA));
+
+    // Drain and refill in steps so every offset is used on both sides of the wrap
+    for (i = 0; i < (4 * TEST_RING_SIZE); i++)
+    {
+        TEST_CHECK(bsp_ring_pop(&ring, &byte));
+        TEST_CHECK(byte == (uint8_t) i);
+        TEST_CHECK(bsp_ring_push(&ring, (uint8_t) (i + TEST_RING_SIZE)));
+        TEST_CHECK(bsp_ring_level(&ring) == TEST_RING_SIZE);
+    }
+    for (i = 0; i < TEST_RING_SIZE; i++)
+    {
+        TEST_CHECK(bsp_ring_pop(&ring, &byte));
+        TEST_CHECK(byte == (uint8_t) ((4 * TEST_RING_SIZE) + i));
+    }
+    TEST_CHECK(!bsp_ring_pop(&ring, &byte));
+    TEST_CHECK(bsp_ring_level(&ring) == 0);
+    TEST_CHECK(bsp_ring_space(&ring) == TEST_RING_SIZE);
+    TEST_CHECK(ring.dropped == 0);
+
+    return;
+}
+
+/**
+ * bsp_ring_write()/bsp_ring_read() split across the end of the buffer, and clipped to the space or level
+ *
+ */
+static void test_bulk_split(void)
+{
+    bsp_ring_t ring;
+    uint8_t in[2 * TEST_RING_SIZE];
+    uint8_t out[2 * TEST_RING_SIZE];
+    uint32_t i;
+
+    for (i = 0; i < sizeof(in); i++)
+    {
+        in[i] = (uint8_t) (0x40 + i);
+    }
+
+    // Offset 10: 6 bytes to the end of the buffer and 6 more from its start
+    test_ring_at(&ring, 10);
+    TEST_CHECK(bsp_ring_write(&ring, in, 12) == 12);
+    TEST_CHECK(memcmp(&test_buffer[10], &in[0], 6) == 0);
+    TEST_CHECK(memcmp(&test_buffer[0], &in[6], 6) == 0);
+    memset(out, 0, sizeof(out));
+    TEST_CHECK(bsp_ring_read(&ring, out, 12) == 12);
+    TEST_CHECK(memcmp(out, in, 12) == 0);
+    TEST_CHECK(bsp_ring_level(&ring) == 0);
+
+    // Asking for more than fits writes only the space, and reading more than is there reads only the level
+    test_ring_at(&ring, UINT32_MAX - 2);
+    TEST_CHECK(bsp_ring_write(&ring, in, 5) == 5);
+    TEST_CHECK(bsp_ring_write(&ring, &in[5], sizeof(in)) == (TEST_RING_SIZE - 5));
+    TEST_CHECK(bsp_ring_write(&ring, in, 1) == 0);
+    memset(out, 0, sizeof(out));
+    TEST_CHECK(bsp_ring_read(&ring, out, 7) == 7);
+    TEST_CHECK(bsp_ring_read(&ring, &out[7], sizeof(out)) == (TEST_RING_SIZE - 7));
+    TEST_CHECK(memcmp(out, in, TEST_RING_SIZE) == 0);
+    TEST_CHECK(bsp_ring_read(&ring, out, 1) == 0);
+
+    return;
+}
+
+/**
+ * Span sizes from bsp_ring_reserve_contiguous() and bsp_ring_peek_contiguous()
+ *
+ */
+static void test_contiguous_spans(void)
+{
+    bsp_ring_t ring;
+    uint8_t *span;
+
+    // Empty at offset 12: the producer gets up to the end of the buffer, the consumer nothing
+    test_ring_at(&ring, 12);
+    TEST_CHECK(bsp_ring_reserve_contiguous(&ring, &span) == 4);
+    TEST_CHECK(span == &test_buffer[12]);
+    TEST_CHECK(bsp_ring_peek_contiguous(&ring, &span) == 0);
+    TEST_CHECK(span == &test_buffer[12]);
+    memset(span, 0x11, 4);
+    bsp_ring_commit(&ring, 4);
+
+    // Producer at offset 0 gets what is left before the tail; consumer still stops at the end of the buffer
+    TEST_CHECK(bsp_ring_reserve_contiguous(&ring, &span) == 12);
+    TEST_CHECK(span == &test_buffer[0]);
+    memset(span, 0x22, 10);
+    bsp_ring_commit(&ring, 10);
+    TEST_CHECK(bsp_ring_reserve_contiguous(&ring, &span) == 2);
+    TEST_CHECK(span == &test_buffer[10]);
+    TEST_CHECK(bsp_ring_peek_contiguous(&ring, &span) == 4);
+    TEST_CHECK((span == &test_buffer[12]) && (span[0] == 0x11) && (span[3] == 0x11));
+
+    // A partial consume moves the span start up, a full one moves the consumer to offset 0
+    bsp_ring_consume(&ring, 1);
+    TEST_CHECK(bsp_ring_peek_contiguous(&ring, &span) == 3);
+    TEST_CHECK(span == &test_buffer[13]);
+    bsp_ring_consume(&ring, 3);
+    TEST_CHECK(bsp_ring_peek_contiguous(&ring, &span) == 10);
+    TEST_CHECK((span == &test_buffer[0]) && (span[0] == 0x22) && (span[9] == 0x22));
+
+    // Retracting withdraws committed bytes the consumer has not seen
+    bsp_ring_retract(&ring, 4);
+    TEST_CHECK(bsp_ring_peek_contiguous(&ring, &span) == 6);
+    TEST_CHECK(bsp_ring_reserve_contiguous(&ring, &span) == 10);
+    TEST_CHECK(span == &test_buffer[6]);
+    bsp_ring_consume(&ring, 6);
+
+    // Full: neither side's span reaches past the other
+    test_ring_at(&ring, 5);
+    bsp_ring_commit(&ring, TEST_RING_SIZE);
+    TEST_CHECK(bsp_ring_reserve_contiguous(&ring, &span) == 0);
+    TEST_CHECK(bsp_ring_peek_contiguous(&ring, &span) == (TEST_RING_SIZE - 5));
+    TEST_CHECK(span == &test_buffer[5]);
+
+    return;
+}
+
+/**
+ * Producer committing past the consumer, as circular DMA does
+ *
+ */
+static void test_lapped_consumer(void)
+{
+    bsp_ring_t ring;
+    uint8_t out[TEST_RING_SIZE];
+    uint8_t *span;
+    uint8_t byte;
+    uint32_t i;
+
+    // 26 bytes committed into 16 across the counter wrap: the oldest 10 are lost
+    test_ring_at(&ring, UINT32_MAX - 3);
+    for (i = 0; i < (TEST_RING_SIZE + 10); i++)
+    {
+        test_buffer[ring.head & ring.mask] = (uint8_t) i;
+        bsp_ring_commit(&ring, 1);
+    }
+    TEST_CHECK(bsp_ring_level(&ring) == TEST_RING_SIZE);
+    TEST_CHECK(bsp_ring_space(&ring) == 0);
+    TEST_CHECK(ring.dropped == 0);
+
+    // The consumer's first access skips to the newest 16 bytes and counts the rest
+    TEST_CHECK(bsp_ring_pop(&ring, &byte));
+    TEST_CHECK(byte == 10);
+    TEST_CHECK(ring.dropped == 10);
+    for (i = 11; i < (TEST_RING_SIZE + 10); i++)
+    {
+        TEST_CHECK(bsp_ring_pop(&ring, &byte));
+        TEST_CHECK(byte == (uint8_t) i);
+    }
+    TEST_CHECK(!bsp_ring_pop(&ring, &byte));
+    TEST_CHECK(ring.dropped == 10);
+
+    // Lapped again by a whole buffer and 3 more, seen through a span and a bulk read; dropped accumulates
+    for (i = 0; i < ((2 * TEST_RING_SIZE) + 3); i++)
+    {
+        test_buffer[ring.head & ring.mask] = (uint8_t) (0x80 + i);
+        bsp_ring_commit(&ring, 1);
+    }
+    TEST_CHECK(bsp_ring_peek_contiguous(&ring, &span) > 0);
+    TEST_CHECK(span[0] == (uint8_t) (0x80 + TEST_RING_SIZE + 3));
+    TEST_CHECK(ring.dropped == (10 + TEST_RING_SIZE + 3));
+    TEST_CHECK(bsp_ring_read(&ring, out, sizeof(out)) == TEST_RING_SIZE);
+    for (i = 0; i < TEST_RING_SIZE; i++)
+    {
+        TEST_CHECK(out[i] == (uint8_t) (0x80 + TEST_RING_SIZE + 3 + i));
+    }
+    TEST_CHECK(bsp_ring_level(&ring) == 0);
+    TEST_CHECK(ring.dropped == (10 + TEST_RING_SIZE + 3));
+
+    return;
+}
+
+/***********************************************************************************************************************
+ * API FUNCTIONS
+ **********************************************************************************************************************/
+int main(void)
+{
+    test_counter_wrap();
+    test_bulk_split();
+    test_contiguous_spans();
+    test_lapped_consumer();
+
+    printf("test_ring: %lu checks, %lu failed\n", (unsigned long) test_checks, (unsigned long) test_failures);
+
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
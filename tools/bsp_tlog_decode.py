@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+#
+# @file bsp_tlog_decode.py
+#
+# @brief Render a console capture containing BSP_TLOG() frames as text, using the format strings in the ELF file
+#
+# Usage:
+#      bsp_tlog_decode.py build/stm32f401re_hello.elf [capture]
+#
+# The capture is read from a file, a serial device or, when omitted, stdin, and is decoded as it arrives.  Bytes
+# outside frames are passed through unchanged.  The frame format is described in bsp_tlog.h.  Only the Python 3
+# standard library is needed.
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import re
+import struct
+import sys
+
+FRAME_MARKER = 0x1E
+SECTION_NAME = b'.bsp_tlog'
+
+CONVERSION = re.compile(rb'%([-+ 0#]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|z|j|t|L)?([diouxXcspfFeEgG%])')
+
+
+class FrameError(Exception):
+    pass
+
+
+def load_formats(elf_path):
+    """Return the .bsp_tlog section contents, its address and the width in bits of long, from an ELF file"""
+    with open(elf_path, 'rb') as f:
+        elf = f.read()
+
+    if elf[:4] != b'\x7fELF' or elf[5] != 1:
+        raise SystemExit('%s: not a little endian ELF file' % elf_path)
+
+    if elf[4] == 1:
+        shoff, = struct.unpack_from('<I', elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from('<HHH', elf, 0x2E)
+        section = lambda i: struct.unpack_from('<IIIIII', elf, shoff + i * shentsize)
+        long_bits = 32
+    else:
+        shoff, = struct.unpack_from('<Q', elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from('<HHH', elf, 0x3A)
+        section = lambda i: struct.unpack_from('<IIQQQQ', elf, shoff + i * shentsize)
+        long_bits = 64
+
+    names_offset = section(shstrndx)[4]
+    for i in range(shnum):
+        name, _, _, addr, offset, size = section(i)
+        name_end = elf.index(b'\0', names_offset + name)
+        if elf[names_offset + name:name_end] == SECTION_NAME:
+            return elf[offset:offset + size], addr, long_bits
+
+    # The linker drops the section when nothing uses BSP_TLOG(), so every frame is then unknown
+    return b'', 0, long_bits
+
+
+class Payload:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            if self.pos >= len(self.data):
+                raise FrameError('truncated varint')
+            byte = self.data[self.pos]
+            self.pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if byte < 0x80:
+                return value
+
+    def int(self):
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+    def float(self):
+        if self.pos + 4 > len(self.data):
+            raise FrameError('truncated float')
+        value, = struct.unpack_from('<f', self.data, self.pos)
+        self.pos += 4
+        return value
+
+    def string(self):
+        length = self.varint()
+        if self.pos + length > len(self.data):
+            raise FrameError('truncated string')
+        value = self.data[self.pos:self.pos + length]
+        self.pos += length
+        return value
+
+
+def render(fmt, payload, long_bits):
+    out = bytearray()
+    pos = 0
+
+    for m in CONVERSION.finditer(fmt):
+        flags, width, precision, length, conv = m.groups()
+        out += fmt[pos:m.start()]
+        pos = m.end()
+
+        if conv == b'%':
+            out += b'%'
+            continue
+
+        if width == b'*':
+            width = b'%d' % payload.int()
+        if precision == b'*':
+            precision = b'%d' % payload.int()
+        spec = b'%' + flags + (width or b'') + (b'.' + precision if precision is not None else b'')
+
+        if conv in b'fFeEgG':
+            out += (spec + conv) % payload.float()
+        elif conv == b's':
+            out += (spec + b's') % payload.string()
+        elif conv == b'c':
+            out += (spec + b'c') % (payload.int() & 0xFF)
+        elif conv == b'p':
+            out += (spec + b's') % (b'0x%x' % (payload.int() & ((1 << long_bits) - 1)))
+        else:
+            value = payload.int()
+            if conv in b'ouxX':
+                bits = 64 if length in (b'll', b'j') or (length in (b'l', b'z', b't') and long_bits == 64) else 32
+                value &= (1 << bits) - 1
+            out += (spec + (b'd' if conv in b'iu' else conv)) % value
+
+    out += fmt[pos:]
+    if payload.pos != len(payload.data):
+        raise FrameError('%d bytes left over' % (len(payload.data) - payload.pos))
+
+    return bytes(out)
+
+
+def decode_frame(frame, formats, base, long_bits):
+    payload = Payload(frame)
+    try:
+        offset = payload.varint() - base
+        if offset < 0 or offset >= len(formats):
+            raise FrameError('unknown ID')
+        fmt = formats[offset:formats.index(b'\0', offset)]
+        return render(fmt, payload, long_bits)
+    except FrameError as e:
+        return b'<tlog: %s in frame %s>' % (str(e).encode(), frame.hex().encode())
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        raise SystemExit('usage: %s ELF [capture]' % sys.argv[0])
+
+    formats, base, long_bits = load_formats(sys.argv[1])
+    capture = open(sys.argv[2], 'rb', buffering=0) if len(sys.argv) == 3 else sys.stdin.buffer
+    out = sys.stdout.buffer
+    pending = bytearray()
+
+    while True:
+        chunk = capture.read1(4096) if hasattr(capture, 'read1') else capture.read(4096)
+        if not chunk:
+            break
+        pending += chunk
+
+        while pending:
+            marker = pending.find(FRAME_MARKER)
+            if marker != 0:
+                text = pending if marker < 0 else pending[:marker]
+                out.write(text)
+                del pending[:len(text)]
+                continue
+            if len(pending) < 2 or len(pending) < 2 + pending[1]:
+                break
+            out.write(decode_frame(bytes(pending[2:2 + pending[1]]), formats, base, long_bits))
+            del pending[:2 + pending[1]]
+
+        out.flush()
+
+    out.write(pending)
+    out.flush()
+
+
+if __name__ == '__main__':
+    main()